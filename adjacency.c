@@ -0,0 +1,308 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) Martino Pilia, 2015
+ */
+
+/*!
+ * \file adjacency.c
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "adjacency.h"
+#include "profile.h"
+
+/*!
+ * Arrays longer than this are sorted with qsort() instead of insertion
+ * sort, which is quadratic on the stars of high-valence vertices.
+ */
+#define INSERTION_SORT_MAX 32
+
+/*!
+ * Compare two indices, for qsort().
+ */
+static int compare_indices(const void *a, const void *b)
+{
+    Index x = *(const Index*) a, y = *(const Index*) b;
+
+    return (x > y) - (x < y);
+}
+
+/*!
+ * Sort an array of indices in increasing order. Vertex stars have a
+ * handful of elements, so insertion sort beats qsort() on them.
+ */
+static void sort_indices(Index *a, Index n)
+{
+    Index i, j, x;
+
+    if (n > INSERTION_SORT_MAX)
+    {
+        qsort(a, n, sizeof (Index), compare_indices);
+        return;
+    }
+
+    for (i = 1; i < n; ++i)
+    {
+        x = a[i];
+        for (j = i; j > 0 && a[j - 1] > x; --j)
+            a[j] = a[j - 1];
+        a[j] = x;
+    }
+}
+
+/*!
+ * Build the vertex-to-face lists with a counting sort: the faces of each
+ * vertex are counted in parallel, the counts are turned into offsets with a
+ * prefix sum, then the faces are written in order at the next free slot of
+ * their vertices. The scatter is sequential, so each list comes out sorted
+ * by face, at no extra cost on high-valence vertices.
+ */
+static int build_vertex_faces(Model3D *m, Adjacency *a)
+{
+    Index f, v, c;
+    Index *cursor;
+    int k;
+
+    a->vf_offsets = (Index*) calloc(m->n_vertices + 1, sizeof (Index));
+    a->vf = (Index*) malloc(3 * m->n_faces * sizeof (Index));
+    cursor = (Index*) malloc(m->n_vertices * sizeof (Index));
+    if (a->vf_offsets == NULL || a->vf == NULL || cursor == NULL)
+    {
+        free(cursor);
+        return ERR_NO_MEMORY;
+    }
+
+    #pragma omp parallel for schedule(static) private(k, v)
+    for (f = 0; f < m->n_faces; ++f)
+    {
+        for (k = 0; k < 3; ++k)
+        {
+            v = face_vertex(m, f, k);
+            #pragma omp atomic
+            a->vf_offsets[v + 1]++;
+        }
+    }
+
+    for (v = 0; v < m->n_vertices; ++v)
+    {
+        a->vf_offsets[v + 1] += a->vf_offsets[v];
+        cursor[v] = a->vf_offsets[v];
+    }
+
+    for (c = 0; c < 3 * m->n_faces; ++c)
+        a->vf[cursor[face_vertex(m, c / 3, c % 3)]++] = c / 3;
+
+    free(cursor);
+
+    return 0;
+}
+
+/*!
+ * Collect in s the vertices of the faces incident to v, other than v
+ * itself, sorted and without repetitions. Return their number.
+ */
+static Index gather_neighbours(Model3D *m, Adjacency *a, Index v, Index *s)
+{
+    Index e, u, n = 0, i, j;
+    int k;
+
+    for (e = a->vf_offsets[v]; e < a->vf_offsets[v + 1]; ++e)
+        for (k = 0; k < 3; ++k)
+            if ((u = face_vertex(m, a->vf[e], k)) != v)
+                s[n++] = u;
+
+    sort_indices(s, n);
+
+    for (i = 0, j = 0; i < n; ++i)
+        if (j == 0 || s[i] != s[j - 1])
+            s[j++] = s[i];
+
+    return j;
+}
+
+/*!
+ * Build the vertex-to-vertex lists from the vertex-to-face ones, in two
+ * parallel passes: the first one counts the distinct neighbours of each
+ * vertex, the second one writes them after the prefix sum of the counts.
+ * Each thread uses a scratch buffer large enough for the largest star.
+ */
+static int build_vertex_vertices(Model3D *m, Adjacency *a)
+{
+    Index v, max = 0;
+    int failed = 0;
+
+    a->vv_offsets = (Index*) calloc(m->n_vertices + 1, sizeof (Index));
+    if (a->vv_offsets == NULL)
+        return ERR_NO_MEMORY;
+
+    #pragma omp parallel for schedule(static) reduction(max:max)
+    for (v = 0; v < m->n_vertices; ++v)
+        if (a->vf_offsets[v + 1] - a->vf_offsets[v] > max)
+            max = a->vf_offsets[v + 1] - a->vf_offsets[v];
+
+    #pragma omp parallel
+    {
+        Index *s = (Index*) malloc((3 * max + 1) * sizeof (Index));
+
+        if (s == NULL)
+        {
+            #pragma omp atomic write
+            failed = 1;
+        }
+
+        /* all threads must take the same branch, since each one has to
+         * reach the worksharing loops */
+        #pragma omp barrier
+        if (!failed)
+        {
+            #pragma omp for schedule(dynamic, 4096)
+            for (v = 0; v < m->n_vertices; ++v)
+                a->vv_offsets[v + 1] = gather_neighbours(m, a, v, s);
+
+            #pragma omp single
+            {
+                for (v = 0; v < m->n_vertices; ++v)
+                    a->vv_offsets[v + 1] += a->vv_offsets[v];
+
+                a->vv = (Index*) malloc(
+                        (a->vv_offsets[m->n_vertices] + 1) * sizeof (Index));
+                failed = a->vv == NULL;
+            }
+
+            if (!failed)
+            {
+                #pragma omp for schedule(dynamic, 4096)
+                for (v = 0; v < m->n_vertices; ++v)
+                {
+                    gather_neighbours(m, a, v, s);
+                    memcpy(a->vv + a->vv_offsets[v], s,
+                            (a->vv_offsets[v + 1] - a->vv_offsets[v])
+                            * sizeof (Index));
+                }
+            }
+        }
+
+        free(s);
+    }
+
+    return failed ? ERR_NO_MEMORY : 0;
+}
+
+/*!
+ * Pair each half-edge with the opposite one, searching among the faces
+ * incident to its head vertex.
+ */
+static int build_twins(Model3D *m, Adjacency *a)
+{
+    Index h, f, g, e, va, vb;
+    int k, j;
+
+    a->twin = (Index*) malloc((3 * m->n_faces + 1) * sizeof (Index));
+    if (a->twin == NULL)
+        return ERR_NO_MEMORY;
+
+    #pragma omp parallel for schedule(static) private(f, g, e, va, vb, k, j)
+    for (h = 0; h < 3 * m->n_faces; ++h)
+    {
+        f = h / 3;
+        k = h % 3;
+        va = face_vertex(m, f, k);
+        vb = face_vertex(m, f, (k + 1) % 3);
+        a->twin[h] = -1;
+
+        for (e = a->vf_offsets[vb]; e < a->vf_offsets[vb + 1]; ++e)
+        {
+            g = a->vf[e];
+            for (j = 0; j < 3; ++j)
+                if (g != f
+                        && face_vertex(m, g, j) == vb
+                        && face_vertex(m, g, (j + 1) % 3) == va)
+                    break;
+            if (j < 3)
+            {
+                a->twin[h] = 3 * g + j;
+                break;
+            }
+        }
+    }
+
+    return 0;
+}
+
+/*!
+ * Return the cached structure, or build the vertex-to-face and the
+ * vertex-to-vertex lists and store them in the model.
+ */
+const Adjacency* model_adjacency(Model3D *m)
+{
+    Adjacency *a;
+    double start;
+
+    if (m->adjacency != NULL)
+        return m->adjacency;
+
+    start = profile_clock();
+
+    if (model_build_indices(m))
+        return NULL;
+
+    a = (Adjacency*) calloc(1, sizeof (Adjacency));
+    if (a == NULL)
+        return NULL;
+
+    if (build_vertex_faces(m, a) || build_vertex_vertices(m, a))
+    {
+        adjacency_free(a);
+        return NULL;
+    }
+
+    m->adjacency = a;
+
+    profile_record(PROF_ADJACENCY, start, m->n_vertices, m->n_faces);
+
+    return a;
+}
+
+/*!
+ * Build the connectivity if needed, then add the half-edge twins.
+ */
+const Adjacency* model_halfedges(Model3D *m)
+{
+    if (model_adjacency(m) == NULL)
+        return NULL;
+
+    if (m->adjacency->twin == NULL && build_twins(m, m->adjacency))
+        return NULL;
+
+    return m->adjacency;
+}
+
+/*!
+ * Free all the arrays and the structure.
+ */
+void adjacency_free(Adjacency *a)
+{
+    if (a == NULL)
+        return;
+
+    free(a->vf_offsets);
+    free(a->vf);
+    free(a->vv_offsets);
+    free(a->vv);
+    free(a->twin);
+    free(a);
+}
@@ -0,0 +1,77 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) Martino Pilia, 2015
+ */
+
+/*!
+ * \file adjacency.h
+ */
+
+#ifndef ADJACENCY_H
+#define ADJACENCY_H
+
+#include "backend.h"
+
+/*!
+ * Type holding the connectivity of a model in compressed sparse row format.
+ * The faces incident to vertex v are vf[vf_offsets[v]] ...
+ * vf[vf_offsets[v + 1] - 1], and its neighbour vertices are
+ * vv[vv_offsets[v]] ... vv[vv_offsets[v + 1] - 1], both in increasing
+ * order. The neighbours have no repetitions, while a degenerate face with
+ * a repeated vertex is listed once for each occurrence. Faces are
+ * identified by their position in the compact index buffer (see
+ * model_build_indices(Model3D*)).
+ *
+ * The half-edge from the k-th to the (k+1)-th vertex of face f has index
+ * 3 * f + k, and twin gives the half-edge going the opposite way on the
+ * adjacent face, or -1 on the boundary.
+ */
+struct Adjacency
+{
+    Index *vf_offsets; /*!< Start of the faces of each vertex. */
+    Index *vf;         /*!< Faces incident to each vertex. */
+    Index *vv_offsets; /*!< Start of the neighbours of each vertex. */
+    Index *vv;         /*!< Neighbour vertices of each vertex. */
+    Index *twin;       /*!< Opposite of each half-edge, NULL until
+                            model_halfedges(Model3D*) is called. */
+};
+
+/*!
+ * \brief Get the connectivity of the model, building it if needed.
+ * @param m Model.
+ * @return The connectivity, or NULL if an allocation failed.
+ * @note The structure is cached in the model and freed by
+ * model_topology_changed(Model3D*), so it is built once for any number of
+ * queries, as long as the faces are not changed.
+ */
+const Adjacency* model_adjacency(Model3D *m);
+
+/*!
+ * \brief Get the connectivity of the model, including the half-edge twins.
+ * @param m Model.
+ * @return The connectivity with the twin field filled, or NULL if an
+ * allocation failed.
+ * @note On a non-manifold edge, shared by more than two faces, each
+ * half-edge is paired with one of the opposite ones.
+ */
+const Adjacency* model_halfedges(Model3D *m);
+
+/*!
+ * \brief Free a connectivity structure.
+ * @param a Structure to be freed, may be NULL.
+ */
+void adjacency_free(Adjacency *a);
+
+#endif // ADJACENCY_H
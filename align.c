@@ -0,0 +1,282 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) Martino Pilia, 2015
+ */
+
+
+/*!
+ * \file align.c
+ */
+
+#include <math.h>
+
+#include "align.h"
+#include "profile.h"
+
+/*! Maximum number of sweeps of the Jacobi eigenvalue algorithm. */
+#define JACOBI_SWEEPS 32
+
+/*!
+ * Compute the eigenvalues and eigenvectors of a symmetric matrix with the
+ * cyclic Jacobi algorithm: each rotation zeroes an off-diagonal entry, and
+ * the sweeps stop when the off-diagonal part is negligible. On exit the
+ * diagonal of a holds the eigenvalues, and the columns of v the
+ * eigenvectors.
+ */
+static void jacobi(double a[3][3], double v[3][3])
+{
+    double off, theta, t, c, s, tmp;
+    int sweep, p, q, k;
+
+    for (p = 0; p < 3; ++p)
+        for (q = 0; q < 3; ++q)
+            v[p][q] = p == q;
+
+    for (sweep = 0; sweep < JACOBI_SWEEPS; ++sweep)
+    {
+        off = a[0][1] * a[0][1] + a[0][2] * a[0][2] + a[1][2] * a[1][2];
+        if (off <= 1e-30 * (a[0][0] * a[0][0] + a[1][1] * a[1][1]
+                    + a[2][2] * a[2][2]))
+            break;
+
+        for (p = 0; p < 2; ++p)
+        {
+            for (q = p + 1; q < 3; ++q)
+            {
+                if (a[p][q] == 0)
+                    continue;
+
+                /* tangent of the rotation angle, the smaller root */
+                theta = (a[q][q] - a[p][p]) / (2 * a[p][q]);
+                t = (theta >= 0 ? 1 : -1)
+                    / (fabs(theta) + sqrt(theta * theta + 1));
+                c = 1 / sqrt(t * t + 1);
+                s = t * c;
+
+                for (k = 0; k < 3; ++k)
+                {
+                    tmp = a[k][p];
+                    a[k][p] = c * tmp - s * a[k][q];
+                    a[k][q] = s * tmp + c * a[k][q];
+                }
+                for (k = 0; k < 3; ++k)
+                {
+                    tmp = a[p][k];
+                    a[p][k] = c * tmp - s * a[q][k];
+                    a[q][k] = s * tmp + c * a[q][k];
+                }
+                for (k = 0; k < 3; ++k)
+                {
+                    tmp = v[k][p];
+                    v[k][p] = c * tmp - s * v[k][q];
+                    v[k][q] = s * tmp + c * v[k][q];
+                }
+            }
+        }
+    }
+}
+
+/*!
+ * Accumulate the area, the first and the second moments of the surface in
+ * a single parallel reduction over the faces. The second moment of a
+ * triangle with vertices a, b, c and area A is
+ * A / 12 (s s^T + a a^T + b b^T + c c^T), with s = a + b + c. Coordinates
+ * are taken relative to the centre of the bounding box, so that the
+ * covariance does not suffer from cancellation on models far from the
+ * origin. Then the covariance is diagonalized, the axes are sorted and
+ * their sign is chosen by the third moment of the face centroids, computed
+ * with a second reduction.
+ */
+int principal_axes(Model3D *m, Point3D *center, Vector3D axes[3])
+{
+    double area = 0, sx = 0, sy = 0, sz = 0;
+    double sxx = 0, syy = 0, szz = 0, sxy = 0, sxz = 0, syz = 0;
+    double skew0 = 0, skew1 = 0;
+    double r[3], mu[3], cov[3][3], vec[3][3], e[3][3], p[3][3], s[3];
+    double ux, uy, uz, wx, wy, wz, A, d0, d1;
+    Point3D o;
+    Index f;
+    int i, j, k, order[3] = {0, 1, 2};
+
+    if (m->n_faces == 0 || m->info.min_x == NULL)
+        return -1;
+
+    if (model_build_indices(m) != 0)
+        return ERR_NO_MEMORY;
+
+    r[0] = 0.5 * (m->info.min_x->vertexCoordinates.x
+            + m->info.max_x->vertexCoordinates.x);
+    r[1] = 0.5 * (m->info.min_y->vertexCoordinates.y
+            + m->info.max_y->vertexCoordinates.y);
+    r[2] = 0.5 * (m->info.min_z->vertexCoordinates.z
+            + m->info.max_z->vertexCoordinates.z);
+
+    #pragma omp parallel for schedule(static) \
+            private(o, p, s, ux, uy, uz, wx, wy, wz, A, k) \
+            reduction(+: area, sx, sy, sz, sxx, syy, szz, sxy, sxz, syz)
+    for (f = 0; f < m->n_faces; ++f)
+    {
+        for (k = 0; k < 3; ++k)
+        {
+            o = m->vertices_array[face_vertex(m, f, k)]->vertexCoordinates;
+            p[k][0] = o.x - r[0];
+            p[k][1] = o.y - r[1];
+            p[k][2] = o.z - r[2];
+        }
+        for (k = 0; k < 3; ++k)
+            s[k] = p[0][k] + p[1][k] + p[2][k];
+
+        ux = p[1][0] - p[0][0];
+        uy = p[1][1] - p[0][1];
+        uz = p[1][2] - p[0][2];
+        wx = p[2][0] - p[0][0];
+        wy = p[2][1] - p[0][1];
+        wz = p[2][2] - p[0][2];
+        A = 0.5 * sqrt((uy * wz - uz * wy) * (uy * wz - uz * wy)
+                + (uz * wx - ux * wz) * (uz * wx - ux * wz)
+                + (ux * wy - uy * wx) * (ux * wy - uy * wx));
+
+        area += A;
+        sx += A * s[0] / 3;
+        sy += A * s[1] / 3;
+        sz += A * s[2] / 3;
+        sxx += A / 12 * (s[0] * s[0] + p[0][0] * p[0][0]
+                + p[1][0] * p[1][0] + p[2][0] * p[2][0]);
+        syy += A / 12 * (s[1] * s[1] + p[0][1] * p[0][1]
+                + p[1][1] * p[1][1] + p[2][1] * p[2][1]);
+        szz += A / 12 * (s[2] * s[2] + p[0][2] * p[0][2]
+                + p[1][2] * p[1][2] + p[2][2] * p[2][2]);
+        sxy += A / 12 * (s[0] * s[1] + p[0][0] * p[0][1]
+                + p[1][0] * p[1][1] + p[2][0] * p[2][1]);
+        sxz += A / 12 * (s[0] * s[2] + p[0][0] * p[0][2]
+                + p[1][0] * p[1][2] + p[2][0] * p[2][2]);
+        syz += A / 12 * (s[1] * s[2] + p[0][1] * p[0][2]
+                + p[1][1] * p[1][2] + p[2][1] * p[2][2]);
+    }
+
+    if (area <= 0)
+        return -1;
+
+    mu[0] = sx / area;
+    mu[1] = sy / area;
+    mu[2] = sz / area;
+    cov[0][0] = sxx / area - mu[0] * mu[0];
+    cov[1][1] = syy / area - mu[1] * mu[1];
+    cov[2][2] = szz / area - mu[2] * mu[2];
+    cov[0][1] = cov[1][0] = sxy / area - mu[0] * mu[1];
+    cov[0][2] = cov[2][0] = sxz / area - mu[0] * mu[2];
+    cov[1][2] = cov[2][1] = syz / area - mu[1] * mu[2];
+
+    jacobi(cov, vec);
+
+    /* sort the eigenvalues in decreasing order */
+    for (i = 0; i < 2; ++i)
+        for (j = i + 1; j < 3; ++j)
+            if (cov[order[j]][order[j]] > cov[order[i]][order[i]])
+            {
+                k = order[i];
+                order[i] = order[j];
+                order[j] = k;
+            }
+
+    for (i = 0; i < 3; ++i)
+        for (k = 0; k < 3; ++k)
+            e[i][k] = vec[k][order[i]];
+
+    #pragma omp parallel for schedule(static) private(o, s, d0, d1, j, k) \
+            reduction(+: skew0, skew1)
+    for (f = 0; f < m->n_faces; ++f)
+    {
+        for (k = 0; k < 3; ++k)
+            s[k] = 0;
+        for (j = 0; j < 3; ++j)
+        {
+            o = m->vertices_array[face_vertex(m, f, j)]->vertexCoordinates;
+            s[0] += o.x - r[0];
+            s[1] += o.y - r[1];
+            s[2] += o.z - r[2];
+        }
+        for (k = 0; k < 3; ++k)
+            s[k] = s[k] / 3 - mu[k];
+
+        d0 = s[0] * e[0][0] + s[1] * e[0][1] + s[2] * e[0][2];
+        d1 = s[0] * e[1][0] + s[1] * e[1][1] + s[2] * e[1][2];
+        skew0 += d0 * d0 * d0;
+        skew1 += d1 * d1 * d1;
+    }
+
+    for (k = 0; k < 3; ++k)
+    {
+        if (skew0 < 0)
+            e[0][k] = -e[0][k];
+        if (skew1 < 0)
+            e[1][k] = -e[1][k];
+    }
+
+    /* right handed frame, so that the transformation is a rotation */
+    e[2][0] = e[0][1] * e[1][2] - e[0][2] * e[1][1];
+    e[2][1] = e[0][2] * e[1][0] - e[0][0] * e[1][2];
+    e[2][2] = e[0][0] * e[1][1] - e[0][1] * e[1][0];
+
+    center->x = mu[0] + r[0];
+    center->y = mu[1] + r[1];
+    center->z = mu[2] + r[2];
+
+    for (i = 0; i < 3; ++i)
+    {
+        axes[i].x = e[i][0];
+        axes[i].y = e[i][1];
+        axes[i].z = e[i][2];
+    }
+
+    return 0;
+}
+
+/*!
+ * Compute the principal axes, then apply the rotation whose rows are the
+ * axes with the same kernel as rotation().
+ */
+int align_principal_axes(Model3D *m, Point3D *center, Vector3D axes[3])
+{
+    Point3D c;
+    Vector3D a[3];
+    float rot[3][3];
+    int i, status;
+    double start = profile_clock();
+
+    status = principal_axes(m, &c, a);
+    if (status != 0)
+        return status;
+
+    for (i = 0; i < 3; ++i)
+    {
+        rot[i][0] = a[i].x;
+        rot[i][1] = a[i].y;
+        rot[i][2] = a[i].z;
+    }
+
+    transform_model(m, rot, c);
+    rescan_vertices_info(m);
+
+    if (center != NULL)
+        *center = c;
+    if (axes != NULL)
+        for (i = 0; i < 3; ++i)
+            axes[i] = a[i];
+
+    profile_record(PROF_ALIGN, start, m->n_vertices, m->n_faces);
+
+    return 0;
+}
@@ -0,0 +1,67 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) Martino Pilia, 2015
+ */
+
+
+/*!
+ * \file align.h
+ */
+
+#ifndef ALIGN_H
+#define ALIGN_H
+
+#include "backend.h"
+
+/*!
+ * \brief Compute the centroid and the principal axes of the surface of a
+ * model.
+ *
+ * The principal axes are the eigenvectors of the covariance of the model
+ * surface, where each face is weighted by its area. See
+ * align_principal_axes() for their order and orientation.
+ * @param m Model.
+ * @param center Filled with the centroid of the surface.
+ * @param axes Filled with the principal axes, in order of decreasing
+ * variance, as unit vectors forming a right handed frame.
+ * @return Zero on success, -1 if the model has no surface, ERR_NO_MEMORY if
+ * an allocation failed.
+ */
+int principal_axes(Model3D *m, Point3D *center, Vector3D axes[3]);
+
+/*!
+ * \brief Rotate a model so that its principal axes are aligned with the
+ * coordinate axes.
+ *
+ * The principal axes are the eigenvectors of the covariance of the model
+ * surface, where each face is weighted by its area, so the result does not
+ * depend on how finely the surface is tessellated. The axis of largest
+ * variance is brought on x, the one of smallest variance on z, and each of
+ * the first two axes points towards the side where the surface is more
+ * spread. The rotation is around the centroid of the surface, which is
+ * not moved.
+ * @param m Model to be aligned.
+ * @param center If not NULL, filled with the centroid of the surface.
+ * @param axes If not NULL, filled with the principal axes, in order of
+ * decreasing variance, as unit vectors in the coordinates before the
+ * rotation.
+ * @return Zero on success, -1 if the model has no surface, ERR_NO_MEMORY if
+ * an allocation failed.
+ * @note The vertex normals are rotated too, and the vertices info are
+ * updated.
+ */
+int align_principal_axes(Model3D *m, Point3D *center, Vector3D axes[3]);
+
+#endif // ALIGN_H
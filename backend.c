@@ -26,7 +26,10 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "adjacency.h"
 #include "backend.h"
+#include "kdtree.h"
+#include "profile.h"
 
 /*!
  * Open file in OSX, using a path relative to the executable location.
@@ -53,9 +56,10 @@ FILE* osx_open_file(char *fn, int dim_file, char *exe_path, char *mode)
  */
 int parse_model_data(Model3D *m)
 {
-    int line;
-    char s[STR_LEN + 1];
-    int v_counter = 0, f_counter = 0;
+    char s[STR_LEN + 1] = "";
+    Index v_counter = 0, f_counter = 0;
+    double start = profile_clock();
+    long offset = ftell(m->file_model);
     
     /* parse file header */
     while (
@@ -65,24 +69,25 @@ int parse_model_data(Model3D *m)
         fgets(s, STR_LEN, m->file_model);
 
         if (strstr(s, "element vertex"))
-            sscanf(s, "%*s %*s %d", &m->n_vertices);
+            sscanf(s, "%*s %*s %lld", &m->n_vertices);
 
         if (strstr(s, "element face"))
-            sscanf(s, "%*s %*s %d", &m->n_faces);
+            sscanf(s, "%*s %*s %lld", &m->n_faces);
 
     }
 
     /* check if file content is useful */
-    if (m->n_faces == 0 || m->n_vertices == 0 )
+    if (m->n_faces <= 0 || m->n_vertices <= 0)
         return PARSER_ERR_NO_DATA; 
 
     /* init hash table for vertices */
-    line = __LINE__ + 2;
     m->vertices_array = 
         (Vertex**) malloc(m->n_vertices * sizeof (Vertex*));
 
-    if (m->vertices_array == NULL)
-        error_handler("malloc",__func__,  __FILE__, line);
+    /* allocate all the vertices and faces declared in the header at once */
+    if (m->vertices_array == NULL
+            || model_reserve(m, m->n_vertices, m->n_faces) != 0)
+        return ERR_NO_MEMORY;
 
     /* read vertices */
     while (v_counter < m->n_vertices)
@@ -96,8 +101,6 @@ int parse_model_data(Model3D *m)
         #endif // __DEBUG__
 
         Vertex v; /* temp variable for the current vertex */
-        Vertex *v_p; /* temp variable, will refer to the actual
-                        allocation of current vertex */
 
         v.index = v_counter; /* assign v index */
 
@@ -112,7 +115,8 @@ int parse_model_data(Model3D *m)
               );
 
         /* add vertex v to the vertex list of the model */
-        v_p = vertex_add(m, v, v_counter);
+        if (vertex_add(m, v, v_counter) == NULL)
+            return ERR_NO_MEMORY;
 
         v_counter++;
     }
@@ -129,17 +133,16 @@ int parse_model_data(Model3D *m)
         #endif // __DEBUG__
 
         Face f; /* temp variable for current face */
-        Face *f_p; /* temp variable for a pointer 
-                      to allocation of current face */
 
         f.index = f_counter; /* set index */
 
-        /* get face vertex indices */
-        sscanf(s, "%*d %d %d %d",
-                &f.v1,
-                &f.v2,
-                &f.v3
-              );
+        /* get face vertex indices, which must refer to existing vertices */
+        if (v_counter != m->n_vertices
+                || sscanf(s, "%*d %lld %lld %lld", &f.v1, &f.v2, &f.v3) != 3
+                || f.v1 < 0 || f.v1 >= m->n_vertices
+                || f.v2 < 0 || f.v2 >= m->n_vertices
+                || f.v3 < 0 || f.v3 >= m->n_vertices)
+            return PARSER_ERR_INCOHERENT_DATA;
 
         /* 
          * Set pointers to vertices, use array to have faster access than list's
@@ -149,13 +152,12 @@ int parse_model_data(Model3D *m)
         f.v3p = m->vertices_array[f.v3];
 
         /* add face to list */
-        f_p = face_add(m, f);
+        if (face_add(m, f) == NULL)
+            return ERR_NO_MEMORY;
 
         f_counter++;
     }
 
-    printf("\n%d %d\n", m->n_faces, f_counter);
-
     /* read data does not match with header file declaration (there are 
      * missing or extra data lines in the file) */
     if (f_counter != m->n_faces)
@@ -166,11 +168,14 @@ int parse_model_data(Model3D *m)
     assert(m->faces_list != NULL && m->vertices_list != NULL);
 
     #ifdef __DEBUG__
-    printf("\nVertices: %d \nFaces: %d\n",
+    printf("\nVertices: %lld \nFaces: %lld\n",
             m->n_vertices,
             m->n_faces);
     #endif // __DEBUG__
 
+    profile_add_bytes_read(ftell(m->file_model) - offset);
+    profile_record(PROF_PARSE, start, m->n_vertices, m->n_faces);
+
     return 0;
 }
 
@@ -182,8 +187,19 @@ void init_model(Model3D *m)
 {
     m->faces_list = NULL;
     m->vertices_list = NULL;
+    m->vertices_array = NULL;
     m->n_vertices = 0;
     m->n_faces = 0;
+    m->vertex_pool.items = NULL;
+    m->vertex_pool.size = 0;
+    m->vertex_pool.used = 0;
+    m->face_pool.items = NULL;
+    m->face_pool.size = 0;
+    m->face_pool.used = 0;
+    m->indices = NULL;
+    m->index_size = 0;
+    m->adjacency = NULL;
+    m->seed = rand();
     m->info.max_x = NULL;
     m->info.min_x = NULL;
     m->info.max_y = NULL;
@@ -193,23 +209,187 @@ void init_model(Model3D *m)
     m->info.biggest_face = NULL;
     m->info.smallest_face = NULL;
     m->info.tot_surface = 0;
+    m->info.volume = 0;
+}
+
+/*!
+ * Allocate the pools from which vertex_add() and face_add() take their
+ * items. A single allocation for each kind of item is much faster than one 
+ * for each item, it avoids the allocator overhead on each item, and it keeps
+ * items contiguous in memory, in the same order of the lists.
+ */
+int model_reserve(Model3D *m, Index n_vertices, Index n_faces)
+{
+    free(m->vertex_pool.items);
+    free(m->face_pool.items);
+
+    m->vertex_pool.items = malloc(n_vertices * sizeof (Vertex));
+    m->vertex_pool.size = n_vertices;
+    m->vertex_pool.used = 0;
+    m->face_pool.items = malloc(n_faces * sizeof (Face));
+    m->face_pool.size = n_faces;
+    m->face_pool.used = 0;
+
+    if (m->vertex_pool.items == NULL || m->face_pool.items == NULL)
+    {
+        free(m->vertex_pool.items);
+        free(m->face_pool.items);
+        m->vertex_pool.items = NULL;
+        m->vertex_pool.size = 0;
+        m->face_pool.items = NULL;
+        m->face_pool.size = 0;
+        return ERR_NO_MEMORY;
+    }
+
+    return 0;
+}
+
+/*!
+ * Build the new geometry in a temporary model, so that the current one is
+ * left untouched if an allocation fails, then release the old lists and
+ * move the new ones in place. The filename, the input file and the seed of
+ * the model are kept.
+ */
+int model_replace(Model3D *m, const Vertex *vertices, Index n_vertices,
+        const Index *faces, Index n_faces)
+{
+    Model3D tmp;
+    Vertex v;
+    Face f;
+    Index i;
+
+    init_model(&tmp);
+    tmp.n_vertices = n_vertices;
+    tmp.n_faces = n_faces;
+    tmp.vertices_array = (Vertex**) malloc(n_vertices * sizeof (Vertex*));
+
+    if (tmp.vertices_array == NULL
+            || model_reserve(&tmp, n_vertices, n_faces) != 0)
+    {
+        free(tmp.vertices_array);
+        return ERR_NO_MEMORY;
+    }
+
+    for (i = 0; i < n_vertices; ++i)
+    {
+        v = vertices[i];
+        v.index = i;
+        vertex_add(&tmp, v, i); /* cannot fail, the pool is large enough */
+    }
+
+    for (i = 0; i < n_faces; ++i)
+    {
+        f.index = i;
+        f.v1 = faces[3 * i];
+        f.v2 = faces[3 * i + 1];
+        f.v3 = faces[3 * i + 2];
+        f.v1p = tmp.vertices_array[f.v1];
+        f.v2p = tmp.vertices_array[f.v2];
+        f.v3p = tmp.vertices_array[f.v3];
+        face_add(&tmp, f);
+    }
+
+    strcpy(tmp.filename, m->filename);
+    tmp.file_model = m->file_model;
+    tmp.seed = m->seed;
+
+    clear_model(m);
+    *m = tmp;
+
+    model_info(m);
+
+    return 0;
+}
+
+/*!
+ * Fill a buffer with the vertex indices of each face, three consecutive 
+ * entries for each face in list order. When all indices are less than 
+ * INDEX_32_MAX the entries are 32 bit wide, halving the size of the buffer 
+ * (and the memory traffic of the algorithms which scan it), otherwise they
+ * are 64 bit wide. Entries must be read with face_vertex().
+ */
+int model_build_indices(Model3D *m)
+{
+    Face *f;
+    Index i = 0;
+    uint32_t *i32;
+    Index *i64;
+
+    if (m->index_size != 0)
+        return 0; /* already built */
+
+    if (m->n_vertices <= INDEX_32_MAX)
+    {
+        i32 = (uint32_t*) malloc(3 * m->n_faces * sizeof (uint32_t));
+        if (i32 == NULL)
+            return ERR_NO_MEMORY;
+
+        for (f = m->faces_list; f != NULL; f = f->next, i += 3)
+        {
+            i32[i] = f->v1;
+            i32[i + 1] = f->v2;
+            i32[i + 2] = f->v3;
+        }
+
+        m->indices = i32;
+        m->index_size = sizeof (uint32_t);
+    }
+    else
+    {
+        i64 = (Index*) malloc(3 * m->n_faces * sizeof (Index));
+        if (i64 == NULL)
+            return ERR_NO_MEMORY;
+
+        for (f = m->faces_list; f != NULL; f = f->next, i += 3)
+        {
+            i64[i] = f->v1;
+            i64[i + 1] = f->v2;
+            i64[i + 2] = f->v3;
+        }
+
+        m->indices = i64;
+        m->index_size = sizeof (Index);
+    }
+
+    return 0;
+}
+
+/*!
+ * Free the compact index buffer and the connectivity, which will be rebuilt
+ * on demand.
+ */
+void model_topology_changed(Model3D *m)
+{
+    free(m->indices);
+    m->indices = NULL;
+    m->index_size = 0;
+    adjacency_free(m->adjacency);
+    m->adjacency = NULL;
 }
 
 /*!
  * All'interno di questa funzione sara' possibile salvare il modello
  * opportunatamente modificato.
  */
-void save_model(FILE *newfile, Model3D m)
+int save_model(FILE *newfile, Model3D *m)
 {
-    Vertex *v = m.vertices_list;
-    Face *f = m.faces_list;
+    Vertex *v = m->vertices_list;
+    Face *f = m->faces_list;
+    double start = profile_clock();
+    long offset;
+
+    /* PLY has no standard integer type wider than 32 bits for the indices */
+    if (m->n_vertices > INDEX_32_MAX)
+        return ERR_INVALID_ARGUMENT;
+
+    offset = ftell(newfile);
 
     /* print header on file */
     fprintf(newfile,
             "ply\n"
             "format ascii 1.0\n"
             "comment %s\n"
-            "element vertex %d\n"
+            "element vertex %lld\n"
             "property float x\n"
             "property float y\n"
             "property float z\n"
@@ -219,12 +399,14 @@ void save_model(FILE *newfile, Model3D m)
             "property uchar red\n"
             "property uchar green\n"
             "property uchar blue\n"
-            "element face %d\n"
-            "property list uchar int vertex_indices\n"
+            "element face %lld\n"
+            "property list uchar %s vertex_indices\n"
             "end_header\n",
             PLY_OUTPUT_COMMENT,
-            m.n_vertices,
-            m.n_faces
+            m->n_vertices,
+            m->n_faces,
+            /* use the narrowest type which can hold all the indices */
+            m->n_vertices <= INT32_MAX ? "int" : "uint"
             );
 
     /* print vertices on file */
@@ -252,11 +434,11 @@ void save_model(FILE *newfile, Model3D m)
     }
 
     /* print faces on file */
-    f = m.faces_list;
+    f = m->faces_list;
     while (f != NULL)
     {
         fprintf(newfile,
-                "%d %d %d %d\n",
+                "%d %lld %lld %lld\n",
                 3,
                 f->v1,
                 f->v2,
@@ -270,7 +452,13 @@ void save_model(FILE *newfile, Model3D m)
         #endif // __DEBUG__
     }
 
-    fflush(newfile);
+    if (fflush(newfile) != 0 || ferror(newfile))
+        return 1;
+
+    profile_add_bytes_written(ftell(newfile) - offset);
+    profile_record(PROF_SAVE, start, m->n_vertices, m->n_faces);
+
+    return 0;
 }
 
 /*!
@@ -279,9 +467,10 @@ void save_model(FILE *newfile, Model3D m)
  * each of its vertexes. If coloration is done succesfully, the function shows 
  * a verbose message.
  */
-int color_flat(Model3D model, ColorRGB c)
+int color_flat(Model3D *model, ColorRGB c)
 {
-    Vertex *v = model.vertices_list;
+    Vertex *v = model->vertices_list;
+    double start = profile_clock();
 
     while (v != NULL)
     {
@@ -289,6 +478,8 @@ int color_flat(Model3D model, ColorRGB c)
         v = v->next;
     }
 
+    profile_record(PROF_COLOR_FLAT, start, model->n_vertices, 0);
+
     return 0;
 }
 
@@ -296,22 +487,32 @@ int color_flat(Model3D model, ColorRGB c)
  * Apply a random coloration to the Model3D object provided in input. A random
  * generated color is applied to each vertex of the input model. If coloration 
  * is done succesfully, the function shows a verbose message.
+ *
+ * Random values are taken from a linear congruential generator whose state 
+ * is stored in the model, instead of rand(), so that different models can be
+ * colored concurrently.
  */
-int color_random(Model3D model)
+int color_random(Model3D *model)
 {
-    Vertex *v = model.vertices_list;
+    Vertex *v = model->vertices_list;
+    double start = profile_clock();
 
     while (v != NULL)
     {
-        /* generate random coordinates 
-         * srand(unsigned int) must be called before using this function */
-        v->vertexColor.r = rand() % 256;
-        v->vertexColor.g = rand() % 256;
-        v->vertexColor.b = rand() % 256;
+        /* generate random coordinates (use the high bits of the state,
+         * which have a longer period) */
+        model->seed = model->seed * 1103515245u + 12345u;
+        v->vertexColor.r = (model->seed >> 24) & 0xff;
+        model->seed = model->seed * 1103515245u + 12345u;
+        v->vertexColor.g = (model->seed >> 24) & 0xff;
+        model->seed = model->seed * 1103515245u + 12345u;
+        v->vertexColor.b = (model->seed >> 24) & 0xff;
 
         v = v->next;
     }
 
+    profile_record(PROF_COLOR_RANDOM, start, model->n_vertices, 0);
+
     return 0;
 }
 
@@ -338,53 +539,194 @@ int color_random(Model3D model)
  * this situation, the coloration is aborted and a message is shown to
  * the user, returning to the caller a nonzero value (which permits to the 
  * caller to ask the user another action to do).
+ *
+ * Distances are computed twice, once for the range and once for the color,
+ * instead of being stored: this needs no scratch memory, whatever the size 
+ * of the model, and recomputing a distance is cheaper than reading it back 
+ * from a large array.
  */
-int color_distance(Model3D m, ColorRGB c, Point3D p)
+int color_distance(Model3D *m, ColorRGB c, Point3D p)
 {
-    Vertex *v = m.vertices_list;
-    double distance[m.n_vertices]; /* store values because are used twice */
+    Vertex *v = m->vertices_list;
+    double distance;
+    double d_min = DBL_MAX, d_max = -DBL_MAX;
     double distance_range; /* d_max - d_min */
-    int max = 0, min = 0;  /* d_max and d_min indexes */
     float coef; /* coefficient for coloration */
-    int i = 0;
+    double start = profile_clock();
 
-    /* compute distance between each model point and p */
+    /* compute the range of distances between model points and p */
     while (v != NULL)
     {
-        distance[i] = euclidean_distance(p, v->vertexCoordinates);
+        distance = euclidean_distance(p, v->vertexCoordinates);
 
-        if (distance[i] > distance[max])
-            max = i;
-        if (distance[i] < distance[min])
-            min = i;
+        if (distance > d_max)
+            d_max = distance;
+        if (distance < d_min)
+            d_min = distance;
 
         v = v->next;
-        i++;
     }
 
     /* check if all vertexes have equal distance from the chosen point;
      * if so, abort coloration with error */
-    if (distance[max] == distance[min])
+    if (d_max == d_min)
         return -1;
 
     /* compute d_max - d_min, a value reused a lot */
-    distance_range = distance[max] - distance[min];
+    distance_range = d_max - d_min;
 
     /* color the vertexes
      * cannot do this in previous cycle, because depends of the
      * values of farthest and nearest */
-    i = 0;
-    v = m.vertices_list;
+    v = m->vertices_list;
     while (v != NULL)
     {
-        coef = (distance[i] - distance[min]) / distance_range;
+        distance = euclidean_distance(p, v->vertexCoordinates);
+        coef = (distance - d_min) / distance_range;
 
         v->vertexColor.r = c.r + coef * (255 - c.r);
         v->vertexColor.g = c.g + coef * (255 - c.g);
         v->vertexColor.b = c.b + coef * (255 - c.b);
         
         v = v->next;
-        i++;
+    }
+
+    profile_record(PROF_COLOR_DISTANCE, start, m->n_vertices, 0);
+
+    return 0;
+}
+
+/*!
+ * Apply a distance-based coloration like color_distance(Model3D*, ColorRGB,
+ * Point3D), where the distance of each vertex is taken from the nearest of
+ * the n input points.
+ *
+ * A brute force search would cost O(V * n), so the points are indexed once
+ * in a k-d tree, and the nearest one to each vertex is found in O(log n).
+ * Queries are independent, so they are split among threads when OpenMP is
+ * enabled.
+ */
+int color_distance_multi(Model3D *m, ColorRGB c, const Point3D *p, Index n)
+{
+    KdTree tree;
+    double *distances;
+    Index i;
+    int status;
+    double start = profile_clock();
+
+    if (p == NULL || n <= 0)
+        return ERR_INVALID_ARGUMENT;
+
+    distances = (double*) malloc(m->n_vertices * sizeof (double));
+    if (distances == NULL)
+        return ERR_NO_MEMORY;
+
+    status = kdtree_build(&tree, p, n);
+    if (status != 0)
+    {
+        free(distances);
+        return status;
+    }
+
+    #pragma omp parallel for schedule(static)
+    for (i = 0; i < m->n_vertices; ++i)
+        distances[i] = kdtree_nearest(
+                &tree, m->vertices_array[i]->vertexCoordinates, NULL);
+
+    kdtree_free(&tree);
+
+    status = color_scalar(m, c, distances);
+    free(distances);
+
+    if (status == 0)
+        profile_record(PROF_COLOR_MULTI, start, m->n_vertices, 0);
+
+    return status;
+}
+
+/*!
+ * Map linearly the range of the field to the colors between c and white,
+ * with the same formula used by color_distance(Model3D*, ColorRGB, Point3D).
+ * Both passes over the vertices are split among threads when OpenMP is
+ * enabled.
+ */
+int color_scalar(Model3D *m, ColorRGB c, const double *values)
+{
+    Index i;
+    Vertex *v;
+    double v_min = DBL_MAX, v_max = -DBL_MAX;
+    double range;
+    float coef;
+
+    #pragma omp parallel for schedule(static) \
+            reduction(min:v_min) reduction(max:v_max)
+    for (i = 0; i < m->n_vertices; ++i)
+    {
+        if (values[i] < v_min)
+            v_min = values[i];
+        if (values[i] > v_max)
+            v_max = values[i];
+    }
+
+    /* a constant field gives no coloration */
+    if (v_max == v_min)
+        return -1;
+
+    range = v_max - v_min;
+
+    #pragma omp parallel for schedule(static) private(v, coef)
+    for (i = 0; i < m->n_vertices; ++i)
+    {
+        v = m->vertices_array[i];
+        coef = (values[i] - v_min) / range;
+
+        v->vertexColor.r = c.r + coef * (255 - c.r);
+        v->vertexColor.g = c.g + coef * (255 - c.g);
+        v->vertexColor.b = c.b + coef * (255 - c.b);
+    }
+
+    return 0;
+}
+
+/*!
+ * Read the points line by line, growing the array geometrically.
+ */
+int load_points(FILE *f, Point3D **p, Index *n)
+{
+    char s[STR_LEN + 1];
+    Point3D q, *tmp;
+    Index size = 0;
+
+    *p = NULL;
+    *n = 0;
+
+    while (fgets(s, STR_LEN + 1, f) != NULL)
+    {
+        if (sscanf(s, "%f %f %f", &q.x, &q.y, &q.z) != 3)
+            continue;
+
+        if (*n == size)
+        {
+            size = size ? 2 * size : 64;
+            tmp = (Point3D*) realloc(*p, size * sizeof (Point3D));
+            if (tmp == NULL)
+            {
+                free(*p);
+                *p = NULL;
+                *n = 0;
+                return ERR_NO_MEMORY;
+            }
+            *p = tmp;
+        }
+
+        (*p)[(*n)++] = q;
+    }
+
+    if (*n == 0)
+    {
+        free(*p);
+        *p = NULL;
+        return PARSER_ERR_NO_DATA;
     }
 
     return 0;
@@ -414,11 +756,12 @@ int color_distance(Model3D m, ColorRGB c, Point3D p)
  * shown to the user, returning to the caller a nonzero value (which permits to 
  * the caller to ask the user another action to do).
  */
-int color_gradient(Model3D m, ColorRGB c, Direction d)
+int color_gradient(Model3D *m, ColorRGB c, Direction d)
 {
-    Vertex *v = m.vertices_list;
+    Vertex *v = m->vertices_list;
     float coef;
     int flag = 0;
+    double start = profile_clock();
 
     /* check if the model is flat respect to the axis chosen for gradient
      * coloration */
@@ -427,32 +770,30 @@ int color_gradient(Model3D m, ColorRGB c, Direction d)
         /* gradient along x axis */
         case RL:
         case LR:
-            if ((m.info.max_x->vertexCoordinates.x 
-                    - m.info.min_x->vertexCoordinates.x) < NUM_TOL)
+            if ((m->info.max_x->vertexCoordinates.x 
+                    - m->info.min_x->vertexCoordinates.x) < NUM_TOL)
                 flag = 1;
             break;
 
         /* gradient along y axis */
         case TB:
         case BT:
-            if ((m.info.max_y->vertexCoordinates.y 
-                    - m.info.min_y->vertexCoordinates.y) < NUM_TOL)
+            if ((m->info.max_y->vertexCoordinates.y 
+                    - m->info.min_y->vertexCoordinates.y) < NUM_TOL)
                 flag = 1;
             break;
 
         /* gradient along z axis */
         case FB:
         case BF:
-            if ((m.info.max_z->vertexCoordinates.z 
-                    - m.info.min_z->vertexCoordinates.z) < NUM_TOL)
+            if ((m->info.max_z->vertexCoordinates.z 
+                    - m->info.min_z->vertexCoordinates.z) < NUM_TOL)
                 flag = 1;
             break;
 
         default:
             /* should be unreachable if input is valid */
-            perror("color_gradient(): invalid value for direction");
-            exit(EXIT_FAILURE);
-            break;
+            return ERR_INVALID_ARGUMENT;
     }
 
     /* if so, abort coloration with error */
@@ -470,6 +811,8 @@ int color_gradient(Model3D m, ColorRGB c, Direction d)
         v = v->next;
     }
 
+    profile_record(PROF_COLOR_GRADIENT, start, m->n_vertices, 0);
+
     return 0;
 }
 
@@ -483,9 +826,9 @@ int color_gradient(Model3D m, ColorRGB c, Direction d)
  * component in such direction among all vertices, \f$ x_{max} \f$ similarly
  * is the maximum component.
  */
-float distance_coefficient(Model3D m, Vertex *v, Direction d)
+float distance_coefficient(Model3D *m, Vertex *v, Direction d)
 {
-    float coef;
+    float coef = 0;
 
     switch (d)
     {
@@ -493,54 +836,54 @@ float distance_coefficient(Model3D m, Vertex *v, Direction d)
         case RL:
             coef = 1 -
                 (v->vertexCoordinates.x 
-                 - m.info.min_x->vertexCoordinates.x) 
-                / (m.info.max_x->vertexCoordinates.x 
-                        - m.info.min_x->vertexCoordinates.x);
+                 - m->info.min_x->vertexCoordinates.x) 
+                / (m->info.max_x->vertexCoordinates.x 
+                        - m->info.min_x->vertexCoordinates.x);
             break;
 
             /* color left to right */
         case LR:
             coef = 
                 (v->vertexCoordinates.x 
-                 - m.info.min_x->vertexCoordinates.x) 
-                / (m.info.max_x->vertexCoordinates.x 
-                        - m.info.min_x->vertexCoordinates.x);
+                 - m->info.min_x->vertexCoordinates.x) 
+                / (m->info.max_x->vertexCoordinates.x 
+                        - m->info.min_x->vertexCoordinates.x);
             break;
 
             /* color up to down */
         case TB:
             coef = 1 -
                 (v->vertexCoordinates.y 
-                 - m.info.min_y->vertexCoordinates.y) 
-                / (m.info.max_y->vertexCoordinates.y 
-                        - m.info.min_y->vertexCoordinates.y);
+                 - m->info.min_y->vertexCoordinates.y) 
+                / (m->info.max_y->vertexCoordinates.y 
+                        - m->info.min_y->vertexCoordinates.y);
             break;
 
             /* color down to up */
         case BT:
             coef = 
                 (v->vertexCoordinates.y 
-                 - m.info.min_y->vertexCoordinates.y) 
-                / (m.info.max_y->vertexCoordinates.y 
-                        - m.info.min_y->vertexCoordinates.y);
+                 - m->info.min_y->vertexCoordinates.y) 
+                / (m->info.max_y->vertexCoordinates.y 
+                        - m->info.min_y->vertexCoordinates.y);
             break;
 
             /* color front to back */
         case FB:
             coef = 1 -
                 (v->vertexCoordinates.z 
-                 - m.info.min_z->vertexCoordinates.z) 
-                / (m.info.max_z->vertexCoordinates.z 
-                        - m.info.min_z->vertexCoordinates.z);
+                 - m->info.min_z->vertexCoordinates.z) 
+                / (m->info.max_z->vertexCoordinates.z 
+                        - m->info.min_z->vertexCoordinates.z);
             break;
 
             /* color back to front */
         case BF:
             coef = 
                 (v->vertexCoordinates.z 
-                 - m.info.min_z->vertexCoordinates.z) 
-                / (m.info.max_z->vertexCoordinates.z 
-                        - m.info.min_z->vertexCoordinates.z);
+                 - m->info.min_z->vertexCoordinates.z) 
+                / (m->info.max_z->vertexCoordinates.z 
+                        - m->info.min_z->vertexCoordinates.z);
             break;
 
         default:
@@ -580,6 +923,41 @@ void apply_transformation_matrix(float y[3], float a[3][3], float x[3])
     }
 }
 
+/*!
+ * Each vertex is translated by -o, multiplied by the matrix and translated
+ * back, while its normal, being a direction, is only multiplied by the
+ * matrix. Vertices are independent, so they are transformed in parallel
+ * through the vertices array.
+ */
+void transform_model(Model3D *m, float a[3][3], Point3D o)
+{
+    float input[3], result[3];
+    Vertex *v;
+    Index i;
+
+    #pragma omp parallel for schedule(static) private(input, result, v)
+    for (i = 0; i < m->n_vertices; ++i)
+    {
+        v = m->vertices_array[i];
+
+        input[0] = v->vertexCoordinates.x - o.x;
+        input[1] = v->vertexCoordinates.y - o.y;
+        input[2] = v->vertexCoordinates.z - o.z;
+        apply_transformation_matrix(result, a, input);
+        v->vertexCoordinates.x = result[0] + o.x;
+        v->vertexCoordinates.y = result[1] + o.y;
+        v->vertexCoordinates.z = result[2] + o.z;
+
+        input[0] = v->vertexNormals.x;
+        input[1] = v->vertexNormals.y;
+        input[2] = v->vertexNormals.z;
+        apply_transformation_matrix(result, a, input);
+        v->vertexNormals.x = result[0];
+        v->vertexNormals.y = result[1];
+        v->vertexNormals.z = result[2];
+    }
+}
+
 /*!
  * This function applies an arbitrary rotation to the input model. The 
  * rotation is defined by a rotation axis (given by a point \f$ \mathbf{o} \f$ 
@@ -631,8 +1009,10 @@ void apply_transformation_matrix(float y[3], float a[3][3], float x[3])
  * 
  * Finally, the model is translated back by \f$ \mathbf{o} \f$.
  */
-int rotation(Model3D m, Point3D o, Vector3D u, float theta)
+int rotation(Model3D *m, Point3D o, Vector3D u, float theta)
 {
+    double start = profile_clock();
+
     /* norm of the input vector */
     float norm = sqrt(u.x * u.x + u.y * u.y + u.z * u.z);
     
@@ -671,37 +1051,13 @@ int rotation(Model3D m, Point3D o, Vector3D u, float theta)
             z*z + (x*z * (s*y + c*x*z) - y * (s*x*z - c*y)) / q2,
         }
     };
-    float input[3], result[3];
-    Vertex *v = m.vertices_list;
     
-    while (v != NULL)
-    {
-        /* rotate vertex */
-        input[0] = v->vertexCoordinates.x - o.x;
-        input[1] = v->vertexCoordinates.y - o.y;
-        input[2] = v->vertexCoordinates.z - o.z;
-        if (fabs(y) < NUM_TOL && fabs(z) < NUM_TOL)
-            apply_transformation_matrix(result, rot_x, input);
-        else
-            apply_transformation_matrix(result, rot, input);
-        v->vertexCoordinates.x = result[0] + o.x;
-        v->vertexCoordinates.y = result[1] + o.y;
-        v->vertexCoordinates.z = result[2] + o.z;
-        
-        /* rotate normal */
-        input[0] = v->vertexNormals.x - o.x;
-        input[1] = v->vertexNormals.y - o.y;
-        input[2] = v->vertexNormals.z - o.z;
-        if (fabs(y) < NUM_TOL && fabs(z) < NUM_TOL)
-            apply_transformation_matrix(result, rot_x, input);
-        else
-            apply_transformation_matrix(result, rot, input);
-        v->vertexNormals.x = result[0] + o.x;
-        v->vertexNormals.y = result[1] + o.y;
-        v->vertexNormals.z = result[2] + o.z;
-        
-        v = v->next;
-    }
+    if (fabs(y) < NUM_TOL && fabs(z) < NUM_TOL)
+        transform_model(m, rot_x, o);
+    else
+        transform_model(m, rot, o);
+
+    profile_record(PROF_ROTATION, start, m->n_vertices, 0);
 
     return 0;
 }
@@ -734,6 +1090,29 @@ void rescan_vertices_info(Model3D *m)
     }
 }
 
+/*!
+ * This procedure computes again the surface of each face, and searches for
+ * the faces with maximum and minimum surface. It is needed when the shape
+ * of the faces has been modified, i.e. with a smoothing, and the previous
+ * totals must be discarded before the faces are summed again.
+ */
+void rescan_faces_info(Model3D *m)
+{
+    Face *f = m->faces_list;
+
+    /* reset faces info */
+    m->info.biggest_face = NULL;
+    m->info.smallest_face = NULL;
+    m->info.tot_surface = 0;
+
+    /* rescan */
+    while (f != NULL)
+    {
+        update_faces_info(m, f);
+        f = f->next;
+    }
+}
+
 
 /*!
  * This function adds a vertex in the vertex list of the input Model3D object,
@@ -744,24 +1123,26 @@ void rescan_vertices_info(Model3D *m)
  * The list tail, i.e. the last added element, is also memorized in the
  * Model3D object, in order to eliminate the needing for list flow when adding
  * a new item.
+ *
+ * The vertex is taken from the storage reserved with model_reserve(), if 
+ * it is not full yet, otherwise it is allocated on its own. The function 
+ * returns NULL, leaving the model unchanged, if the allocation fails or if 
+ * the model is NULL.
  */
-Vertex* vertex_add(Model3D *model, Vertex item, int index)
+Vertex* vertex_add(Model3D *model, Vertex item, Index index)
 {
-    int line;
     Vertex *v;
 
     if (model == NULL)
-    {
-        /* should be unreachable if code is ok */
-        perror("vertex_add(): NULL pointer to Model3D object");
-        exit(EXIT_FAILURE);
-    }
+        return NULL; /* should be unreachable if code is ok */
 
-    line = __LINE__ + 1;
-    v = (Vertex*) malloc(sizeof (Vertex));
+    if (model->vertex_pool.used < model->vertex_pool.size)
+        v = (Vertex*) model->vertex_pool.items + model->vertex_pool.used++;
+    else
+        v = (Vertex*) malloc(sizeof (Vertex));
     
     if (v == NULL)
-        error_handler("malloc", __func__, __FILE__, line);
+        return NULL;
 
     *v = item;
     v->next = NULL;
@@ -787,9 +1168,9 @@ Vertex* vertex_add(Model3D *model, Vertex item, int index)
  * Flow the list until the desired position, and return a pointer to the
  * corresponding vector.
  */
-Vertex* vertex_get(Vertex *l, int n)
+Vertex* vertex_get(Vertex *l, Index n)
 {
-    int i = 0;
+    Index i = 0;
     Vertex *v = l;
 
     if (n < 0)
@@ -821,25 +1202,26 @@ Vertex* vertex_get(Vertex *l, int n)
  * The list tail, i.e. the last added element, is also memorized in the
  * Model3D object, in order to eliminate the needing for list flow when adding
  * a new item.
+ *
+ * The face is taken from the storage reserved with model_reserve(), if 
+ * it is not full yet, otherwise it is allocated on its own. The function 
+ * returns NULL, leaving the model unchanged, if the allocation fails or if 
+ * the model is NULL.
  */
-
 Face* face_add(Model3D *model, Face item)
 {
-    int line;
     Face *f;
 
     if (model == NULL)
-    {
-        /* should be unreachable if code is ok */
-        perror("vertex_add(): NULL pointer to Model3D object");
-        exit(EXIT_FAILURE);
-    }
+        return NULL; /* should be unreachable if code is ok */
 
-    line = __LINE__ + 1;
-    f = (Face*) malloc(sizeof (Face));
+    if (model->face_pool.used < model->face_pool.size)
+        f = (Face*) model->face_pool.items + model->face_pool.used++;
+    else
+        f = (Face*) malloc(sizeof (Face));
     
     if (f == NULL)
-        error_handler("malloc",__func__, __FILE__, line);
+        return NULL;
 
     *f = item;
     f->next = NULL;
@@ -1035,7 +1417,7 @@ double triangle_surface(Face *f)
 void vertex_to_string(char *s, Vertex *v)
 {
     sprintf(s,
-            "index: %*d;     coord: (% *.*f, % *.*f, % *.*f )",
+            "index: %*lld;     coord: (% *.*f, % *.*f, % *.*f )",
             INT_DIGITS,
             v->index,
             FLO_DIGITS,
@@ -1059,7 +1441,7 @@ void vertex_to_string(char *s, Vertex *v)
 void face_to_string(char *s, Face *f)
 {
     sprintf(s,
-            "indexes: %*d, %*d, %*d;     area: % .g",
+            "indexes: %*lld, %*lld, %*lld;     area: % .g",
             INT_DIGITS,
             f->v1,
             INT_DIGITS,
@@ -1099,33 +1481,54 @@ void error_handler(char *fun_name, const char *caller, char *file, int line)
 
 /*!
  * This procedure frees all dynamical resources allocated for the input 
- * model.
+ * model, and resets its lists, so that it is safe to clear a model twice.
+ * Items are freed one by one only if they do not belong to the storage 
+ * reserved by model_reserve(), which is freed at once.
  */
-void clear_model(Model3D m)
+void clear_model(Model3D *m)
 {
     Vertex *v1, *v2;
     Face *f1, *f2;
+    Vertex *vp = (Vertex*) m->vertex_pool.items;
+    Face *fp = (Face*) m->face_pool.items;
 
     /* dealloc all vertices */
-    v1 = m.vertices_list;
+    v1 = m->vertices_list;
     while (v1 != NULL)
     {
         v2 = v1->next;
-        free(v1);
+        if (v1 < vp || v1 >= vp + m->vertex_pool.size)
+            free(v1);
         v1 = v2;
     }
 
     /* dealloc all faces */
-    f1 = m.faces_list;
+    f1 = m->faces_list;
     while (f1 != NULL)
     {
         f2 = f1->next;
-        free(f1);
+        if (f1 < fp || f1 >= fp + m->face_pool.size)
+            free(f1);
         f1 = f2;
     }
 
-    /* dealloc vertex associative table */
-    free(m.vertices_array);
+    /* dealloc reserved storage */
+    free(m->vertex_pool.items);
+    free(m->face_pool.items);
+    m->vertex_pool.items = NULL;
+    m->vertex_pool.size = 0;
+    m->vertex_pool.used = 0;
+    m->face_pool.items = NULL;
+    m->face_pool.size = 0;
+    m->face_pool.used = 0;
+
+    /* dealloc vertex associative table and derived data */
+    free(m->vertices_array);
+    model_topology_changed(m);
+
+    m->vertices_list = NULL;
+    m->faces_list = NULL;
+    m->vertices_array = NULL;
 }
 
 /*!
@@ -1159,10 +1562,10 @@ double mixed_product(Point3D a, Point3D b, Point3D c)
  * a closed surface or if the surface is not orientable, or if vertices have
  * not a consistent order with the face normal according to the right hand rule.
  */
-double model_volume(Model3D m)
+double model_volume(Model3D *m)
 {
     double volume = 0;
-    Face *f = m.faces_list;
+    Face *f = m->faces_list;
 
     while (f != NULL)
     {
@@ -1205,7 +1608,7 @@ double model_volume(Model3D m)
  * a closed surface, and the approximation is quite rough if faces are not very
  * small.
  */
-double model_volume_approx(Model3D m)
+double model_volume_approx(Model3D *m)
 {
     double volume = 0;
     double norm2;
@@ -1213,7 +1616,7 @@ double model_volume_approx(Model3D m)
     double dot_prod;
     Vector3D n;
     Point3D g;
-    Face *f = m.faces_list;
+    Face *f = m->faces_list;
 
     /* iterate on model faces */
     while (f != NULL)
@@ -1268,27 +1671,22 @@ double model_volume_approx(Model3D m)
 
 /*!
  * This subroutine computes the informations about a 3D model, saving all in
- * its struct Info field.
+ * its struct Info field. Previous informations are reset, so it can be
+ * called again after the model has been modified.
  */
 void model_info(Model3D *m)
 {
-    Vertex *v = m->vertices_list;
-    Face *f = m->faces_list;
+    double start = profile_clock();
 
-    /* determine informations about vertices */
-    while (v != NULL)
-    {
-        update_vertices_info(m, v);
-        v = v->next;
-    }
+    /* determine informations about vertices, discarding the previous
+     * ones if the model was already scanned */
+    rescan_vertices_info(m);
 
     /* determine informations about faces and area */
-    while (f != NULL)
-    {
-        update_faces_info(m, f);
-        f = f->next;
-    }
+    rescan_faces_info(m);
 
     /* determine volume */
-    m->info.volume = model_volume(*m);
+    m->info.volume = model_volume(m);
+
+    profile_record(PROF_INFO, start, m->n_vertices, m->n_faces);
 }
@@ -19,6 +19,12 @@
  * \file backend.h
  */
 
+#ifndef BACKEND_H
+#define BACKEND_H
+
+#include <stdint.h>
+#include <stdio.h>
+
 /*! Value returned by the parseModelData(Model3D*) when the model file
  * contains no useful data. */
 #define PARSER_ERR_NO_DATA 1
@@ -28,6 +34,15 @@
  * of the .ply file. */
 #define PARSER_ERR_INCOHERENT_DATA 2
 
+/*! Value returned by backend functions when a memory allocation fails. */
+#define ERR_NO_MEMORY 3
+
+/*! Value returned by backend functions when a parameter is not valid. */
+#define ERR_INVALID_ARGUMENT 4
+
+/*! Value returned by backend functions when writing a file fails. */
+#define ERR_IO 5
+
 /*!
  * Maximum number of chars in a string (for paths, filenames etc.)
  */
@@ -52,6 +67,12 @@
  */
 #define FLO_DIGITS 8
 
+/*!
+ * Largest number of vertices whose indices are stored with 32 bits in the
+ * compact index buffer, see model_build_indices(Model3D*).
+ */
+#define INDEX_32_MAX UINT32_MAX
+
 /*!
  * Text (without newlines inside) to be inserted as comment in files 
  * generated by the program.
@@ -207,11 +228,27 @@ typedef enum Action
     COL_GRAD = 2, /*!< Color the model with a gradient coloration. */
     COL_DIST = 3, /*!< Color the model with a distance-based coloration. */
     COL_RAND = 4, /*!< Color the model with a random coloration. */
-    INFO = 5,     /*!< Show info about current model. */
-    ROTATE = 6,   /*!< Show model in 3D viewer. */
-    ANOTHER = 7,  /*!< Pick another model, discarding the current one. */
-    SAVE = 8,     /*!< Save the model on a file. */
-    EXIT = 9      /*!< Discard all and exit. */
+    COL_MULTI = 5, /*!< Color the model by distance from a set of points. */
+    COL_GEO,      /*!< Color the model by geodesic distance from a vertex. */
+    COL_FIELD,    /*!< Color the model by curvature or occlusion. */
+    COL_COMP,     /*!< Color each connected component of the model. */
+    COL_DEV,      /*!< Color the model by distance from a reference. */
+    INFO,         /*!< Show info about current model. */
+    ROTATE,       /*!< Show model in 3D viewer. */
+    ALIGN,        /*!< Align the principal axes with the coordinate axes. */
+    NORMALS,      /*!< Recompute the vertex normals from the faces. */
+    SMOOTH,       /*!< Smooth the surface, reducing the noise. */
+    SUBDIVIDE,    /*!< Split each face of the model in four. */
+    DECIMATE,     /*!< Reduce the number of faces of the model. */
+    LOD,          /*!< Save a chain of simplified copies of the model. */
+    WELD,         /*!< Merge the vertices sharing the same position. */
+    CLEANUP,      /*!< Remove degenerate faces and small components. */
+    ORIENT,       /*!< Make the winding of the faces consistent. */
+    REORDER,      /*!< Sort vertices and faces for memory locality. */
+    VCACHE,       /*!< Sort faces and vertices for GPU rendering. */
+    ANOTHER,      /*!< Pick another model, discarding the current one. */
+    SAVE,         /*!< Save the model on a file. */
+    EXIT          /*!< Discard all and exit. */
 } Action;
 
 /*! 
@@ -228,9 +265,21 @@ typedef enum Direction
     FB = 6  /*!< From front to back. */
 } Direction;
 
+/*! 
+ * Type for element counts and indices. It is 64 bit wide, so models with
+ * more than 2^31 vertices or faces are supported.
+ */
+typedef long long Index;
+
 /*! Define a type containing informations about the model. */
 typedef struct Info Info;
 
+/*! Define a type for a storage reserved for list items. */
+typedef struct Pool Pool;
+
+/*! Define a type for the connectivity of a model, see adjacency.h. */
+typedef struct Adjacency Adjacency;
+
 /*! Define a type representing a RGB color. */
 typedef struct ColorRGB ColorRGB;
 
@@ -267,6 +316,18 @@ struct Info
     double volume;       /*! Volume delimited by the model. */
 };
 
+/*!
+ * Type for a contiguous storage reserved for list items, in order to avoid 
+ * one allocation for each item. Items are taken in order, until the 
+ * storage is full.
+ */
+struct Pool
+{
+    void *items; /*!< Storage for the items. */
+    Index size;  /*!< Number of items which fit in the storage. */
+    Index used;  /*!< Number of items already taken. */
+};
+
 /*!
  * Type representing a 3D model.
  */
@@ -276,11 +337,21 @@ struct Model3D
     FILE *file_model;        /*!< Input file for current 3D model. */
     Face *faces_list;        /*!< Model faces. */
     Vertex *vertices_list;   /*!< Model vertices. */
-    int n_vertices;          /*!< Number of vertices. */
-    int n_faces;             /*!< Number of faces. */
+    Index n_vertices;        /*!< Number of vertices. */
+    Index n_faces;           /*!< Number of faces. */
     Vertex **vertices_array; /*!< A dinamycal array, indexing vertexes. */
     Face *last_face;         /*!< Pointer to the last face added to the list. */
     Vertex *last_vertex;     /*!< Pointer to the last vertex in the list. */
+    Pool vertex_pool;        /*!< Storage reserved for vertices. */
+    Pool face_pool;          /*!< Storage reserved for faces. */
+    void *indices;           /*!< Compact buffer with the three vertex indices
+                                 of each face, see model_build_indices(). */
+    int index_size;          /*!< Size in bytes of the entries of indices (4 
+                                 or 8), zero if the buffer is not built. */
+    Adjacency *adjacency;    /*!< Cached connectivity, NULL if not built, see
+                                 model_adjacency(). */
+    unsigned int seed;       /*!< State of the generator for random 
+                                 coloration, private to the model. */
     Info info;               /*!< Field containing informations on the current 
                                  model, see struct Info */
 };
@@ -300,11 +371,11 @@ struct ColorRGB
  */
 struct Face
 {
-    int index;      /*!< Face index. */
+    Index index;    /*!< Face index. */
     double surface; /*!< Face area. */
-    int v1;         /*!< First vertex index. */
-    int v2;         /*!< Second vertex index. */
-    int v3;         /*!< Third vertex index. */
+    Index v1;       /*!< First vertex index. */
+    Index v2;       /*!< Second vertex index. */
+    Index v3;       /*!< Third vertex index. */
     Vertex *v1p;    /*!< Pointer to first vertex. */
     Vertex *v2p;    /*!< Pointer to second vertex. */
     Vertex *v3p;    /*!< Pointer to third vertex. */
@@ -327,7 +398,7 @@ struct Point3D
  */
 struct Vertex
 {
-    int index;                 /*!< Vertex index. */
+    Index index;               /*!< Vertex index. */
     Point3D vertexCoordinates; /*!< Vertex coordinates. */
     Normal3D vertexNormals;    /*!< Vertex normal. */
     ColorRGB vertexColor;      /*!< Vertex color. */
@@ -360,13 +431,75 @@ int parse_model_data(Model3D *model);
  */
 void init_model(Model3D *myModel);
 
+/*!
+ * \brief Reserve contiguous storage for the vertices and faces to be added
+ * to a model.
+ * @param m Model for which reserve the storage.
+ * @param n_vertices Number of vertices.
+ * @param n_faces Number of faces.
+ * @return Zero on success, ERR_NO_MEMORY if the allocation failed.
+ * @note It must be called before adding any item to the model. Items added
+ * beyond the reserved number are allocated one by one.
+ */
+int model_reserve(Model3D *m, Index n_vertices, Index n_faces);
+
+/*!
+ * \brief Replace the vertices and faces of a model.
+ *
+ * This is the common path for the operations which change the model
+ * topology: the lists are rebuilt from the arrays, the derived data are
+ * discarded and the model info are computed again.
+ * @param m Model.
+ * @param vertices New vertices, in index order (the index and the list
+ * pointers of the items are ignored).
+ * @param n_vertices Number of vertices.
+ * @param faces Three vertex indices for each face.
+ * @param n_faces Number of faces.
+ * @return Zero on success, ERR_NO_MEMORY if an allocation failed, in which
+ * case the model is not changed.
+ */
+int model_replace(Model3D *m, const Vertex *vertices, Index n_vertices,
+        const Index *faces, Index n_faces);
+
+/*!
+ * \brief Build the compact index buffer of the model.
+ * @param m Model, whose indices field is filled.
+ * @return Zero on success, ERR_NO_MEMORY if the allocation failed.
+ * @note The buffer is kept until model_topology_changed(Model3D*) is called,
+ * so calling this function when it is already built costs nothing.
+ */
+int model_build_indices(Model3D *m);
+
+/*!
+ * \brief Get a vertex index from the compact index buffer.
+ * @param m Model, whose index buffer must be built.
+ * @param f Face index.
+ * @param k Position of the vertex in the face (0, 1 or 2).
+ * @return Index of the k-th vertex of the f-th face.
+ */
+static inline Index face_vertex(const Model3D *m, Index f, int k)
+{
+    if (m->index_size == 4)
+        return ((const uint32_t*) m->indices)[3 * f + k];
+    return ((const Index*) m->indices)[3 * f + k];
+}
+
+/*!
+ * \brief Discard the data derived from the model connectivity.
+ * @param m Model whose faces or vertices were added, removed or renumbered.
+ */
+void model_topology_changed(Model3D *m);
+
 
 /*! 
  * \brief Save the edited model in the desired file.
  * @param file Pointer to the file in which save the edited model.
  * @param myModel Model to be saved.
+ * @return Zero on success, ERR_INVALID_ARGUMENT if the vertex indices do
+ * not fit in the 32 bit integer types of the PLY format, nonzero if writing
+ * on the file failed.
  */
-void save_model(FILE *file, Model3D myModel);
+int save_model(FILE *file, Model3D *myModel);
 
 /*!
  * \brief Apply a flat coloration to the model.
@@ -374,17 +507,17 @@ void save_model(FILE *file, Model3D myModel);
  * @param c Desired color for coloration.
  * @return Zero if coloration was fine, nonzero otherwise.
  */
-int color_flat(Model3D myModel, ColorRGB c);
+int color_flat(Model3D *myModel, ColorRGB c);
 
 /*!
  * \brief Apply a random coloration to the model.
  * @param myModel Model to be colored.
  * @return Zero if coloration was fine, nonzero otherwise.
- * @note Before calling this function, or another function which depends on it,
- * srand(unsigned int) must be called at least once in order to inizialize the 
- * random number generator.
+ * @note The random sequence is taken from the seed field of the model, 
+ * which is initialized by init_model(Model3D*) with rand(), so srand(unsigned
+ * int) should be called at least once before initializing the model.
  */
-int color_random(Model3D myModel);
+int color_random(Model3D *myModel);
 
 /*!
  * \brief Apply a distance-based coloration to the model.
@@ -393,7 +526,43 @@ int color_random(Model3D myModel);
  * @param p Point to which the coloration is referred.
  * @return Zero if coloration was fine, nonzero otherwise.
  */
-int color_distance(Model3D myModel, ColorRGB c, Point3D p);
+int color_distance(Model3D *myModel, ColorRGB c, Point3D p);
+
+/*!
+ * \brief Apply a coloration based on the distance of each vertex from the
+ * nearest of a set of points.
+ * @param m Model to be colored.
+ * @param c Color of the vertices nearest to the points.
+ * @param p Reference points.
+ * @param n Number of reference points, must be positive.
+ * @return Zero if coloration was fine, -1 if all vertices are equidistant
+ * from the points, ERR_NO_MEMORY or ERR_INVALID_ARGUMENT on error.
+ */
+int color_distance_multi(Model3D *m, ColorRGB c, const Point3D *p, Index n);
+
+/*!
+ * \brief Color the model according to a scalar field defined on its
+ * vertices.
+ * @param m Model to be colored.
+ * @param c Color of the vertices with the lowest value.
+ * @param values Value of the field for each vertex, indexed by vertex index.
+ * @return Zero if coloration was fine, -1 if the field is constant.
+ * @note Vertices with the highest value are colored in white, and the
+ * others with a linear combination of the two colors.
+ */
+int color_scalar(Model3D *m, ColorRGB c, const double *values);
+
+/*!
+ * \brief Read a set of points from a text file.
+ * @param f File with one point per line, as three coordinates separated by
+ * spaces. Lines which do not begin with a point are ignored.
+ * @param p Pointer filled with a new array of points, to be freed by the
+ * caller.
+ * @param n Pointer filled with the number of points read.
+ * @return Zero on success, PARSER_ERR_NO_DATA if the file contains no
+ * point, ERR_NO_MEMORY if an allocation failed.
+ */
+int load_points(FILE *f, Point3D **p, Index *n);
 
 /*!
  * \brief Apply a gradient coloration to the model.
@@ -402,7 +571,7 @@ int color_distance(Model3D myModel, ColorRGB c, Point3D p);
  * @param d Direction in which shade the color.
  * @return Zero if coloration was fine, nonzero otherwise.
  */
-int color_gradient(Model3D myModel, ColorRGB c, Direction d);
+int color_gradient(Model3D *myModel, ColorRGB c, Direction d);
 
 /*!
  * \brief Compute distance coefficient for gradient coloration.
@@ -410,7 +579,7 @@ int color_gradient(Model3D myModel, ColorRGB c, Direction d);
  * @param v Current vertex to be colored.
  * @param d Direction for color gradient.
  */
-float distance_coefficient(Model3D m, Vertex *v, Direction d);
+float distance_coefficient(Model3D *m, Vertex *v, Direction d);
 
 /*!
  * \brief Drain the stdin buffer.
@@ -426,6 +595,17 @@ void clear_stdin(void);
  */
 void apply_transformation_matrix(float y[3], float a[3][3], float x[3]);
 
+/*!
+ * \brief Apply a linear transformation around a point to a model.
+ * @param m Model to be transformed.
+ * @param a Matrix of the transformation, applied to the vertex normals too,
+ * so it should be a rotation.
+ * @param o Fixed point of the transformation.
+ * @note The vertices info are not updated, see
+ * rescan_vertices_info(Model3D*).
+ */
+void transform_model(Model3D *m, float a[3][3], Point3D o);
+
 /*!
  * \brief Apply an arbitrary rotation to a model.
  * @param m Model to be rotated.
@@ -434,7 +614,7 @@ void apply_transformation_matrix(float y[3], float a[3][3], float x[3]);
  * @param theta Rotation angle in radians.
  * @return Zero if elaboration was done successfully, nonzero otherwise.
  */
-int rotation(Model3D m, Point3D o, Vector3D u, float theta);
+int rotation(Model3D *m, Point3D o, Vector3D u, float theta);
 
 /*!
  * \brief Search for vertices with maximum of minimum coordinates.
@@ -442,14 +622,22 @@ int rotation(Model3D m, Point3D o, Vector3D u, float theta);
  */
 void rescan_vertices_info(Model3D *myModel);
 
+/*!
+ * \brief Recompute the face surfaces, the total surface and the faces with
+ * maximum and minimum surface.
+ * @param myModel Model containing faces to be scanned.
+ */
+void rescan_faces_info(Model3D *myModel);
+
 /*!
  * \brief Add a vertex to the vertices list of the model.
  * @param model Model3D object containing model data.
  * @param item Vertex to be added to the list.
  * @param index Index of the vertex to be added.
- * @return A pointer to the allocation of the vertex.
+ * @return A pointer to the allocation of the vertex, or NULL if the
+ * allocation failed.
  */
-Vertex* vertex_add(Model3D *model, Vertex item, int index);
+Vertex* vertex_add(Model3D *model, Vertex item, Index index);
 
 /*!
  * \brief Get the pointer to a vertex in the desried position in the list.
@@ -457,13 +645,14 @@ Vertex* vertex_add(Model3D *model, Vertex item, int index);
  * @param n Index (position) of the item in the list, beginning from the
  * head (i.e. the first element added). The index is zero based.
  */
-Vertex* vertex_get(Vertex *l, int n);
+Vertex* vertex_get(Vertex *l, Index n);
 
 /*!
  * \brief Add a face to the faces list of the model.
  * @param model Model3D object containing model data.
  * @param item Face to be added to the list.
- * @return A pointer to the allocation of the face.
+ * @return A pointer to the allocation of the face, or NULL if the
+ * allocation failed.
  */
 Face* face_add(Model3D *model, Face item);
 
@@ -529,14 +718,17 @@ void face_to_string(char *s, Face *f);
  * @param caller Name of the caller of the failed function.
  * @param file Name of the file in which the failure happened.
  * @param line Line number of the failed function invocation.
- * @note This procedure causes the termination of the program.
+ * @note This procedure causes the termination of the program, so it is
+ * meant for the front-end only: backend functions return an error code 
+ * instead.
  */
 void error_handler(char *fun_name, const char *caller, char *file, int line);
 
 /*!
  * \brief Deallocate all dynamical resources owned by a Model3D object.
+ * @param m Model to be cleared.
  */
-void clear_model(Model3D m);
+void clear_model(Model3D *m);
 
 /*!
  * \brief Compute the mixed (box) product of three vectors 
@@ -557,7 +749,7 @@ double mixed_product(Point3D a, Point3D b, Point3D c);
  * vertices of each face have a consistent order, with face normal according
  * to the right hand rule or to its opposite in the same way for all faces.
  */
-double model_volume(Model3D m);
+double model_volume(Model3D *m);
 
 /*!
  * \brief Approximate the volume subtended by the model.
@@ -568,10 +760,12 @@ double model_volume(Model3D m);
  * normals; a formal evaluation of the error was not done, but for the sample 
  * models it may be around 7-10%.
  */
-double model_volume_approx(Model3D m);
+double model_volume_approx(Model3D *m);
 
 /*!
  * \brief Compute info about the input model.
  * @param m Pointer to the model.
  */
 void model_info(Model3D *m);
+
+#endif // BACKEND_H
@@ -0,0 +1,472 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) Martino Pilia, 2015
+ */
+
+/*!
+ * \file bench.c
+ *
+ * Benchmark driver for the backend. It generates deterministic synthetic
+ * meshes, runs each backend operation on them a number of times, and
+ * writes median and 95th percentile of the execution times on stdout, one
+ * JSON object per line.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "backend.h"
+#include "profile.h"
+
+/*! Default number of repetitions for each measure. */
+#define BENCH_REPS 5
+
+/*! Maximum number of mesh sizes accepted on the command line. */
+#define BENCH_MAX_SIZES 16
+
+/*!
+ * Type for the kind of synthetic mesh.
+ */
+typedef enum MeshKind
+{
+    MESH_SPHERE = 0, /*!< Sphere subdivided in latitude and longitude. */
+    MESH_TERRAIN,    /*!< Regular grid with a height field. */
+    MESH_SOUP,       /*!< Independent random triangles. */
+    MESH_KINDS       /*!< Number of mesh kinds, not a real kind. */
+} MeshKind;
+
+/*! Names of the mesh kinds, used on the command line and in the output. */
+static const char *mesh_names[MESH_KINDS] = {"sphere", "terrain", "soup"};
+
+/*!
+ * Type for the operations measured by the benchmark.
+ */
+typedef enum BenchOp
+{
+    OP_PARSE_ASCII = 0,
+    OP_INFO,
+    OP_COLOR_FLAT,
+    OP_COLOR_RANDOM,
+    OP_COLOR_DISTANCE,
+    OP_COLOR_GRADIENT,
+    OP_ROTATION,
+    OP_SAVE,
+    OP_COUNT
+} BenchOp;
+
+/*! Names of the operations in the output. */
+static const char *op_names[OP_COUNT] =
+{
+    "parse_ascii",
+    "model_info",
+    "color_flat",
+    "color_random",
+    "color_distance",
+    "color_gradient",
+    "rotation",
+    "save",
+};
+
+/*! State of the pseudo-random generator, fixed for reproducibility. */
+static unsigned long long rng_state;
+
+/*!
+ * Xorshift generator, returning a uniform value in [0,1). It is used instead
+ * of rand() so that meshes are identical on every platform.
+ */
+static double rng_next(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return (rng_state >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/*!
+ * Write the header of an ASCII .ply file with the same vertex properties
+ * read by parse_model_data().
+ */
+static void write_header(FILE *f, long long n_vertices, long long n_faces)
+{
+    fprintf(f,
+            "ply\n"
+            "format ascii 1.0\n"
+            "element vertex %lld\n"
+            "property float x\n"
+            "property float y\n"
+            "property float z\n"
+            "property float nx\n"
+            "property float ny\n"
+            "property float nz\n"
+            "element face %lld\n"
+            "property list uchar int vertex_indices\n"
+            "end_header\n",
+            n_vertices,
+            n_faces);
+}
+
+/*!
+ * Write a unit sphere with r rings and 2r segments. The two poles are
+ * single vertices, so the surface is closed. The number of faces is
+ * 4r(r - 1).
+ */
+static void generate_sphere(FILE *f, long long target)
+{
+    long long r = (long long) (0.5 + sqrt(target / 4.0)) + 1;
+    long long s = 2 * r;
+    long long i, j, a, b;
+    double th, ph;
+
+    write_header(f, s * (r - 1) + 2, 2 * s * (r - 1));
+
+    /* vertices: north pole, rings, south pole (normal equals position) */
+    fprintf(f, "0 0 1 0 0 1\n");
+    for (i = 1; i < r; ++i)
+    {
+        th = M_PI * i / r;
+        for (j = 0; j < s; ++j)
+        {
+            ph = 2 * M_PI * j / s;
+            fprintf(f, "%.7g %.7g %.7g %.7g %.7g %.7g\n",
+                    sin(th) * cos(ph), sin(th) * sin(ph), cos(th),
+                    sin(th) * cos(ph), sin(th) * sin(ph), cos(th));
+        }
+    }
+    fprintf(f, "0 0 -1 0 0 -1\n");
+
+    /* faces: caps and quads between consecutive rings */
+    for (j = 0; j < s; ++j)
+        fprintf(f, "3 0 %lld %lld\n", 1 + j, 1 + (j + 1) % s);
+
+    for (i = 1; i < r - 1; ++i)
+    {
+        for (j = 0; j < s; ++j)
+        {
+            a = 1 + (i - 1) * s;
+            b = 1 + i * s;
+            fprintf(f, "3 %lld %lld %lld\n3 %lld %lld %lld\n",
+                    a + j, b + j, b + (j + 1) % s,
+                    a + j, b + (j + 1) % s, a + (j + 1) % s);
+        }
+    }
+
+    a = 1 + (r - 2) * s;
+    for (j = 0; j < s; ++j)
+        fprintf(f, "3 %lld %lld %lld\n",
+                s * (r - 1) + 1, a + (j + 1) % s, a + j);
+}
+
+/*!
+ * Write a square n x n grid on the xz plane, displaced along y by a smooth
+ * height field with some deterministic noise. The number of faces is
+ * 2(n - 1)^2.
+ */
+static void generate_terrain(FILE *f, long long target)
+{
+    long long n = (long long) (sqrt(target / 2.0) + 0.5) + 1;
+    long long i, j, a;
+    double x, z, y, dx, dz, norm;
+
+    write_header(f, n * n, 2 * (n - 1) * (n - 1));
+
+    for (i = 0; i < n; ++i)
+    {
+        for (j = 0; j < n; ++j)
+        {
+            x = (double) j / (n - 1);
+            z = (double) i / (n - 1);
+            y = 0.1 * sin(6 * x) * cos(4 * z) + 0.005 * rng_next();
+
+            /* analytic normal of the smooth part of the height field */
+            dx = 0.6 * cos(6 * x) * cos(4 * z);
+            dz = -0.4 * sin(6 * x) * sin(4 * z);
+            norm = sqrt(dx * dx + 1 + dz * dz);
+
+            fprintf(f, "%.7g %.7g %.7g %.7g %.7g %.7g\n",
+                    x, y, z, -dx / norm, 1 / norm, -dz / norm);
+        }
+    }
+
+    for (i = 0; i < n - 1; ++i)
+    {
+        for (j = 0; j < n - 1; ++j)
+        {
+            a = i * n + j;
+            fprintf(f, "3 %lld %lld %lld\n3 %lld %lld %lld\n",
+                    a, a + n, a + n + 1,
+                    a, a + n + 1, a + 1);
+        }
+    }
+}
+
+/*!
+ * Write a soup of independent triangles with vertices uniformly distributed
+ * in the unit cube. Each face has its own three vertices.
+ */
+static void generate_soup(FILE *f, long long target)
+{
+    long long i;
+    double p[9], u[3], v[3], n[3], norm;
+    int k;
+
+    write_header(f, 3 * target, target);
+
+    for (i = 0; i < target; ++i)
+    {
+        for (k = 0; k < 9; ++k)
+            p[k] = rng_next();
+
+        for (k = 0; k < 3; ++k)
+        {
+            u[k] = p[3 + k] - p[k];
+            v[k] = p[6 + k] - p[k];
+        }
+        n[0] = u[1] * v[2] - u[2] * v[1];
+        n[1] = u[2] * v[0] - u[0] * v[2];
+        n[2] = u[0] * v[1] - u[1] * v[0];
+        norm = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (norm == 0)
+            norm = 1;
+
+        for (k = 0; k < 3; ++k)
+            fprintf(f, "%.7g %.7g %.7g %.7g %.7g %.7g\n",
+                    p[3 * k], p[3 * k + 1], p[3 * k + 2],
+                    n[0] / norm, n[1] / norm, n[2] / norm);
+    }
+
+    for (i = 0; i < target; ++i)
+        fprintf(f, "3 %lld %lld %lld\n", 3 * i, 3 * i + 1, 3 * i + 2);
+}
+
+/*!
+ * Generate the desired mesh on a temporary file, rewound and ready to be
+ * parsed.
+ */
+static FILE* generate(MeshKind kind, long long target)
+{
+    FILE *f = tmpfile();
+
+    if (f == NULL)
+        return NULL;
+
+    rng_state = 0x9E3779B97F4A7C15ULL;
+
+    switch (kind)
+    {
+        case MESH_SPHERE:
+            generate_sphere(f, target);
+            break;
+        case MESH_TERRAIN:
+            generate_terrain(f, target);
+            break;
+        case MESH_SOUP:
+            generate_soup(f, target);
+            break;
+        default:
+            break;
+    }
+
+    rewind(f);
+    return f;
+}
+
+/*!
+ * Comparison function for qsort() on doubles.
+ */
+static int compare_double(const void *a, const void *b)
+{
+    double x = *(const double*) a, y = *(const double*) b;
+    return (x > y) - (x < y);
+}
+
+/*!
+ * Return the p-th percentile of n sorted samples, with the nearest-rank
+ * definition.
+ */
+static double percentile(const double *t, int n, double p)
+{
+    int k = (int) ceil(p / 100.0 * n) - 1;
+    return t[k < 0 ? 0 : k];
+}
+
+/*!
+ * Run all the operations on a mesh for the desired number of repetitions,
+ * then write one line of results for each operation.
+ */
+static int run(MeshKind kind, long long target, int reps)
+{
+    double times[OP_COUNT][reps];
+    double t;
+    int i, k;
+    long long n_vertices = 0, n_faces = 0;
+    Model3D m;
+    ColorRGB c = {255, 0, 0};
+    Point3D p = {1, 2, 3};
+    Point3D o = {0, 0, 0};
+    Vector3D u = {1, 1, 1};
+    FILE *in, *out;
+
+    in = generate(kind, target);
+    out = tmpfile();
+    if (in == NULL || out == NULL)
+    {
+        perror("bench: unable to create temporary files");
+        return 1;
+    }
+
+    for (i = 0; i < reps; ++i)
+    {
+        rewind(in);
+        rewind(out);
+        init_model(&m);
+        m.file_model = in;
+        strcpy(m.filename, mesh_names[kind]);
+
+        t = profile_clock();
+        if (parse_model_data(&m) != 0)
+        {
+            fprintf(stderr, "bench: unable to parse %s mesh\n",
+                    mesh_names[kind]);
+            return 1;
+        }
+        times[OP_PARSE_ASCII][i] = profile_clock() - t;
+
+        t = profile_clock();
+        model_info(&m);
+        times[OP_INFO][i] = profile_clock() - t;
+
+        t = profile_clock();
+        color_flat(&m, c);
+        times[OP_COLOR_FLAT][i] = profile_clock() - t;
+
+        t = profile_clock();
+        color_random(&m);
+        times[OP_COLOR_RANDOM][i] = profile_clock() - t;
+
+        t = profile_clock();
+        color_distance(&m, c, p);
+        times[OP_COLOR_DISTANCE][i] = profile_clock() - t;
+
+        t = profile_clock();
+        color_gradient(&m, c, BT);
+        times[OP_COLOR_GRADIENT][i] = profile_clock() - t;
+
+        t = profile_clock();
+        rotation(&m, o, u, 0.5);
+        times[OP_ROTATION][i] = profile_clock() - t;
+
+        t = profile_clock();
+        save_model(out, &m);
+        times[OP_SAVE][i] = profile_clock() - t;
+
+        n_vertices = m.n_vertices;
+        n_faces = m.n_faces;
+        clear_model(&m);
+    }
+
+    for (k = 0; k < OP_COUNT; ++k)
+    {
+        qsort(times[k], reps, sizeof (double), compare_double);
+        printf("{\"mesh\": \"%s\", \"vertices\": %lld, \"faces\": %lld, "
+                "\"op\": \"%s\", \"reps\": %d, \"median_s\": %.9f, "
+                "\"p95_s\": %.9f}\n",
+                mesh_names[kind],
+                n_vertices,
+                n_faces,
+                op_names[k],
+                reps,
+                percentile(times[k], reps, 50),
+                percentile(times[k], reps, 95));
+    }
+    fflush(stdout);
+
+    fclose(in);
+    fclose(out);
+    return 0;
+}
+
+/*!
+ * Show the command line syntax.
+ */
+static void usage(const char *name)
+{
+    fprintf(stderr,
+            "Usage: %s [-r REPS] [-m MESH] [SIZE...]\n"
+            "  -r REPS  repetitions for each measure (default %d)\n"
+            "  -m MESH  sphere, terrain or soup (default: all)\n"
+            "  SIZE     approximate number of triangles, e.g. 1e6 "
+            "(default: 1e4 1e5 1e6)\n",
+            name,
+            BENCH_REPS);
+}
+
+int main(int argc, char *argv[])
+{
+    long long sizes[BENCH_MAX_SIZES] = {10000, 100000, 1000000};
+    int n_sizes = 3, custom_sizes = 0;
+    int reps = BENCH_REPS;
+    int kind = -1;
+    int i, j;
+
+    for (i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+        {
+            reps = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc)
+        {
+            ++i;
+            for (kind = 0; kind < MESH_KINDS; ++kind)
+                if (strcmp(argv[i], mesh_names[kind]) == 0)
+                    break;
+            if (kind == MESH_KINDS)
+            {
+                usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        }
+        else if (argv[i][0] != '-' && n_sizes < BENCH_MAX_SIZES)
+        {
+            if (!custom_sizes)
+                n_sizes = 0; /* replace the default sizes */
+            custom_sizes = 1;
+            sizes[n_sizes++] = (long long) atof(argv[i]);
+        }
+        else
+        {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (reps < 1)
+    {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    /* fixed seed, so color_random() does the same work on each run */
+    srand(1);
+
+    for (j = 0; j < n_sizes; ++j)
+        for (i = 0; i < MESH_KINDS; ++i)
+            if ((kind < 0 || kind == i) && run(i, sizes[j], reps))
+                return EXIT_FAILURE;
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,925 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) Martino Pilia, 2015
+ */
+
+
+/*!
+ * \file bvh.c
+ */
+
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+
+#include "bvh.h"
+
+/*!
+ * Size of the traversal stack. The depth of the hierarchy is at most
+ * SAH_MAX_DEPTH plus the depth of a balanced hierarchy below it.
+ */
+#define STACK_SIZE 128
+
+/*!
+ * Depth from which nodes are split at the median instead of with the
+ * surface area heuristic, which bounds the depth whatever the distribution
+ * of the faces.
+ */
+#define SAH_MAX_DEPTH 64
+
+/*! Minimum number of faces of a node whose subtrees are built by two tasks. */
+#define TASK_MIN_FACES 4096
+
+/*!
+ * Type for a face during the construction, with its bounding box and
+ * centroid, so that the faces of a node are read sequentially.
+ */
+typedef struct FaceRef
+{
+    float min[3];      /*!< Minimum corner of the bounding box. */
+    float max[3];      /*!< Maximum corner of the bounding box. */
+    float centroid[3]; /*!< Centroid of the face. */
+    Index face;        /*!< Face index. */
+} FaceRef;
+
+/*!
+ * Data shared by the recursive steps of the construction. The subtree of a
+ * node over n faces has at most 2n - 1 nodes, so each node reserves a range
+ * of that size for its subtree, and the subtrees can be built concurrently
+ * in a layout which does not depend on the scheduling. The unused nodes
+ * are removed at the end.
+ */
+typedef struct BuildContext
+{
+    BvhNode *nodes;      /*!< Nodes, with gaps between the subtrees. */
+    unsigned char *used; /*!< Nonzero for each node actually built. */
+    FaceRef *refs;       /*!< Faces, reordered during the construction. */
+} BuildContext;
+
+/*!
+ * Type for a bin of the centroids of a node along an axis.
+ */
+typedef struct Bin
+{
+    float min[3]; /*!< Minimum corner of the faces of the bin. */
+    float max[3]; /*!< Maximum corner of the faces of the bin. */
+    Index count;  /*!< Number of faces in the bin. */
+} Bin;
+
+/*!
+ * Return the coordinates of the k-th vertex of a face as an array.
+ */
+static const float* corner(Model3D *m, Index f, int k)
+{
+    return &m->vertices_array[face_vertex(m, f, k)]->vertexCoordinates.x;
+}
+
+/*!
+ * Minimum of two values (fminf() also handles NaN, which is slower and not
+ * needed here).
+ */
+static float min_f(float a, float b)
+{
+    return a < b ? a : b;
+}
+
+/*!
+ * Maximum of two values.
+ */
+static float max_f(float a, float b)
+{
+    return a > b ? a : b;
+}
+
+/*!
+ * Half the surface area of a box, zero for an empty one.
+ */
+static float half_area(const float min[3], const float max[3])
+{
+    float dx = max[0] - min[0], dy = max[1] - min[1], dz = max[2] - min[2];
+
+    if (dx < 0 || dy < 0 || dz < 0)
+        return 0;
+
+    return dx * dy + dy * dz + dz * dx;
+}
+
+/*!
+ * Return the bin of a centroid coordinate.
+ */
+static int bin_of(float c, float cmin, float scale)
+{
+    int bin = (int) ((c - cmin) * scale);
+
+    return bin < BVH_BINS - 1 ? bin : BVH_BINS - 1;
+}
+
+/*!
+ * Exchange two faces.
+ */
+static void swap(FaceRef *r, Index i, Index j)
+{
+    FaceRef tmp = r[i];
+
+    r[i] = r[j];
+    r[j] = tmp;
+}
+
+/*!
+ * Partially sort the faces in [lo, hi) by centroid along an axis, so that
+ * the k-th position holds the face it would hold if the range was sorted.
+ */
+static void select_kth(FaceRef *r, Index lo, Index hi, Index k, int axis)
+{
+    Index i, j;
+    float pivot;
+
+    while (hi - lo > 1)
+    {
+        /* middle element as pivot, placed at lo */
+        swap(r, lo, lo + (hi - lo) / 2);
+        pivot = r[lo].centroid[axis];
+
+        i = lo;
+        for (j = lo + 1; j < hi; ++j)
+            if (r[j].centroid[axis] < pivot)
+                swap(r, ++i, j);
+        swap(r, lo, i);
+
+        if (i == k)
+            return;
+        if (k < i)
+            hi = i;
+        else
+            lo = i + 1;
+    }
+}
+
+/*!
+ * Find the cheapest split of the faces of a node among the bin boundaries
+ * along the three axes, with the cost estimated by the surface area
+ * heuristic as the sum of the area of each side times its number of faces.
+ * The bins of the three axes are filled in a single pass over the faces.
+ * Return the axis, or -1 if the centroids cannot be separated, and fill
+ * split with the last bin of the left side.
+ */
+static int best_split(const FaceRef *r, Index count, const float cmin[3],
+        const float cmax[3], int *split)
+{
+    Bin bins[3][BVH_BINS];
+    float left_area[BVH_BINS];
+    Index left_count[BVH_BINS];
+    float scale[3], lmin[3], lmax[3], cost, best = FLT_MAX;
+    Bin *bin;
+    Index i, n;
+    int a, k, j, axis = -1;
+
+    for (a = 0; a < 3; ++a)
+    {
+        scale[a] = cmax[a] > cmin[a] ? BVH_BINS / (cmax[a] - cmin[a]) : 0;
+        for (k = 0; k < BVH_BINS; ++k)
+        {
+            bins[a][k].count = 0;
+            for (j = 0; j < 3; ++j)
+            {
+                bins[a][k].min[j] = FLT_MAX;
+                bins[a][k].max[j] = -FLT_MAX;
+            }
+        }
+    }
+
+    for (i = 0; i < count; ++i)
+    {
+        for (a = 0; a < 3; ++a)
+        {
+            bin = &bins[a][bin_of(r[i].centroid[a], cmin[a], scale[a])];
+            ++bin->count;
+            for (j = 0; j < 3; ++j)
+            {
+                bin->min[j] = min_f(bin->min[j], r[i].min[j]);
+                bin->max[j] = max_f(bin->max[j], r[i].max[j]);
+            }
+        }
+    }
+
+    for (a = 0; a < 3; ++a)
+    {
+        if (scale[a] == 0)
+            continue;
+
+        /* sweep from the left, then from the right evaluating the cost */
+        n = 0;
+        for (j = 0; j < 3; ++j)
+        {
+            lmin[j] = FLT_MAX;
+            lmax[j] = -FLT_MAX;
+        }
+        for (k = 0; k < BVH_BINS - 1; ++k)
+        {
+            n += bins[a][k].count;
+            for (j = 0; j < 3; ++j)
+            {
+                lmin[j] = min_f(lmin[j], bins[a][k].min[j]);
+                lmax[j] = max_f(lmax[j], bins[a][k].max[j]);
+            }
+            left_area[k] = half_area(lmin, lmax);
+            left_count[k] = n;
+        }
+
+        n = 0;
+        for (j = 0; j < 3; ++j)
+        {
+            lmin[j] = FLT_MAX;
+            lmax[j] = -FLT_MAX;
+        }
+        for (k = BVH_BINS - 1; k > 0; --k)
+        {
+            n += bins[a][k].count;
+            for (j = 0; j < 3; ++j)
+            {
+                lmin[j] = min_f(lmin[j], bins[a][k].min[j]);
+                lmax[j] = max_f(lmax[j], bins[a][k].max[j]);
+            }
+            if (n == 0 || left_count[k - 1] == 0)
+                continue;
+            cost = left_area[k - 1] * left_count[k - 1]
+                + half_area(lmin, lmax) * n;
+            if (cost < best)
+            {
+                best = cost;
+                axis = a;
+                *split = k - 1;
+            }
+        }
+    }
+
+    return axis;
+}
+
+/*!
+ * Compute the bounding box of the faces of a node, then split them with
+ * the surface area heuristic, or at the median centroid along the axis of
+ * largest centroid extent when the heuristic finds no split or the node is
+ * too deep. The subtrees of large nodes are built by separate tasks.
+ */
+static void build_node(BuildContext *b, Index node, Index first, Index count,
+        int depth)
+{
+    BvhNode *n = &b->nodes[node];
+    FaceRef *r = &b->refs[first];
+    float cmin[3] = {FLT_MAX, FLT_MAX, FLT_MAX};
+    float cmax[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+    float scale;
+    Index i, j, left = 0, right;
+    int a, axis = -1, split = 0;
+
+    b->used[node] = 1;
+
+    for (a = 0; a < 3; ++a)
+    {
+        n->min[a] = FLT_MAX;
+        n->max[a] = -FLT_MAX;
+    }
+
+    for (i = 0; i < count; ++i)
+    {
+        for (a = 0; a < 3; ++a)
+        {
+            n->min[a] = min_f(n->min[a], r[i].min[a]);
+            n->max[a] = max_f(n->max[a], r[i].max[a]);
+            cmin[a] = min_f(cmin[a], r[i].centroid[a]);
+            cmax[a] = max_f(cmax[a], r[i].centroid[a]);
+        }
+    }
+
+    if (count <= BVH_LEAF_SIZE)
+    {
+        n->first = first;
+        n->count = count;
+        return;
+    }
+
+    if (depth < SAH_MAX_DEPTH)
+        axis = best_split(r, count, cmin, cmax, &split);
+
+    if (axis >= 0)
+    {
+        /* move the faces of the bins up to split to the front */
+        scale = BVH_BINS / (cmax[axis] - cmin[axis]);
+        i = 0;
+        j = count - 1;
+        while (i <= j)
+        {
+            if (bin_of(r[i].centroid[axis], cmin[axis], scale) <= split)
+                ++i;
+            else
+                swap(r, i, j--);
+        }
+        left = i;
+    }
+
+    if (left == 0 || left == count)
+    {
+        axis = 0;
+        for (a = 1; a < 3; ++a)
+            if (cmax[a] - cmin[a] > cmax[axis] - cmin[axis])
+                axis = a;
+        /* coincident centroids can be split anywhere */
+        if (cmax[axis] > cmin[axis])
+            select_kth(r, 0, count, count / 2, axis);
+        left = count / 2;
+    }
+
+    right = node + 2 * left;
+    n->first = right;
+    n->count = 0;
+
+    if (count >= TASK_MIN_FACES)
+    {
+        #pragma omp task
+        build_node(b, node + 1, first, left, depth + 1);
+        build_node(b, right, first + left, count - left, depth + 1);
+    }
+    else
+    {
+        build_node(b, node + 1, first, left, depth + 1);
+        build_node(b, right, first + left, count - left, depth + 1);
+    }
+}
+
+/*!
+ * Compute bounding boxes and centroids of the faces, build the nodes with
+ * reserved ranges, then compact them in depth-first order and copy the
+ * triangles of each leaf in a pack.
+ */
+int bvh_build(Bvh *t, Model3D *m)
+{
+    BuildContext b;
+    BvhNode node;
+    Index *map, *leaves;
+    const float *p;
+    Index F = m->n_faces, f, i, n_nodes = 0, n_packs = 0;
+    int k, a, l;
+
+    t->nodes = NULL;
+    t->packs = NULL;
+    t->faces = NULL;
+    t->n_nodes = 0;
+    t->n_packs = 0;
+    t->n_tris = 0;
+
+    if (F <= 0)
+        return ERR_INVALID_ARGUMENT;
+
+    if (model_build_indices(m))
+        return ERR_NO_MEMORY;
+
+    b.nodes = (BvhNode*) malloc(2 * F * sizeof (BvhNode));
+    b.used = (unsigned char*) calloc(2 * F, 1);
+    b.refs = (FaceRef*) malloc(F * sizeof (FaceRef));
+    map = (Index*) malloc(2 * F * sizeof (Index));
+
+    if (b.nodes == NULL || b.used == NULL || b.refs == NULL || map == NULL)
+    {
+        free(b.nodes);
+        free(b.used);
+        free(b.refs);
+        free(map);
+        return ERR_NO_MEMORY;
+    }
+
+    #pragma omp parallel for schedule(static) private(k, a, p)
+    for (f = 0; f < F; ++f)
+    {
+        b.refs[f].face = f;
+        for (a = 0; a < 3; ++a)
+        {
+            b.refs[f].min[a] = FLT_MAX;
+            b.refs[f].max[a] = -FLT_MAX;
+            b.refs[f].centroid[a] = 0;
+        }
+        for (k = 0; k < 3; ++k)
+        {
+            p = corner(m, f, k);
+            for (a = 0; a < 3; ++a)
+            {
+                b.refs[f].min[a] = min_f(b.refs[f].min[a], p[a]);
+                b.refs[f].max[a] = max_f(b.refs[f].max[a], p[a]);
+                b.refs[f].centroid[a] += p[a] / 3;
+            }
+        }
+    }
+
+    #pragma omp parallel
+    {
+        #pragma omp single
+        build_node(&b, 0, 0, F, 0);
+    }
+
+    /* number the nodes built, in depth-first order */
+    for (i = 0; i < 2 * F - 1; ++i)
+    {
+        if (!b.used[i])
+            continue;
+        map[i] = n_nodes++;
+        if (b.nodes[i].count > 0)
+            ++n_packs;
+    }
+
+    t->nodes = (BvhNode*) malloc(n_nodes * sizeof (BvhNode));
+    t->packs = (BvhPack*) malloc(n_packs * sizeof (BvhPack));
+    t->faces = (Index*) malloc(BVH_LEAF_SIZE * n_packs * sizeof (Index));
+    leaves = (Index*) malloc(2 * n_packs * sizeof (Index));
+
+    if (t->nodes == NULL || t->packs == NULL || t->faces == NULL
+            || leaves == NULL)
+    {
+        free(b.nodes);
+        free(b.used);
+        free(b.refs);
+        free(map);
+        free(leaves);
+        bvh_free(t);
+        return ERR_NO_MEMORY;
+    }
+
+    /* keep the range of faces of each leaf, which are still in the
+     * reordered array, to fill its pack */
+    n_packs = 0;
+    for (i = 0; i < 2 * F - 1; ++i)
+    {
+        if (!b.used[i])
+            continue;
+        node = b.nodes[i];
+        if (node.count == 0)
+            node.first = map[node.first];
+        else
+        {
+            leaves[2 * n_packs] = node.first;
+            leaves[2 * n_packs + 1] = node.count;
+            node.first = n_packs++;
+        }
+        t->nodes[map[i]] = node;
+    }
+
+    #pragma omp parallel for schedule(static) private(f, a, l, p)
+    for (i = 0; i < n_packs; ++i)
+    {
+        for (l = 0; l < BVH_LEAF_SIZE; ++l)
+        {
+            if (l >= leaves[2 * i + 1])
+            {
+                t->faces[BVH_LEAF_SIZE * i + l] = -1;
+                for (a = 0; a < 3; ++a)
+                {
+                    t->packs[i].v0[a][l] = 0;
+                    t->packs[i].e1[a][l] = 0;
+                    t->packs[i].e2[a][l] = 0;
+                }
+                continue;
+            }
+
+            f = b.refs[leaves[2 * i] + l].face;
+            t->faces[BVH_LEAF_SIZE * i + l] = f;
+            p = corner(m, f, 0);
+            for (a = 0; a < 3; ++a)
+            {
+                t->packs[i].v0[a][l] = p[a];
+                t->packs[i].e1[a][l] = corner(m, f, 1)[a] - p[a];
+                t->packs[i].e2[a][l] = corner(m, f, 2)[a] - p[a];
+            }
+        }
+    }
+
+    free(b.nodes);
+    free(b.used);
+    free(b.refs);
+    free(map);
+    free(leaves);
+
+    t->n_nodes = n_nodes;
+    t->n_packs = n_packs;
+    t->n_tris = F;
+
+    return 0;
+}
+
+/*!
+ * Slab test between a ray and a box, for distances in [0, t_max]. Return
+ * the distance at which the ray enters the box, or FLT_MAX if it misses
+ * the box.
+ */
+static float box_entry(const BvhNode *n, const float o[3], const float inv[3],
+        float t_max)
+{
+    float t0 = 0, t1 = t_max, near, far, tmp;
+    int a;
+
+    for (a = 0; a < 3; ++a)
+    {
+        near = (n->min[a] - o[a]) * inv[a];
+        far = (n->max[a] - o[a]) * inv[a];
+        if (near > far)
+        {
+            tmp = near;
+            near = far;
+            far = tmp;
+        }
+        t0 = near > t0 ? near : t0;
+        t1 = far < t1 ? far : t1;
+        if (t0 > t1)
+            return FLT_MAX;
+    }
+
+    return t0;
+}
+
+/*!
+ * Intersection between a ray and the triangles of a pack (Moller-Trumbore
+ * algorithm). The lanes are computed without branches, so the loop can be
+ * vectorized, and the nearest hit is chosen at the end. Return the lane of
+ * the nearest hit within t_max, or -1 if the ray misses all the triangles.
+ */
+static int pack_hit(const BvhPack *p, const float o[3], const float d[3],
+        float t_max, float *t_hit)
+{
+    float t[BVH_LEAF_SIZE];
+    float px, py, pz, qx, qy, qz, sx, sy, sz, det, inv, u, v, w;
+    int l, best = -1;
+
+    #pragma omp simd private(px, py, pz, qx, qy, qz, sx, sy, sz, det, inv, \
+            u, v, w)
+    for (l = 0; l < BVH_LEAF_SIZE; ++l)
+    {
+        px = d[1] * p->e2[2][l] - d[2] * p->e2[1][l];
+        py = d[2] * p->e2[0][l] - d[0] * p->e2[2][l];
+        pz = d[0] * p->e2[1][l] - d[1] * p->e2[0][l];
+        det = p->e1[0][l] * px + p->e1[1][l] * py + p->e1[2][l] * pz;
+        inv = 1 / det;
+
+        sx = o[0] - p->v0[0][l];
+        sy = o[1] - p->v0[1][l];
+        sz = o[2] - p->v0[2][l];
+        u = (sx * px + sy * py + sz * pz) * inv;
+
+        qx = sy * p->e1[2][l] - sz * p->e1[1][l];
+        qy = sz * p->e1[0][l] - sx * p->e1[2][l];
+        qz = sx * p->e1[1][l] - sy * p->e1[0][l];
+        v = (d[0] * qx + d[1] * qy + d[2] * qz) * inv;
+        w = (p->e2[0][l] * qx + p->e2[1][l] * qy + p->e2[2][l] * qz) * inv;
+
+        /* a ray parallel to the plane (or a degenerate lane) has det = 0,
+         * and fails the tests with infinite or undefined values; the tests
+         * are combined with bitwise operators, which do not branch */
+        t[l] = ((det != 0) & (u >= 0) & (v >= 0) & (u + v <= 1) & (w > 0))
+            ? w : FLT_MAX;
+    }
+
+    for (l = 0; l < BVH_LEAF_SIZE; ++l)
+    {
+        if (t[l] < t_max)
+        {
+            t_max = t[l];
+            best = l;
+        }
+    }
+
+    *t_hit = t_max;
+
+    return best;
+}
+
+/*!
+ * Traverse the hierarchy front to back: at each inner node the nearer
+ * child is visited first and the farther one is pushed on the stack with
+ * its entry distance, so that it is skipped if a nearer triangle is found
+ * meanwhile. When any_hit is nonzero the traversal stops at the first
+ * intersection.
+ */
+static Index traverse(const Bvh *t, Point3D origin, Vector3D dir,
+        float t_max, float *t_hit, int any_hit)
+{
+    Index stack[STACK_SIZE];
+    float stack_t[STACK_SIZE];
+    Index node = 0, l, r, hit = -1;
+    int sp = 0, lane;
+    float o[3] = {origin.x, origin.y, origin.z};
+    float d[3] = {dir.x, dir.y, dir.z};
+    float inv[3] = {1 / dir.x, 1 / dir.y, 1 / dir.z};
+    float tl, tr, dist;
+    const BvhNode *n;
+
+    if (box_entry(&t->nodes[0], o, inv, t_max) == FLT_MAX)
+        return -1;
+
+    for (;;)
+    {
+        n = &t->nodes[node];
+
+        if (n->count == 0)
+        {
+            l = node + 1;
+            r = n->first;
+            tl = box_entry(&t->nodes[l], o, inv, t_max);
+            tr = box_entry(&t->nodes[r], o, inv, t_max);
+
+            if (tl != FLT_MAX && tr != FLT_MAX)
+            {
+                stack[sp] = tl <= tr ? r : l;
+                stack_t[sp++] = tl <= tr ? tr : tl;
+                node = tl <= tr ? l : r;
+                continue;
+            }
+            if (tl != FLT_MAX || tr != FLT_MAX)
+            {
+                node = tl != FLT_MAX ? l : r;
+                continue;
+            }
+        }
+        else
+        {
+            lane = pack_hit(&t->packs[n->first], o, d, t_max, &dist);
+            if (lane >= 0)
+            {
+                t_max = dist;
+                hit = BVH_LEAF_SIZE * n->first + lane;
+                if (any_hit)
+                    break;
+            }
+        }
+
+        /* pop the next node which may still hold a nearer triangle */
+        while (sp > 0 && stack_t[sp - 1] >= t_max)
+            --sp;
+        if (sp == 0)
+            break;
+        node = stack[--sp];
+    }
+
+    if (hit == -1)
+        return -1;
+
+    if (t_hit != NULL)
+        *t_hit = t_max;
+
+    return t->faces[hit];
+}
+
+/*!
+ * Closest hit traversal.
+ */
+Index bvh_intersect(const Bvh *t, Point3D o, Vector3D d, float t_max,
+        float *t_hit)
+{
+    return traverse(t, o, d, t_max, t_hit, 0);
+}
+
+/*!
+ * Any hit traversal.
+ */
+int bvh_occluded(const Bvh *t, Point3D o, Vector3D d, float t_max)
+{
+    return traverse(t, o, d, t_max, NULL, 1) != -1;
+}
+
+/*!
+ * Squared distance between a point and a box, zero inside the box.
+ */
+static float box_distance2(const BvhNode *n, const float q[3])
+{
+    float d, d2 = 0;
+    int a;
+
+    for (a = 0; a < 3; ++a)
+    {
+        d = q[a] < n->min[a] ? n->min[a] - q[a]
+            : (q[a] > n->max[a] ? q[a] - n->max[a] : 0);
+        d2 += d * d;
+    }
+
+    return d2;
+}
+
+/*!
+ * Squared distance between the query, relative to the first vertex of a
+ * triangle, and the point with barycentric coordinates v and w along the
+ * two edges.
+ */
+#define LANE_DISTANCE2(p, l, ax, ay, az, v, w) \
+    ((p->e1[0][l] * (v) + p->e2[0][l] * (w) - (ax)) \
+     * (p->e1[0][l] * (v) + p->e2[0][l] * (w) - (ax)) \
+     + (p->e1[1][l] * (v) + p->e2[1][l] * (w) - (ay)) \
+     * (p->e1[1][l] * (v) + p->e2[1][l] * (w) - (ay)) \
+     + (p->e1[2][l] * (v) + p->e2[2][l] * (w) - (az)) \
+     * (p->e1[2][l] * (v) + p->e2[2][l] * (w) - (az)))
+
+/*!
+ * Clamp a value to [0,1], with max(x, 0) = (x + |x|) / 2 and
+ * min(x, 1) = (x + 1 - |x - 1|) / 2. Selections would give the compiler
+ * constant values to propagate in separate branches, which prevent the
+ * vectorization of the callers.
+ */
+static float clamp01(float x)
+{
+    x = 0.5f * (x + fabsf(x));
+    return 0.5f * (x + 1 - fabsf(x - 1));
+}
+
+/*!
+ * Closest points of the triangles of a pack to a query point. The closest
+ * point is the projection of the query on the plane of the triangle if it
+ * falls inside it, or the nearest of the closest points of the three
+ * edges otherwise. All the candidates are computed and the nearest is
+ * selected without branches, so that the lanes are processed together.
+ * Fill the barycentric coordinates of the second and third vertex and the
+ * squared distance of each lane.
+ */
+static void pack_closest(const BvhPack *p, const float q[3],
+        float v[BVH_LEAF_SIZE], float w[BVH_LEAF_SIZE],
+        float d2[BVH_LEAF_SIZE])
+{
+    int l;
+
+    #pragma omp simd
+    for (l = 0; l < BVH_LEAF_SIZE; ++l)
+    {
+        float ax, ay, az, e11, e12, e22, q1, q2, den, det;
+        float iv, iw, t1, t2, t3, di, da, db, dc, best, lv, lw;
+        int inside, nearer;
+
+        ax = q[0] - p->v0[0][l];
+        ay = q[1] - p->v0[1][l];
+        az = q[2] - p->v0[2][l];
+
+        /* products of the edges with each other and with the query */
+        e11 = p->e1[0][l] * p->e1[0][l] + p->e1[1][l] * p->e1[1][l]
+            + p->e1[2][l] * p->e1[2][l];
+        e12 = p->e1[0][l] * p->e2[0][l] + p->e1[1][l] * p->e2[1][l]
+            + p->e1[2][l] * p->e2[2][l];
+        e22 = p->e2[0][l] * p->e2[0][l] + p->e2[1][l] * p->e2[1][l]
+            + p->e2[2][l] * p->e2[2][l];
+        q1 = p->e1[0][l] * ax + p->e1[1][l] * ay + p->e1[2][l] * az;
+        q2 = p->e2[0][l] * ax + p->e2[1][l] * ay + p->e2[2][l] * az;
+
+        /* projection on the plane, from the normal equations, which is
+         * a candidate only if it falls inside the triangle; null
+         * denominators (degenerate triangles and edges) are replaced with
+         * a tiny value, whose results are discarded or clamped */
+        det = e11 * e22 - e12 * e12;
+        den = det > FLT_MIN ? det : FLT_MIN;
+        iv = (e22 * q1 - e12 * q2) / den;
+        iw = (e11 * q2 - e12 * q1) / den;
+        inside = (det > FLT_MIN) & (iv >= 0) & (iw >= 0) & (iv + iw <= 1);
+        di = LANE_DISTANCE2(p, l, ax, ay, az, iv, iw);
+
+        /* first edge (t, 0), second edge (0, t), third edge (1 - t, t) */
+        den = e11 > FLT_MIN ? e11 : FLT_MIN;
+        t1 = clamp01(q1 / den);
+        da = LANE_DISTANCE2(p, l, ax, ay, az, t1, 0);
+
+        den = e22 > FLT_MIN ? e22 : FLT_MIN;
+        t2 = clamp01(q2 / den);
+        db = LANE_DISTANCE2(p, l, ax, ay, az, 0, t2);
+
+        den = e11 - 2 * e12 + e22;
+        den = den > FLT_MIN ? den : FLT_MIN;
+        t3 = clamp01((q2 - q1 - e12 + e11) / den);
+        dc = LANE_DISTANCE2(p, l, ax, ay, az, 1 - t3, t3);
+
+        best = da;
+        lv = t1;
+        lw = 0;
+
+        nearer = db < best;
+        best = nearer ? db : best;
+        lv = nearer ? 0 : lv;
+        lw = nearer ? t2 : lw;
+
+        nearer = dc < best;
+        best = nearer ? dc : best;
+        lv = nearer ? 1 - t3 : lv;
+        lw = nearer ? t3 : lw;
+
+        inside = inside & (di < best);
+        best = inside ? di : best;
+        lv = inside ? iv : lv;
+        lw = inside ? iw : lw;
+
+        v[l] = lv;
+        w[l] = lw;
+        d2[l] = best;
+    }
+}
+
+/*!
+ * Traverse the hierarchy visiting first the child whose box is nearer to
+ * the query, and skipping the boxes farther than the best distance found.
+ */
+Index bvh_closest(const Bvh *t, Point3D p, float max_dist, Point3D *closest,
+        float *dist)
+{
+    Index stack[STACK_SIZE];
+    float stack_d[STACK_SIZE];
+    Index node = 0, l, r, hit = -1;
+    int sp = 0, k, a;
+    float q[3] = {p.x, p.y, p.z};
+    float v[BVH_LEAF_SIZE], w[BVH_LEAF_SIZE], d2[BVH_LEAF_SIZE];
+    float best_c[3] = {0, 0, 0};
+    float best = max_dist * max_dist, dl, dr;
+    const BvhNode *n;
+    const BvhPack *pack;
+
+    if (box_distance2(&t->nodes[0], q) >= best)
+        return -1;
+
+    for (;;)
+    {
+        n = &t->nodes[node];
+
+        if (n->count == 0)
+        {
+            l = node + 1;
+            r = n->first;
+            dl = box_distance2(&t->nodes[l], q);
+            dr = box_distance2(&t->nodes[r], q);
+
+            if (dl < best && dr < best)
+            {
+                stack[sp] = dl <= dr ? r : l;
+                stack_d[sp++] = dl <= dr ? dr : dl;
+                node = dl <= dr ? l : r;
+                continue;
+            }
+            if (dl < best || dr < best)
+            {
+                node = dl < best ? l : r;
+                continue;
+            }
+        }
+        else
+        {
+            pack = &t->packs[n->first];
+            pack_closest(pack, q, v, w, d2);
+            for (k = 0; k < n->count; ++k)
+            {
+                if (d2[k] < best)
+                {
+                    best = d2[k];
+                    hit = BVH_LEAF_SIZE * n->first + k;
+                    for (a = 0; a < 3; ++a)
+                        best_c[a] = pack->v0[a][k] + pack->e1[a][k] * v[k]
+                            + pack->e2[a][k] * w[k];
+                }
+            }
+        }
+
+        while (sp > 0 && stack_d[sp - 1] >= best)
+            --sp;
+        if (sp == 0)
+            break;
+        node = stack[--sp];
+    }
+
+    if (hit == -1)
+        return -1;
+
+    if (closest != NULL)
+    {
+        closest->x = best_c[0];
+        closest->y = best_c[1];
+        closest->z = best_c[2];
+    }
+
+    if (dist != NULL)
+        *dist = sqrtf(best);
+
+    return t->faces[hit];
+}
+
+/*!
+ * Free the hierarchy arrays.
+ */
+void bvh_free(Bvh *t)
+{
+    free(t->nodes);
+    free(t->packs);
+    free(t->faces);
+    t->nodes = NULL;
+    t->packs = NULL;
+    t->faces = NULL;
+    t->n_nodes = 0;
+    t->n_packs = 0;
+    t->n_tris = 0;
+}
@@ -0,0 +1,153 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) Martino Pilia, 2015
+ */
+
+/*!
+ * \file bvh.h
+ */
+
+#ifndef BVH_H
+#define BVH_H
+
+#include "backend.h"
+
+/*!
+ * Maximum number of triangles in a leaf of the hierarchy, which is also the
+ * width of the triangle packs tested together against a ray.
+ */
+#define BVH_LEAF_SIZE 4
+
+/*! Number of bins along each axis for the evaluation of the splits. */
+#define BVH_BINS 16
+
+/*! Define a type for a node of a bounding volume hierarchy. */
+typedef struct BvhNode BvhNode;
+
+/*! Define a type for the triangles of a leaf. */
+typedef struct BvhPack BvhPack;
+
+/*! Define a type for a bounding volume hierarchy over the model faces. */
+typedef struct Bvh Bvh;
+
+/*!
+ * Type representing a node of the hierarchy, with the box bounding all the
+ * triangles below it. Nodes are stored in depth-first order, so the left
+ * child of an inner node immediately follows it.
+ */
+struct BvhNode
+{
+    float min[3]; /*!< Minimum corner of the bounding box. */
+    float max[3]; /*!< Maximum corner of the bounding box. */
+    Index first;  /*!< Pack of the triangles for a leaf, right child for an
+                       inner node. */
+    Index count;  /*!< Number of triangles in a leaf, zero for an inner
+                       node. */
+};
+
+/*!
+ * Type holding the triangles of a leaf, stored by coordinate rather than
+ * by triangle, so that the lanes of a pack are tested against a ray with
+ * the same instructions. Unused lanes hold a degenerate triangle, which is
+ * never hit.
+ */
+struct BvhPack
+{
+    float v0[3][BVH_LEAF_SIZE]; /*!< First vertex of each triangle. */
+    float e1[3][BVH_LEAF_SIZE]; /*!< Second vertex minus the first. */
+    float e2[3][BVH_LEAF_SIZE]; /*!< Third vertex minus the first. */
+};
+
+/*!
+ * Type representing a bounding volume hierarchy over the faces of a model.
+ * Triangles are stored by value, in leaf order, so that traversals do not
+ * touch the model lists.
+ */
+struct Bvh
+{
+    BvhNode *nodes; /*!< Nodes, the root is the first one. */
+    Index n_nodes;  /*!< Number of nodes. */
+    BvhPack *packs; /*!< Triangles of each leaf. */
+    Index *faces;   /*!< Face index of each lane of each pack, -1 for the
+                         unused lanes. */
+    Index n_packs;  /*!< Number of packs. */
+    Index n_tris;   /*!< Number of triangles. */
+};
+
+/*!
+ * \brief Build a bounding volume hierarchy over the faces of a model.
+ *
+ * Nodes are split where the surface area heuristic estimates the cheapest
+ * traversal, evaluated on BVH_BINS bins of the centroids along each axis,
+ * and the subtrees of large nodes are built in parallel.
+ * @param t Hierarchy to be built.
+ * @param m Model.
+ * @return Zero on success, ERR_NO_MEMORY if an allocation failed or
+ * ERR_INVALID_ARGUMENT if the model has no faces.
+ * @note The hierarchy holds a copy of the geometry, so it must be rebuilt
+ * after the model is changed. The result does not depend on the number of
+ * threads.
+ */
+int bvh_build(Bvh *t, Model3D *m);
+
+/*!
+ * \brief Find the first intersection of a ray with the model.
+ * @param t Hierarchy.
+ * @param o Origin of the ray.
+ * @param d Direction of the ray (not necessarily normalized).
+ * @param t_max Maximum distance along the ray, in units of the length of d.
+ * @param t_hit If not NULL, filled with the distance of the intersection,
+ * in units of the length of d.
+ * @return Face index of the nearest intersected face, -1 if there is no
+ * intersection within t_max.
+ * @note Queries do not modify the hierarchy, so they can run concurrently.
+ */
+Index bvh_intersect(const Bvh *t, Point3D o, Vector3D d, float t_max,
+        float *t_hit);
+
+/*!
+ * \brief Check if a ray intersects the model.
+ * @param t Hierarchy.
+ * @param o Origin of the ray.
+ * @param d Direction of the ray (not necessarily normalized).
+ * @param t_max Maximum distance along the ray, in units of the length of d.
+ * @return Nonzero if any face is intersected within t_max.
+ * @note This query stops at the first intersection found, so it is faster
+ * than bvh_intersect().
+ */
+int bvh_occluded(const Bvh *t, Point3D o, Vector3D d, float t_max);
+
+/*!
+ * \brief Find the point of the model surface closest to a query point.
+ * @param t Hierarchy.
+ * @param p Query point.
+ * @param max_dist Maximum distance searched.
+ * @param closest If not NULL, filled with the closest point.
+ * @param dist If not NULL, filled with the distance between p and the
+ * closest point.
+ * @return Face index of the face containing the closest point, -1 if no
+ * face is within max_dist.
+ * @note Queries do not modify the hierarchy, so they can run concurrently.
+ */
+Index bvh_closest(const Bvh *t, Point3D p, float max_dist, Point3D *closest,
+        float *dist);
+
+/*!
+ * \brief Free the resources owned by a hierarchy.
+ * @param t Hierarchy to be freed.
+ */
+void bvh_free(Bvh *t);
+
+#endif // BVH_H
@@ -0,0 +1,225 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) Martino Pilia, 2015
+ */
+
+
+/*!
+ * \file cleanup.c
+ */
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "cleanup.h"
+#include "components.h"
+#include "profile.h"
+
+/*! Number of blocks processed in parallel by the stream compaction. */
+#define COMPACT_BLOCKS 64
+
+/*!
+ * Number the flagged elements keeping their order, filling map with the
+ * new position of each element, or -1 for the ones not flagged, and
+ * return their count. The flags are counted by blocks in parallel, then
+ * the block counts are summed, and each block is numbered from its
+ * offset in parallel.
+ */
+static Index compact_map(const unsigned char *flag, Index n, Index *map)
+{
+    Index offset[COMPACT_BLOCKS + 1];
+    Index block, b, i, end, pos;
+
+    block = (n + COMPACT_BLOCKS - 1) / COMPACT_BLOCKS;
+
+    #pragma omp parallel for schedule(static) private(i, end, pos)
+    for (b = 0; b < COMPACT_BLOCKS; ++b)
+    {
+        end = (b + 1) * block < n ? (b + 1) * block : n;
+        pos = 0;
+        for (i = b * block; i < end; ++i)
+            pos += flag[i] != 0;
+        offset[b + 1] = pos;
+    }
+
+    offset[0] = 0;
+    for (b = 0; b < COMPACT_BLOCKS; ++b)
+        offset[b + 1] += offset[b];
+
+    #pragma omp parallel for schedule(static) private(i, end, pos)
+    for (b = 0; b < COMPACT_BLOCKS; ++b)
+    {
+        end = (b + 1) * block < n ? (b + 1) * block : n;
+        pos = offset[b];
+        for (i = b * block; i < end; ++i)
+            map[i] = flag[i] ? pos++ : -1;
+    }
+
+    return offset[COMPACT_BLOCKS];
+}
+
+/*!
+ * Compute the area of a face from the cross product of two edges.
+ */
+static double face_area(const Model3D *m, Index f)
+{
+    Point3D a = m->vertices_array[face_vertex(m, f, 0)]->vertexCoordinates;
+    Point3D b = m->vertices_array[face_vertex(m, f, 1)]->vertexCoordinates;
+    Point3D c = m->vertices_array[face_vertex(m, f, 2)]->vertexCoordinates;
+    double ux = b.x - a.x, uy = b.y - a.y, uz = b.z - a.z;
+    double wx = c.x - a.x, wy = c.y - a.y, wz = c.z - a.z;
+    double nx = uy * wz - uz * wy;
+    double ny = uz * wx - ux * wz;
+    double nz = ux * wy - uy * wx;
+
+    return 0.5 * sqrt(nx * nx + ny * ny + nz * nz);
+}
+
+/*!
+ * Flag the faces to be kept and the vertices they use, then compact both
+ * and rebuild the model.
+ */
+int cleanup_mesh(Model3D *m, double min_area, Index min_faces,
+        Index *removed_faces, Index *removed_vertices)
+{
+    unsigned char *keep, *used;
+    Index *label, *size, *vmap, *fmap, *faces;
+    Vertex *vertices;
+    Index V = m->n_vertices, F = m->n_faces;
+    Index v, f, n, n_vertices = 0, n_faces = 0;
+    Index a, b, c;
+    double start = profile_clock();
+    int k, status = 0;
+
+    if (min_area < 0 || min_faces < 0)
+        return ERR_INVALID_ARGUMENT;
+
+    if (model_build_indices(m) != 0)
+        return ERR_NO_MEMORY;
+
+    keep = (unsigned char*) malloc(F + 1);
+    used = (unsigned char*) calloc(V + 1, 1);
+    label = (Index*) malloc((V + 1) * sizeof (Index));
+    vmap = (Index*) malloc((V + 1) * sizeof (Index));
+    fmap = (Index*) malloc((F + 1) * sizeof (Index));
+    size = NULL;
+    faces = NULL;
+    vertices = NULL;
+
+    if (keep == NULL || used == NULL || label == NULL || vmap == NULL
+            || fmap == NULL)
+        status = ERR_NO_MEMORY;
+
+    if (status == 0)
+    {
+        #pragma omp parallel for schedule(static) private(a, b, c)
+        for (f = 0; f < F; ++f)
+        {
+            a = face_vertex(m, f, 0);
+            b = face_vertex(m, f, 1);
+            c = face_vertex(m, f, 2);
+            keep[f] = a != b && b != c && c != a
+                && face_area(m, f) > min_area;
+        }
+    }
+
+    /* count the faces of each component, and drop the small ones */
+    if (status == 0 && min_faces > 1)
+    {
+        if (component_labels(m, keep, label, &n) != 0
+                || (size = (Index*) calloc(n + 1, sizeof (Index))) == NULL)
+            status = ERR_NO_MEMORY;
+        else
+        {
+            #pragma omp parallel for schedule(static)
+            for (f = 0; f < F; ++f)
+            {
+                if (keep[f])
+                {
+                    #pragma omp atomic
+                    ++size[label[face_vertex(m, f, 0)]];
+                }
+            }
+
+            #pragma omp parallel for schedule(static)
+            for (f = 0; f < F; ++f)
+                if (keep[f] && size[label[face_vertex(m, f, 0)]] < min_faces)
+                    keep[f] = 0;
+        }
+    }
+
+    if (status == 0)
+    {
+        #pragma omp parallel for schedule(static) private(k)
+        for (f = 0; f < F; ++f)
+        {
+            if (!keep[f])
+                continue;
+            for (k = 0; k < 3; ++k)
+            {
+                #pragma omp atomic write
+                used[face_vertex(m, f, k)] = 1;
+            }
+        }
+
+        n_faces = compact_map(keep, F, fmap);
+        n_vertices = compact_map(used, V, vmap);
+
+        if (n_faces == 0)
+            status = -1;
+    }
+
+    if (status == 0)
+    {
+        faces = (Index*) malloc(3 * n_faces * sizeof (Index));
+        vertices = (Vertex*) malloc(n_vertices * sizeof (Vertex));
+        if (faces == NULL || vertices == NULL)
+            status = ERR_NO_MEMORY;
+    }
+
+    if (status == 0)
+    {
+        #pragma omp parallel for schedule(static) private(k)
+        for (f = 0; f < F; ++f)
+            if (fmap[f] != -1)
+                for (k = 0; k < 3; ++k)
+                    faces[3 * fmap[f] + k] = vmap[face_vertex(m, f, k)];
+
+        #pragma omp parallel for schedule(static)
+        for (v = 0; v < V; ++v)
+            if (vmap[v] != -1)
+                vertices[vmap[v]] = *m->vertices_array[v];
+
+        if (removed_faces != NULL)
+            *removed_faces = F - n_faces;
+        if (removed_vertices != NULL)
+            *removed_vertices = V - n_vertices;
+
+        status = model_replace(m, vertices, n_vertices, faces, n_faces);
+    }
+
+    free(keep);
+    free(used);
+    free(label);
+    free(size);
+    free(vmap);
+    free(fmap);
+    free(faces);
+    free(vertices);
+
+    profile_record(PROF_CLEANUP, start, V, F);
+
+    return status;
+}
@@ -0,0 +1,55 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) Martino Pilia, 2015
+ */
+
+
+/*!
+ * \file cleanup.h
+ */
+
+#ifndef CLEANUP_H
+#define CLEANUP_H
+
+#include "backend.h"
+
+/*!
+ * \brief Remove the degenerate faces and the small connected components of
+ * a model.
+ *
+ * Faces with a repeated vertex or with an area not greater than min_area
+ * are removed first, then the connected components of the remaining faces
+ * with fewer than min_faces faces, and finally the vertices left without
+ * faces. Vertices and faces are compacted with a parallel stream
+ * compaction, which keeps their relative order.
+ * @param m Model to be cleaned.
+ * @param min_area Area threshold; zero removes only the faces with null
+ * area.
+ * @param min_faces Minimum number of faces of a component to be kept; zero
+ * or one keep all the components.
+ * @param removed_faces If not NULL, filled with the number of faces
+ * removed.
+ * @param removed_vertices If not NULL, filled with the number of vertices
+ * removed.
+ * @return Zero on success, -1 if no face would be left (the model is not
+ * changed), ERR_INVALID_ARGUMENT if a threshold is negative, ERR_NO_MEMORY
+ * if an allocation failed.
+ * @note The model lists are rebuilt, so pointers to the old vertices and
+ * faces are no longer valid.
+ */
+int cleanup_mesh(Model3D *m, double min_area, Index min_faces,
+        Index *removed_faces, Index *removed_vertices);
+
+#endif // CLEANUP_H
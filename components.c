@@ -0,0 +1,326 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) Martino Pilia, 2015
+ */
+
+
+/*!
+ * \file components.c
+ */
+
+#include <float.h>
+#include <math.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+
+#include "components.h"
+#include "profile.h"
+
+/*!
+ * Type for the sorting key of a component.
+ */
+typedef struct ComponentKey
+{
+    Index n_faces; /*!< Number of faces of the component. */
+    Index id;      /*!< Position of the component in vertex order. */
+} ComponentKey;
+
+/*!
+ * Find the root of the set of a vertex, halving the path on the way. A
+ * parent always has a smaller index than its child, and a concurrent
+ * change of the parent only makes it smaller, so a failed halving is
+ * harmless.
+ */
+static Index find_root(atomic_llong *parent, Index x)
+{
+    Index p, gp;
+
+    while ((p = atomic_load_explicit(&parent[x], memory_order_relaxed)) != x)
+    {
+        gp = atomic_load_explicit(&parent[p], memory_order_relaxed);
+        if (gp != p)
+            atomic_compare_exchange_weak(&parent[x], &p, gp);
+        x = gp;
+    }
+
+    return x;
+}
+
+/*!
+ * Join the sets of two vertices, linking the larger root to the smaller
+ * one. The link only succeeds if the root is still a root, otherwise the
+ * roots are searched again.
+ */
+static void unite(atomic_llong *parent, Index a, Index b)
+{
+    Index t;
+
+    for (;;)
+    {
+        a = find_root(parent, a);
+        b = find_root(parent, b);
+        if (a == b)
+            return;
+        if (a < b)
+        {
+            t = a;
+            a = b;
+            b = t;
+        }
+        t = a;
+        if (atomic_compare_exchange_strong(&parent[a], &t, b))
+            return;
+    }
+}
+
+/*!
+ * Order the components by decreasing number of faces, then by position.
+ */
+static int compare_keys(const void *a, const void *b)
+{
+    const ComponentKey *x = (const ComponentKey*) a;
+    const ComponentKey *y = (const ComponentKey*) b;
+
+    if (x->n_faces != y->n_faces)
+        return x->n_faces > y->n_faces ? -1 : 1;
+    return (x->id > y->id) - (x->id < y->id);
+}
+
+/*!
+ * Join the vertices of the selected faces with the union-find, then number
+ * the roots in vertex order.
+ */
+int component_labels(Model3D *m, const unsigned char *keep, Index *label,
+        Index *n)
+{
+    atomic_llong *parent;
+    Index V = m->n_vertices, F = m->n_faces;
+    Index v, f;
+
+    if (model_build_indices(m) != 0)
+        return ERR_NO_MEMORY;
+
+    parent = (atomic_llong*) malloc((V + 1) * sizeof (atomic_llong));
+    if (parent == NULL)
+        return ERR_NO_MEMORY;
+
+    #pragma omp parallel for schedule(static)
+    for (v = 0; v < V; ++v)
+        atomic_init(&parent[v], v);
+
+    #pragma omp parallel for schedule(static)
+    for (f = 0; f < F; ++f)
+    {
+        if (keep != NULL && !keep[f])
+            continue;
+        unite(parent, face_vertex(m, f, 0), face_vertex(m, f, 1));
+        unite(parent, face_vertex(m, f, 1), face_vertex(m, f, 2));
+    }
+
+    /* no more links, so the roots are final */
+    #pragma omp parallel for schedule(static)
+    for (v = 0; v < V; ++v)
+        label[v] = find_root(parent, v);
+
+    free(parent);
+
+    /* each root is the smallest vertex of its set, so it is met before
+     * the other vertices of the set */
+    *n = 0;
+    for (v = 0; v < V; ++v)
+        label[v] = (label[v] == v ? (*n)++ : label[label[v]]);
+
+    return 0;
+}
+
+/*!
+ * Label the vertices, accumulate the summaries and sort the components by
+ * size.
+ */
+int model_components(Model3D *m, Components *c)
+{
+    Index *id, *rank;
+    Component *parts, *p;
+    ComponentKey *keys;
+    Index V = m->n_vertices, F = m->n_faces;
+    Index v, f, i, n;
+    Point3D a, b, d;
+    double ux, uy, uz, wx, wy, wz, nx, ny, nz;
+    double start = profile_clock();
+
+    c->n = 0;
+    c->label = NULL;
+    c->parts = NULL;
+
+    id = (Index*) malloc((V + 1) * sizeof (Index));
+    if (id == NULL || component_labels(m, NULL, id, &n) != 0)
+    {
+        free(id);
+        return ERR_NO_MEMORY;
+    }
+
+    parts = (Component*) malloc((n + 1) * sizeof (Component));
+    keys = (ComponentKey*) malloc((n + 1) * sizeof (ComponentKey));
+    if (parts == NULL || keys == NULL)
+    {
+        free(id);
+        free(parts);
+        free(keys);
+        return ERR_NO_MEMORY;
+    }
+
+    for (i = 0; i < n; ++i)
+    {
+        parts[i].n_vertices = 0;
+        parts[i].n_faces = 0;
+        parts[i].surface = 0.0;
+        parts[i].volume = 0.0;
+        parts[i].min.x = parts[i].min.y = parts[i].min.z = FLT_MAX;
+        parts[i].max.x = parts[i].max.y = parts[i].max.z = -FLT_MAX;
+    }
+
+    for (v = 0; v < V; ++v)
+    {
+        p = &parts[id[v]];
+        a = m->vertices_array[v]->vertexCoordinates;
+        p->n_vertices++;
+        p->min.x = fminf(p->min.x, a.x);
+        p->min.y = fminf(p->min.y, a.y);
+        p->min.z = fminf(p->min.z, a.z);
+        p->max.x = fmaxf(p->max.x, a.x);
+        p->max.y = fmaxf(p->max.y, a.y);
+        p->max.z = fmaxf(p->max.z, a.z);
+    }
+
+    /* the volume is the sum of the signed volumes of the tetrahedra
+     * joining each face to the origin */
+    for (f = 0; f < F; ++f)
+    {
+        p = &parts[id[face_vertex(m, f, 0)]];
+        a = m->vertices_array[face_vertex(m, f, 0)]->vertexCoordinates;
+        b = m->vertices_array[face_vertex(m, f, 1)]->vertexCoordinates;
+        d = m->vertices_array[face_vertex(m, f, 2)]->vertexCoordinates;
+        ux = b.x - a.x;
+        uy = b.y - a.y;
+        uz = b.z - a.z;
+        wx = d.x - a.x;
+        wy = d.y - a.y;
+        wz = d.z - a.z;
+        nx = uy * wz - uz * wy;
+        ny = uz * wx - ux * wz;
+        nz = ux * wy - uy * wx;
+        p->n_faces++;
+        p->surface += 0.5 * sqrt(nx * nx + ny * ny + nz * nz);
+        p->volume += (a.x * nx + a.y * ny + a.z * nz) / 6.0;
+    }
+
+    for (i = 0; i < n; ++i)
+    {
+        parts[i].volume = fabs(parts[i].volume);
+        keys[i].n_faces = parts[i].n_faces;
+        keys[i].id = i;
+    }
+
+    qsort(keys, n, sizeof (ComponentKey), compare_keys);
+
+    /* move the summaries in sorted order, and relabel the vertices */
+    c->parts = (Component*) malloc((n + 1) * sizeof (Component));
+    rank = (Index*) malloc((n + 1) * sizeof (Index));
+    if (c->parts == NULL || rank == NULL)
+    {
+        free(c->parts);
+        c->parts = NULL;
+        free(rank);
+        free(id);
+        free(parts);
+        free(keys);
+        return ERR_NO_MEMORY;
+    }
+    for (i = 0; i < n; ++i)
+    {
+        c->parts[i] = parts[keys[i].id];
+        rank[keys[i].id] = i;
+    }
+
+    #pragma omp parallel for schedule(static)
+    for (v = 0; v < V; ++v)
+        id[v] = rank[id[v]];
+
+    free(parts);
+    free(keys);
+    free(rank);
+
+    c->n = n;
+    c->label = id;
+
+    profile_record(PROF_COMPONENTS, start, V, F);
+
+    return 0;
+}
+
+/*!
+ * Free the label and summary arrays.
+ */
+void components_free(Components *c)
+{
+    free(c->label);
+    free(c->parts);
+    c->label = NULL;
+    c->parts = NULL;
+    c->n = 0;
+}
+
+/*!
+ * Draw a color for each component, then paint its vertices.
+ */
+int color_components(Model3D *m)
+{
+    Components c;
+    ColorRGB *colors;
+    Index i, v;
+    double start = profile_clock();
+
+    if (model_components(m, &c) != 0)
+        return ERR_NO_MEMORY;
+
+    colors = (ColorRGB*) malloc((c.n + 1) * sizeof (ColorRGB));
+    if (colors == NULL)
+    {
+        components_free(&c);
+        return ERR_NO_MEMORY;
+    }
+
+    /* same generator as color_random() */
+    for (i = 0; i < c.n; ++i)
+    {
+        m->seed = m->seed * 1103515245u + 12345u;
+        colors[i].r = (m->seed >> 24) & 0xff;
+        m->seed = m->seed * 1103515245u + 12345u;
+        colors[i].g = (m->seed >> 24) & 0xff;
+        m->seed = m->seed * 1103515245u + 12345u;
+        colors[i].b = (m->seed >> 24) & 0xff;
+    }
+
+    #pragma omp parallel for schedule(static)
+    for (v = 0; v < m->n_vertices; ++v)
+        m->vertices_array[v]->vertexColor = colors[c.label[v]];
+
+    free(colors);
+    components_free(&c);
+
+    profile_record(PROF_COLOR_COMP, start, m->n_vertices, m->n_faces);
+
+    return 0;
+}
@@ -0,0 +1,111 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) Martino Pilia, 2015
+ */
+
+
+/*!
+ * \file components.h
+ */
+
+#ifndef COMPONENTS_H
+#define COMPONENTS_H
+
+#include "backend.h"
+
+/*!
+ * Number of components listed individually by show_info(Model3D*), the
+ * others are summarized in a single line.
+ */
+#define COMPONENTS_SHOWN 10
+
+/*! Define a type for the summary of a connected component. */
+typedef struct Component Component;
+
+/*! Define a type for the connected components of a model. */
+typedef struct Components Components;
+
+/*!
+ * Type holding the summary of a connected component of a model.
+ */
+struct Component
+{
+    Index n_vertices; /*!< Number of vertices. */
+    Index n_faces;    /*!< Number of faces. */
+    double surface;   /*!< Sum of the faces area. */
+    double volume;    /*!< Volume delimited by the faces, exact if the
+                           component is closed and consistently oriented. */
+    Point3D min;      /*!< Minimum corner of the bounding box. */
+    Point3D max;      /*!< Maximum corner of the bounding box. */
+};
+
+/*!
+ * Type holding the connected components of a model, ordered by decreasing
+ * number of faces (ties are broken by the smallest vertex index), so that
+ * the main body comes first and the debris last.
+ */
+struct Components
+{
+    Index n;          /*!< Number of components. */
+    Index *label;     /*!< Component of each vertex, indexed by vertex
+                           index. */
+    Component *parts; /*!< Summary of each component. */
+};
+
+/*!
+ * \brief Find the connected components of a model.
+ *
+ * Two vertices are in the same component if a path of faces joins them,
+ * so each vertex used by no face is a component on its own. Vertices are
+ * joined with a lock-free union-find on the face index buffer, where each
+ * root is linked with a compare-and-swap to the smaller one, and paths are
+ * halved during the searches; the faces are processed in parallel.
+ * @param m Model.
+ * @param c Structure to be filled, to be freed with components_free().
+ * @return Zero on success, ERR_NO_MEMORY if an allocation failed.
+ */
+int model_components(Model3D *m, Components *c);
+
+/*!
+ * \brief Label the vertices of a model with their connected component,
+ * considering only a subset of the faces.
+ * @param m Model.
+ * @param keep Array with a nonzero element for each face to be considered,
+ * or NULL to consider all the faces.
+ * @param label Array of n_vertices elements, filled with the component of
+ * each vertex. Components are numbered in order of their smallest vertex.
+ * @param n Filled with the number of components.
+ * @return Zero on success, ERR_NO_MEMORY if an allocation failed.
+ */
+int component_labels(Model3D *m, const unsigned char *keep, Index *label,
+        Index *n);
+
+/*!
+ * \brief Free the resources owned by a set of components.
+ * @param c Structure to be freed.
+ */
+void components_free(Components *c);
+
+/*!
+ * \brief Color each connected component of the model with a random color.
+ * @param m Model to be colored.
+ * @return Zero if coloration was fine, ERR_NO_MEMORY if an allocation
+ * failed.
+ * @note Colors are drawn from the generator of the model, largest
+ * component first.
+ */
+int color_components(Model3D *m);
+
+#endif // COMPONENTS_H
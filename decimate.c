@@ -0,0 +1,1377 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) Martino Pilia, 2015
+ */
+
+/*!
+ * \file decimate.c
+ */
+
+#include <math.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "adjacency.h"
+#include "decimate.h"
+#include "profile.h"
+
+/*!
+ * Minimum cosine of the angle between the normal of a face before and after
+ * a collapse; collapses which rotate a face more than that are skipped.
+ */
+#define FLIP_COS 0.1
+
+/*!
+ * Each batched round takes as candidates about this fraction of the edges,
+ * the ones with the smallest cost.
+ */
+#define BATCH_SHARE 64
+
+/*!
+ * Edges with more than this number of edges around their ends, like those
+ * of the vertex at the apex of a fan, are not collapsed in batched rounds:
+ * they would exclude too many other candidates.
+ */
+#define BATCH_REGION 64
+
+/*!
+ * The list of the edges of the batched rounds is compacted when this
+ * fraction of the faces was removed since the last time.
+ */
+#define BATCH_COMPACT 8
+
+/*!
+ * The batched rounds stop when there are less than this number of
+ * candidates or of winners in a round, as where the cheap edges are
+ * crowded in a small part of the model, and the remaining collapses are
+ * done one at a time.
+ */
+#define BATCH_MIN 1024
+
+/*!
+ * Number of edge costs sampled to choose the cost threshold of a round.
+ */
+#define BATCH_SAMPLES 2048
+
+/*!
+ * Number of blocks in which the edge lists are split to be filtered in
+ * parallel. It is fixed so that the result does not depend on the number
+ * of threads.
+ */
+#define BATCH_BLOCKS 64
+
+/*!
+ * Type for an entry of the edge heap. The cost is stored in the entry, so
+ * that comparing the children of a node reads a single cache line.
+ */
+typedef struct HeapEntry
+{
+    double cost; /*!< Error introduced by the collapse. */
+    Index edge;  /*!< Edge to be collapsed. */
+} HeapEntry;
+
+/*!
+ * Key of an edge in the choice of the candidates of a batched round, which
+ * are the edges with the smallest keys.
+ */
+typedef struct BatchKey
+{
+    double cost;   /*!< Error introduced by the collapse. */
+    uint64_t rank; /*!< Scrambled index, ordering the edges of equal cost. */
+} BatchKey;
+
+/*!
+ * State of a decimation. Faces are stored in the compact index format, and
+ * each vertex has a linked list of its corners (corner c is the vertex
+ * c % 3 of face c / 3), so that the faces of the removed vertex can be moved
+ * to the kept one without scanning the model.
+ *
+ * Edges are kept in the same way: the two ends of edge e are 2 * e and
+ * 2 * e + 1, and each vertex has a linked list of the ends lying on it.
+ * Collapses only merge or remove edges, so the edge array never grows. The
+ * edges are the entries of an indexed heap ordered by collapse cost, which
+ * is updated in place when the cost changes, so the heap never holds stale
+ * candidates and each collapse pops a single entry.
+ *
+ * Large models are first simplified in batched rounds instead, where the
+ * costs are kept in an array and a set of cheap edges with disjoint
+ * neighbourhoods is collapsed in parallel (see decimation_round()). The
+ * heap is filled when the model becomes small enough.
+ */
+typedef struct Decimation
+{
+    Index n_vertices;      /*!< Number of vertices of the input. */
+    Index n_faces;         /*!< Number of faces of the input. */
+    Index n_edges;         /*!< Number of edges of the input. */
+    Index alive_faces;     /*!< Number of faces not yet removed. */
+    double *pos;           /*!< Position of each vertex (3 values). */
+    Normal3D *normal;      /*!< Normal of each vertex. */
+    ColorRGB *color;       /*!< Color of each vertex. */
+    double *q;             /*!< Quadric of each vertex (10 values). */
+    Index *corner;         /*!< Vertex of each corner. */
+    unsigned char *dead;   /*!< Flag for each removed face. */
+    Index *next;           /*!< Next corner of the same vertex, or -1. */
+    Index *head;           /*!< First corner of each vertex, -1 if the vertex
+                                was removed. */
+    Index *tail;           /*!< Last corner of each vertex. */
+    Index *end;            /*!< Vertex of each edge end, -1 for removed
+                                edges. */
+    Index *end_next;       /*!< Next end on the same vertex, or -1. */
+    Index *end_head;       /*!< First edge end of each vertex. */
+    Index *end_tail;       /*!< Last edge end of each vertex. */
+    HeapEntry *heap;       /*!< Heap of edges, by cost. */
+    Index *heap_pos;       /*!< Position of each edge in the heap, -1 if it
+                                is not there. */
+    Index heap_size;       /*!< Number of edges in the heap. */
+    Index *mark;           /*!< Marks for the neighbour sets. */
+    Index stamp;           /*!< Current mark value. */
+    int batched;           /*!< Nonzero while the collapses are batched. */
+    double *cost;          /*!< Cost of each edge, in batched rounds. */
+    unsigned char *blocked;/*!< Flag for each edge whose collapse was not
+                                allowed, cleared when its cost changes. */
+    Index *live;           /*!< Edges not yet removed when the list was
+                                last compacted, in batched rounds. */
+    Index n_live;          /*!< Number of entries of live. */
+    Index live_faces;      /*!< Faces alive when live was compacted. */
+    Index *candidate;      /*!< Candidates of the current round. */
+    unsigned char *won;    /*!< Flag for each candidate which owns its
+                                neighbourhood. */
+    atomic_llong *owner;   /*!< Candidate of smallest rank claiming each
+                                vertex, -1 if none. */
+} Decimation;
+
+/*!
+ * Add to a quadric the one of the plane ax + by + cz + d = 0 (with unit
+ * normal), multiplied by a weight.
+ */
+static void quadric_add_plane(double *q, double a, double b, double c,
+        double d, double w)
+{
+    q[0] += w * a * a;
+    q[1] += w * a * b;
+    q[2] += w * a * c;
+    q[3] += w * a * d;
+    q[4] += w * b * b;
+    q[5] += w * b * c;
+    q[6] += w * b * d;
+    q[7] += w * c * c;
+    q[8] += w * c * d;
+    q[9] += w * d * d;
+}
+
+/*!
+ * Evaluate a quadric in a point.
+ */
+static double quadric_eval(const double *q, const double *p)
+{
+    double x = p[0], y = p[1], z = p[2];
+
+    return q[0] * x * x + 2 * q[1] * x * y + 2 * q[2] * x * z
+        + 2 * q[3] * x + q[4] * y * y + 2 * q[5] * y * z + 2 * q[6] * y
+        + q[7] * z * z + 2 * q[8] * z + q[9];
+}
+
+/*!
+ * Compute the position minimizing the sum of the quadrics of two vertices,
+ * and return the error in such position. When the quadric is singular (flat
+ * or straight regions) or its minimum is far from the edge, the best among
+ * the endpoints and the midpoint is taken instead.
+ */
+static double optimal_position(const Decimation *s, Index a, Index b,
+        double *p)
+{
+    double q[10], mid[3], len2 = 0, det, tr, best, cost;
+    const double *pa = &s->pos[3 * a], *pb = &s->pos[3 * b];
+    const double *cand[3];
+    int i;
+
+    for (i = 0; i < 10; ++i)
+        q[i] = s->q[10 * a + i] + s->q[10 * b + i];
+
+    for (i = 0; i < 3; ++i)
+    {
+        mid[i] = (pa[i] + pb[i]) / 2;
+        len2 += (pb[i] - pa[i]) * (pb[i] - pa[i]);
+    }
+
+    det = q[0] * (q[4] * q[7] - q[5] * q[5])
+        - q[1] * (q[1] * q[7] - q[5] * q[2])
+        + q[2] * (q[1] * q[5] - q[4] * q[2]);
+
+    tr = q[0] + q[4] + q[7];
+    if (fabs(det) > 1e-12 * tr * tr * tr)
+    {
+        /* Cramer's rule on the 3x3 block, right-hand side -(q3, q6, q8) */
+        p[0] = -(q[3] * (q[4] * q[7] - q[5] * q[5])
+                - q[1] * (q[6] * q[7] - q[5] * q[8])
+                + q[2] * (q[6] * q[5] - q[4] * q[8])) / det;
+        p[1] = -(q[0] * (q[6] * q[7] - q[8] * q[5])
+                - q[3] * (q[1] * q[7] - q[5] * q[2])
+                + q[2] * (q[1] * q[8] - q[6] * q[2])) / det;
+        p[2] = -(q[0] * (q[4] * q[8] - q[5] * q[6])
+                - q[1] * (q[1] * q[8] - q[6] * q[2])
+                + q[3] * (q[1] * q[5] - q[4] * q[2])) / det;
+
+        if ((p[0] - mid[0]) * (p[0] - mid[0])
+                + (p[1] - mid[1]) * (p[1] - mid[1])
+                + (p[2] - mid[2]) * (p[2] - mid[2]) <= len2)
+        {
+            cost = quadric_eval(q, p);
+            return cost > 0 ? cost : 0;
+        }
+    }
+
+    cand[0] = pa;
+    cand[1] = pb;
+    cand[2] = mid;
+    best = HUGE_VAL;
+    for (i = 0; i < 3; ++i)
+    {
+        cost = quadric_eval(q, cand[i]);
+        if (cost < best)
+        {
+            best = cost;
+            memcpy(p, cand[i], 3 * sizeof (double));
+        }
+    }
+
+    return best > 0 ? best : 0;
+}
+
+/*!
+ * Move up the heap entry at position i, until its parent has a smaller
+ * cost.
+ */
+static void heap_sift_up(Decimation *s, Index i)
+{
+    HeapEntry x = s->heap[i];
+    Index parent;
+
+    while (i > 0 && s->heap[parent = (i - 1) / 2].cost > x.cost)
+    {
+        s->heap[i] = s->heap[parent];
+        s->heap_pos[s->heap[i].edge] = i;
+        i = parent;
+    }
+    s->heap[i] = x;
+    s->heap_pos[x.edge] = i;
+}
+
+/*!
+ * Move down the heap entry at position i, until its children have greater
+ * costs.
+ */
+static void heap_sift_down(Decimation *s, Index i)
+{
+    HeapEntry x = s->heap[i];
+    Index child;
+
+    while ((child = 2 * i + 1) < s->heap_size)
+    {
+        if (child + 1 < s->heap_size
+                && s->heap[child + 1].cost < s->heap[child].cost)
+            ++child;
+        if (s->heap[child].cost >= x.cost)
+            break;
+        s->heap[i] = s->heap[child];
+        s->heap_pos[s->heap[i].edge] = i;
+        i = child;
+    }
+    s->heap[i] = x;
+    s->heap_pos[x.edge] = i;
+}
+
+/*!
+ * Remove an edge from the heap, if it is there.
+ */
+static void heap_remove(Decimation *s, Index e)
+{
+    Index i = s->heap_pos[e];
+
+    if (i == -1)
+        return;
+
+    s->heap_pos[e] = -1;
+    if (i == --s->heap_size)
+        return;
+
+    /* move the last entry in the hole, then restore the order */
+    s->heap[i] = s->heap[s->heap_size];
+    if (i > 0 && s->heap[(i - 1) / 2].cost > s->heap[i].cost)
+        heap_sift_up(s, i);
+    else
+        heap_sift_down(s, i);
+}
+
+/*!
+ * Compute the collapse cost of an edge, then insert it in the heap or move
+ * it to its new position.
+ */
+static void heap_update(Decimation *s, Index e)
+{
+    double p[3];
+    Index i;
+
+    if ((i = s->heap_pos[e]) == -1)
+        i = s->heap_size++;
+
+    s->heap[i].cost = optimal_position(s, s->end[2 * e], s->end[2 * e + 1], p);
+    s->heap[i].edge = e;
+
+    if (i > 0 && s->heap[(i - 1) / 2].cost > s->heap[i].cost)
+        heap_sift_up(s, i);
+    else
+        heap_sift_down(s, i);
+}
+
+/*!
+ * Compute again the cost of an edge whose ends changed.
+ */
+static void update_edge(Decimation *s, Index e)
+{
+    double p[3];
+
+    if (!s->batched)
+    {
+        heap_update(s, e);
+        return;
+    }
+
+    s->cost[e] = optimal_position(s, s->end[2 * e], s->end[2 * e + 1], p);
+    s->blocked[e] = 0;
+}
+
+/*!
+ * Forget an edge which is being removed.
+ */
+static void remove_edge(Decimation *s, Index e)
+{
+    if (!s->batched)
+        heap_remove(s, e);
+}
+
+/*!
+ * Release the arrays used by the batched rounds.
+ */
+static void batch_free(Decimation *s)
+{
+    free(s->cost);
+    free(s->blocked);
+    free(s->live);
+    free(s->candidate);
+    free(s->won);
+    free(s->owner);
+    s->cost = NULL;
+    s->blocked = NULL;
+    s->live = NULL;
+    s->candidate = NULL;
+    s->won = NULL;
+    s->owner = NULL;
+}
+
+/*!
+ * Release the memory of a decimation state.
+ */
+static void decimation_free(Decimation *s)
+{
+    free(s->pos);
+    free(s->normal);
+    free(s->color);
+    free(s->q);
+    free(s->corner);
+    free(s->dead);
+    free(s->next);
+    free(s->head);
+    free(s->tail);
+    free(s->end);
+    free(s->end_next);
+    free(s->end_head);
+    free(s->end_tail);
+    free(s->heap);
+    free(s->heap_pos);
+    free(s->mark);
+    batch_free(s);
+}
+
+/*!
+ * Add to the quadric of vertex v the planes of its faces, weighted by their
+ * area, and the constraint planes of its boundary edges, which contain the
+ * edge and are orthogonal to the face.
+ */
+static void vertex_quadric(Decimation *s, const Adjacency *adj, Index v)
+{
+    double *q = &s->q[10 * v];
+    const double *p0, *p1, *p2;
+    double e1[3], e2[3], n[3], b[3], len, area, d, w;
+    Index e, f, h;
+    int i, k;
+
+    for (e = adj->vf_offsets[v]; e < adj->vf_offsets[v + 1]; ++e)
+    {
+        f = adj->vf[e];
+        if (s->dead[f])
+            continue;
+
+        p0 = &s->pos[3 * s->corner[3 * f]];
+        p1 = &s->pos[3 * s->corner[3 * f + 1]];
+        p2 = &s->pos[3 * s->corner[3 * f + 2]];
+        for (i = 0; i < 3; ++i)
+        {
+            e1[i] = p1[i] - p0[i];
+            e2[i] = p2[i] - p0[i];
+        }
+        n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+        n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+        n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+        len = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (len == 0)
+            continue;
+
+        area = len / 2;
+        for (i = 0; i < 3; ++i)
+            n[i] /= len;
+        d = -(n[0] * p0[0] + n[1] * p0[1] + n[2] * p0[2]);
+        quadric_add_plane(q, n[0], n[1], n[2], d, area);
+
+        for (k = 0; k < 3; ++k)
+        {
+            h = 3 * f + k;
+            if (adj->twin[h] != -1
+                    || (s->corner[h] != v
+                        && s->corner[3 * f + (k + 1) % 3] != v))
+                continue;
+
+            p0 = &s->pos[3 * s->corner[h]];
+            p1 = &s->pos[3 * s->corner[3 * f + (k + 1) % 3]];
+            for (i = 0; i < 3; ++i)
+                e1[i] = p1[i] - p0[i];
+            b[0] = e1[1] * n[2] - e1[2] * n[1];
+            b[1] = e1[2] * n[0] - e1[0] * n[2];
+            b[2] = e1[0] * n[1] - e1[1] * n[0];
+            len = sqrt(b[0] * b[0] + b[1] * b[1] + b[2] * b[2]);
+            if (len == 0)
+                continue;
+
+            /* |b| = |e| since n is a unit vector orthogonal to the edge */
+            w = DECIMATE_BOUNDARY_WEIGHT * len * len;
+            for (i = 0; i < 3; ++i)
+                b[i] /= len;
+            d = -(b[0] * p0[0] + b[1] * p0[1] + b[2] * p0[2]);
+            quadric_add_plane(q, b[0], b[1], b[2], d, w);
+        }
+    }
+}
+
+/*!
+ * Copy the model in a decimation state, compute the initial quadrics and
+ * fill the heap with the edges. Faces with a repeated vertex have no area
+ * and are dropped from the start.
+ */
+static int decimation_init(Decimation *s, Model3D *m)
+{
+    const Adjacency *adj;
+    const Vertex *p;
+    Index V = m->n_vertices, F = m->n_faces, E;
+    Index v, f, c, e, i, x;
+    double q[3], cost;
+    int k;
+
+    memset(s, 0, sizeof (Decimation));
+
+    if (model_build_indices(m) != 0 || (adj = model_halfedges(m)) == NULL)
+        return ERR_NO_MEMORY;
+
+    E = adj->vv_offsets[V] / 2;
+    s->n_vertices = V;
+    s->n_faces = F;
+    s->n_edges = E;
+
+    s->pos = (double*) malloc(3 * V * sizeof (double));
+    s->normal = (Normal3D*) malloc(V * sizeof (Normal3D));
+    s->color = (ColorRGB*) malloc(V * sizeof (ColorRGB));
+    s->q = (double*) calloc(10 * V, sizeof (double));
+    s->corner = (Index*) malloc(3 * F * sizeof (Index));
+    s->dead = (unsigned char*) malloc(F);
+    s->next = (Index*) malloc(3 * F * sizeof (Index));
+    s->head = (Index*) malloc(V * sizeof (Index));
+    s->tail = (Index*) malloc(V * sizeof (Index));
+    s->end = (Index*) malloc((2 * E + 1) * sizeof (Index));
+    s->end_next = (Index*) malloc((2 * E + 1) * sizeof (Index));
+    s->end_head = (Index*) malloc(V * sizeof (Index));
+    s->end_tail = (Index*) malloc(V * sizeof (Index));
+    s->heap = (HeapEntry*) malloc((E + 1) * sizeof (HeapEntry));
+    s->heap_pos = (Index*) malloc((E + 1) * sizeof (Index));
+    s->mark = (Index*) calloc(V, sizeof (Index));
+
+    if (s->pos == NULL || s->normal == NULL || s->color == NULL
+            || s->q == NULL || s->corner == NULL || s->dead == NULL
+            || s->next == NULL || s->head == NULL || s->tail == NULL
+            || s->end == NULL || s->end_next == NULL || s->end_head == NULL
+            || s->end_tail == NULL || s->heap == NULL
+            || s->heap_pos == NULL || s->mark == NULL)
+        return ERR_NO_MEMORY;
+
+    if (F > DECIMATE_BATCH_FACES)
+    {
+        s->batched = 1;
+        s->cost = (double*) malloc((E + 1) * sizeof (double));
+        s->blocked = (unsigned char*) calloc(E + 1, 1);
+        s->live = (Index*) malloc((E + 1) * sizeof (Index));
+        s->candidate = (Index*) malloc((E + 1) * sizeof (Index));
+        s->won = (unsigned char*) malloc(E + 1);
+        s->owner = (atomic_llong*) malloc(V * sizeof (atomic_llong));
+
+        if (s->cost == NULL || s->blocked == NULL || s->live == NULL
+                || s->candidate == NULL || s->won == NULL
+                || s->owner == NULL)
+            return ERR_NO_MEMORY;
+
+        #pragma omp parallel for schedule(static)
+        for (v = 0; v < V; ++v)
+            atomic_init(&s->owner[v], -1);
+    }
+
+    #pragma omp parallel for schedule(static) private(p)
+    for (v = 0; v < V; ++v)
+    {
+        p = m->vertices_array[v];
+        s->pos[3 * v] = p->vertexCoordinates.x;
+        s->pos[3 * v + 1] = p->vertexCoordinates.y;
+        s->pos[3 * v + 2] = p->vertexCoordinates.z;
+        s->normal[v] = p->vertexNormals;
+        s->color[v] = p->vertexColor;
+        s->head[v] = -1;
+        s->end_head[v] = -1;
+    }
+
+    s->alive_faces = 0;
+    for (f = 0; f < F; ++f)
+    {
+        for (k = 0; k < 3; ++k)
+            s->corner[3 * f + k] = face_vertex(m, f, k);
+        s->dead[f] = s->corner[3 * f] == s->corner[3 * f + 1]
+            || s->corner[3 * f + 1] == s->corner[3 * f + 2]
+            || s->corner[3 * f + 2] == s->corner[3 * f];
+        if (s->dead[f])
+            continue;
+        ++s->alive_faces;
+
+        /* append the corners to the lists of their vertices */
+        for (k = 0; k < 3; ++k)
+        {
+            c = 3 * f + k;
+            v = s->corner[c];
+            s->next[c] = -1;
+            if (s->head[v] == -1)
+                s->head[v] = c;
+            else
+                s->next[s->tail[v]] = c;
+            s->tail[v] = c;
+        }
+    }
+
+    #pragma omp parallel for schedule(dynamic, 4096)
+    for (v = 0; v < V; ++v)
+        vertex_quadric(s, adj, v);
+
+    /* each pair of neighbours (v, w) with v < w is an edge, numbered by the
+     * prefix sum of the counts of each vertex (held in mark) */
+    x = 0;
+    for (v = 0; v < V; ++v)
+    {
+        s->mark[v] = x;
+        for (i = adj->vv_offsets[v]; i < adj->vv_offsets[v + 1]; ++i)
+            if (adj->vv[i] > v)
+                ++x;
+    }
+
+    #pragma omp parallel for schedule(dynamic, 4096) private(i, e, q, cost)
+    for (v = 0; v < V; ++v)
+    {
+        e = s->mark[v];
+        for (i = adj->vv_offsets[v]; i < adj->vv_offsets[v + 1]; ++i)
+        {
+            if (adj->vv[i] < v)
+                continue;
+            s->end[2 * e] = v;
+            s->end[2 * e + 1] = adj->vv[i];
+            cost = optimal_position(s, v, adj->vv[i], q);
+            if (s->batched)
+            {
+                s->cost[e] = cost;
+                s->live[e] = e;
+            }
+            else
+            {
+                s->heap[e].cost = cost;
+                s->heap[e].edge = e;
+                s->heap_pos[e] = e;
+            }
+            ++e;
+        }
+    }
+
+    memset(s->mark, 0, V * sizeof (Index));
+
+    for (x = 0; x < 2 * E; ++x)
+    {
+        v = s->end[x];
+        s->end_next[x] = -1;
+        if (s->end_head[v] == -1)
+            s->end_head[v] = x;
+        else
+            s->end_next[s->end_tail[v]] = x;
+        s->end_tail[v] = x;
+    }
+
+    if (s->batched)
+    {
+        s->n_live = E;
+        s->live_faces = s->alive_faces;
+        return 0;
+    }
+
+    s->heap_size = E;
+    for (i = E / 2 - 1; i >= 0; --i)
+        heap_sift_down(s, i);
+
+    return 0;
+}
+
+/*!
+ * Tell if moving vertex v into p would flip or fold one of its faces not
+ * shared with vertex other.
+ */
+static int flips(const Decimation *s, Index v, Index other, const double *p)
+{
+    const double *q[3];
+    double e1[3], e2[3], n0[3], n1[3], l0, l1;
+    Index c, f;
+    int i, k, j;
+
+    for (c = s->head[v]; c != -1; c = s->next[c])
+    {
+        f = c / 3;
+        if (s->dead[f] || s->corner[3 * f] == other
+                || s->corner[3 * f + 1] == other
+                || s->corner[3 * f + 2] == other)
+            continue;
+
+        for (k = 0; k < 3; ++k)
+            q[k] = &s->pos[3 * s->corner[3 * f + k]];
+        for (i = 0; i < 3; ++i)
+        {
+            e1[i] = q[1][i] - q[0][i];
+            e2[i] = q[2][i] - q[0][i];
+        }
+        n0[0] = e1[1] * e2[2] - e1[2] * e2[1];
+        n0[1] = e1[2] * e2[0] - e1[0] * e2[2];
+        n0[2] = e1[0] * e2[1] - e1[1] * e2[0];
+
+        q[c - 3 * f] = p;
+        for (i = 0; i < 3; ++i)
+        {
+            e1[i] = q[1][i] - q[0][i];
+            e2[i] = q[2][i] - q[0][i];
+        }
+        n1[0] = e1[1] * e2[2] - e1[2] * e2[1];
+        n1[1] = e1[2] * e2[0] - e1[0] * e2[2];
+        n1[2] = e1[0] * e2[1] - e1[1] * e2[0];
+
+        l0 = l1 = 0;
+        for (j = 0; j < 3; ++j)
+        {
+            l0 += n0[j] * n0[j];
+            l1 += n1[j] * n1[j];
+        }
+        if (l0 == 0)
+            continue; /* already degenerate, nothing to flip */
+
+        if (n0[0] * n1[0] + n0[1] * n1[1] + n0[2] * n1[2]
+                <= FLIP_COS * sqrt(l0 * l1))
+            return 1;
+    }
+
+    return 0;
+}
+
+/*!
+ * Tell if the collapse of b into a, placed in p, keeps the surface manifold
+ * and does not flip faces. The link condition requires the common
+ * neighbours of a and b to be exactly the opposite vertices of their shared
+ * faces, and no face of a to be spanned by two of them (which would be
+ * duplicated, as when collapsing an edge of a tetrahedron).
+ */
+static int collapse_allowed(Decimation *s, Index a, Index b, const double *p)
+{
+    Index c, f, w, s1, s2, alive, shared = 0, common = 0;
+    int k, n;
+
+    #pragma omp atomic capture
+    s1 = ++s->stamp;
+    for (c = s->head[a]; c != -1; c = s->next[c])
+    {
+        f = c / 3;
+        if (s->dead[f])
+            continue;
+        for (k = 0; k < 3; ++k)
+        {
+            w = s->corner[3 * f + k];
+            if (w == b)
+                ++shared;
+            else if (w != a)
+                s->mark[w] = s1;
+        }
+    }
+
+    #pragma omp atomic read
+    alive = s->alive_faces;
+
+    if (shared == 0 || shared >= alive)
+        return 0;
+
+    #pragma omp atomic capture
+    s2 = ++s->stamp;
+    for (c = s->head[b]; c != -1; c = s->next[c])
+    {
+        f = c / 3;
+        if (s->dead[f])
+            continue;
+        for (k = 0; k < 3; ++k)
+        {
+            w = s->corner[3 * f + k];
+            if (w != a && w != b && s->mark[w] == s1)
+            {
+                s->mark[w] = s2;
+                ++common;
+            }
+        }
+    }
+
+    if (common != shared)
+        return 0;
+
+    for (c = s->head[a]; c != -1; c = s->next[c])
+    {
+        f = c / 3;
+        if (s->dead[f])
+            continue;
+        n = 0;
+        for (k = 0; k < 3; ++k)
+            if (s->mark[s->corner[3 * f + k]] == s2)
+                ++n;
+        if (n == 2)
+            return 0;
+    }
+
+    return !flips(s, a, b, p) && !flips(s, b, a, p);
+}
+
+/*!
+ * Drop the corners of removed faces from the list of vertex v.
+ */
+static void prune_corners(Decimation *s, Index v)
+{
+    Index c, prev = -1;
+
+    for (c = s->head[v]; c != -1; c = s->next[c])
+    {
+        if (s->dead[c / 3])
+            continue;
+        if (prev == -1)
+            s->head[v] = c;
+        else
+            s->next[prev] = c;
+        prev = c;
+    }
+    if (prev == -1)
+        s->head[v] = -1;
+    else
+        s->next[prev] = -1;
+    s->tail[v] = prev;
+}
+
+/*!
+ * Drop the ends of removed edges from the list of vertex v, and if
+ * requested update the cost of the remaining edges.
+ */
+static void prune_ends(Decimation *s, Index v, int update)
+{
+    Index x, prev = -1;
+
+    for (x = s->end_head[v]; x != -1; x = s->end_next[x])
+    {
+        if (s->end[x] == -1)
+            continue;
+        if (prev == -1)
+            s->end_head[v] = x;
+        else
+            s->end_next[prev] = x;
+        prev = x;
+        if (update)
+            update_edge(s, x / 2);
+    }
+    if (prev == -1)
+        s->end_head[v] = -1;
+    else
+        s->end_next[prev] = -1;
+    s->end_tail[v] = prev;
+}
+
+/*!
+ * Collapse edge e, moving its second vertex b into the first one a, placed
+ * in p. Colors and normals are interpolated at the projection of p on the
+ * edge, the shared faces are removed and the corners and edges of b are
+ * moved to a.
+ */
+static void collapse(Decimation *s, Index e, const double *p)
+{
+    Index a = s->end[2 * e], b = s->end[2 * e + 1];
+    double *pa = &s->pos[3 * a], *pb = &s->pos[3 * b];
+    double len2 = 0, dot = 0, t, nx, ny, nz, norm;
+    ColorRGB ca = s->color[a], cb = s->color[b];
+    Index c, f, w, x, st;
+    int i, k;
+
+    for (i = 0; i < 3; ++i)
+    {
+        len2 += (pb[i] - pa[i]) * (pb[i] - pa[i]);
+        dot += (p[i] - pa[i]) * (pb[i] - pa[i]);
+    }
+    t = len2 > 0 ? dot / len2 : 0.5;
+    t = t < 0 ? 0 : (t > 1 ? 1 : t);
+
+    nx = s->normal[a].x + t * (s->normal[b].x - s->normal[a].x);
+    ny = s->normal[a].y + t * (s->normal[b].y - s->normal[a].y);
+    nz = s->normal[a].z + t * (s->normal[b].z - s->normal[a].z);
+    norm = sqrt(nx * nx + ny * ny + nz * nz);
+    if (norm > 0)
+    {
+        s->normal[a].x = nx / norm;
+        s->normal[a].y = ny / norm;
+        s->normal[a].z = nz / norm;
+    }
+
+    s->color[a].r = (int) (ca.r + t * (cb.r - ca.r) + 0.5);
+    s->color[a].g = (int) (ca.g + t * (cb.g - ca.g) + 0.5);
+    s->color[a].b = (int) (ca.b + t * (cb.b - ca.b) + 0.5);
+
+    for (i = 0; i < 3; ++i)
+        pa[i] = p[i];
+    for (i = 0; i < 10; ++i)
+        s->q[10 * a + i] += s->q[10 * b + i];
+
+    /* remove the faces shared by a and b, together with the corners of the
+     * opposite vertices, which would slow down the later visits */
+    for (c = s->head[a]; c != -1; c = s->next[c])
+    {
+        f = c / 3;
+        if (s->dead[f] || (s->corner[3 * f] != b
+                    && s->corner[3 * f + 1] != b
+                    && s->corner[3 * f + 2] != b))
+            continue;
+
+        s->dead[f] = 1;
+        #pragma omp atomic
+        --s->alive_faces;
+        for (k = 0; k < 3; ++k)
+            if (s->corner[3 * f + k] != a && s->corner[3 * f + k] != b)
+                prune_corners(s, s->corner[3 * f + k]);
+    }
+
+    /* move the corners of b to a, appending its list */
+    for (c = s->head[b]; c != -1; c = s->next[c])
+        s->corner[c] = a;
+    s->next[s->tail[a]] = s->head[b];
+    s->tail[a] = s->tail[b];
+    s->head[b] = -1;
+    prune_corners(s, a);
+
+    /* remove the collapsed edge, then merge the edges of b into a: edge
+     * (b, w) is removed if (a, w) exists, otherwise it becomes (a, w) */
+    remove_edge(s, e);
+    s->end[2 * e] = s->end[2 * e + 1] = -1;
+
+    #pragma omp atomic capture
+    st = ++s->stamp;
+    for (x = s->end_head[a]; x != -1; x = s->end_next[x])
+        if (s->end[x] != -1)
+            s->mark[s->end[x ^ 1]] = st;
+
+    for (x = s->end_head[b]; x != -1; x = s->end_next[x])
+    {
+        if (s->end[x] == -1)
+            continue;
+        if (s->mark[s->end[x ^ 1]] == st)
+        {
+            remove_edge(s, x / 2);
+            w = s->end[x ^ 1];
+            s->end[x] = s->end[x ^ 1] = -1;
+            prune_ends(s, w, 0);
+        }
+        else
+            s->end[x] = a;
+    }
+
+    if (s->end_head[b] != -1)
+    {
+        if (s->end_head[a] == -1)
+            s->end_head[a] = s->end_head[b];
+        else
+            s->end_next[s->end_tail[a]] = s->end_head[b];
+        s->end_tail[a] = s->end_tail[b];
+        s->end_head[b] = -1;
+    }
+
+    /* the quadric of a changed, so all its edges get a new cost */
+    prune_ends(s, a, 1);
+}
+
+/*!
+ * Scramble the index of an edge (splitmix64 finalizer). The candidates of
+ * a batched round are ordered by this value and not by cost, because the
+ * costs often grow steadily along the model, as the indices do, and then
+ * only the few local minima would win.
+ */
+static uint64_t edge_rank(Index e)
+{
+    uint64_t x = (uint64_t) e;
+
+    x = (x ^ x >> 30) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ x >> 27) * 0x94D049BB133111EBull;
+    return x ^ x >> 31;
+}
+
+/*!
+ * Tell if an edge is kept by filter_edges().
+ */
+static int keep_edge(const Decimation *s, Index e, const BatchKey *max)
+{
+    if (s->end[2 * e] == -1)
+        return 0;
+    if (max == NULL)
+        return 1;
+    return !s->blocked[e] && (s->cost[e] < max->cost
+            || (s->cost[e] == max->cost && edge_rank(e) <= max->rank));
+}
+
+/*!
+ * Copy in out, keeping their order, the edges of in which were not
+ * removed and, if max is not NULL, which are not blocked and whose key is
+ * not greater than max. The blocks are filtered in
+ * parallel, each in its own range of out, and then moved together.
+ * Return the number of edges copied.
+ */
+static Index filter_edges(const Decimation *s, const Index *in, Index n,
+        Index *out, const BatchKey *max)
+{
+    Index count[BATCH_BLOCKS], i, j;
+    int k;
+
+    #pragma omp parallel for schedule(static) private(i, j)
+    for (k = 0; k < BATCH_BLOCKS; ++k)
+    {
+        j = n * k / BATCH_BLOCKS;
+        for (i = j; i < n * (k + 1) / BATCH_BLOCKS; ++i)
+            if (keep_edge(s, in[i], max))
+                out[j++] = in[i];
+        count[k] = j - n * k / BATCH_BLOCKS;
+    }
+
+    for (j = count[0], k = 1; k < BATCH_BLOCKS; j += count[k++])
+        memmove(&out[j], &out[n * k / BATCH_BLOCKS],
+                count[k] * sizeof (Index));
+
+    return j;
+}
+
+/*!
+ * Claim vertex w for edge e, a candidate under max, unless a candidate of
+ * smaller rank claimed it, or check that it is owned by e. The claims of
+ * the earlier rounds are not released: those of edges which are no longer
+ * candidates are taken over, and the others can only make a candidate
+ * lose. Return zero if a check failed.
+ */
+static int visit_vertex(Decimation *s, Index e, Index w,
+        const BatchKey *max, int claim)
+{
+    Index old = atomic_load_explicit(&s->owner[w], memory_order_relaxed);
+
+    if (!claim)
+        return old == e;
+
+    while ((old == -1 || !keep_edge(s, old, max)
+                || edge_rank(e) < edge_rank(old))
+            && old != e
+            && !atomic_compare_exchange_weak(&s->owner[w], &old, e))
+        ;
+
+    return 1;
+}
+
+/*!
+ * Claim or check the neighbours of the ends of edge e, which include the
+ * ends themselves and the vertices of their faces, and are the only
+ * vertices read or written by its collapse. Return zero if a check failed
+ * or if the ends have more than BATCH_REGION edges.
+ */
+static int visit_region(Decimation *s, Index e, const BatchKey *max,
+        int claim)
+{
+    Index ends[2] = {s->end[2 * e], s->end[2 * e + 1]};
+    Index x, n = 0;
+    int i;
+
+    for (i = 0; i < 2; ++i)
+        for (x = s->end_head[ends[i]]; x != -1 && n <= BATCH_REGION;
+                x = s->end_next[x])
+            n += s->end[x] != -1;
+    if (n > BATCH_REGION)
+        return 0;
+
+    for (i = 0; i < 2; ++i)
+        for (x = s->end_head[ends[i]]; x != -1; x = s->end_next[x])
+            if (s->end[x] != -1
+                    && !visit_vertex(s, e, s->end[x ^ 1], max, claim))
+                return 0;
+
+    return 1;
+}
+
+/*!
+ * Count the faces shared by the ends of edge e, which its collapse
+ * removes.
+ */
+static Index shared_faces(const Decimation *s, Index e)
+{
+    Index a = s->end[2 * e], b = s->end[2 * e + 1], c, f, n = 0;
+
+    for (c = s->head[a]; c != -1; c = s->next[c])
+    {
+        f = c / 3;
+        if (!s->dead[f] && (s->corner[3 * f] == b
+                    || s->corner[3 * f + 1] == b
+                    || s->corner[3 * f + 2] == b))
+            ++n;
+    }
+
+    return n;
+}
+
+/*!
+ * Compare two keys by cost and then by rank, for qsort().
+ */
+static int compare_keys(const void *a, const void *b)
+{
+    const BatchKey *x = (const BatchKey*) a, *y = (const BatchKey*) b;
+
+    if (x->cost != y->cost)
+        return (x->cost > y->cost) - (x->cost < y->cost);
+    return (x->rank > y->rank) - (x->rank < y->rank);
+}
+
+/*!
+ * Do a batched round of collapses. The cost threshold which selects about
+ * one edge out of BATCH_SHARE is estimated from a sample of the costs, and
+ * the edges under it are the candidates. Each candidate claims the
+ * vertices around its ends, each vertex going to the claimant of smallest
+ * rank (see edge_rank()), so that the candidates which own all their
+ * vertices have disjoint neighbourhoods, and they are collapsed in
+ * parallel. The winners do not depend on the number of threads.
+ *
+ * Return zero if no round was done, because there are not enough
+ * candidates or the winners would remove more faces than needed to reach
+ * the target, or if there were not enough winners.
+ */
+static int decimation_round(Decimation *s, Index target_faces,
+        double max_error)
+{
+    BatchKey sample[BATCH_SAMPLES], max;
+    double p[3];
+    Index i, e, n_sample = 0, n_cand, n_won = 0, removed = 0, stride;
+    Index *tmp;
+
+    /* drop the removed edges once enough faces are gone, swapping the
+     * lists */
+    if (s->alive_faces < s->live_faces - s->live_faces / BATCH_COMPACT)
+    {
+        s->n_live = filter_edges(s, s->live, s->n_live, s->candidate, NULL);
+        s->live_faces = s->alive_faces;
+        tmp = s->live;
+        s->live = s->candidate;
+        s->candidate = tmp;
+    }
+
+    stride = s->n_live / BATCH_SAMPLES + 1;
+    for (i = 0; i < s->n_live; i += stride)
+    {
+        e = s->live[i];
+        if (s->end[2 * e] == -1 || s->blocked[e])
+            continue;
+        sample[n_sample].cost = s->cost[e];
+        sample[n_sample++].rank = edge_rank(e);
+    }
+    if (n_sample == 0)
+        return 0;
+    qsort(sample, n_sample, sizeof (BatchKey), compare_keys);
+
+    max = sample[n_sample / BATCH_SHARE];
+    if (max_error > 0 && max.cost > max_error)
+    {
+        max.cost = max_error;
+        max.rank = UINT64_MAX;
+    }
+
+    n_cand = filter_edges(s, s->live, s->n_live, s->candidate, &max);
+    if (n_cand < BATCH_MIN)
+        return 0;
+
+    #pragma omp parallel for schedule(dynamic, 1024)
+    for (i = 0; i < n_cand; ++i)
+        visit_region(s, s->candidate[i], &max, 1);
+
+    #pragma omp parallel for schedule(dynamic, 1024) \
+            reduction(+: n_won, removed)
+    for (i = 0; i < n_cand; ++i)
+    {
+        s->won[i] = visit_region(s, s->candidate[i], &max, 0);
+        if (s->won[i])
+        {
+            ++n_won;
+            removed += shared_faces(s, s->candidate[i]);
+        }
+    }
+
+    if (s->alive_faces - removed < target_faces)
+        return 0;
+
+    #pragma omp parallel for schedule(dynamic, 256) private(e, p)
+    for (i = 0; i < n_cand; ++i)
+    {
+        if (!s->won[i])
+            continue;
+
+        e = s->candidate[i];
+        optimal_position(s, s->end[2 * e], s->end[2 * e + 1], p);
+        if (collapse_allowed(s, s->end[2 * e], s->end[2 * e + 1], p))
+            collapse(s, e, p);
+        else
+            s->blocked[e] = 1;
+    }
+
+    return n_won >= BATCH_MIN;
+}
+
+/*!
+ * Leave the batched rounds, filling the heap with the edges which are
+ * neither removed nor blocked.
+ */
+static void batch_end(Decimation *s)
+{
+    Index i, e;
+
+    #pragma omp parallel for schedule(static)
+    for (e = 0; e < s->n_edges; ++e)
+        s->heap_pos[e] = -1;
+
+    s->heap_size = 0;
+    for (i = 0; i < s->n_live; ++i)
+    {
+        e = s->live[i];
+        if (s->end[2 * e] == -1 || s->blocked[e])
+            continue;
+        s->heap[s->heap_size].cost = s->cost[e];
+        s->heap[s->heap_size].edge = e;
+        s->heap_pos[e] = s->heap_size++;
+    }
+
+    for (i = s->heap_size / 2 - 1; i >= 0; --i)
+        heap_sift_down(s, i);
+
+    s->batched = 0;
+    batch_free(s);
+}
+
+/*!
+ * Perform the collapses in order of increasing cost, until the model has
+ * no more than target_faces faces or the cost exceeds max_error. Large
+ * models are reduced with batched rounds down to DECIMATE_BATCH_FACES
+ * faces, or until a round does not find enough independent collapses, then
+ * the collapses are taken one at a time from the heap. An edge
+ * whose collapse is not allowed leaves the heap, and it is inserted again
+ * when the cost of the edge is updated.
+ */
+static void decimation_run(Decimation *s, Index target_faces,
+        double max_error)
+{
+    Index e;
+    double p[3];
+
+    while (s->batched && s->alive_faces > target_faces
+            && s->alive_faces > DECIMATE_BATCH_FACES
+            && decimation_round(s, target_faces, max_error))
+        ;
+
+    if (s->batched && (s->alive_faces <= DECIMATE_BATCH_FACES
+                || s->alive_faces > target_faces))
+        batch_end(s);
+
+    while (s->alive_faces > target_faces && s->heap_size > 0)
+    {
+        e = s->heap[0].edge;
+        if (max_error > 0 && s->heap[0].cost > max_error)
+            break;
+
+        heap_remove(s, e);
+        optimal_position(s, s->end[2 * e], s->end[2 * e + 1], p);
+        if (collapse_allowed(s, s->end[2 * e], s->end[2 * e + 1], p))
+            collapse(s, e, p);
+    }
+}
+
+/*!
+ * Replace the content of the model with the faces still alive, numbering
+ * the vertices they use in their original order.
+ */
+static int decimation_export(const Decimation *s, Model3D *m)
+{
+    Index *map, *faces, v, f, n_vertices = 0, n_faces = 0;
+    Vertex *vertices;
+    int k, err;
+
+    map = (Index*) malloc(s->n_vertices * sizeof (Index));
+    faces = (Index*) malloc(3 * s->alive_faces * sizeof (Index));
+    if (map == NULL || faces == NULL)
+    {
+        free(map);
+        free(faces);
+        return ERR_NO_MEMORY;
+    }
+
+    for (v = 0; v < s->n_vertices; ++v)
+        map[v] = s->head[v] == -1 ? -1 : n_vertices++;
+
+    vertices = (Vertex*) malloc(n_vertices * sizeof (Vertex));
+    if (vertices == NULL)
+    {
+        free(map);
+        free(faces);
+        return ERR_NO_MEMORY;
+    }
+
+    for (v = 0; v < s->n_vertices; ++v)
+    {
+        if (map[v] == -1)
+            continue;
+        vertices[map[v]].vertexCoordinates.x = s->pos[3 * v];
+        vertices[map[v]].vertexCoordinates.y = s->pos[3 * v + 1];
+        vertices[map[v]].vertexCoordinates.z = s->pos[3 * v + 2];
+        vertices[map[v]].vertexNormals = s->normal[v];
+        vertices[map[v]].vertexColor = s->color[v];
+    }
+
+    for (f = 0; f < s->n_faces; ++f)
+    {
+        if (s->dead[f])
+            continue;
+        for (k = 0; k < 3; ++k)
+            faces[3 * n_faces + k] = map[s->corner[3 * f + k]];
+        ++n_faces;
+    }
+
+    err = model_replace(m, vertices, n_vertices, faces, n_faces);
+
+    free(map);
+    free(faces);
+    free(vertices);
+
+    return err;
+}
+
+/*!
+ * Garland-Heckbert simplification. The initial quadrics and edge costs are
+ * computed in parallel. Each collapse changes the costs of its
+ * neighbourhood, so on large models only collapses with disjoint
+ * neighbourhoods are done together, and the rest are sequential.
+ */
+int decimate(Model3D *m, Index target_faces, double max_error)
+{
+    Decimation s;
+    Index n_vertices = m->n_vertices, n_faces = m->n_faces;
+    double start = profile_clock();
+    int err;
+
+    if (target_faces <= 0)
+        return ERR_INVALID_ARGUMENT;
+    if (target_faces >= m->n_faces)
+        return 0;
+
+    err = decimation_init(&s, m);
+    if (err == 0)
+    {
+        decimation_run(&s, target_faces, max_error);
+        err = decimation_export(&s, m);
+    }
+    decimation_free(&s);
+
+    profile_record(PROF_DECIMATE, start, n_vertices, n_faces);
+
+    return err;
+}
+
+/*!
+ * Run the decimation up to each target in turn, exporting each level into
+ * a temporary model which is saved and released before continuing.
+ */
+int decimate_lod(Model3D *m, const Index *targets, FILE **files,
+        int n_levels)
+{
+    Decimation s;
+    Model3D level;
+    Index n_vertices = m->n_vertices, n_faces = m->n_faces;
+    double start = profile_clock();
+    int i, err;
+
+    if (n_levels <= 0)
+        return ERR_INVALID_ARGUMENT;
+    for (i = 0; i < n_levels; ++i)
+        if (targets[i] <= 0 || (i > 0 && targets[i] >= targets[i - 1]))
+            return ERR_INVALID_ARGUMENT;
+
+    err = decimation_init(&s, m);
+    for (i = 0; err == 0 && i < n_levels; ++i)
+    {
+        decimation_run(&s, targets[i], 0);
+
+        init_model(&level);
+        strcpy(level.filename, m->filename);
+        level.file_model = NULL;
+        err = decimation_export(&s, &level);
+        if (err == 0)
+        {
+            err = save_model(files[i], &level);
+            if (err != 0 && err != ERR_INVALID_ARGUMENT)
+                err = ERR_IO;
+        }
+        clear_model(&level);
+    }
+    decimation_free(&s);
+
+    profile_record(PROF_DECIMATE, start, n_vertices, n_faces);
+
+    return err;
+}
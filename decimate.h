@@ -0,0 +1,92 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) Martino Pilia, 2015
+ */
+
+/*!
+ * \file decimate.h
+ */
+
+#ifndef DECIMATE_H
+#define DECIMATE_H
+
+#include "backend.h"
+
+/*!
+ * Weight of the constraint planes added along the boundary edges, relative
+ * to the face planes, which keeps open borders from shrinking.
+ */
+#define DECIMATE_BOUNDARY_WEIGHT 100.0
+
+/*!
+ * Number of faces above which the collapses are done in parallel batches,
+ * see decimate(Model3D*, Index, double).
+ */
+#define DECIMATE_BATCH_FACES (1 << 20)
+
+/*!
+ * \brief Simplify a model by edge collapses driven by the quadric error
+ * metric.
+ *
+ * Each vertex holds the sum of the quadrics of the planes of its faces,
+ * weighted by their area. Edges are collapsed in order of increasing
+ * error, each one into the position which minimizes the sum of the
+ * quadrics of its endpoints, and colors and normals of the new vertex are
+ * interpolated along the edge. Collapses which would make the model
+ * non-manifold or flip a face are skipped.
+ *
+ * Models with more than DECIMATE_BATCH_FACES faces are first reduced in
+ * rounds, each collapsing in parallel a set of cheap edges whose
+ * neighbourhoods do not overlap. Within a round the order is not that of
+ * the costs, so the result is close to, but not the same as, the one of
+ * strictly increasing costs. It does not depend on the number of threads.
+ * @param m Model to be simplified.
+ * @param target_faces Stop when the model has no more than this number of
+ * faces.
+ * @param max_error Stop when the next collapse would introduce an error
+ * (squared distance from the original planes) greater than this value; a
+ * non-positive value means no bound.
+ * @return Zero on success, ERR_INVALID_ARGUMENT if the target is not
+ * positive, ERR_NO_MEMORY if an allocation failed.
+ * @note The model lists are rebuilt, so pointers to the old vertices and
+ * faces are no longer valid.
+ */
+int decimate(Model3D *m, Index target_faces, double max_error);
+
+/*!
+ * \brief Save a chain of progressively simplified copies of a model (levels
+ * of detail).
+ *
+ * The levels are computed in a single decimation run, which stops at each
+ * target to save the current state and then continues from it, so the
+ * connectivity and the quadrics are built once and each level costs only
+ * the collapses which separate it from the previous one. The quadrics keep
+ * the error measured from the original surface, so each level is the same
+ * model which decimate(Model3D*, Index, double) would give for its target,
+ * except that for models with more than DECIMATE_BATCH_FACES faces the
+ * batched rounds stop at the first level.
+ * @param m Model to be simplified, which is not modified.
+ * @param targets Number of faces of each level, positive and decreasing.
+ * @param files Files in which the levels are written with
+ * save_model(FILE*, Model3D*), one for each target.
+ * @param n_levels Number of levels.
+ * @return Zero on success, ERR_INVALID_ARGUMENT if the targets are not
+ * valid, ERR_NO_MEMORY if an allocation failed, ERR_IO if writing a file
+ * failed.
+ */
+int decimate_lod(Model3D *m, const Index *targets, FILE **files,
+        int n_levels);
+
+#endif // DECIMATE_H
@@ -0,0 +1,315 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) Martino Pilia, 2015
+ */
+
+
+/*!
+ * \file deviation.c
+ */
+
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+
+#include "adjacency.h"
+#include "bvh.h"
+#include "deviation.h"
+#include "profile.h"
+
+/*!
+ * Copy the coordinates of the k-th vertex of a face in double precision.
+ */
+static void corner(const Model3D *m, Index f, int k, double p[3])
+{
+    const Point3D *q = &m->vertices_array[face_vertex(m, f, k)]
+        ->vertexCoordinates;
+
+    p[0] = q->x;
+    p[1] = q->y;
+    p[2] = q->z;
+}
+
+/*!
+ * Compute the unit normal of each face (null for a degenerate face), then
+ * the pseudo-normal of each vertex, as the sum of the normals of its faces
+ * weighted by their angle in the vertex. The normal of an edge is the sum
+ * of the normals of its two faces, computed when needed.
+ */
+static void pseudo_normals(Model3D *ref, const Adjacency *adj, double *fn,
+        double *vn)
+{
+    Index f, v, e, g;
+    double a[3], b[3], c[3], u[3], w[3], n[3], len, angle;
+    int j, k;
+
+    #pragma omp parallel for schedule(static) private(a, b, c, u, w, n, len, k)
+    for (f = 0; f < ref->n_faces; ++f)
+    {
+        corner(ref, f, 0, a);
+        corner(ref, f, 1, b);
+        corner(ref, f, 2, c);
+        for (k = 0; k < 3; ++k)
+        {
+            u[k] = b[k] - a[k];
+            w[k] = c[k] - a[k];
+        }
+        n[0] = u[1] * w[2] - u[2] * w[1];
+        n[1] = u[2] * w[0] - u[0] * w[2];
+        n[2] = u[0] * w[1] - u[1] * w[0];
+        len = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        for (k = 0; k < 3; ++k)
+            fn[3 * f + k] = len > 0 ? n[k] / len : 0;
+    }
+
+    #pragma omp parallel for schedule(static) \
+            private(e, g, a, b, c, u, w, n, angle, j, k)
+    for (v = 0; v < ref->n_vertices; ++v)
+    {
+        vn[3 * v] = vn[3 * v + 1] = vn[3 * v + 2] = 0;
+
+        for (e = adj->vf_offsets[v]; e < adj->vf_offsets[v + 1]; ++e)
+        {
+            g = adj->vf[e];
+            for (j = 0; j < 3 && face_vertex(ref, g, j) != v; ++j)
+                ;
+            corner(ref, g, j, a);
+            corner(ref, g, (j + 1) % 3, b);
+            corner(ref, g, (j + 2) % 3, c);
+            for (k = 0; k < 3; ++k)
+            {
+                u[k] = b[k] - a[k];
+                w[k] = c[k] - a[k];
+            }
+            n[0] = u[1] * w[2] - u[2] * w[1];
+            n[1] = u[2] * w[0] - u[0] * w[2];
+            n[2] = u[0] * w[1] - u[1] * w[0];
+            angle = atan2(sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]),
+                    u[0] * w[0] + u[1] * w[1] + u[2] * w[2]);
+            for (k = 0; k < 3; ++k)
+                vn[3 * v + k] += angle * fn[3 * g + k];
+        }
+    }
+}
+
+/*!
+ * Return the sign of the distance between a point and its closest point
+ * on a face of the reference, from the pseudo-normal of the face, of the
+ * edge or of the vertex containing the closest point, located by its
+ * barycentric coordinates.
+ */
+static double side(Model3D *ref, const Adjacency *adj, const double *fn,
+        const double *vn, Index f, const double p[3], const double q[3])
+{
+    double a[3], b[3], c[3], u[3], w[3], r[3], n[3], bary[3];
+    double e11 = 0, e12 = 0, e22 = 0, r1 = 0, r2 = 0, det, dot = 0;
+    Index twin, v;
+    int k, j, zeros = 0, first = 0, last = 0;
+
+    corner(ref, f, 0, a);
+    corner(ref, f, 1, b);
+    corner(ref, f, 2, c);
+
+    for (k = 0; k < 3; ++k)
+    {
+        u[k] = b[k] - a[k];
+        w[k] = c[k] - a[k];
+        r[k] = q[k] - a[k];
+        e11 += u[k] * u[k];
+        e12 += u[k] * w[k];
+        e22 += w[k] * w[k];
+        r1 += u[k] * r[k];
+        r2 += w[k] * r[k];
+    }
+
+    det = e11 * e22 - e12 * e12;
+    if (det > 0)
+    {
+        bary[1] = (e22 * r1 - e12 * r2) / det;
+        bary[2] = (e11 * r2 - e12 * r1) / det;
+        bary[0] = 1 - bary[1] - bary[2];
+        for (k = 0; k < 3; ++k)
+        {
+            if (bary[k] < DEVIATION_EPS)
+            {
+                ++zeros;
+                last = k;
+            }
+            else
+                first = k;
+        }
+    }
+    else
+        zeros = 2; /* degenerate face, use the normal of a vertex */
+
+    if (zeros >= 2)
+    {
+        v = face_vertex(ref, f, first);
+        for (k = 0; k < 3; ++k)
+            n[k] = vn[3 * v + k];
+    }
+    else if (zeros == 1)
+    {
+        /* the edge opposite to the null coordinate */
+        j = (last + 1) % 3;
+        twin = adj->twin[3 * f + j];
+        for (k = 0; k < 3; ++k)
+            n[k] = fn[3 * f + k] + (twin >= 0 ? fn[3 * (twin / 3) + k] : 0);
+    }
+    else
+    {
+        for (k = 0; k < 3; ++k)
+            n[k] = fn[3 * f + k];
+    }
+
+    for (k = 0; k < 3; ++k)
+        dot += (p[k] - q[k]) * n[k];
+
+    return dot < 0 ? -1 : 1;
+}
+
+/*!
+ * Build the hierarchy and the pseudo-normals of the reference, then query
+ * the closest point of each vertex in parallel. Vertices near in the list
+ * are usually near in space, so the distance of the previous vertex of the
+ * thread plus the distance between the two vertices, which bounds the
+ * distance of the current one, limits the search from the start.
+ */
+int surface_distances(Model3D *m, Model3D *ref, double *d)
+{
+    const Adjacency *adj;
+    Bvh bvh;
+    double *fn, *vn;
+    double p[3], q[3], last[3] = {0, 0, 0};
+    double last_d = -1, bound;
+    Point3D c;
+    Index v, f;
+    float dist;
+    int status;
+
+    if (ref->n_faces <= 0)
+        return ERR_INVALID_ARGUMENT;
+
+    adj = model_halfedges(ref);
+    if (adj == NULL)
+        return ERR_NO_MEMORY;
+
+    fn = (double*) malloc(3 * ref->n_faces * sizeof (double));
+    vn = (double*) malloc(3 * ref->n_vertices * sizeof (double));
+    if (fn == NULL || vn == NULL)
+    {
+        free(fn);
+        free(vn);
+        return ERR_NO_MEMORY;
+    }
+
+    status = bvh_build(&bvh, ref);
+    if (status != 0)
+    {
+        free(fn);
+        free(vn);
+        return status;
+    }
+
+    pseudo_normals(ref, adj, fn, vn);
+
+    #pragma omp parallel for schedule(dynamic, 256) \
+            private(p, q, c, f, dist, bound) firstprivate(last, last_d)
+    for (v = 0; v < m->n_vertices; ++v)
+    {
+        c = m->vertices_array[v]->vertexCoordinates;
+        p[0] = c.x;
+        p[1] = c.y;
+        p[2] = c.z;
+
+        /* the margin covers the rounding of the single precision search */
+        f = -1;
+        if (last_d >= 0)
+        {
+            bound = last_d + sqrt((p[0] - last[0]) * (p[0] - last[0])
+                    + (p[1] - last[1]) * (p[1] - last[1])
+                    + (p[2] - last[2]) * (p[2] - last[2]));
+            f = bvh_closest(&bvh, c, bound * 1.001 + FLT_EPSILON, &c, &dist);
+        }
+        if (f < 0)
+            f = bvh_closest(&bvh, c, FLT_MAX, &c, &dist);
+        if (f < 0)
+        {
+            d[v] = 0; /* only for invalid coordinates */
+            continue;
+        }
+
+        q[0] = c.x;
+        q[1] = c.y;
+        q[2] = c.z;
+        d[v] = dist * side(ref, adj, fn, vn, f, p, q);
+
+        last[0] = p[0];
+        last[1] = p[1];
+        last[2] = p[2];
+        last_d = dist;
+    }
+
+    bvh_free(&bvh);
+    free(fn);
+    free(vn);
+
+    return 0;
+}
+
+/*!
+ * Compute the distances and map them to colors with color_scalar(Model3D*,
+ * ColorRGB, const double*).
+ */
+int color_deviation(Model3D *m, ColorRGB c, Model3D *ref, double range[2])
+{
+    double *d;
+    double min = DBL_MAX, max = -DBL_MAX;
+    Index v;
+    int status;
+    double start = profile_clock();
+
+    d = (double*) malloc((m->n_vertices + 1) * sizeof (double));
+    if (d == NULL)
+        return ERR_NO_MEMORY;
+
+    status = surface_distances(m, ref, d);
+    if (status)
+    {
+        free(d);
+        return status;
+    }
+
+    for (v = 0; v < m->n_vertices; ++v)
+    {
+        if (d[v] < min)
+            min = d[v];
+        if (d[v] > max)
+            max = d[v];
+    }
+    if (range != NULL)
+    {
+        range[0] = min;
+        range[1] = max;
+    }
+
+    status = color_scalar(m, c, d);
+    free(d);
+
+    if (status == 0)
+        profile_record(PROF_COLOR_DEV, start, m->n_vertices, ref->n_faces);
+
+    return status;
+}
@@ -0,0 +1,69 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) Martino Pilia, 2015
+ */
+
+
+/*!
+ * \file deviation.h
+ */
+
+#ifndef DEVIATION_H
+#define DEVIATION_H
+
+#include "backend.h"
+
+/*!
+ * Tolerance on the barycentric coordinates of a closest point, below which
+ * it is taken on an edge or on a vertex of the reference face.
+ */
+#define DEVIATION_EPS 1e-4
+
+/*!
+ * \brief Compute the signed distance of each vertex from the surface of a
+ * reference model.
+ *
+ * The closest point of the reference surface is found through a bounding
+ * volume hierarchy over its faces, with the vertices processed in
+ * parallel. The sign is taken from the angle-weighted pseudo-normal of the
+ * face, edge or vertex containing the closest point (Baerentzen and
+ * Aanaes), which is reliable also where the closest point is on an edge or
+ * on a vertex.
+ * @param m Model whose vertices are measured.
+ * @param ref Reference model.
+ * @param d Array of n_vertices elements, filled with the distance of each
+ * vertex, positive on the side of the reference faces towards which their
+ * normals point (outside, for faces oriented counterclockwise from
+ * outside) and negative on the other side.
+ * @return Zero on success, ERR_NO_MEMORY if an allocation failed or
+ * ERR_INVALID_ARGUMENT if the reference has no faces.
+ */
+int surface_distances(Model3D *m, Model3D *ref, double *d);
+
+/*!
+ * \brief Apply a coloration based on the signed distance of each vertex
+ * from the surface of a reference model.
+ * @param m Model to be colored.
+ * @param c Color of the vertices deepest inside the reference.
+ * @param ref Reference model.
+ * @param range If not NULL, filled with the minimum and the maximum
+ * distance.
+ * @return Zero if coloration was fine, -1 if all vertices have the same
+ * distance, ERR_NO_MEMORY or ERR_INVALID_ARGUMENT on error.
+ * @note Vertices farthest outside the reference are colored in white.
+ */
+int color_deviation(Model3D *m, ColorRGB c, Model3D *ref, double range[2]);
+
+#endif // DEVIATION_H
@@ -0,0 +1,341 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) Martino Pilia, 2015
+ */
+
+/*!
+ * \file fields.c
+ */
+
+#include <float.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "adjacency.h"
+#include "bvh.h"
+#include "fields.h"
+#include "profile.h"
+
+/*!
+ * Full angle in radians. The angle deficit is a small difference between
+ * large numbers, so it needs more digits than the PI macro provides.
+ */
+#define FULL_ANGLE 6.283185307179586
+
+/*!
+ * Return the position of a vertex in a face, or -1 if it does not belong
+ * to the face.
+ */
+static int corner_of(const Model3D *m, Index f, Index v)
+{
+    int k;
+
+    for (k = 0; k < 3; ++k)
+        if (face_vertex(m, f, k) == v)
+            return k;
+
+    return -1;
+}
+
+/*!
+ * Return the coordinates of a vertex.
+ */
+static Point3D position(const Model3D *m, Index v)
+{
+    return m->vertices_array[v]->vertexCoordinates;
+}
+
+/*!
+ * Gather the contributions of the faces around each vertex, through the
+ * vertex-to-face lists. For the face (v, a, b) with angles alpha in a and
+ * beta in b, the Laplacian gets cot(beta) (a - v) + cot(alpha) (b - v),
+ * the angle sum gets the angle in v, and the area and the normal get the
+ * face ones. Cotangents are computed as the ratio between the dot and the
+ * cross product of the edges, without trigonometric functions.
+ *
+ * A vertex is on the boundary when it has more neighbours than faces; its
+ * angle deficit is then measured from pi instead of 2 pi.
+ */
+int curvature(Model3D *m, double *mean, double *gauss)
+{
+    const Adjacency *adj;
+    Index v, e, g, a, b;
+    Point3D pv, pa, pb;
+    double ea[3], eb[3], ab[3], cr[3], lap[3], n[3];
+    double dbl_area, area, angle, cot_a, cot_b, norm;
+    int j, i;
+    double start = profile_clock();
+
+    adj = model_adjacency(m);
+    if (adj == NULL)
+        return ERR_NO_MEMORY;
+
+    #pragma omp parallel for schedule(dynamic, 4096) \
+            private(e, g, a, b, pv, pa, pb, ea, eb, ab, cr, lap, n, \
+                    dbl_area, area, angle, cot_a, cot_b, norm, j, i)
+    for (v = 0; v < m->n_vertices; ++v)
+    {
+        pv = position(m, v);
+        area = angle = 0;
+        for (i = 0; i < 3; ++i)
+            lap[i] = n[i] = 0;
+
+        for (e = adj->vf_offsets[v]; e < adj->vf_offsets[v + 1]; ++e)
+        {
+            g = adj->vf[e];
+            j = corner_of(m, g, v);
+            a = face_vertex(m, g, (j + 1) % 3);
+            b = face_vertex(m, g, (j + 2) % 3);
+            pa = position(m, a);
+            pb = position(m, b);
+
+            ea[0] = pa.x - pv.x;
+            ea[1] = pa.y - pv.y;
+            ea[2] = pa.z - pv.z;
+            eb[0] = pb.x - pv.x;
+            eb[1] = pb.y - pv.y;
+            eb[2] = pb.z - pv.z;
+            ab[0] = pb.x - pa.x;
+            ab[1] = pb.y - pa.y;
+            ab[2] = pb.z - pa.z;
+
+            cr[0] = ea[1] * eb[2] - ea[2] * eb[1];
+            cr[1] = ea[2] * eb[0] - ea[0] * eb[2];
+            cr[2] = ea[0] * eb[1] - ea[1] * eb[0];
+            dbl_area = sqrt(cr[0] * cr[0] + cr[1] * cr[1] + cr[2] * cr[2]);
+            if (dbl_area == 0)
+                continue;
+
+            /* angle in a between a->v and a->b, angle in b between b->v
+             * and b->a */
+            cot_a = -(ea[0] * ab[0] + ea[1] * ab[1] + ea[2] * ab[2])
+                / dbl_area;
+            cot_b = (eb[0] * ab[0] + eb[1] * ab[1] + eb[2] * ab[2])
+                / dbl_area;
+
+            for (i = 0; i < 3; ++i)
+            {
+                lap[i] += cot_b * ea[i] + cot_a * eb[i];
+                n[i] += cr[i];
+            }
+
+            angle += atan2(dbl_area,
+                    ea[0] * eb[0] + ea[1] * eb[1] + ea[2] * eb[2]);
+            area += dbl_area / 6;
+        }
+
+        norm = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+        if (mean != NULL)
+            mean[v] = area > 0 && norm > 0
+                ? -(lap[0] * n[0] + lap[1] * n[1] + lap[2] * n[2])
+                    / (norm * 4 * area)
+                : 0;
+
+        if (gauss != NULL)
+        {
+            if (area == 0)
+                gauss[v] = 0;
+            else if (adj->vv_offsets[v + 1] - adj->vv_offsets[v]
+                    > adj->vf_offsets[v + 1] - adj->vf_offsets[v])
+                gauss[v] = (FULL_ANGLE / 2 - angle) / area;
+            else
+                gauss[v] = (FULL_ANGLE - angle) / area;
+        }
+    }
+
+    profile_record(PROF_CURVATURE, start, m->n_vertices, m->n_faces);
+
+    return 0;
+}
+
+/*!
+ * Random number generator for the ray directions (xorshift), returning
+ * values in [0,1).
+ */
+static double next_random(uint64_t *s)
+{
+    *s ^= *s << 13;
+    *s ^= *s >> 7;
+    *s ^= *s << 17;
+    return (*s >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/*!
+ * Cast the rays from each vertex in parallel. The normal of each vertex is
+ * computed from its faces, instead of being taken from the model, so that
+ * wrong normals in the file do not spoil the estimate. Ray origins are
+ * moved slightly along the normal, to avoid hitting the faces of the
+ * vertex itself.
+ */
+int ambient_occlusion(Model3D *m, double *ao)
+{
+    const Adjacency *adj;
+    Bvh bvh;
+    Index v, e, g;
+    Point3D p, o, pa, pb;
+    Vector3D d;
+    double n[3], t[3], b[3], cr[3], norm, r1, r2, phi, s;
+    double lo[3] = {DBL_MAX, DBL_MAX, DBL_MAX};
+    double hi[3] = {-DBL_MAX, -DBL_MAX, -DBL_MAX};
+    double diag, eps;
+    uint64_t seed;
+    int j, k, open;
+    double start = profile_clock();
+
+    adj = model_adjacency(m);
+    if (adj == NULL)
+        return ERR_NO_MEMORY;
+
+    if (bvh_build(&bvh, m))
+        return ERR_NO_MEMORY;
+
+    for (v = 0; v < m->n_vertices; ++v)
+    {
+        p = position(m, v);
+        lo[0] = fmin(lo[0], p.x);
+        lo[1] = fmin(lo[1], p.y);
+        lo[2] = fmin(lo[2], p.z);
+        hi[0] = fmax(hi[0], p.x);
+        hi[1] = fmax(hi[1], p.y);
+        hi[2] = fmax(hi[2], p.z);
+    }
+    diag = sqrt((hi[0] - lo[0]) * (hi[0] - lo[0])
+            + (hi[1] - lo[1]) * (hi[1] - lo[1])
+            + (hi[2] - lo[2]) * (hi[2] - lo[2]));
+    eps = 1e-4 * diag;
+
+    #pragma omp parallel for schedule(dynamic, 256) \
+            private(e, g, p, o, pa, pb, d, n, t, b, cr, norm, r1, r2, phi, \
+                    s, seed, j, k, open)
+    for (v = 0; v < m->n_vertices; ++v)
+    {
+        p = position(m, v);
+
+        /* area-weighted normal from the faces */
+        n[0] = n[1] = n[2] = 0;
+        for (e = adj->vf_offsets[v]; e < adj->vf_offsets[v + 1]; ++e)
+        {
+            g = adj->vf[e];
+            j = corner_of(m, g, v);
+            pa = position(m, face_vertex(m, g, (j + 1) % 3));
+            pb = position(m, face_vertex(m, g, (j + 2) % 3));
+            n[0] += (pa.y - p.y) * (pb.z - p.z) - (pa.z - p.z) * (pb.y - p.y);
+            n[1] += (pa.z - p.z) * (pb.x - p.x) - (pa.x - p.x) * (pb.z - p.z);
+            n[2] += (pa.x - p.x) * (pb.y - p.y) - (pa.y - p.y) * (pb.x - p.x);
+        }
+        norm = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (norm == 0)
+        {
+            ao[v] = 1; /* isolated vertex, nothing to occlude it */
+            continue;
+        }
+        for (k = 0; k < 3; ++k)
+            n[k] /= norm;
+
+        /* orthonormal basis (t, b, n) */
+        if (fabs(n[0]) > 0.5)
+        {
+            cr[0] = 0;
+            cr[1] = 1;
+        }
+        else
+        {
+            cr[0] = 1;
+            cr[1] = 0;
+        }
+        cr[2] = 0;
+        t[0] = cr[1] * n[2] - cr[2] * n[1];
+        t[1] = cr[2] * n[0] - cr[0] * n[2];
+        t[2] = cr[0] * n[1] - cr[1] * n[0];
+        norm = sqrt(t[0] * t[0] + t[1] * t[1] + t[2] * t[2]);
+        for (k = 0; k < 3; ++k)
+            t[k] /= norm;
+        b[0] = n[1] * t[2] - n[2] * t[1];
+        b[1] = n[2] * t[0] - n[0] * t[2];
+        b[2] = n[0] * t[1] - n[1] * t[0];
+
+        o.x = p.x + eps * n[0];
+        o.y = p.y + eps * n[1];
+        o.z = p.z + eps * n[2];
+
+        /* the seed depends on the vertex only (never zero) */
+        seed = (uint64_t) v * 0x9E3779B97F4A7C15ull + 1;
+        open = 0;
+
+        for (j = 0; j < AO_RAYS; ++j)
+        {
+            r1 = next_random(&seed);
+            r2 = next_random(&seed);
+            phi = FULL_ANGLE * r1;
+            s = sqrt(r2);
+
+            d.x = (t[0] * cos(phi) + b[0] * sin(phi)) * s + n[0] * sqrt(1 - r2);
+            d.y = (t[1] * cos(phi) + b[1] * sin(phi)) * s + n[1] * sqrt(1 - r2);
+            d.z = (t[2] * cos(phi) + b[2] * sin(phi)) * s + n[2] * sqrt(1 - r2);
+
+            if (!bvh_occluded(&bvh, o, d, AO_RANGE * diag))
+                ++open;
+        }
+
+        ao[v] = (double) open / AO_RAYS;
+    }
+
+    bvh_free(&bvh);
+
+    profile_record(PROF_OCCLUSION, start, m->n_vertices, m->n_faces);
+
+    return 0;
+}
+
+/*!
+ * Compute the requested field, then map it to colors with
+ * color_scalar(Model3D*, ColorRGB, const double*).
+ */
+int color_field(Model3D *m, ColorRGB c, Field f)
+{
+    double *values;
+    int status;
+
+    values = (double*) malloc((m->n_vertices + 1) * sizeof (double));
+    if (values == NULL)
+        return ERR_NO_MEMORY;
+
+    switch (f)
+    {
+        case FIELD_MEAN_CURVATURE:
+            status = curvature(m, values, NULL);
+            break;
+
+        case FIELD_GAUSSIAN_CURVATURE:
+            status = curvature(m, NULL, values);
+            break;
+
+        case FIELD_OCCLUSION:
+            status = ambient_occlusion(m, values);
+            break;
+
+        default:
+            status = ERR_INVALID_ARGUMENT;
+            break;
+    }
+
+    if (status == 0)
+        status = color_scalar(m, c, values);
+
+    free(values);
+    return status;
+}
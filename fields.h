@@ -0,0 +1,93 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) Martino Pilia, 2015
+ */
+
+/*!
+ * \file fields.h
+ *
+ * Scalar fields computed on the vertices of a model, for the coloration
+ * with color_scalar(Model3D*, ColorRGB, const double*).
+ */
+
+#ifndef FIELDS_H
+#define FIELDS_H
+
+#include "backend.h"
+
+/*! Number of rays cast from each vertex by ambient_occlusion(). */
+#define AO_RAYS 32
+
+/*!
+ * Length of the rays cast by ambient_occlusion(), relative to the diagonal
+ * of the model bounding box. Faces farther than that do not occlude.
+ */
+#define AO_RANGE 0.25
+
+/*!
+ * Type for the scalar fields avaible for color_field().
+ */
+typedef enum Field
+{
+    FIELD_MEAN_CURVATURE = 1,     /*!< Discrete mean curvature. */
+    FIELD_GAUSSIAN_CURVATURE = 2, /*!< Discrete Gaussian curvature. */
+    FIELD_OCCLUSION = 3           /*!< Ambient occlusion. */
+} Field;
+
+/*!
+ * \brief Compute the discrete curvature at each vertex.
+ *
+ * The mean curvature comes from the cotangent Laplacian of the vertex
+ * positions, with positive values on convex regions (for faces oriented
+ * counterclockwise from outside). The Gaussian curvature is the angle
+ * deficit of the vertex. Both are divided by the barycentric area of the
+ * vertex, one third of the area of its faces.
+ * @param m Model.
+ * @param mean Array of n_vertices elements filled with the mean curvature,
+ * or NULL.
+ * @param gauss Array of n_vertices elements filled with the Gaussian
+ * curvature, or NULL.
+ * @return Zero on success, ERR_NO_MEMORY if an allocation failed.
+ * @note Vertices without faces of nonzero area get a null curvature.
+ */
+int curvature(Model3D *m, double *mean, double *gauss);
+
+/*!
+ * \brief Estimate the ambient occlusion at each vertex.
+ *
+ * AO_RAYS rays are cast from each vertex over the hemisphere around its
+ * normal, with a cosine-weighted distribution, and the fraction of rays
+ * which do not hit the model within AO_RANGE is taken as the openness of
+ * the vertex. Ray queries are accelerated with a bounding volume
+ * hierarchy, and the sample directions depend on the vertex index only, so
+ * the result does not depend on the number of threads.
+ * @param m Model, whose info must be computed.
+ * @param ao Array of n_vertices elements filled with values in [0,1], where
+ * zero is fully occluded and one fully open.
+ * @return Zero on success, ERR_NO_MEMORY if an allocation failed.
+ */
+int ambient_occlusion(Model3D *m, double *ao);
+
+/*!
+ * \brief Color the model according to a scalar field.
+ * @param m Model to be colored.
+ * @param c Color of the vertices with the lowest value.
+ * @param f Field.
+ * @return Zero if coloration was fine, -1 if the field is constant,
+ * ERR_NO_MEMORY or ERR_INVALID_ARGUMENT on error.
+ */
+int color_field(Model3D *m, ColorRGB c, Field f);
+
+#endif // FIELDS_H
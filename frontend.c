@@ -28,7 +28,135 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "align.h"
+#include "cleanup.h"
+#include "components.h"
+#include "decimate.h"
+#include "deviation.h"
+#include "fields.h"
 #include "frontend.h"
+#include "geodesic.h"
+#include "hull.h"
+#include "manifold.h"
+#include "normals.h"
+#include "profile.h"
+#include "quality.h"
+#include "reorder.h"
+#include "smooth.h"
+#include "subdivide.h"
+#include "trace.h"
+#include "vcache.h"
+#include "weld.h"
+
+/*! Maximum number of levels of detail saved at once. */
+#define LOD_MAX_LEVELS 8
+
+/*! Name of the JSON file for the profiling report, if requested. */
+static char profile_json[STR_LEN + 1];
+
+/*! Flag for the human readable profiling report on stderr. */
+static int profile_stderr = 0;
+
+/*! Name of the file for the trace events, if requested. */
+static char trace_json[STR_LEN + 1];
+
+/*! Labels of the actions in the main menu, indexed by Action value. */
+static const char *action_labels[EXIT + 1] =
+{
+    [COL_FLAT] = "flat coloration",
+    [COL_GRAD] = "gradient coloration",
+    [COL_DIST] = "distance-based coloration",
+    [COL_RAND] = "random coloration",
+    [COL_MULTI] = "distance from a set of points coloration",
+    [COL_GEO] = "geodesic distance coloration",
+    [COL_FIELD] = "curvature or ambient occlusion coloration",
+    [COL_COMP] = "connected components coloration",
+    [COL_DEV] = "deviation from a reference model coloration",
+    [INFO] = "model info",
+    [ROTATE] = "apply a rotation",
+    [ALIGN] = "align the principal axes",
+    [NORMALS] = "recompute vertex normals",
+    [SMOOTH] = "smooth the model surface",
+    [SUBDIVIDE] = "subdivide the model faces",
+    [DECIMATE] = "simplify the model",
+    [LOD] = "save levels of detail",
+    [WELD] = "merge duplicate vertices",
+    [CLEANUP] = "remove degenerate faces and small components",
+    [ORIENT] = "make face orientation consistent",
+    [REORDER] = "reorder vertices and faces for locality",
+    [VCACHE] = "optimize face order for GPU rendering",
+    [ANOTHER] = "pick another model",
+    [SAVE] = "save modified model",
+    [EXIT] = "exit without actions",
+};
+
+/*!
+ * Write the profiling reports requested on the command line. This procedure
+ * is registered with atexit(), so it runs however the program terminates.
+ */
+static void dump_profile(void)
+{
+    if (profile_stderr)
+        profile_report(stderr);
+
+    if (profile_json[0] != '\0' && profile_write_json(profile_json))
+        fprintf(stderr, "Unable to write profile on %s\n", profile_json);
+
+    if (trace_json[0] != '\0' && trace_write_json(trace_json))
+        fprintf(stderr, "Unable to write trace on %s\n", trace_json);
+}
+
+/*!
+ * Scan the command line for the following options:
+ * <ul>
+ *   <li> <code>-p</code>: write a profiling report on stderr at exit; </li>
+ *   <li> <code>-j FILE</code>: write a profiling report in JSON format on
+ *        the file FILE at exit; </li>
+ *   <li> <code>-t FILE</code>: write the trace of backend calls in Chrome
+ *        trace-event format on the file FILE at exit; </li>
+ *   <li> <code>-s N</code>: trace one call out of N for each thread
+ *        (default 1). </li>
+ * </ul>
+ * On invalid arguments, a usage message is shown.
+ */
+int parse_arguments(int argc, char *argv[])
+{
+    int i, sampling = 1;
+
+    for (i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "-p") == 0)
+            profile_stderr = 1;
+        else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+            strncpy(profile_json, argv[++i], STR_LEN);
+        else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+            strncpy(trace_json, argv[++i], STR_LEN);
+        else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc
+                && (sampling = atoi(argv[++i])) > 0)
+            continue;
+        else
+        {
+            fprintf(stderr, "Usage: %s [-p] [-j FILE] [-t FILE [-s N]]\n"
+                    "  -p       write a profiling report on stderr\n"
+                    "  -j FILE  write a profiling report in JSON on FILE\n"
+                    "  -t FILE  write a trace of backend calls on FILE\n"
+                    "  -s N     trace one call out of N (default 1)\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+
+    if (profile_stderr || profile_json[0] != '\0')
+        profile_enable(1);
+
+    if (trace_json[0] != '\0')
+        trace_enable(sampling);
+
+    if (profile_enabled() || trace_enabled())
+        atexit(dump_profile);
+
+    return 0;
+}
 
 /*!
  * This procedure shows a menu in the console, asking the user to chose one
@@ -202,24 +330,18 @@ void get_output_filename(char *outFile)
  * Show in the console a menu, asking the user for the desired action. Validate
  * input and return the choice to the caller.
  */
-Action main_menu(Model3D m)
+Action main_menu(Model3D *m)
 {
     Action choice;
+    int i;
 
     /* show a menu and get user choice */
     printf( "\nModel: %s\n"
-            "Avaible actions:\n"
-            "  1: flat coloration\n"
-            "  2: gradient coloration\n"
-            "  3: distance-based coloration\n"
-            "  4: random coloration\n"
-            "  5: model info\n"
-            "  6: apply a rotation\n"
-            "  7: pick another model\n"
-            "  8: save modified model\n"
-            "  9: exit without actions\n"
-            STR_ATT("Chose an action [1-9]: ", ANSI_ATT_BOLD),
-            m.filename);
+            "Avaible actions:\n",
+            m->filename);
+    for (i = COL_FLAT; i <= EXIT; ++i)
+        printf("  %d: %s\n", i, action_labels[i]);
+    printf(STR_ATT("Chose an action [1-%d]: ", ANSI_ATT_BOLD), EXIT);
 
     /* get the user choice */
     do
@@ -230,9 +352,9 @@ Action main_menu(Model3D m)
         /* show message on invalid choice */
         if (choice < COL_FLAT || choice > EXIT)
             printf(STR_ATT(
-                    "Invalid choice. Please retry [1-9]: ",
+                    "Invalid choice. Please retry [1-%d]: ",
                     ANSI_ATT_BOLD
-                    ));
+                    ), EXIT);
 
     } while (choice < COL_FLAT || choice > EXIT);
 
@@ -268,6 +390,228 @@ int ask_exit(void)
     return flag - 2; /* 0 if user wants to exit */
 }
 
+/*!
+ * Print the connected components of the model, one line for each of the
+ * largest ones and a summary line for the others.
+ */
+static void show_components(Model3D *model)
+{
+    Components c;
+    Component *p;
+    Index i, faces = 0, vertices = 0;
+
+    if (model_components(model, &c) != 0)
+    {
+        printf(STR_COL_ATT(
+                "Error: not enough memory to find the connected components.\n",
+                ANSI_COL_RED,
+                ANSI_ATT_BOLD));
+        return;
+    }
+
+    printf(STR_COL("\n  connected components: %lld\n", ANSI_COL_GRE), c.n);
+
+    if (c.n > 1)
+    {
+        printf(STR_COL(
+                    "  %6s %10s %10s %12s %12s  %s\n",
+                    ANSI_COL_GRE),
+                "#", "vertices", "faces", "surface", "volume",
+                "bounding box");
+
+        for (i = 0; i < c.n && i < COMPONENTS_SHOWN; ++i)
+        {
+            p = &c.parts[i];
+            printf(STR_COL(
+                        "  %6lld %10lld %10lld %12g %12g"
+                        "  (%g, %g, %g) - (%g, %g, %g)\n",
+                        ANSI_COL_GRE),
+                    i,
+                    p->n_vertices,
+                    p->n_faces,
+                    p->surface,
+                    p->volume,
+                    p->min.x, p->min.y, p->min.z,
+                    p->max.x, p->max.y, p->max.z);
+        }
+
+        for (; i < c.n; ++i)
+        {
+            vertices += c.parts[i].n_vertices;
+            faces += c.parts[i].n_faces;
+        }
+
+        if (c.n > COMPONENTS_SHOWN)
+        {
+            printf(STR_COL(
+                        "  ... %lld smaller components, with %lld vertices and "
+                        "%lld faces\n",
+                        ANSI_COL_GRE),
+                    c.n - COMPONENTS_SHOWN,
+                    vertices,
+                    faces);
+        }
+    }
+
+    components_free(&c);
+}
+
+/*!
+ * Print the edge counts of the model, and whether its volume is reliable.
+ */
+static void show_surface_check(Model3D *model)
+{
+    SurfaceCheck c;
+
+    if (check_surface(model, &c) != 0)
+    {
+        printf(STR_COL_ATT(
+                "Error: not enough memory to check the surface.\n",
+                ANSI_COL_RED,
+                ANSI_ATT_BOLD));
+        return;
+    }
+
+    printf(STR_COL(
+                "\n  edges:           %lld\n"
+                "  boundary:        %lld\n"
+                "  non-manifold:    %lld\n"
+                "  misoriented:     %lld\n",
+                ANSI_COL_GRE),
+            c.edges,
+            c.boundary,
+            c.non_manifold,
+            c.misoriented);
+
+    if (c.boundary == 0 && c.non_manifold == 0 && c.misoriented == 0)
+        printf(STR_COL(
+                    "  the surface is closed and consistently oriented.\n",
+                    ANSI_COL_GRE));
+    else
+        printf(STR_COL(
+                    "  the surface is not closed or not consistently "
+                    "oriented, so the\n  total volume is not reliable.\n",
+                    ANSI_COL_YEL));
+}
+
+/*!
+ * Print the convex hull and the oriented bounding box of the model. The
+ * compactness is the ratio between the volume of the hull and the volume
+ * of the box, which is near to one for box shaped models.
+ */
+static void show_hull(Model3D *model)
+{
+    ConvexHull h;
+    OrientedBox b;
+    int status;
+
+    status = convex_hull(model, &h);
+
+    if (status == -1)
+    {
+        printf(STR_COL(
+                    "\n  the model is flat, so it has no convex hull.\n",
+                    ANSI_COL_YEL));
+        return;
+    }
+
+    if (status == 0)
+    {
+        status = oriented_box(model, &h, &b);
+        if (status != 0)
+            hull_free(&h);
+    }
+
+    if (status != 0)
+    {
+        printf(STR_COL_ATT(
+                "Error: not enough memory to compute the convex hull.\n",
+                ANSI_COL_RED,
+                ANSI_ATT_BOLD));
+        return;
+    }
+
+    printf(STR_COL(
+                "\n  hull vertices:   %lld\n"
+                "  hull faces:      %lld\n"
+                "  hull surface:    %g\n"
+                "  hull volume:     %g\n"
+                "\n"
+                "  oriented box:    %g x %g x %g\n"
+                "  box volume:      %g\n"
+                "  box center:      (%g, %g, %g)\n"
+                "  compactness:     %g\n",
+                ANSI_COL_GRE),
+            h.n_vertices,
+            h.n_faces,
+            h.surface,
+            h.volume,
+            b.extents[0], b.extents[1], b.extents[2],
+            b.volume,
+            b.center.x, b.center.y, b.center.z,
+            b.volume > 0 ? h.volume / b.volume : 0.0);
+
+    hull_free(&h);
+}
+
+/*!
+ * Print the percentiles of a distribution, and its histogram on a
+ * logarithmic scale between the smallest and the largest value, with a
+ * character for each bin whose density grows with the count.
+ */
+static void show_distribution(const char *name, const Sketch *s)
+{
+    static const char shades[] = " .:-=+*#%@";
+    char bars[QUALITY_BINS + 1];
+    Index counts[QUALITY_BINS], max = 0;
+    int k;
+
+    sketch_histogram(s, QUALITY_BINS, counts);
+
+    for (k = 0; k < QUALITY_BINS; ++k)
+        if (counts[k] > max)
+            max = counts[k];
+
+    for (k = 0; k < QUALITY_BINS; ++k)
+        bars[k] = counts[k] == 0 ? shades[0] : shades[1 + (int)
+                ((sizeof shades - 3) * (double) counts[k] / max)];
+    bars[QUALITY_BINS] = '\0';
+
+    printf(STR_COL(
+                "  %-17s"
+                "p1 %-11g p50 %-11g p99 %g\n"
+                "                   %g |%s| %g\n",
+                ANSI_COL_GRE),
+            name,
+            sketch_quantile(s, 0.01),
+            sketch_quantile(s, 0.5),
+            sketch_quantile(s, 0.99),
+            s->min,
+            bars,
+            s->max);
+}
+
+/*!
+ * Print the distribution of the face areas and of the edge lengths.
+ */
+static void show_quality(Model3D *model)
+{
+    Quality q;
+
+    if (model_quality(model, &q) != 0)
+    {
+        printf(STR_COL_ATT(
+                "Error: not enough memory to compute the face statistics.\n",
+                ANSI_COL_RED,
+                ANSI_ATT_BOLD));
+        return;
+    }
+
+    printf("\n");
+    show_distribution("face area:", &q.area);
+    show_distribution("edge length:", &q.edge);
+}
+
 /*!
  * This procedure shows on the console some info related to a 
  * Model3D object:       
@@ -283,10 +627,17 @@ int ask_exit(void)
  *   <li> largest face vertices indexes and surface; </li>
  *   <li> smallest face vertices indexes and surface; </li>
  *   <li> total surface; </li>
- *   <li> total volume. </li>
+ *   <li> total volume; </li>
+ *   <li> percentiles and histogram of the face areas and of the edge
+ *        lengths; </li>
+ *   <li> number of boundary, non-manifold and misoriented edges; </li>
+ *   <li> size of the convex hull, extents of the oriented bounding box
+ *        and compactness of the model; </li>
+ *   <li> number of connected components, and vertices, faces, surface,
+ *        volume and bounding box of the largest ones. </li>
  * </ul>
  */           
-void show_info(Model3D model)
+void show_info(Model3D *model)
 {
     char left[STR_LEN];
     char right[STR_LEN];
@@ -297,14 +648,14 @@ void show_info(Model3D model)
     char largest[STR_LEN];
     char smallest[STR_LEN];
     
-    if (       model.info.min_x == NULL
-            || model.info.max_x == NULL
-            || model.info.max_y == NULL
-            || model.info.min_y == NULL
-            || model.info.max_z == NULL
-            || model.info.min_z == NULL
-            || model.info.biggest_face == NULL
-            || model.info.smallest_face == NULL
+    if (       model->info.min_x == NULL
+            || model->info.max_x == NULL
+            || model->info.max_y == NULL
+            || model->info.min_y == NULL
+            || model->info.max_z == NULL
+            || model->info.min_z == NULL
+            || model->info.biggest_face == NULL
+            || model->info.smallest_face == NULL
             )
     {
         /* should be unrechable if the code is ok and nothing crazy happens */
@@ -314,15 +665,15 @@ void show_info(Model3D model)
     }
         
 
-    vertex_to_string(left, model.info.min_x);
-    vertex_to_string(right, model.info.max_x);
-    vertex_to_string(up, model.info.max_y);
-    vertex_to_string(down, model.info.min_y);
-    vertex_to_string(front, model.info.max_z);
-    vertex_to_string(back, model.info.min_z);
+    vertex_to_string(left, model->info.min_x);
+    vertex_to_string(right, model->info.max_x);
+    vertex_to_string(up, model->info.max_y);
+    vertex_to_string(down, model->info.min_y);
+    vertex_to_string(front, model->info.max_z);
+    vertex_to_string(back, model->info.min_z);
 
-    face_to_string(largest, model.info.biggest_face);
-    face_to_string(smallest, model.info.smallest_face);
+    face_to_string(largest, model->info.biggest_face);
+    face_to_string(smallest, model->info.smallest_face);
 
     printf(
             STR_COL_ATT(
@@ -330,8 +681,8 @@ void show_info(Model3D model)
                 ANSI_COL_GRE,
                 ANSI_ATT_BOLD)
             STR_COL(
-                "  vertices number: %d\n"
-                "  faces number:    %d\n"
+                "  vertices number: %lld\n"
+                "  faces number:    %lld\n"
                 "  total surface:   %g\n"
                 "  total volume:    %g\n"
                 "\n"
@@ -345,11 +696,11 @@ void show_info(Model3D model)
                 "  largest face:    %s\n"
                 "  smallest face:   %s\n",
                 ANSI_COL_GRE),
-            model.filename,
-            model.n_vertices,
-            model.n_faces,
-            model.info.tot_surface,
-            model.info.volume,
+            model->filename,
+            model->n_vertices,
+            model->n_faces,
+            model->info.tot_surface,
+            model->info.volume,
             left,
             right,
             up,
@@ -359,6 +710,11 @@ void show_info(Model3D model)
             largest,
             smallest
             );
+
+    show_quality(model);
+    show_surface_check(model);
+    show_hull(model);
+    show_components(model);
 }
 
 /*!
@@ -513,6 +869,126 @@ float ask_angle(void)
     return angle;
 }
 
+/*!
+ * Ask the user the name of a file containing a set of points, and read it
+ * with load_points(FILE*, Point3D**, Index*). On failure, a message is shown
+ * and nonzero is returned to the caller.
+ */
+int ask_points(Point3D **p, Index *n)
+{
+    char s[STR_LEN];
+    char fname[STR_LEN + 1];
+    char specifier[STR_LEN + 1];
+    FILE *f;
+    int status;
+
+    printf(STR_ATT(
+                "\nInsert the name of the points file (max. %d chars): ",
+                ANSI_ATT_BOLD),
+            (int) (STR_LEN - strlen(MODEL_DIR)));
+    sprintf(specifier, "%%%ds", (int) (STR_LEN - strlen(MODEL_DIR)));
+    scanf(specifier, s);
+    clear_stdin();
+    f = NULL;
+    if (snprintf(fname, sizeof fname, "%s%s", MODEL_DIR, s)
+            < (int) sizeof fname)
+        f = fopen(fname, "r");
+    if (f == NULL)
+    {
+        printf(STR_COL_ATT(
+                    "\nError: unable to open file %s.\n",
+                    ANSI_COL_RED,
+                    ANSI_ATT_BOLD),
+                fname);
+        return 1;
+    }
+
+    status = load_points(f, p, n);
+    fclose(f);
+
+    if (status)
+        printf(STR_COL_ATT(
+                    "\nError: unable to read any point from %s.\n",
+                    ANSI_COL_RED,
+                    ANSI_ATT_BOLD),
+                fname);
+
+    return status;
+}
+
+/*!
+ * Ask the name of a model file in the model folder, then open and parse it
+ * as done for the main model.
+ */
+int ask_model(Model3D *m)
+{
+    char s[STR_LEN];
+    char specifier[STR_LEN + 1];
+    int status;
+
+    init_model(m);
+
+    printf(STR_ATT(
+                "\nInsert the name of the reference model file "
+                "(max. %d chars): ",
+                ANSI_ATT_BOLD),
+            (int) (STR_LEN - strlen(MODEL_DIR)));
+    sprintf(specifier, "%%%ds", (int) (STR_LEN - strlen(MODEL_DIR)));
+    scanf(specifier, s);
+    clear_stdin();
+    m->file_model = NULL;
+    if (snprintf(m->filename, sizeof m->filename, "%s%s", MODEL_DIR, s)
+            < (int) sizeof m->filename)
+        m->file_model = fopen(m->filename, "r");
+    if (m->file_model == NULL)
+    {
+        printf(STR_COL_ATT(
+                    "\nError: unable to open file %s.\n",
+                    ANSI_COL_RED,
+                    ANSI_ATT_BOLD),
+                m->filename);
+        return 1;
+    }
+
+    status = parse_model_data(m);
+    fclose(m->file_model);
+    m->file_model = NULL;
+
+    if (status)
+    {
+        printf(STR_COL_ATT(
+                    "\nError: unable to read a model from %s.\n",
+                    ANSI_COL_RED,
+                    ANSI_ATT_BOLD),
+                m->filename);
+        if (status != PARSER_ERR_NO_DATA)
+            clear_model(m);
+    }
+
+    return status;
+}
+
+/*!
+ * Show a menu and ask the user a scalar field.
+ */
+Field ask_field(void)
+{
+    int choice;
+
+    printf( "\nField for coloration\n"
+            "  1: mean curvature\n"
+            "  2: Gaussian curvature\n"
+            "  3: ambient occlusion\n"
+            STR_ATT("Chose a field [1-3]: ", ANSI_ATT_BOLD));
+    do
+    {
+        scanf("%d", &choice);
+        clear_stdin();
+    } while (choice < 1 || choice > 3);
+
+    return choice;
+}
+
 /*!
  * Show a menu and ask the user a direction.
  */
@@ -546,13 +1022,17 @@ Direction ask_direction(void)
  * mantain independent from the interface, and then more reusable, the functions 
  * which actually computes the coloration.
  */                
-int color_model(Model3D model, Action action)
+int color_model(Model3D *model, Action action)
 {
     int status = 0;
     char message[STR_LEN + 1];
     ColorRGB c;
     Direction d;
-    Point3D p;
+    Point3D p, *points;
+    Index n_points, source;
+    Field field;
+    Model3D reference;
+    double range[2];
     
     switch (action) 
     {
@@ -675,6 +1155,144 @@ int color_model(Model3D model, Action action)
             }
             return status;
 
+        /* distance from a set of points */
+        case COL_MULTI:
+            printf( "\nMulti-point distance coloration\n"
+                    "Model vertexes will be colored with a fading color. "
+                    "The desired color\nwill be applied to the vertexes "
+                    "nearest to the points read from a file\n(one point per "
+                    "line, as three coordinates), the other vertexes are\n"
+                    "colored with a hue which fades to white according to "
+                    "the distance\nfrom the nearest point.\n"
+                    );
+            c = ask_color();
+            if (ask_points(&points, &n_points))
+                return 1;
+            status = color_distance_multi(model, c, points, n_points);
+            free(points);
+            if (status == ERR_NO_MEMORY)
+            {
+                printf(STR_COL_ATT(
+                        "Error: not enough memory for the coloration.\n",
+                        ANSI_COL_RED,
+                        ANSI_ATT_BOLD));
+            }
+            else if (status)
+            {
+                printf(STR_COL_ATT(
+                        "Error: all model vertexes have equal distance respect "
+                        "to the chosen\npoints, so this kind of coloration is "
+                        "undefined.\n",
+                        ANSI_COL_RED,
+                        ANSI_ATT_BOLD));
+            }
+            else
+            {
+                printf(STR_COL_ATT(
+                        "\nApplied distance based coloration.\n"
+                        "Reference points: %lld\n"
+                        "Starting color: (%d, %d, %d)\n",
+                        ANSI_COL_GRE,
+                        ANSI_ATT_BOLD),
+                    n_points,
+                    c.r,
+                    c.g,
+                    c.b);
+            }
+            return status;
+
+        /* geodesic distance from a vertex */
+        case COL_GEO:
+            printf( "\nGeodesic distance coloration\n"
+                    "Model vertexes will be colored with a fading color. "
+                    "The desired color\nwill be applied to the chosen vertex, "
+                    "the other vertexes are colored\nwith a hue which fades "
+                    "to white according to the length of the\nshortest path "
+                    "along the model edges from such vertex.\n"
+                    );
+            c = ask_color();
+            do
+            {
+                printf(STR_ATT("\nSource vertex index [0-%lld]: ",
+                            ANSI_ATT_BOLD),
+                        model->n_vertices - 1);
+                scanf("%lld", &source);
+                clear_stdin();
+            } while (source < 0 || source >= model->n_vertices);
+            status = color_geodesic(model, c, source);
+            if (status == ERR_NO_MEMORY)
+            {
+                printf(STR_COL_ATT(
+                        "Error: not enough memory for the coloration.\n",
+                        ANSI_COL_RED,
+                        ANSI_ATT_BOLD));
+            }
+            else if (status)
+            {
+                printf(STR_COL_ATT(
+                        "Error: no other vertex is connected to the chosen "
+                        "one, so this kind\nof coloration is undefined.\n",
+                        ANSI_COL_RED,
+                        ANSI_ATT_BOLD));
+            }
+            else
+            {
+                printf(STR_COL_ATT(
+                        "\nApplied geodesic distance coloration.\n"
+                        "Source vertex: %lld\n"
+                        "Starting color: (%d, %d, %d)\n",
+                        ANSI_COL_GRE,
+                        ANSI_ATT_BOLD),
+                    source,
+                    c.r,
+                    c.g,
+                    c.b);
+            }
+            return status;
+
+        /* scalar field */
+        case COL_FIELD:
+            printf( "\nField coloration\n"
+                    "Model vertexes will be colored with a fading color. "
+                    "The desired color\nwill be applied to the vertexes with "
+                    "the lowest value of the chosen\nfield, the other "
+                    "vertexes are colored with a hue which fades to white\n"
+                    "as the value grows.\n"
+                    );
+            c = ask_color();
+            field = ask_field();
+            status = color_field(model, c, field);
+            if (status == ERR_NO_MEMORY)
+            {
+                printf(STR_COL_ATT(
+                        "Error: not enough memory for the coloration.\n",
+                        ANSI_COL_RED,
+                        ANSI_ATT_BOLD));
+            }
+            else if (status)
+            {
+                printf(STR_COL_ATT(
+                        "Error: the field is constant on the model, so this "
+                        "kind of coloration\nis undefined.\n",
+                        ANSI_COL_RED,
+                        ANSI_ATT_BOLD));
+            }
+            else
+            {
+                printf(STR_COL_ATT(
+                        "\nApplied %s coloration.\n"
+                        "Starting color: (%d, %d, %d)\n",
+                        ANSI_COL_GRE,
+                        ANSI_ATT_BOLD),
+                    field == FIELD_MEAN_CURVATURE ? "mean curvature"
+                    : field == FIELD_GAUSSIAN_CURVATURE ? "Gaussian curvature"
+                    : "ambient occlusion",
+                    c.r,
+                    c.g,
+                    c.b);
+            }
+            return status;
+
         /* random coloration */
         case COL_RAND:
             printf( "\nRandom coloration\n"
@@ -688,22 +1306,98 @@ int color_model(Model3D model, Action action)
                     ANSI_ATT_BOLD));
             return status;
 
-        /* other values: invalid */
-        default:
-            /* should be unreachable if code is ok*/
-            break;
-    }
-
-    /* should be unreachable if code is ok*/
-    perror("color_model(): invalid action as parameter");
-    exit(EXIT_FAILURE);
-}
-
-/*!
- * Ask the user for details (axis base point and direction, angle), then apply
- * the desired rotation to the model.
- */
-int rotate_model(Model3D m)
+        /* connected components */
+        case COL_COMP:
+            printf( "\nConnected components coloration\n"
+                    "Each set of vertexes joined by a path of faces is "
+                    "colored with a\nrandom color.\n"
+                    );
+            status = color_components(model);
+            if (status)
+            {
+                printf(STR_COL_ATT(
+                        "Error: not enough memory for the coloration.\n",
+                        ANSI_COL_RED,
+                        ANSI_ATT_BOLD));
+            }
+            else
+            {
+                printf(STR_COL_ATT(
+                        "\nApplied connected components coloration.\n",
+                        ANSI_COL_GRE,
+                        ANSI_ATT_BOLD));
+            }
+            return status;
+
+        /* signed distance from a reference model */
+        case COL_DEV:
+            printf( "\nDeviation coloration\n"
+                    "Model vertexes will be colored with a fading color "
+                    "according to their\nsigned distance from the surface "
+                    "of a reference model. The desired\ncolor will be "
+                    "applied to the vertexes deepest inside the reference,\n"
+                    "fading to white for the vertexes farthest outside.\n"
+                    );
+            c = ask_color();
+            if (ask_model(&reference))
+                return 1;
+            status = color_deviation(model, c, &reference, range);
+            clear_model(&reference);
+            if (status == ERR_NO_MEMORY)
+            {
+                printf(STR_COL_ATT(
+                        "Error: not enough memory for the coloration.\n",
+                        ANSI_COL_RED,
+                        ANSI_ATT_BOLD));
+            }
+            else if (status == ERR_INVALID_ARGUMENT)
+            {
+                printf(STR_COL_ATT(
+                        "Error: the reference model has no faces.\n",
+                        ANSI_COL_RED,
+                        ANSI_ATT_BOLD));
+            }
+            else if (status)
+            {
+                printf(STR_COL_ATT(
+                        "Error: all model vertexes have equal distance from "
+                        "the reference, so\nthis kind of coloration is "
+                        "undefined.\n",
+                        ANSI_COL_RED,
+                        ANSI_ATT_BOLD));
+            }
+            else
+            {
+                printf(STR_COL_ATT(
+                        "\nApplied deviation coloration.\n"
+                        "Distance range: [%g, %g]\n"
+                        "Starting color: (%d, %d, %d)\n",
+                        ANSI_COL_GRE,
+                        ANSI_ATT_BOLD),
+                    range[0],
+                    range[1],
+                    c.r,
+                    c.g,
+                    c.b);
+            }
+            return status;
+
+        /* other values: invalid */
+        default:
+            /* should be unreachable if code is ok*/
+            break;
+    }
+
+    /* should be unreachable if code is ok*/
+    perror("color_model(): invalid action as parameter");
+    exit(EXIT_FAILURE);
+}
+
+/*!
+ * Ask the user for details (axis base point and direction, angle), then apply
+ * the desired rotation to the model.
+ */
+int rotate_model(Model3D *m)
 {
     int status = 0;
     Point3D o;   /* rotation axis base point */
@@ -722,7 +1416,7 @@ int rotate_model(Model3D m)
     status = rotation(m, o, u, theta);
 
     /* update vertices info, modified due to rotation */
-    rescan_vertices_info(&m);
+    rescan_vertices_info(m);
 
     /* verbose */
     printf(STR_COL_ATT(
@@ -741,6 +1435,493 @@ int rotate_model(Model3D m)
     return status;
 }
 
+/*!
+ * Align the model with its principal axes, showing them.
+ */
+int align_model(Model3D *m)
+{
+    Point3D c;
+    Vector3D a[3];
+    int status = align_principal_axes(m, &c, a);
+
+    if (status > 0)
+        printf(STR_COL_ATT(
+                    "\nError: not enough memory to align the model.\n",
+                    ANSI_COL_RED,
+                    ANSI_ATT_BOLD));
+    else if (status)
+        printf(STR_COL_ATT(
+                    "\nError: the model has no surface to align.\n",
+                    ANSI_COL_RED,
+                    ANSI_ATT_BOLD));
+    else
+        printf(STR_COL_ATT(
+                    "\nModel rotated around its centroid (%g, %g, %g), "
+                    "principal axes:\n"
+                    "  x <- (%g, %g, %g)\n"
+                    "  y <- (%g, %g, %g)\n"
+                    "  z <- (%g, %g, %g)\n",
+                    ANSI_COL_GRE,
+                    ANSI_ATT_BOLD),
+                c.x, c.y, c.z,
+                a[0].x, a[0].y, a[0].z,
+                a[1].x, a[1].y, a[1].z,
+                a[2].x, a[2].y, a[2].z);
+
+    return status;
+}
+
+/*!
+ * Recompute the vertex normals of the model, showing the outcome.
+ */
+int normals_model(Model3D *m)
+{
+    int status = compute_normals(m);
+
+    if (status)
+        printf(STR_COL_ATT(
+                    "\nError: not enough memory to compute the normals.\n",
+                    ANSI_COL_RED,
+                    ANSI_ATT_BOLD));
+    else
+        printf(STR_COL_ATT(
+                    "\nVertex normals recomputed from %lld faces.\n",
+                    ANSI_COL_GRE,
+                    ANSI_ATT_BOLD),
+                m->n_faces);
+
+    return status;
+}
+
+/*!
+ * Ask the user for the smoothing method and the number of iterations, then
+ * smooth the model, showing the outcome.
+ */
+int smooth_model(Model3D *m)
+{
+    int method, iterations, status;
+
+    printf( "\nSurface smoothing\n"
+            "Each vertex is moved towards the centroid of its neighbours, "
+            "boundary vertices\nare kept fixed. Laplacian smoothing shrinks "
+            "the model at each iteration,\nTaubin smoothing preserves its "
+            "volume.\n"
+            "1) Laplacian\n"
+            "2) Taubin\n"
+            );
+    do
+    {
+        printf(STR_ATT("\nMethod [1-2]: ", ANSI_ATT_BOLD));
+        scanf("%d", &method);
+        clear_stdin();
+    } while (method < 1 || method > 2);
+
+    do
+    {
+        printf(STR_ATT("\nNumber of iterations [1-%d]: ", ANSI_ATT_BOLD),
+                SMOOTH_MAX_ITERATIONS);
+        scanf("%d", &iterations);
+        clear_stdin();
+    } while (iterations < 1 || iterations > SMOOTH_MAX_ITERATIONS);
+
+    status = smooth_mesh(m, iterations, SMOOTH_LAMBDA,
+            method == 2 ? SMOOTH_MU : 0);
+
+    if (status)
+        printf(STR_COL_ATT(
+                    "\nError: not enough memory to smooth the model.\n",
+                    ANSI_COL_RED,
+                    ANSI_ATT_BOLD));
+    else
+        printf(STR_COL_ATT(
+                    "\nModel smoothed with %d iterations.\n",
+                    ANSI_COL_GRE,
+                    ANSI_ATT_BOLD),
+                iterations);
+
+    return status;
+}
+
+/*!
+ * Ask the user for the subdivision scheme and the number of levels, then
+ * refine the model, showing the outcome.
+ */
+int subdivide_model(Model3D *m)
+{
+    int scheme, levels, status;
+    Index n_faces = m->n_faces;
+
+    printf( "\nSubdivision\n"
+            "Each face is split in four at each level. The midpoint scheme "
+            "keeps the shape\nof the model, the Loop scheme makes it "
+            "smooth.\n"
+            "1) Midpoint\n"
+            "2) Loop\n"
+            );
+    do
+    {
+        printf(STR_ATT("\nScheme [1-2]: ", ANSI_ATT_BOLD));
+        scanf("%d", &scheme);
+        clear_stdin();
+    } while (scheme < 1 || scheme > 2);
+
+    do
+    {
+        printf(STR_ATT("\nNumber of levels [1-%d]: ", ANSI_ATT_BOLD),
+                SUBDIVIDE_MAX_LEVELS);
+        scanf("%d", &levels);
+        clear_stdin();
+    } while (levels < 1 || levels > SUBDIVIDE_MAX_LEVELS);
+
+    status = subdivide_mesh(m, levels, (Subdivision) scheme);
+
+    if (status)
+        printf(STR_COL_ATT(
+                    "\nError: not enough memory to subdivide the model.\n",
+                    ANSI_COL_RED,
+                    ANSI_ATT_BOLD));
+    else
+        printf(STR_COL_ATT(
+                    "\nModel subdivided from %lld to %lld faces.\n",
+                    ANSI_COL_GRE,
+                    ANSI_ATT_BOLD),
+                n_faces,
+                m->n_faces);
+
+    return status;
+}
+
+/*!
+ * Ask the user for the number of faces to keep and simplify the model,
+ * showing the outcome.
+ */
+int decimate_model(Model3D *m)
+{
+    Index target;
+    Index n_faces = m->n_faces;
+    int status;
+
+    printf( "\nModel simplification\n"
+            "Edges are collapsed in order of increasing geometric error, "
+            "until the model\nhas the desired number of faces.\n"
+            );
+    do
+    {
+        printf(STR_ATT("\nNumber of faces to keep [1-%lld]: ",
+                    ANSI_ATT_BOLD),
+                m->n_faces);
+        scanf("%lld", &target);
+        clear_stdin();
+    } while (target < 1 || target > m->n_faces);
+
+    status = decimate(m, target, 0);
+
+    if (status)
+        printf(STR_COL_ATT(
+                    "\nError: not enough memory to simplify the model.\n",
+                    ANSI_COL_RED,
+                    ANSI_ATT_BOLD));
+    else
+        printf(STR_COL_ATT(
+                    "\nModel simplified from %lld to %lld faces.\n",
+                    ANSI_COL_GRE,
+                    ANSI_ATT_BOLD),
+                n_faces,
+                m->n_faces);
+
+    return status;
+}
+
+/*!
+ * Ask the user for the number of levels and the reduction between them, then
+ * save the levels in files named after a common prefix, with a _lod suffix
+ * followed by the level number.
+ */
+int lod_model(Model3D *m)
+{
+    char base[STR_LEN + 1];
+    char fname[LOD_MAX_LEVELS][STR_LEN + 16];
+    FILE *files[LOD_MAX_LEVELS];
+    Index targets[LOD_MAX_LEVELS];
+    float ratio;
+    int i, n, opened, status = 0;
+
+    printf( "\nLevels of detail\n"
+            "Each level is a copy of the model simplified from the previous "
+            "one, by the\nsame factor. All levels are computed in a single "
+            "simplification run.\n"
+            );
+    do
+    {
+        printf(STR_ATT("\nNumber of levels [1-%d]: ", ANSI_ATT_BOLD),
+                LOD_MAX_LEVELS);
+        scanf("%d", &n);
+        clear_stdin();
+    } while (n < 1 || n > LOD_MAX_LEVELS);
+
+    do
+    {
+        printf(STR_ATT("\nFraction of faces kept by each level (0-1): ",
+                    ANSI_ATT_BOLD));
+        scanf("%f", &ratio);
+        clear_stdin();
+    } while (ratio <= 0 || ratio >= 1);
+
+    /* stop early if the levels would get below one face */
+    for (i = 0; i < n; ++i)
+    {
+        targets[i] = (Index) ((i > 0 ? targets[i - 1] : m->n_faces) * ratio);
+        if (targets[i] < 1)
+            break;
+    }
+    n = i;
+    if (n == 0)
+    {
+        printf(STR_COL_ATT(
+                    "\nError: the model has too few faces.\n",
+                    ANSI_COL_RED,
+                    ANSI_ATT_BOLD));
+        return 1;
+    }
+
+    get_output_filename(base);
+    base[strlen(base) - strlen(".ply")] = '\0';
+
+    for (opened = 0; opened < n; ++opened)
+    {
+        sprintf(fname[opened], "%s_lod%d.ply", base, opened + 1);
+        files[opened] = fopen(fname[opened], "w");
+        if (files[opened] == NULL)
+        {
+            printf(STR_COL_ATT(
+                        "\nError: unable to open/create file %s.\n",
+                        ANSI_COL_RED,
+                        ANSI_ATT_BOLD),
+                    fname[opened]);
+            status = ERR_IO;
+            break;
+        }
+    }
+
+    if (status == 0)
+        status = decimate_lod(m, targets, files, n);
+
+    for (i = 0; i < opened; ++i)
+        fclose(files[i]);
+
+    if (status == ERR_NO_MEMORY)
+        printf(STR_COL_ATT(
+                    "\nError: not enough memory for the levels of detail.\n",
+                    ANSI_COL_RED,
+                    ANSI_ATT_BOLD));
+    else if (status == ERR_IO)
+        printf(STR_COL_ATT(
+                    "\nError: unable to write the levels of detail.\n",
+                    ANSI_COL_RED,
+                    ANSI_ATT_BOLD));
+    else
+        for (i = 0; i < n; ++i)
+            printf(STR_COL_ATT(
+                        "\nLevel %d saved in %s (up to %lld faces).",
+                        ANSI_COL_GRE,
+                        ANSI_ATT_BOLD),
+                    i + 1,
+                    fname[i],
+                    targets[i]);
+    printf("\n");
+
+    return status;
+}
+
+/*!
+ * Ask the user for the welding tolerance and merge the duplicate vertices,
+ * showing the outcome.
+ */
+int weld_model(Model3D *m)
+{
+    float tolerance;
+    Index merged;
+    int status;
+
+    printf( "\nVertex welding\n"
+            "Vertices closer than the tolerance are merged, and the faces "
+            "are joined on\nthem. A zero tolerance merges only vertices "
+            "with the same coordinates.\n"
+            );
+    do
+    {
+        printf(STR_ATT("\nTolerance: ", ANSI_ATT_BOLD));
+        scanf("%f", &tolerance);
+        clear_stdin();
+    } while (tolerance < 0);
+
+    status = weld_vertices(m, tolerance, &merged);
+
+    if (status)
+        printf(STR_COL_ATT(
+                    "\nError: not enough memory to weld the vertices.\n",
+                    ANSI_COL_RED,
+                    ANSI_ATT_BOLD));
+    else
+        printf(STR_COL_ATT(
+                    "\n%lld vertices removed, the model has now %lld "
+                    "vertices and %lld faces.\n",
+                    ANSI_COL_GRE,
+                    ANSI_ATT_BOLD),
+                merged,
+                m->n_vertices,
+                m->n_faces);
+
+    return status;
+}
+
+/*!
+ * Ask the user for the thresholds, then remove the degenerate faces and the
+ * small components, showing how much of the model was removed.
+ */
+int cleanup_model(Model3D *m)
+{
+    float min_area;
+    Index min_faces, faces, vertices;
+    int status;
+
+    printf( "\nCleanup\n"
+            "Faces with a repeated vertex or with an area not greater than "
+            "the\nthreshold are removed, then the connected components with "
+            "fewer faces\nthan the minimum, and the vertices left unused.\n"
+            );
+    do
+    {
+        printf(STR_ATT("\nArea threshold: ", ANSI_ATT_BOLD));
+        scanf("%f", &min_area);
+        clear_stdin();
+    } while (min_area < 0);
+    do
+    {
+        printf(STR_ATT("Minimum faces of a component: ", ANSI_ATT_BOLD));
+        scanf("%lld", &min_faces);
+        clear_stdin();
+    } while (min_faces < 0);
+
+    status = cleanup_mesh(m, min_area, min_faces, &faces, &vertices);
+
+    if (status == ERR_NO_MEMORY)
+        printf(STR_COL_ATT(
+                    "\nError: not enough memory to clean the model.\n",
+                    ANSI_COL_RED,
+                    ANSI_ATT_BOLD));
+    else if (status)
+        printf(STR_COL_ATT(
+                    "\nError: no face would be left, the model was not "
+                    "changed.\n",
+                    ANSI_COL_RED,
+                    ANSI_ATT_BOLD));
+    else
+        printf(STR_COL_ATT(
+                    "\n%lld faces and %lld vertices removed, the model has "
+                    "now %lld vertices\nand %lld faces.\n",
+                    ANSI_COL_GRE,
+                    ANSI_ATT_BOLD),
+                faces,
+                vertices,
+                m->n_vertices,
+                m->n_faces);
+
+    return status;
+}
+
+/*!
+ * Orient the faces, then check the surface again to show what is left.
+ */
+int orient_model(Model3D *m)
+{
+    SurfaceCheck c;
+    Index flipped;
+    int status;
+
+    printf( "\nFace orientation\n"
+            "Faces are flipped so that each edge is traversed in opposite "
+            "directions\nby its two faces, and closed parts face outwards.\n"
+            );
+
+    status = orient_faces(m, &flipped);
+
+    if (status > 0 || check_surface(m, &c) != 0)
+    {
+        printf(STR_COL_ATT(
+                    "\nError: not enough memory to orient the faces.\n",
+                    ANSI_COL_RED,
+                    ANSI_ATT_BOLD));
+        return ERR_NO_MEMORY;
+    }
+
+    printf(STR_COL_ATT(
+                "\n%lld faces flipped, %lld misoriented edges left.\n",
+                ANSI_COL_GRE,
+                ANSI_ATT_BOLD),
+            flipped,
+            c.misoriented);
+
+    if (status)
+        printf(STR_COL_ATT(
+                    "Warning: some part of the model is not orientable.\n",
+                    ANSI_COL_YEL,
+                    ANSI_ATT_BOLD));
+
+    return 0;
+}
+
+/*!
+ * Reorder the model, showing the outcome.
+ */
+int reorder_model(Model3D *m)
+{
+    int status = spatial_reorder(m);
+
+    if (status)
+        printf(STR_COL_ATT(
+                    "\nError: not enough memory to reorder the model.\n",
+                    ANSI_COL_RED,
+                    ANSI_ATT_BOLD));
+    else
+        printf(STR_COL_ATT(
+                    "\nVertices sorted along a space filling curve, and "
+                    "faces by vertex.\nSave the model to keep the new "
+                    "order in the file.\n",
+                    ANSI_COL_GRE,
+                    ANSI_ATT_BOLD));
+
+    return status;
+}
+
+/*!
+ * Optimize the model for the vertex cache, showing the average cache miss
+ * ratio before and after.
+ */
+int vcache_model(Model3D *m)
+{
+    double before = vertex_cache_acmr(m, VCACHE_SIZE);
+    int status = optimize_vertex_cache(m, VCACHE_SIZE);
+
+    if (status)
+        printf(STR_COL_ATT(
+                    "\nError: not enough memory to reorder the model.\n",
+                    ANSI_COL_RED,
+                    ANSI_ATT_BOLD));
+    else
+        printf(STR_COL_ATT(
+                    "\nFaces reordered for a cache of %d vertices, average "
+                    "cache misses per face\nfrom %.3f to %.3f. Save the "
+                    "model to keep the new order in the file.\n",
+                    ANSI_COL_GRE,
+                    ANSI_ATT_BOLD),
+                VCACHE_SIZE,
+                before,
+                vertex_cache_acmr(m, VCACHE_SIZE));
+
+    return status;
+}
+
 /*!
  * Ask the user to confirm an action, showing a warning message.
  */
@@ -21,7 +21,21 @@
  * @date 2015-01-24
  */
 
+#ifndef FRONTEND_H
+#define FRONTEND_H
+
 #include "backend.h"
+#include "fields.h"
+
+/*!
+ * \brief Parse the command line arguments of the program.
+ * @param argc Value of argc from main().
+ * @param argv Value of argv from main().
+ * @return Zero if arguments are valid, nonzero otherwise.
+ * @note If profiling is requested, the report is written when the
+ * program terminates.
+ */
+int parse_arguments(int argc, char *argv[]);
 
 /*!
  * \brief Ask the user for the name of the file to be opened.
@@ -44,7 +58,7 @@ void get_output_filename(char *f);
  * @param m Model currently loaded.
  * @return The action chosen by the user.
  */
-Action main_menu(Model3D m);
+Action main_menu(Model3D *m);
 
 /*!
  * \brief Ask the user for exit or another model processing.
@@ -56,7 +70,7 @@ int ask_exit(void);
  * \brief Show informations about the current model.
  * @param m Model from which show informations.
  */
-void show_info(Model3D m);
+void show_info(Model3D *m);
 
 /*!
  * \brief Check if a RGB color component is valid or not.
@@ -89,6 +103,30 @@ Vector3D ask_vector(void);
  */
 float ask_angle(void);
 
+/*!
+ * \brief Ask the user for a file and read a set of points from it.
+ * @param p Pointer filled with a new array of points, to be freed by the
+ * caller.
+ * @param n Pointer filled with the number of points.
+ * @return Zero on success, nonzero otherwise.
+ */
+int ask_points(Point3D **p, Index *n);
+
+/*!
+ * \brief Ask the user for a file and read a model from it.
+ * @param m Model, initialized by the function and filled with the content
+ * of the file, to be cleared by the caller with clear_model(Model3D*) on
+ * success.
+ * @return Zero on success, nonzero otherwise.
+ */
+int ask_model(Model3D *m);
+
+/*!
+ * \brief Ask the user for a scalar field.
+ * @return The chosen field.
+ */
+Field ask_field(void);
+
 /*!
  * \brief Ask the user for a direction.
  * @return The Direction value chosen by the user.
@@ -100,18 +138,100 @@ Direction ask_direction(void);
  * @param m Model to be colored.
  * @param a The desired kind of coloration.
  * @return Zero if coloration was fine, nonzero otherwise.
- * @note Before calling this function, srand(unsigned int) must be called 
- * at least once in order to inizialize the random number generator, if the
- * color_random(Model3D) coloration is required.
  */
-int color_model(Model3D m, Action a);
+int color_model(Model3D *m, Action a);
 
 /*!
  * \brief Apply a rotation to the model, asking details to the user.
  * @param m Model to be rotated.
  * @return Zero if rotation was fine, nonzero otherwise.
  */
-int rotate_model(Model3D m);
+int rotate_model(Model3D *m);
+
+/*!
+ * \brief Rotate the model to align its principal axes with the coordinate
+ * axes, showing the outcome.
+ * @param m Model to be aligned.
+ * @return Zero if the model was aligned, nonzero otherwise.
+ */
+int align_model(Model3D *m);
+
+/*!
+ * \brief Recompute the vertex normals of the model, showing the outcome.
+ * @param m Model.
+ * @return Zero if the normals were recomputed, nonzero otherwise.
+ */
+int normals_model(Model3D *m);
+
+/*!
+ * \brief Smooth the surface of the model, asking the method and the number
+ * of iterations to the user.
+ * @param m Model to be smoothed.
+ * @return Zero if the model was smoothed, nonzero otherwise.
+ */
+int smooth_model(Model3D *m);
+
+/*!
+ * \brief Subdivide the faces of the model, asking the scheme and the number
+ * of levels to the user.
+ * @param m Model to be refined.
+ * @return Zero if the model was subdivided, nonzero otherwise.
+ */
+int subdivide_model(Model3D *m);
+
+/*!
+ * \brief Simplify the model, asking the number of faces to the user.
+ * @param m Model to be simplified.
+ * @return Zero if the model was simplified, nonzero otherwise.
+ */
+int decimate_model(Model3D *m);
+
+/*!
+ * \brief Save levels of detail of the model, asking details to the user.
+ * @param m Model to be simplified, which is not modified.
+ * @return Zero if all levels were saved, nonzero otherwise.
+ */
+int lod_model(Model3D *m);
+
+/*!
+ * \brief Merge the duplicate vertices of the model, asking the tolerance to
+ * the user.
+ * @param m Model to be welded.
+ * @return Zero if the vertices were merged, nonzero otherwise.
+ */
+int weld_model(Model3D *m);
+
+/*!
+ * \brief Remove the degenerate faces and the small components of the model,
+ * asking the thresholds to the user.
+ * @param m Model to be cleaned.
+ * @return Zero if the model was cleaned, nonzero otherwise.
+ */
+int cleanup_model(Model3D *m);
+
+/*!
+ * \brief Flip faces of the model to make their orientation consistent,
+ * showing the outcome.
+ * @param m Model to be oriented.
+ * @return Zero if the model was oriented, nonzero otherwise.
+ */
+int orient_model(Model3D *m);
+
+/*!
+ * \brief Reorder vertices and faces of the model for memory locality,
+ * showing the outcome.
+ * @param m Model to be reordered.
+ * @return Zero if the model was reordered, nonzero otherwise.
+ */
+int reorder_model(Model3D *m);
+
+/*!
+ * \brief Reorder faces and vertices of the model for the GPU vertex cache,
+ * showing the outcome.
+ * @param m Model to be reordered.
+ * @return Zero if the model was reordered, nonzero otherwise.
+ */
+int vcache_model(Model3D *m);
 
 /*!
  * \brief Ask for confirmation for the chosen action.
@@ -120,3 +240,5 @@ int rotate_model(Model3D m);
  * value otherwise.
  */
 Action confirm(Action a);
+
+#endif // FRONTEND_H
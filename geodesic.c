@@ -0,0 +1,411 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) Martino Pilia, 2015
+ */
+
+/*!
+ * \file geodesic.c
+ */
+
+#include <float.h>
+#include <stdlib.h>
+
+#include "adjacency.h"
+#include "geodesic.h"
+#include "profile.h"
+
+/*!
+ * Edge graph of a model in compressed sparse row format: the neighbours of
+ * vertex v are adj[offsets[v]] ... adj[offsets[v + 1] - 1], and w holds the
+ * length of each edge. The lists are borrowed from the model connectivity.
+ */
+typedef struct Graph
+{
+    const Index *offsets; /*!< Start of the neighbours of each vertex. */
+    const Index *adj;     /*!< Neighbours. */
+    float *w;             /*!< Edge lengths. */
+} Graph;
+
+/*!
+ * Take the vertex-to-vertex lists from the cached connectivity and compute
+ * the edge lengths once, in parallel, instead of at each relaxation.
+ */
+static int build_graph(Model3D *m, Graph *g)
+{
+    const Adjacency *a = model_adjacency(m);
+    Index v, e;
+
+    if (a == NULL)
+        return ERR_NO_MEMORY;
+
+    g->offsets = a->vv_offsets;
+    g->adj = a->vv;
+    g->w = (float*) malloc((a->vv_offsets[m->n_vertices] + 1)
+            * sizeof (float));
+    if (g->w == NULL)
+        return ERR_NO_MEMORY;
+
+    #pragma omp parallel for schedule(dynamic, 4096) private(e)
+    for (v = 0; v < m->n_vertices; ++v)
+        for (e = g->offsets[v]; e < g->offsets[v + 1]; ++e)
+            g->w[e] = euclidean_distance(
+                    m->vertices_array[v]->vertexCoordinates,
+                    m->vertices_array[g->adj[e]]->vertexCoordinates);
+
+    return 0;
+}
+
+/*!
+ * Move up the heap entry at position i, until its parent has a smaller
+ * distance. The heap stores vertices, pos gives the position of each vertex
+ * in the heap.
+ */
+static void sift_up(Index *heap, Index *pos, const double *d, Index i)
+{
+    Index v = heap[i], parent;
+
+    while (i > 0 && d[heap[parent = (i - 1) / 2]] > d[v])
+    {
+        heap[i] = heap[parent];
+        pos[heap[i]] = i;
+        i = parent;
+    }
+    heap[i] = v;
+    pos[v] = i;
+}
+
+/*!
+ * Move down the heap entry at position i, until its children have greater
+ * distances.
+ */
+static void sift_down(Index *heap, Index *pos, const double *d, Index i,
+        Index size)
+{
+    Index v = heap[i], child;
+
+    while ((child = 2 * i + 1) < size)
+    {
+        if (child + 1 < size && d[heap[child + 1]] < d[heap[child]])
+            ++child;
+        if (d[heap[child]] >= d[v])
+            break;
+        heap[i] = heap[child];
+        pos[heap[i]] = i;
+        i = child;
+    }
+    heap[i] = v;
+    pos[v] = i;
+}
+
+/*!
+ * Dijkstra's algorithm on an indexed binary heap with decrease-key, so the
+ * heap never holds more than one entry for each vertex.
+ */
+static int dijkstra(Model3D *m, const Graph *g, Index source, double *d)
+{
+    Index *heap, *pos;
+    Index size = 0, v, u, e;
+    double nd;
+
+    heap = (Index*) malloc(m->n_vertices * sizeof (Index));
+    pos = (Index*) malloc(m->n_vertices * sizeof (Index));
+    if (heap == NULL || pos == NULL)
+    {
+        free(heap);
+        free(pos);
+        return ERR_NO_MEMORY;
+    }
+
+    for (v = 0; v < m->n_vertices; ++v)
+        pos[v] = -1;
+
+    d[source] = 0;
+    heap[size++] = source;
+    pos[source] = 0;
+
+    while (size > 0)
+    {
+        /* extract the nearest vertex */
+        v = heap[0];
+        pos[v] = -2; /* settled */
+        if (--size > 0)
+        {
+            heap[0] = heap[size];
+            sift_down(heap, pos, d, 0, size);
+        }
+
+        for (e = g->offsets[v]; e < g->offsets[v + 1]; ++e)
+        {
+            u = g->adj[e];
+            if (pos[u] == -2)
+                continue;
+
+            nd = d[v] + g->w[e];
+            if (nd >= d[u])
+                continue;
+
+            d[u] = nd;
+            if (pos[u] == -1)
+            {
+                heap[size] = u;
+                pos[u] = size++;
+            }
+            sift_up(heap, pos, d, pos[u]);
+        }
+    }
+
+    free(heap);
+    free(pos);
+    return 0;
+}
+
+/*!
+ * Cyclic array of buckets, each one a linked list of entries. Popped
+ * entries are recycled through a free list.
+ */
+typedef struct Buckets
+{
+    Index *head;     /*!< First entry of each bucket, -1 if empty. */
+    Index n_buckets; /*!< Number of buckets. */
+    Index *vertex;   /*!< Vertex of each entry. */
+    Index *next;     /*!< Next entry in the same list. */
+    Index size;      /*!< Number of entries allocated. */
+    Index used;      /*!< Number of entries taken at least once. */
+    Index free_list; /*!< First recycled entry, -1 if none. */
+} Buckets;
+
+/*!
+ * Insert a vertex in the bucket k (taken modulo the number of buckets),
+ * growing the entry storage when needed.
+ */
+static int bucket_push(Buckets *b, Index k, Index v)
+{
+    Index e, *tmp;
+
+    if (b->free_list != -1)
+    {
+        e = b->free_list;
+        b->free_list = b->next[e];
+    }
+    else
+    {
+        if (b->used == b->size)
+        {
+            tmp = (Index*) realloc(b->vertex, 2 * b->size * sizeof (Index));
+            if (tmp == NULL)
+                return ERR_NO_MEMORY;
+            b->vertex = tmp;
+            tmp = (Index*) realloc(b->next, 2 * b->size * sizeof (Index));
+            if (tmp == NULL)
+                return ERR_NO_MEMORY;
+            b->next = tmp;
+            b->size *= 2;
+        }
+        e = b->used++;
+    }
+
+    b->vertex[e] = v;
+    b->next[e] = b->head[k % b->n_buckets];
+    b->head[k % b->n_buckets] = e;
+
+    return 0;
+}
+
+/*!
+ * Remove a vertex from the bucket k, which must not be empty.
+ */
+static Index bucket_pop(Buckets *b, Index k)
+{
+    Index e = b->head[k % b->n_buckets];
+
+    b->head[k % b->n_buckets] = b->next[e];
+    b->next[e] = b->free_list;
+    b->free_list = e;
+
+    return b->vertex[e];
+}
+
+/*!
+ * Bucketed variant of Dijkstra's algorithm (sequential delta-stepping).
+ * Vertices are kept in buckets of width delta, equal to the average edge
+ * length, instead of a heap: insertions and extractions take constant time,
+ * and vertices inside the same bucket are scanned in any order, rescanning
+ * them if their distance improves. Since no edge is longer than the
+ * longest one, only a window of buckets is non-empty at any time, so the
+ * buckets are reused cyclically.
+ *
+ * Return -1, without touching d, if the edge lengths are too spread for the
+ * buckets to be effective, so the caller can fall back to the heap.
+ */
+static int delta_stepping(Model3D *m, const Graph *g, Index source,
+        double *d)
+{
+    Buckets b;
+    Index *queued;
+    Index v, u, e, k, cur, pending;
+    double delta = 0, max = 0, nd;
+    int status = 0;
+
+    if (g->offsets[m->n_vertices] == 0)
+        return -1;
+
+    /* bucket width and number of buckets in the window */
+    for (e = 0; e < g->offsets[m->n_vertices]; ++e)
+    {
+        delta += g->w[e];
+        if (g->w[e] > max)
+            max = g->w[e];
+    }
+    delta /= g->offsets[m->n_vertices];
+    if (delta < NUM_TOL || max / delta > m->n_vertices)
+        return -1;
+
+    b.n_buckets = (Index) (max / delta) + 2;
+    b.size = m->n_vertices;
+    b.used = 0;
+    b.free_list = -1;
+    b.head = (Index*) malloc(b.n_buckets * sizeof (Index));
+    b.vertex = (Index*) malloc(b.size * sizeof (Index));
+    b.next = (Index*) malloc(b.size * sizeof (Index));
+    queued = (Index*) malloc(m->n_vertices * sizeof (Index));
+
+    if (b.head == NULL || b.vertex == NULL || b.next == NULL || queued == NULL)
+    {
+        free(b.head);
+        free(b.vertex);
+        free(b.next);
+        free(queued);
+        return ERR_NO_MEMORY;
+    }
+
+    for (k = 0; k < b.n_buckets; ++k)
+        b.head[k] = -1;
+    for (v = 0; v < m->n_vertices; ++v)
+        queued[v] = -1; /* absolute number of the bucket holding v */
+
+    d[source] = 0;
+    bucket_push(&b, 0, source);
+    queued[source] = 0;
+    pending = 1;
+
+    for (cur = 0; pending > 0 && status == 0; ++cur)
+    {
+        while (b.head[cur % b.n_buckets] != -1 && status == 0)
+        {
+            v = bucket_pop(&b, cur);
+            --pending;
+
+            /* skip entries left behind when the vertex moved to an
+             * earlier bucket */
+            if (queued[v] != cur)
+                continue;
+            queued[v] = -1;
+
+            for (e = g->offsets[v]; e < g->offsets[v + 1]; ++e)
+            {
+                u = g->adj[e];
+                nd = d[v] + g->w[e];
+                if (nd >= d[u])
+                    continue;
+
+                d[u] = nd;
+                k = (Index) (nd / delta);
+                if (queued[u] == k)
+                    continue; /* already in the right bucket */
+
+                status = bucket_push(&b, k, u);
+                if (status)
+                    break;
+                queued[u] = k;
+                ++pending;
+            }
+        }
+    }
+
+    free(b.head);
+    free(b.vertex);
+    free(b.next);
+    free(queued);
+    return status;
+}
+
+/*!
+ * Build the edge graph, then run the solver suited to the model size.
+ */
+int geodesic_distances(Model3D *m, Index source, double *d)
+{
+    Graph g;
+    Index v;
+    int status;
+
+    if (source < 0 || source >= m->n_vertices)
+        return ERR_INVALID_ARGUMENT;
+
+    status = build_graph(m, &g);
+    if (status)
+        return status;
+
+    for (v = 0; v < m->n_vertices; ++v)
+        d[v] = DBL_MAX;
+
+    status = -1;
+    if (m->n_vertices >= GEODESIC_BUCKET_MIN)
+        status = delta_stepping(m, &g, source, d);
+    if (status == -1)
+        status = dijkstra(m, &g, source, d);
+
+    free(g.w);
+    return status;
+}
+
+/*!
+ * Compute the distances and map them to colors with color_scalar(Model3D*,
+ * ColorRGB, const double*). Vertices not connected to the source get the
+ * greatest distance found, so they are colored in white.
+ */
+int color_geodesic(Model3D *m, ColorRGB c, Index source)
+{
+    double *d;
+    double max = 0;
+    Index v;
+    int status;
+    double start = profile_clock();
+
+    d = (double*) malloc(m->n_vertices * sizeof (double));
+    if (d == NULL)
+        return ERR_NO_MEMORY;
+
+    status = geodesic_distances(m, source, d);
+    if (status)
+    {
+        free(d);
+        return status;
+    }
+
+    for (v = 0; v < m->n_vertices; ++v)
+        if (d[v] != DBL_MAX && d[v] > max)
+            max = d[v];
+    for (v = 0; v < m->n_vertices; ++v)
+        if (d[v] == DBL_MAX)
+            d[v] = max;
+
+    status = color_scalar(m, c, d);
+    free(d);
+
+    if (status == 0)
+        profile_record(PROF_COLOR_GEODESIC, start, m->n_vertices, m->n_faces);
+
+    return status;
+}
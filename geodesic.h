@@ -0,0 +1,61 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) Martino Pilia, 2015
+ */
+
+/*!
+ * \file geodesic.h
+ */
+
+#ifndef GEODESIC_H
+#define GEODESIC_H
+
+#include "backend.h"
+
+/*!
+ * Number of vertices from which geodesic_distances() uses the bucketed
+ * solver instead of the heap-based one.
+ */
+#define GEODESIC_BUCKET_MIN (1 << 20)
+
+/*!
+ * \brief Compute the geodesic distance of each vertex from a source vertex.
+ *
+ * Distances are the lengths of the shortest paths along the edges of the
+ * faces, computed with Dijkstra's algorithm on a binary heap, or with a
+ * bucketed (delta-stepping) variant for models with at least
+ * GEODESIC_BUCKET_MIN vertices.
+ * @param m Model.
+ * @param source Index of the source vertex.
+ * @param d Array of n_vertices elements, filled with the distance of each
+ * vertex, indexed by vertex index. Vertices not connected to the source
+ * get the value DBL_MAX.
+ * @return Zero on success, ERR_INVALID_ARGUMENT if the source is not a
+ * vertex of the model, ERR_NO_MEMORY if an allocation failed.
+ */
+int geodesic_distances(Model3D *m, Index source, double *d);
+
+/*!
+ * \brief Apply a coloration based on the geodesic distance from a vertex.
+ * @param m Model to be colored.
+ * @param c Color of the source vertex.
+ * @param source Index of the source vertex.
+ * @return Zero if coloration was fine, -1 if no other vertex is connected
+ * to the source, ERR_INVALID_ARGUMENT or ERR_NO_MEMORY on error.
+ * @note Vertices not connected to the source are colored in white.
+ */
+int color_geodesic(Model3D *m, ColorRGB c, Index source);
+
+#endif // GEODESIC_H
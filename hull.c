@@ -0,0 +1,1237 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) Martino Pilia, 2015
+ */
+
+
+/*!
+ * \file hull.c
+ */
+
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "align.h"
+#include "hull.h"
+#include "profile.h"
+
+/*! Number of directions of the extreme vertices seeding the hull. */
+#define HULL_DIRECTIONS 13
+
+/*!
+ * Directions of the extreme vertices: the axes, the diagonals of the
+ * coordinate planes and the diagonals of the cube.
+ */
+static const float directions[HULL_DIRECTIONS][3] =
+{
+    {1, 0, 0}, {0, 1, 0}, {0, 0, 1},
+    {1, 1, 0}, {1, -1, 0}, {1, 0, 1}, {1, 0, -1}, {0, 1, 1}, {0, 1, -1},
+    {1, 1, 1}, {1, 1, -1}, {1, -1, 1}, {1, -1, -1}
+};
+
+/*!
+ * Type for a face of the hull under construction.
+ */
+typedef struct HullFace
+{
+    Index v[3];     /*!< Vertices, counter clockwise seen from outside. */
+    Index adj[3];   /*!< Face across the edge from v[k] to v[k + 1]. */
+    double n[3];    /*!< Unit outward normal. */
+    double d;       /*!< Offset of the plane, n . x = d. */
+    Index head;     /*!< First point of the outside set, -1 if empty. */
+    Index far;      /*!< Farthest point of the outside set. */
+    double far_d;   /*!< Distance of the farthest point. */
+    Index mark;     /*!< Step in which the face was found visible. */
+    int alive;      /*!< Zero once the face has been replaced. */
+} HullFace;
+
+/*!
+ * Type for the state of the construction.
+ */
+typedef struct Builder
+{
+    const Point3D *p;   /*!< Points. */
+    Index n;            /*!< Number of points. */
+    double eps;         /*!< Absolute tolerance. */
+    Index *next;        /*!< Next point of the outside set of each point. */
+    HullFace *f;        /*!< Faces, replaced ones included. */
+    Index n_faces;      /*!< Number of faces. */
+    Index cap;          /*!< Capacity of the faces array. */
+    Index *stack;       /*!< Faces to be visited, then the visible ones. */
+    Index *horizon;     /*!< Edge endpoints and outer face of the horizon. */
+    Index n_horizon;    /*!< Number of horizon edges. */
+    Index cap_stack;    /*!< Capacity of stack and horizon. */
+    Index *start;       /*!< New face starting at each horizon vertex. */
+    Index *end;         /*!< New face ending at each horizon vertex. */
+} Builder;
+
+/*!
+ * Signed distance of point q from the plane of face f.
+ */
+static double face_distance(const Builder *b, Index f, Index q)
+{
+    const HullFace *h = &b->f[f];
+    const Point3D *p = &b->p[q];
+
+    return h->n[0] * p->x + h->n[1] * p->y + h->n[2] * p->z - h->d;
+}
+
+/*!
+ * Append the face (a, b, c) and compute its plane. Return its index, or
+ * -1 if the faces array cannot grow.
+ */
+static Index add_face(Builder *b, Index v0, Index v1, Index v2)
+{
+    HullFace *h;
+    const Point3D *p0 = &b->p[v0], *p1 = &b->p[v1], *p2 = &b->p[v2];
+    double ux, uy, uz, wx, wy, wz, len;
+
+    if (b->n_faces == b->cap)
+    {
+        h = (HullFace*) realloc(b->f, 2 * b->cap * sizeof (HullFace));
+        if (h == NULL)
+            return -1;
+        b->f = h;
+        b->cap *= 2;
+    }
+
+    h = &b->f[b->n_faces];
+    h->v[0] = v0;
+    h->v[1] = v1;
+    h->v[2] = v2;
+    h->adj[0] = h->adj[1] = h->adj[2] = -1;
+    h->head = -1;
+    h->far = -1;
+    h->far_d = 0;
+    h->mark = -1;
+    h->alive = 1;
+
+    ux = (double) p1->x - p0->x;
+    uy = (double) p1->y - p0->y;
+    uz = (double) p1->z - p0->z;
+    wx = (double) p2->x - p0->x;
+    wy = (double) p2->y - p0->y;
+    wz = (double) p2->z - p0->z;
+    h->n[0] = uy * wz - uz * wy;
+    h->n[1] = uz * wx - ux * wz;
+    h->n[2] = ux * wy - uy * wx;
+    len = sqrt(h->n[0] * h->n[0] + h->n[1] * h->n[1] + h->n[2] * h->n[2]);
+    if (len > 0)
+    {
+        h->n[0] /= len;
+        h->n[1] /= len;
+        h->n[2] /= len;
+    }
+    h->d = h->n[0] * p0->x + h->n[1] * p0->y + h->n[2] * p0->z;
+
+    return b->n_faces++;
+}
+
+/*!
+ * Add point q to the outside set of face f.
+ */
+static void push_outside(Builder *b, Index f, Index q, double d)
+{
+    b->next[q] = b->f[f].head;
+    b->f[f].head = q;
+    if (b->f[f].far == -1 || d > b->f[f].far_d)
+    {
+        b->f[f].far = q;
+        b->f[f].far_d = d;
+    }
+}
+
+/*!
+ * Assign point q to the face among [lo, hi) it is farthest above, if it
+ * is above any of them by more than the tolerance.
+ */
+static void assign_point(Builder *b, Index q, Index lo, Index hi)
+{
+    Index f, best = -1;
+    double d, best_d = b->eps;
+
+    for (f = lo; f < hi; ++f)
+    {
+        if (!b->f[f].alive)
+            continue;
+        d = face_distance(b, f, q);
+        if (d > best_d)
+        {
+            best_d = d;
+            best = f;
+        }
+    }
+
+    if (best != -1)
+        push_outside(b, best, q, best_d);
+}
+
+/*!
+ * Make sure that the visit stack and the horizon can hold n entries.
+ */
+static int reserve_stack(Builder *b, Index n)
+{
+    Index *s, *h;
+
+    if (n <= b->cap_stack)
+        return 0;
+
+    n = 2 * n;
+    s = (Index*) realloc(b->stack, n * sizeof (Index));
+    if (s == NULL)
+        return ERR_NO_MEMORY;
+    b->stack = s;
+    h = (Index*) realloc(b->horizon, 3 * n * sizeof (Index));
+    if (h == NULL)
+        return ERR_NO_MEMORY;
+    b->horizon = h;
+    b->cap_stack = n;
+
+    return 0;
+}
+
+/*!
+ * Set the face across the edge from a to b of face f.
+ */
+static void set_neighbour(Builder *b, Index f, Index a, Index c, Index g)
+{
+    int k;
+
+    for (k = 0; k < 3; ++k)
+        if (b->f[f].v[k] == a && b->f[f].v[(k + 1) % 3] == c)
+            b->f[f].adj[k] = g;
+}
+
+/*!
+ * Add the farthest point of the outside set of face f to the hull. The
+ * faces visible from the point are found with a visit from f, stopping at
+ * the horizon, and they are replaced by a fan of new faces joining the
+ * point to the horizon edges. Each new face is linked to the face beyond
+ * its horizon edge, and to the new faces sharing its endpoints, found
+ * through the start and end arrays. The outside sets of the visible faces
+ * are then distributed among the new faces.
+ */
+static int add_point(Builder *b, Index f)
+{
+    Index q = b->f[f].far, top = 0, n_visible, g, h, i, first, r, s;
+    int k;
+
+    b->n_horizon = 0;
+    b->stack[top++] = f;
+    b->f[f].mark = q;
+    n_visible = 0;
+
+    /* visible faces are moved to the bottom of the stack once visited */
+    while (top > n_visible)
+    {
+        h = b->stack[--top];
+        if (reserve_stack(b, n_visible + top + 4) != 0)
+            return ERR_NO_MEMORY;
+        for (i = top; i > n_visible; --i)
+            b->stack[i] = b->stack[i - 1];
+        b->stack[n_visible++] = h;
+        ++top;
+
+        for (k = 0; k < 3; ++k)
+        {
+            g = b->f[h].adj[k];
+            if (b->f[g].mark == q)
+                continue;
+            if (face_distance(b, g, q) > b->eps)
+            {
+                b->f[g].mark = q;
+                if (reserve_stack(b, top + 1) != 0)
+                    return ERR_NO_MEMORY;
+                b->stack[top++] = g;
+            }
+            else
+            {
+                b->horizon[3 * b->n_horizon] = b->f[h].v[k];
+                b->horizon[3 * b->n_horizon + 1] = b->f[h].v[(k + 1) % 3];
+                b->horizon[3 * b->n_horizon + 2] = g;
+                ++b->n_horizon;
+            }
+        }
+    }
+
+    first = b->n_faces;
+    for (i = 0; i < b->n_horizon; ++i)
+    {
+        r = b->horizon[3 * i];
+        s = b->horizon[3 * i + 1];
+        g = add_face(b, r, s, q);
+        if (g == -1)
+            return ERR_NO_MEMORY;
+        b->f[g].adj[0] = b->horizon[3 * i + 2];
+        set_neighbour(b, b->horizon[3 * i + 2], s, r, g);
+        b->start[r] = g;
+        b->end[s] = g;
+    }
+
+    for (g = first; g < b->n_faces; ++g)
+    {
+        b->f[g].adj[1] = b->start[b->f[g].v[1]];
+        b->f[g].adj[2] = b->end[b->f[g].v[0]];
+    }
+
+    for (i = 0; i < n_visible; ++i)
+    {
+        h = b->stack[i];
+        b->f[h].alive = 0;
+        for (r = b->f[h].head; r != -1; r = s)
+        {
+            s = b->next[r];
+            if (r != q)
+                assign_point(b, r, first, b->n_faces);
+        }
+        b->f[h].head = -1;
+    }
+
+    return 0;
+}
+
+/*!
+ * Process the faces in order of creation until no outside set is left.
+ * Points are only assigned to faces newer than the one being processed,
+ * so a single pass over the growing array is enough.
+ */
+static int expand(Builder *b)
+{
+    Index f;
+
+    for (f = 0; f < b->n_faces; ++f)
+        if (b->f[f].alive && b->f[f].head != -1)
+            if (add_point(b, f) != 0)
+                return ERR_NO_MEMORY;
+
+    return 0;
+}
+
+/*!
+ * Find the extreme points along each direction with a parallel scan. Ties
+ * are broken by the smallest index, so that the result does not depend on
+ * the scheduling.
+ */
+static void find_extremes(const Point3D *p, Index n, Index *ext)
+{
+    Index i, lo[HULL_DIRECTIONS], hi[HULL_DIRECTIONS];
+    float x, vlo[HULL_DIRECTIONS], vhi[HULL_DIRECTIONS];
+    int k;
+
+    for (k = 0; k < HULL_DIRECTIONS; ++k)
+        ext[2 * k] = ext[2 * k + 1] = 0;
+
+    #pragma omp parallel private(i, k, x, lo, hi, vlo, vhi)
+    {
+        for (k = 0; k < HULL_DIRECTIONS; ++k)
+        {
+            lo[k] = hi[k] = -1;
+            vlo[k] = FLT_MAX;
+            vhi[k] = -FLT_MAX;
+        }
+
+        #pragma omp for schedule(static)
+        for (i = 0; i < n; ++i)
+        {
+            for (k = 0; k < HULL_DIRECTIONS; ++k)
+            {
+                x = directions[k][0] * p[i].x + directions[k][1] * p[i].y
+                    + directions[k][2] * p[i].z;
+                if (x < vlo[k])
+                {
+                    vlo[k] = x;
+                    lo[k] = i;
+                }
+                if (x > vhi[k])
+                {
+                    vhi[k] = x;
+                    hi[k] = i;
+                }
+            }
+        }
+
+        #pragma omp critical
+        for (k = 0; k < HULL_DIRECTIONS; ++k)
+        {
+            if (lo[k] == -1)
+                continue;
+            x = directions[k][0] * p[ext[2 * k]].x
+                + directions[k][1] * p[ext[2 * k]].y
+                + directions[k][2] * p[ext[2 * k]].z;
+            if (vlo[k] < x || (vlo[k] == x && lo[k] < ext[2 * k]))
+                ext[2 * k] = lo[k];
+            x = directions[k][0] * p[ext[2 * k + 1]].x
+                + directions[k][1] * p[ext[2 * k + 1]].y
+                + directions[k][2] * p[ext[2 * k + 1]].z;
+            if (vhi[k] > x || (vhi[k] == x && hi[k] < ext[2 * k + 1]))
+                ext[2 * k + 1] = hi[k];
+        }
+    }
+}
+
+/*!
+ * Find the point farthest from the line through a and c (if d is -1) or
+ * from the plane through a, c and d, with a parallel scan. Return it, and
+ * its distance in dist.
+ */
+static Index farthest_point(const Point3D *p, Index n, Index a, Index c,
+        Index d, double *dist)
+{
+    double u[3], w[3], nrm[3], x[3], t[3], len, best = -1, local, e;
+    Index i, best_i = a, local_i;
+    int k;
+
+    u[0] = (double) p[c].x - p[a].x;
+    u[1] = (double) p[c].y - p[a].y;
+    u[2] = (double) p[c].z - p[a].z;
+    len = sqrt(u[0] * u[0] + u[1] * u[1] + u[2] * u[2]);
+    for (k = 0; k < 3; ++k)
+        u[k] /= len;
+
+    if (d != -1)
+    {
+        w[0] = (double) p[d].x - p[a].x;
+        w[1] = (double) p[d].y - p[a].y;
+        w[2] = (double) p[d].z - p[a].z;
+        nrm[0] = u[1] * w[2] - u[2] * w[1];
+        nrm[1] = u[2] * w[0] - u[0] * w[2];
+        nrm[2] = u[0] * w[1] - u[1] * w[0];
+        len = sqrt(nrm[0] * nrm[0] + nrm[1] * nrm[1] + nrm[2] * nrm[2]);
+        for (k = 0; k < 3; ++k)
+            nrm[k] /= len;
+    }
+
+    #pragma omp parallel private(i, k, x, t, e, local, local_i)
+    {
+        local = -1;
+        local_i = a;
+
+        #pragma omp for schedule(static)
+        for (i = 0; i < n; ++i)
+        {
+            x[0] = (double) p[i].x - p[a].x;
+            x[1] = (double) p[i].y - p[a].y;
+            x[2] = (double) p[i].z - p[a].z;
+            if (d == -1)
+            {
+                t[0] = x[1] * u[2] - x[2] * u[1];
+                t[1] = x[2] * u[0] - x[0] * u[2];
+                t[2] = x[0] * u[1] - x[1] * u[0];
+                e = t[0] * t[0] + t[1] * t[1] + t[2] * t[2];
+            }
+            else
+            {
+                e = x[0] * nrm[0] + x[1] * nrm[1] + x[2] * nrm[2];
+                e = e * e;
+            }
+            if (e > local)
+            {
+                local = e;
+                local_i = i;
+            }
+        }
+
+        #pragma omp critical
+        if (local > best || (local == best && local_i < best_i))
+        {
+            best = local;
+            best_i = local_i;
+        }
+    }
+
+    *dist = sqrt(best);
+
+    return best_i;
+}
+
+/*!
+ * Build the initial tetrahedron on the points v, orienting its faces
+ * outwards and linking them.
+ */
+static int init_simplex(Builder *b, const Index v[4])
+{
+    static const int tri[4][3] = {{0, 1, 2}, {0, 3, 1}, {1, 3, 2}, {2, 3, 0}};
+    Index f, g, t;
+    int i, j, k, l;
+
+    for (i = 0; i < 4; ++i)
+    {
+        f = add_face(b, v[tri[i][0]], v[tri[i][1]], v[tri[i][2]]);
+        if (f == -1)
+            return ERR_NO_MEMORY;
+
+        /* the opposite vertex must be below the face */
+        if (face_distance(b, f, v[6 - tri[i][0] - tri[i][1] - tri[i][2]])
+                > 0)
+        {
+            b->n_faces--;
+            t = v[tri[i][1]];
+            add_face(b, v[tri[i][0]], v[tri[i][2]], t);
+        }
+    }
+
+    for (f = 0; f < 4; ++f)
+        for (k = 0; k < 3; ++k)
+            for (g = 0; g < 4; ++g)
+                for (l = 0; l < 3; ++l)
+                    if (b->f[g].v[l] == b->f[f].v[(k + 1) % 3]
+                            && b->f[g].v[(l + 1) % 3] == b->f[f].v[k])
+                        b->f[f].adj[k] = g;
+
+    for (j = 0; j < 4; ++j)
+        b->f[j].mark = -1;
+
+    return 0;
+}
+
+/*!
+ * Copy the live faces in the hull structure, and compute the surface and
+ * the volume, summing the tetrahedra from a hull vertex to each face.
+ */
+static int collect_hull(const Builder *b, ConvexHull *h)
+{
+    unsigned char *used;
+    const Point3D *o, *p0, *p1, *p2;
+    double ux, uy, uz, wx, wy, wz, cx, cy, cz, s = 0, vol = 0;
+    Index f, i, n = 0;
+    int k;
+
+    for (f = 0; f < b->n_faces; ++f)
+        n += b->f[f].alive;
+
+    h->faces = (Index*) malloc(3 * n * sizeof (Index));
+    used = (unsigned char*) calloc(b->n, 1);
+    if (h->faces == NULL || used == NULL)
+    {
+        free(used);
+        return ERR_NO_MEMORY;
+    }
+
+    h->n_faces = 0;
+    for (f = 0; f < b->n_faces; ++f)
+    {
+        if (!b->f[f].alive)
+            continue;
+        for (k = 0; k < 3; ++k)
+        {
+            h->faces[3 * h->n_faces + k] = b->f[f].v[k];
+            used[b->f[f].v[k]] = 1;
+        }
+        h->n_faces++;
+    }
+
+    h->n_vertices = 0;
+    for (i = 0; i < b->n; ++i)
+        h->n_vertices += used[i];
+    h->vertices = (Index*) malloc(h->n_vertices * sizeof (Index));
+    if (h->vertices == NULL)
+    {
+        free(used);
+        return ERR_NO_MEMORY;
+    }
+    for (i = 0, n = 0; i < b->n; ++i)
+        if (used[i])
+            h->vertices[n++] = i;
+    free(used);
+
+    o = &b->p[h->faces[0]];
+    for (f = 0; f < h->n_faces; ++f)
+    {
+        p0 = &b->p[h->faces[3 * f]];
+        p1 = &b->p[h->faces[3 * f + 1]];
+        p2 = &b->p[h->faces[3 * f + 2]];
+        ux = (double) p1->x - p0->x;
+        uy = (double) p1->y - p0->y;
+        uz = (double) p1->z - p0->z;
+        wx = (double) p2->x - p0->x;
+        wy = (double) p2->y - p0->y;
+        wz = (double) p2->z - p0->z;
+        cx = uy * wz - uz * wy;
+        cy = uz * wx - ux * wz;
+        cz = ux * wy - uy * wx;
+        s += 0.5 * sqrt(cx * cx + cy * cy + cz * cz);
+        vol += (cx * ((double) p0->x - o->x) + cy * ((double) p0->y - o->y)
+                + cz * ((double) p0->z - o->z)) / 6;
+    }
+    h->surface = s;
+    h->volume = vol;
+
+    return 0;
+}
+
+/*!
+ * Return the plane, among the m ones stored as arrays of the normal
+ * components and of the offsets, that the point is farthest above, or -1
+ * if it is not above any of them by more than eps. Most points are inside
+ * the seed hull, so the maximum distance is found first with a loop which
+ * is vectorized, and the plane is searched only for the other points.
+ */
+static Index classify(const Point3D *p, const double *plane, Index m,
+        double eps)
+{
+    const double *nx = plane, *ny = plane + m, *nz = plane + 2 * m;
+    const double *nd = plane + 3 * m;
+    double x = p->x, y = p->y, z = p->z, d, best = -DBL_MAX;
+    Index k;
+
+    #pragma omp simd reduction(max: best)
+    for (k = 0; k < m; ++k)
+    {
+        d = nx[k] * x + ny[k] * y + nz[k] * z - nd[k];
+        best = d > best ? d : best;
+    }
+
+    if (best <= eps)
+        return -1;
+
+    for (k = 0; k < m - 1; ++k)
+        if (nx[k] * x + ny[k] * y + nz[k] * z - nd[k] >= best)
+            break;
+
+    return k;
+}
+
+/*!
+ * Copy the vertex positions in a contiguous array, seed the hull with the
+ * extreme points, then classify all the points in parallel against the
+ * seed faces and complete the hull.
+ */
+int convex_hull(Model3D *m, ConvexHull *h)
+{
+    Builder b;
+    Point3D *p;
+    Index *owner = NULL, *seed = NULL, ext[2 * HULL_DIRECTIONS], v[4];
+    double *plane = NULL;
+    Index i, f, n = m->n_vertices, seed_faces;
+    double d, size = 0, best;
+    int k, status = 0;
+    double start = profile_clock();
+
+    h->faces = NULL;
+    h->vertices = NULL;
+    h->n_faces = h->n_vertices = 0;
+    h->surface = h->volume = 0;
+
+    if (n < 4)
+        return -1;
+
+    memset(&b, 0, sizeof b);
+    p = (Point3D*) malloc(n * sizeof (Point3D));
+    b.next = (Index*) malloc(n * sizeof (Index));
+    b.start = (Index*) malloc(n * sizeof (Index));
+    b.end = (Index*) malloc(n * sizeof (Index));
+    b.cap = 64;
+    b.f = (HullFace*) malloc(b.cap * sizeof (HullFace));
+    if (p == NULL || b.next == NULL || b.start == NULL || b.end == NULL
+            || b.f == NULL || reserve_stack(&b, 64) != 0)
+        status = ERR_NO_MEMORY;
+
+    if (status == 0)
+    {
+        #pragma omp parallel for schedule(static)
+        for (i = 0; i < n; ++i)
+            p[i] = m->vertices_array[i]->vertexCoordinates;
+
+        b.p = p;
+        b.n = n;
+
+        find_extremes(p, n, ext);
+        for (k = 0; k < 3; ++k)
+            size += (double) p[ext[2 * k + 1]].x * (k == 0)
+                + (double) p[ext[2 * k + 1]].y * (k == 1)
+                + (double) p[ext[2 * k + 1]].z * (k == 2)
+                - p[ext[2 * k]].x * (k == 0) - p[ext[2 * k]].y * (k == 1)
+                - p[ext[2 * k]].z * (k == 2);
+        b.eps = HULL_EPS * size;
+
+        /* the two extremes farthest apart, then the farthest points from
+         * their line and from the plane of the three */
+        best = -1;
+        for (k = 0; k < 2 * HULL_DIRECTIONS; ++k)
+            for (i = 0; i < k; ++i)
+            {
+                d = ((double) p[ext[k]].x - p[ext[i]].x)
+                    * ((double) p[ext[k]].x - p[ext[i]].x)
+                    + ((double) p[ext[k]].y - p[ext[i]].y)
+                    * ((double) p[ext[k]].y - p[ext[i]].y)
+                    + ((double) p[ext[k]].z - p[ext[i]].z)
+                    * ((double) p[ext[k]].z - p[ext[i]].z);
+                if (d > best)
+                {
+                    best = d;
+                    v[0] = ext[i];
+                    v[1] = ext[k];
+                }
+            }
+
+        if (sqrt(best) <= b.eps)
+            status = -1;
+        else
+        {
+            v[2] = farthest_point(p, n, v[0], v[1], -1, &d);
+            if (d <= b.eps)
+                status = -1;
+            else
+            {
+                v[3] = farthest_point(p, n, v[0], v[1], v[2], &d);
+                if (d <= b.eps)
+                    status = -1;
+            }
+        }
+    }
+
+    if (status == 0)
+        status = init_simplex(&b, v);
+
+    /* hull of the extreme points */
+    if (status == 0)
+    {
+        for (k = 0; k < 2 * HULL_DIRECTIONS; ++k)
+        {
+            for (i = 0; i < k && ext[i] != ext[k]; ++i)
+                ;
+            if (i == k)
+                assign_point(&b, ext[k], 0, b.n_faces);
+        }
+        status = expand(&b);
+    }
+
+    /* parallel classification of all the points against its faces */
+    if (status == 0)
+    {
+        owner = (Index*) malloc(n * sizeof (Index));
+        if (owner == NULL)
+            status = ERR_NO_MEMORY;
+    }
+
+    if (status == 0)
+    {
+        for (f = 0, seed_faces = 0; f < b.n_faces; ++f)
+            seed_faces += b.f[f].alive;
+
+        plane = (double*) malloc(4 * seed_faces * sizeof (double));
+        seed = (Index*) malloc(seed_faces * sizeof (Index));
+        if (plane == NULL || seed == NULL)
+            status = ERR_NO_MEMORY;
+    }
+
+    if (status == 0)
+    {
+        for (f = 0, k = 0; f < b.n_faces; ++f)
+        {
+            if (!b.f[f].alive)
+                continue;
+            plane[k] = b.f[f].n[0];
+            plane[seed_faces + k] = b.f[f].n[1];
+            plane[2 * seed_faces + k] = b.f[f].n[2];
+            plane[3 * seed_faces + k] = b.f[f].d;
+            seed[k++] = f;
+        }
+
+        #pragma omp parallel for schedule(static)
+        for (i = 0; i < n; ++i)
+            owner[i] = classify(&p[i], plane, seed_faces, b.eps);
+
+        for (i = n - 1; i >= 0; --i)
+            if (owner[i] != -1)
+                push_outside(&b, seed[owner[i]], i,
+                        face_distance(&b, seed[owner[i]], i));
+
+        status = expand(&b);
+    }
+
+    if (status == 0)
+        status = collect_hull(&b, h);
+
+    if (status > 0)
+        hull_free(h);
+
+    free(p);
+    free(owner);
+    free(plane);
+    free(seed);
+    free(b.next);
+    free(b.start);
+    free(b.end);
+    free(b.f);
+    free(b.stack);
+    free(b.horizon);
+
+    profile_record(PROF_HULL, start, n, 0);
+
+    return status;
+}
+
+/*!
+ * Free the hull arrays.
+ */
+void hull_free(ConvexHull *h)
+{
+    free(h->faces);
+    free(h->vertices);
+    h->faces = NULL;
+    h->vertices = NULL;
+    h->n_faces = h->n_vertices = 0;
+}
+
+/*!
+ * Type for a point of the plane.
+ */
+typedef struct Point2D
+{
+    double x; /*!< First coordinate. */
+    double y; /*!< Second coordinate. */
+} Point2D;
+
+/*!
+ * Lexicographic order of 2D points, for qsort().
+ */
+static int compare_2d(const void *a, const void *b)
+{
+    const Point2D *p = (const Point2D*) a, *q = (const Point2D*) b;
+
+    if (p->x != q->x)
+        return p->x < q->x ? -1 : 1;
+    if (p->y != q->y)
+        return p->y < q->y ? -1 : 1;
+    return 0;
+}
+
+/*!
+ * Cross product of b - a and c - a.
+ */
+static double cross_2d(Point2D a, Point2D b, Point2D c)
+{
+    return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+}
+
+/*!
+ * Dot product of p with the vector (x, y).
+ */
+static double dot_2d(Point2D p, double x, double y)
+{
+    return p.x * x + p.y * y;
+}
+
+/*!
+ * Replace the n points with their convex hull, in counter clockwise order
+ * without collinear points (Andrew's monotone chain), using q as scratch
+ * space of 2 n + 1 points. Return the number of hull points.
+ */
+static Index hull_2d(Point2D *p, Index n, Point2D *q)
+{
+    Index i, k = 0, lower;
+
+    if (n < 3)
+        return n;
+
+    qsort(p, n, sizeof (Point2D), compare_2d);
+
+    for (i = 0; i < n; ++i)
+    {
+        while (k >= 2 && cross_2d(q[k - 2], q[k - 1], p[i]) <= 0)
+            --k;
+        q[k++] = p[i];
+    }
+    lower = k + 1;
+    for (i = n - 2; i >= 0; --i)
+    {
+        while (k >= lower && cross_2d(q[k - 2], q[k - 1], p[i]) <= 0)
+            --k;
+        q[k++] = p[i];
+    }
+
+    memcpy(p, q, (k - 1) * sizeof (Point2D));
+
+    return k - 1;
+}
+
+/*!
+ * Find the rectangle of minimum area around a convex polygon with rotating
+ * calipers. For each edge, taken as a side of the rectangle, three
+ * pointers track the vertex farthest along the edge, the one farthest from
+ * it and the one farthest backwards; they only move forward, so all the
+ * edges are visited in linear time. The rectangle is returned as its
+ * first axis and the ranges of the polygon along the axis and its normal.
+ */
+static double min_rectangle(const Point2D *q, Index n, double axis[2],
+        double range[4])
+{
+    Index i, j = 1, k = 1, l = 1, steps;
+    double ex, ey, len, w, h, area, best = DBL_MAX;
+
+    axis[0] = 1;
+    axis[1] = 0;
+    range[0] = range[1] = range[2] = range[3] = 0;
+
+    for (i = 0; i < n; ++i)
+    {
+        ex = q[(i + 1) % n].x - q[i].x;
+        ey = q[(i + 1) % n].y - q[i].y;
+        len = sqrt(ex * ex + ey * ey);
+        if (len == 0)
+            continue;
+        ex /= len;
+        ey /= len;
+
+        for (steps = 0; steps < n && dot_2d(q[(j + 1) % n], ex, ey)
+                > dot_2d(q[j], ex, ey); ++steps)
+            j = (j + 1) % n;
+        if (i == 0)
+            k = j;
+        for (steps = 0; steps < n && dot_2d(q[(k + 1) % n], -ey, ex)
+                > dot_2d(q[k], -ey, ex); ++steps)
+            k = (k + 1) % n;
+        if (i == 0)
+            l = k;
+        for (steps = 0; steps < n && dot_2d(q[(l + 1) % n], ex, ey)
+                < dot_2d(q[l], ex, ey); ++steps)
+            l = (l + 1) % n;
+
+        w = dot_2d(q[j], ex, ey) - dot_2d(q[l], ex, ey);
+        h = dot_2d(q[k], -ey, ex) - dot_2d(q[i], -ey, ex);
+        area = w * h;
+        if (area < best)
+        {
+            best = area;
+            axis[0] = ex;
+            axis[1] = ey;
+            range[0] = dot_2d(q[l], ex, ey);
+            range[1] = dot_2d(q[j], ex, ey);
+            range[2] = dot_2d(q[i], -ey, ex);
+            range[3] = dot_2d(q[k], -ey, ex);
+        }
+    }
+
+    return best;
+}
+
+/*!
+ * Type for a hull face with its area, to sort the candidates.
+ */
+typedef struct FaceArea
+{
+    double area; /*!< Area of the face. */
+    Index face;  /*!< Index of the face. */
+} FaceArea;
+
+/*!
+ * Decreasing order of area, then increasing index, for qsort().
+ */
+static int compare_area(const void *a, const void *b)
+{
+    const FaceArea *p = (const FaceArea*) a, *q = (const FaceArea*) b;
+
+    if (p->area != q->area)
+        return p->area > q->area ? -1 : 1;
+    return p->face < q->face ? -1 : (p->face > q->face);
+}
+
+/*!
+ * Type for the hull data shared by the candidate boxes.
+ */
+typedef struct BoxData
+{
+    Index n_vertices;   /*!< Number of hull vertices. */
+    double *vertices;   /*!< Hull vertices, relative to origin. */
+    Index n_faces;      /*!< Number of hull faces. */
+    Index *faces;       /*!< Hull faces, on the hull vertices. */
+    double *normals;    /*!< Unnormalized normals of the hull faces. */
+    double origin[3];   /*!< Centroid of the hull vertices. */
+} BoxData;
+
+/*!
+ * Compute the box with one axis along the unit vector n. The hull vertices
+ * on the silhouette seen along n, those with both a face turned towards n
+ * and one turned away, are projected on a basis of the orthogonal plane;
+ * they include all the vertices of the 2D hull of the projection, and
+ * they are far fewer than the hull vertices. The rectangle of minimum area
+ * is found around their 2D hull. The scratch arrays hold the side flags of
+ * the hull vertices and 3 n_vertices + 1 points.
+ */
+static void box_along(const BoxData *d, const double n[3],
+        unsigned char *side, Point2D *p, Point2D *q, OrientedBox *b)
+{
+    double u[3], w[3], axis[2], range[4], lo = DBL_MAX, hi = -DBL_MAX;
+    double len, t, a[3], c[3];
+    const double *x;
+    unsigned char flag;
+    Index i, k;
+    int j;
+
+    /* basis of the plane, from the axis least aligned with the normal */
+    if (fabs(n[0]) <= fabs(n[1]) && fabs(n[0]) <= fabs(n[2]))
+    {
+        u[0] = 0;
+        u[1] = n[2];
+        u[2] = -n[1];
+    }
+    else if (fabs(n[1]) <= fabs(n[2]))
+    {
+        u[0] = -n[2];
+        u[1] = 0;
+        u[2] = n[0];
+    }
+    else
+    {
+        u[0] = n[1];
+        u[1] = -n[0];
+        u[2] = 0;
+    }
+    len = sqrt(u[0] * u[0] + u[1] * u[1] + u[2] * u[2]);
+    for (j = 0; j < 3; ++j)
+        u[j] /= len;
+    w[0] = n[1] * u[2] - n[2] * u[1];
+    w[1] = n[2] * u[0] - n[0] * u[2];
+    w[2] = n[0] * u[1] - n[1] * u[0];
+
+    memset(side, 0, d->n_vertices);
+    for (i = 0; i < d->n_faces; ++i)
+    {
+        x = &d->normals[3 * i];
+        t = x[0] * n[0] + x[1] * n[1] + x[2] * n[2];
+        flag = (t >= 0) | (t <= 0) << 1;
+        for (j = 0; j < 3; ++j)
+            side[d->faces[3 * i + j]] |= flag;
+    }
+
+    for (i = 0, k = 0; i < d->n_vertices; ++i)
+    {
+        x = &d->vertices[3 * i];
+        t = x[0] * n[0] + x[1] * n[1] + x[2] * n[2];
+        if (t < lo)
+            lo = t;
+        if (t > hi)
+            hi = t;
+        if (side[i] == 3)
+        {
+            p[k].x = x[0] * u[0] + x[1] * u[1] + x[2] * u[2];
+            p[k].y = x[0] * w[0] + x[1] * w[1] + x[2] * w[2];
+            ++k;
+        }
+    }
+
+    k = hull_2d(p, k, q);
+    b->volume = min_rectangle(p, k, axis, range) * (hi - lo);
+
+    for (j = 0; j < 3; ++j)
+    {
+        a[j] = axis[0] * u[j] + axis[1] * w[j];
+        c[j] = -axis[1] * u[j] + axis[0] * w[j];
+    }
+
+    b->axes[0].x = a[0];
+    b->axes[0].y = a[1];
+    b->axes[0].z = a[2];
+    b->axes[1].x = c[0];
+    b->axes[1].y = c[1];
+    b->axes[1].z = c[2];
+    b->axes[2].x = n[0];
+    b->axes[2].y = n[1];
+    b->axes[2].z = n[2];
+    b->extents[0] = range[1] - range[0];
+    b->extents[1] = range[3] - range[2];
+    b->extents[2] = hi - lo;
+
+    b->center.x = d->origin[0] + a[0] * 0.5 * (range[0] + range[1])
+        + c[0] * 0.5 * (range[2] + range[3]) + n[0] * 0.5 * (lo + hi);
+    b->center.y = d->origin[1] + a[1] * 0.5 * (range[0] + range[1])
+        + c[1] * 0.5 * (range[2] + range[3]) + n[1] * 0.5 * (lo + hi);
+    b->center.z = d->origin[2] + a[2] * 0.5 * (range[0] + range[1])
+        + c[2] * 0.5 * (range[2] + range[3]) + n[2] * 0.5 * (lo + hi);
+}
+
+/*!
+ * Copy the hull vertices relative to their centroid, renumber the faces on
+ * them and compute the face normals, sort the faces by area, then evaluate
+ * the candidate normals in parallel, each thread with its own scratch
+ * arrays. The principal axes of the model are added to the candidates,
+ * since on smooth models no hull face is flush with the best box. Finally
+ * sort the axes by decreasing extent, keeping the frame right handed.
+ */
+int oriented_box(Model3D *m, const ConvexHull *h, OrientedBox *b)
+{
+    BoxData d;
+    FaceArea *fa;
+    OrientedBox box, best;
+    Point2D *p, *q;
+    Point3D r;
+    Vector3D tv, pa[3];
+    Point3D pc;
+    unsigned char *side;
+    Index *local;
+    double nrm[3], *x, *y, *z, len, te;
+    Index f, n_candidates, best_c = -1;
+    int i, j, n_axes, failed = 0;
+    double start = profile_clock();
+
+    /* the principal axes exist for any model with a surface */
+    i = principal_axes(m, &pc, pa);
+    if (i > 0)
+        return i;
+    n_axes = i == 0 ? 6 : 3;
+
+    d.n_vertices = h->n_vertices;
+    d.n_faces = h->n_faces;
+    d.vertices = (double*) malloc(3 * h->n_vertices * sizeof (double));
+    d.faces = (Index*) malloc(3 * h->n_faces * sizeof (Index));
+    d.normals = (double*) malloc(3 * h->n_faces * sizeof (double));
+    local = (Index*) malloc(m->n_vertices * sizeof (Index));
+    fa = (FaceArea*) malloc((h->n_faces + 1) * sizeof (FaceArea));
+    if (d.vertices == NULL || d.faces == NULL || d.normals == NULL
+            || local == NULL || fa == NULL)
+    {
+        free(d.vertices);
+        free(d.faces);
+        free(d.normals);
+        free(local);
+        free(fa);
+        return ERR_NO_MEMORY;
+    }
+
+    d.origin[0] = d.origin[1] = d.origin[2] = 0;
+    for (f = 0; f < h->n_vertices; ++f)
+    {
+        r = m->vertices_array[h->vertices[f]]->vertexCoordinates;
+        d.origin[0] += r.x;
+        d.origin[1] += r.y;
+        d.origin[2] += r.z;
+        local[h->vertices[f]] = f;
+    }
+    for (i = 0; i < 3; ++i)
+        d.origin[i] /= h->n_vertices;
+
+    #pragma omp parallel for schedule(static) private(r)
+    for (f = 0; f < h->n_vertices; ++f)
+    {
+        r = m->vertices_array[h->vertices[f]]->vertexCoordinates;
+        d.vertices[3 * f] = r.x - d.origin[0];
+        d.vertices[3 * f + 1] = r.y - d.origin[1];
+        d.vertices[3 * f + 2] = r.z - d.origin[2];
+    }
+
+    #pragma omp parallel for schedule(static) private(x, y, z, i)
+    for (f = 0; f < h->n_faces; ++f)
+    {
+        for (i = 0; i < 3; ++i)
+            d.faces[3 * f + i] = local[h->faces[3 * f + i]];
+        x = &d.vertices[3 * d.faces[3 * f]];
+        y = &d.vertices[3 * d.faces[3 * f + 1]];
+        z = &d.vertices[3 * d.faces[3 * f + 2]];
+        d.normals[3 * f] = (y[1] - x[1]) * (z[2] - x[2])
+            - (y[2] - x[2]) * (z[1] - x[1]);
+        d.normals[3 * f + 1] = (y[2] - x[2]) * (z[0] - x[0])
+            - (y[0] - x[0]) * (z[2] - x[2]);
+        d.normals[3 * f + 2] = (y[0] - x[0]) * (z[1] - x[1])
+            - (y[1] - x[1]) * (z[0] - x[0]);
+        fa[f].area = d.normals[3 * f] * d.normals[3 * f]
+            + d.normals[3 * f + 1] * d.normals[3 * f + 1]
+            + d.normals[3 * f + 2] * d.normals[3 * f + 2];
+        fa[f].face = f;
+    }
+
+    free(local);
+
+    qsort(fa, h->n_faces, sizeof (FaceArea), compare_area);
+    n_candidates = h->n_faces < OBB_CANDIDATES ? h->n_faces : OBB_CANDIDATES;
+
+    best.volume = DBL_MAX;
+
+    #pragma omp parallel private(p, q, side, box, nrm, x, len, i)
+    {
+        side = (unsigned char*) malloc(h->n_vertices);
+        p = (Point2D*) malloc((h->n_vertices + 1) * sizeof (Point2D));
+        q = (Point2D*) malloc((2 * h->n_vertices + 1) * sizeof (Point2D));
+        if (side == NULL || p == NULL || q == NULL)
+        {
+            #pragma omp atomic write
+            failed = 1;
+        }
+
+        /* the candidates after the faces are the coordinate axes, then
+         * the principal axes */
+        #pragma omp for schedule(dynamic, 1)
+        for (f = 0; f < n_candidates + n_axes; ++f)
+        {
+            if (side == NULL || p == NULL || q == NULL)
+                continue;
+
+            if (f < n_candidates)
+            {
+                x = &d.normals[3 * fa[f].face];
+                len = sqrt(fa[f].area);
+                if (len == 0)
+                    continue;
+                for (i = 0; i < 3; ++i)
+                    nrm[i] = x[i] / len;
+            }
+            else if (f < n_candidates + 3)
+                for (i = 0; i < 3; ++i)
+                    nrm[i] = i == f - n_candidates;
+            else
+            {
+                nrm[0] = pa[f - n_candidates - 3].x;
+                nrm[1] = pa[f - n_candidates - 3].y;
+                nrm[2] = pa[f - n_candidates - 3].z;
+            }
+
+            box_along(&d, nrm, side, p, q, &box);
+
+            #pragma omp critical
+            if (box.volume < best.volume
+                    || (box.volume == best.volume && f < best_c))
+            {
+                best = box;
+                best_c = f;
+            }
+        }
+
+        free(side);
+        free(p);
+        free(q);
+    }
+
+    free(fa);
+    free(d.vertices);
+    free(d.faces);
+    free(d.normals);
+
+    if (failed)
+        return ERR_NO_MEMORY;
+
+    /* sort the axes by decreasing extent, swapping two axes and flipping
+     * one to keep the frame right handed */
+    for (i = 0; i < 2; ++i)
+        for (j = i + 1; j < 3; ++j)
+            if (best.extents[j] > best.extents[i])
+            {
+                te = best.extents[i];
+                best.extents[i] = best.extents[j];
+                best.extents[j] = te;
+                tv = best.axes[i];
+                best.axes[i] = best.axes[j];
+                best.axes[j].x = -tv.x;
+                best.axes[j].y = -tv.y;
+                best.axes[j].z = -tv.z;
+            }
+
+    *b = best;
+
+    profile_record(PROF_OBB, start, h->n_vertices, h->n_faces);
+
+    return 0;
+}
@@ -0,0 +1,109 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) Martino Pilia, 2015
+ */
+
+
+/*!
+ * \file hull.h
+ */
+
+#ifndef HULL_H
+#define HULL_H
+
+#include "backend.h"
+
+/*!
+ * Relative tolerance of the convex hull: a point is outside a face if its
+ * distance from the face plane exceeds this fraction of the model size.
+ */
+#define HULL_EPS 1e-6
+
+/*!
+ * Number of hull faces, in order of decreasing area, whose plane is tried
+ * as a side of the oriented bounding box.
+ */
+#define OBB_CANDIDATES 128
+
+/*!
+ * Type for the convex hull of a model.
+ */
+typedef struct ConvexHull
+{
+    Index *faces;     /*!< Three vertex indices for each face, in counter
+                           clockwise order seen from outside. */
+    Index n_faces;    /*!< Number of faces. */
+    Index *vertices;  /*!< Indices of the model vertices on the hull. */
+    Index n_vertices; /*!< Number of vertices on the hull. */
+    double surface;   /*!< Area of the hull. */
+    double volume;    /*!< Volume of the hull. */
+} ConvexHull;
+
+/*!
+ * Type for an oriented bounding box.
+ */
+typedef struct OrientedBox
+{
+    Point3D center;     /*!< Centre of the box. */
+    Vector3D axes[3];   /*!< Unit axes of the box, in order of decreasing
+                             extent, forming a right handed frame. */
+    double extents[3];  /*!< Length of the sides along each axis. */
+    double volume;      /*!< Volume of the box. */
+} OrientedBox;
+
+/*!
+ * \brief Compute the convex hull of the vertices of a model.
+ *
+ * The hull is built with the quickhull algorithm. The extreme vertices
+ * along 13 directions are found with a parallel scan and their hull is
+ * built first; then each vertex is tested in parallel against its faces,
+ * so that the vertices inside it, usually most of them, are discarded
+ * before the incremental construction, and the others are assigned to the
+ * face they are farthest above.
+ * @param m Model.
+ * @param h Structure to be filled, to be released with hull_free().
+ * @return Zero on success, -1 if the vertices are coplanar (the structure
+ * is not filled), ERR_NO_MEMORY if an allocation failed.
+ * @note Vertices within HULL_EPS of the hull (relative to the size of the
+ * model) are considered inside it.
+ */
+int convex_hull(Model3D *m, ConvexHull *h);
+
+/*!
+ * \brief Release the arrays of a convex hull.
+ * @param h Hull, whose arrays are freed.
+ */
+void hull_free(ConvexHull *h);
+
+/*!
+ * \brief Compute an oriented bounding box of small volume for a model.
+ *
+ * The box of minimum volume has a side flush with a face of the convex
+ * hull in most practical cases (and always two sides flush with hull
+ * edges). For each of the OBB_CANDIDATES largest hull faces, and for the
+ * coordinate and the principal axes of the model (see principal_axes()),
+ * which suit smooth models, the hull vertices are projected on the plane
+ * orthogonal to the direction, and the rectangle of minimum area around
+ * them is found with rotating calipers on their 2D hull. The candidates are
+ * evaluated in parallel and the box of smallest volume is kept, which is
+ * never larger than the axis aligned bounding box.
+ * @param m Model.
+ * @param h Convex hull of the model, see convex_hull().
+ * @param b Structure to be filled.
+ * @return Zero on success, ERR_NO_MEMORY if an allocation failed.
+ */
+int oriented_box(Model3D *m, const ConvexHull *h, OrientedBox *b);
+
+#endif // HULL_H
@@ -0,0 +1,246 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) Martino Pilia, 2015
+ */
+
+/*!
+ * \file kdtree.c
+ */
+
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "kdtree.h"
+
+/*!
+ * Return the component of a point along an axis.
+ */
+static float coord(Point3D p, int axis)
+{
+    return axis == 0 ? p.x : (axis == 1 ? p.y : p.z);
+}
+
+/*!
+ * Exchange two points of the tree, together with their ids.
+ */
+static void swap(KdTree *t, Index i, Index j)
+{
+    Point3D p = t->points[i];
+    Index id = t->ids[i];
+
+    t->points[i] = t->points[j];
+    t->ids[i] = t->ids[j];
+    t->points[j] = p;
+    t->ids[j] = id;
+}
+
+/*!
+ * Partially sort the range [lo, hi) along an axis, so that the k-th
+ * position holds the point it would hold if the range was sorted, with no
+ * greater point before it and no smaller point after it (Hoare's
+ * selection algorithm). The partition is three-way, so that points with
+ * the same coordinate do not make it quadratic.
+ */
+static void select_kth(KdTree *t, Index lo, Index hi, Index k, int axis)
+{
+    Index i, lt, gt;
+    float a, b, c, pivot;
+
+    while (hi - lo > 1)
+    {
+        /* median of three as pivot */
+        a = coord(t->points[lo], axis);
+        b = coord(t->points[lo + (hi - lo) / 2], axis);
+        c = coord(t->points[hi - 1], axis);
+        if ((a <= b && b <= c) || (c <= b && b <= a))
+            pivot = b;
+        else if ((b <= a && a <= c) || (c <= a && a <= b))
+            pivot = a;
+        else
+            pivot = c;
+
+        /* partition the range in [lo, lt) smaller than the pivot,
+         * [lt, gt) equal and [gt, hi) greater (Dijkstra's flag) */
+        lt = i = lo;
+        gt = hi;
+        while (i < gt)
+        {
+            if (coord(t->points[i], axis) < pivot)
+                swap(t, lt++, i++);
+            else if (coord(t->points[i], axis) > pivot)
+                swap(t, i, --gt);
+            else
+                ++i;
+        }
+
+        if (k < lt)
+            hi = lt;
+        else if (k >= gt)
+            lo = gt;
+        else
+            return;
+    }
+}
+
+/*!
+ * Build the subtree on the range [lo, hi). The splitting axis is the one
+ * along which the points of the range have the largest extent, which gives
+ * better pruning than cycling the axes on clustered data.
+ */
+static void build(KdTree *t, Index lo, Index hi)
+{
+    Index i, mid;
+    float min[3] = {FLT_MAX, FLT_MAX, FLT_MAX};
+    float max[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+    int a, axis = 0;
+
+    if (hi - lo <= 0)
+        return;
+
+    for (i = lo; i < hi; ++i)
+    {
+        for (a = 0; a < 3; ++a)
+        {
+            if (coord(t->points[i], a) < min[a])
+                min[a] = coord(t->points[i], a);
+            if (coord(t->points[i], a) > max[a])
+                max[a] = coord(t->points[i], a);
+        }
+    }
+
+    for (a = 1; a < 3; ++a)
+        if (max[a] - min[a] > max[axis] - min[axis])
+            axis = a;
+
+    mid = lo + (hi - lo) / 2;
+    select_kth(t, lo, hi, mid, axis);
+    t->axis[mid] = axis;
+
+    build(t, lo, mid);
+    build(t, mid + 1, hi);
+}
+
+/*!
+ * Copy the points and reorder them in the implicit tree layout.
+ */
+int kdtree_build(KdTree *t, const Point3D *p, Index n)
+{
+    Index i;
+
+    t->points = NULL;
+    t->ids = NULL;
+    t->axis = NULL;
+    t->n = 0;
+
+    if (n <= 0)
+        return ERR_INVALID_ARGUMENT;
+
+    t->points = (Point3D*) malloc(n * sizeof (Point3D));
+    t->ids = (Index*) malloc(n * sizeof (Index));
+    t->axis = (unsigned char*) malloc(n);
+
+    if (t->points == NULL || t->ids == NULL || t->axis == NULL)
+    {
+        kdtree_free(t);
+        return ERR_NO_MEMORY;
+    }
+
+    memcpy(t->points, p, n * sizeof (Point3D));
+    for (i = 0; i < n; ++i)
+        t->ids[i] = i;
+    t->n = n;
+
+    build(t, 0, n);
+
+    return 0;
+}
+
+/*!
+ * Search the subtree on the range [lo, hi), visiting first the side of the
+ * splitting plane containing the query point, and the other side only if
+ * the plane is nearer than the best point found so far.
+ */
+static void search(const KdTree *t, Index lo, Index hi, Point3D q,
+        double *best, Index *best_i)
+{
+    Index mid;
+    double dx, dy, dz, d2, diff;
+
+    while (hi - lo > 0)
+    {
+        mid = lo + (hi - lo) / 2;
+
+        dx = t->points[mid].x - q.x;
+        dy = t->points[mid].y - q.y;
+        dz = t->points[mid].z - q.z;
+        d2 = dx * dx + dy * dy + dz * dz;
+        if (d2 < *best)
+        {
+            *best = d2;
+            *best_i = mid;
+        }
+
+        diff = coord(q, t->axis[mid]) - coord(t->points[mid], t->axis[mid]);
+
+        /* recurse on the near side, then iterate on the far side if the
+         * plane is nearer than the best point found there */
+        if (diff < 0)
+        {
+            search(t, lo, mid, q, best, best_i);
+            if (diff * diff >= *best)
+                return;
+            lo = mid + 1;
+        }
+        else
+        {
+            search(t, mid + 1, hi, q, best, best_i);
+            if (diff * diff >= *best)
+                return;
+            hi = mid;
+        }
+    }
+}
+
+/*!
+ * Nearest neighbour query, in O(log n) expected time.
+ */
+double kdtree_nearest(const KdTree *t, Point3D q, Index *nearest)
+{
+    double best = DBL_MAX;
+    Index best_i = 0;
+
+    search(t, 0, t->n, q, &best, &best_i);
+
+    if (nearest != NULL)
+        *nearest = t->ids[best_i];
+
+    return sqrt(best);
+}
+
+/*!
+ * Free the tree arrays.
+ */
+void kdtree_free(KdTree *t)
+{
+    free(t->points);
+    free(t->ids);
+    free(t->axis);
+    t->points = NULL;
+    t->ids = NULL;
+    t->axis = NULL;
+    t->n = 0;
+}
@@ -0,0 +1,72 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) Martino Pilia, 2015
+ */
+
+/*!
+ * \file kdtree.h
+ */
+
+#ifndef KDTREE_H
+#define KDTREE_H
+
+#include "backend.h"
+
+/*! Define a type for a k-d tree over a set of points. */
+typedef struct KdTree KdTree;
+
+/*!
+ * Type representing a balanced k-d tree over a set of points in
+ * tridimensional space. The tree is implicit: the points are reordered so
+ * that the root of each subtree is the median of its range, and only the
+ * splitting axis of each node is stored.
+ */
+struct KdTree
+{
+    Point3D *points;     /*!< Points, in tree order. */
+    Index *ids;          /*!< Original position of each point. */
+    unsigned char *axis; /*!< Splitting axis of the node rooted at each
+                              position (0 for x, 1 for y, 2 for z). */
+    Index n;             /*!< Number of points. */
+};
+
+/*!
+ * \brief Build a k-d tree over a set of points.
+ * @param t Tree to be built.
+ * @param p Points, copied inside the tree.
+ * @param n Number of points, must be positive.
+ * @return Zero on success, ERR_NO_MEMORY if an allocation failed or
+ * ERR_INVALID_ARGUMENT if the set is empty.
+ */
+int kdtree_build(KdTree *t, const Point3D *p, Index n);
+
+/*!
+ * \brief Find the point of the tree nearest to a query point.
+ * @param t Tree to be searched.
+ * @param q Query point.
+ * @param nearest If not NULL, filled with the original position of the
+ * nearest point.
+ * @return Euclidean distance between q and the nearest point.
+ * @note Queries do not modify the tree, so they can run concurrently.
+ */
+double kdtree_nearest(const KdTree *t, Point3D q, Index *nearest);
+
+/*!
+ * \brief Free the resources owned by a tree.
+ * @param t Tree to be freed.
+ */
+void kdtree_free(KdTree *t);
+
+#endif // KDTREE_H
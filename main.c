@@ -22,10 +22,6 @@
 
 int main(int argc, char *argv[])
 {
-    /* statements without any effect, only to avoid syntax-checker warnings */
-    UNUSED(argc); /* really unused */
-    UNUSED(argv); /* unused on Linux and Windows */
-
     int line;                      /* line number for error messages */
     char out_fname[STR_LEN + 1];   /* filename for the model to be exported */
     Model3D m;                     /* object for imported 3D model */
@@ -34,8 +30,12 @@ int main(int argc, char *argv[])
     int flag = 1;                  /* flag to remain inside main loop */
     int parser_error;              /* flag for problems parsing the file */
     int color_error;               /* flag for missing/failed coloration */
-    int rotation_error;            /* flag for missing/failed rotation */
+    int edit_error;                /* flag for missing/failed edits */
     
+    /* get options (e.g. profiling) from the command line */
+    if (parse_arguments(argc, argv))
+        return EXIT_FAILURE;
+
     srand(time(NULL));
 
     /* show a brief introduction */
@@ -47,10 +47,10 @@ int main(int argc, char *argv[])
     do /* while (flag) */
     {
         /* set flags for current execution
-         * nonzero value indicates that no coloration/rotation was successfully 
+         * nonzero value indicates that no coloration/edit was successfully 
          * done yet; note that this initialization is needed for each cycle */
         color_error = 1;
-        rotation_error = 1;
+        edit_error = 1;
     
         /* init model */
         init_model(&m);
@@ -83,6 +83,7 @@ int main(int argc, char *argv[])
         }
     
         /* read model data from file */
+        line = __LINE__ + 1; /* mark next line for eventual error message */
         parser_error = parse_model_data(&m);
 
         /* check if file content is useful, otherwise manage errors */
@@ -107,9 +108,12 @@ int main(int argc, char *argv[])
                         "another file.\n",
                         ANSI_COL_RED,
                         ANSI_ATT_BOLD));
-                clear_model(m);
+                clear_model(&m);
                 fclose(m.file_model);
                 continue; /* skip to next do-while iteration */
+
+            case ERR_NO_MEMORY:
+                error_handler("parse_model_data", __func__, __FILE__, line);
         }
 
         /* determine info about current model */
@@ -119,7 +123,7 @@ int main(int argc, char *argv[])
         {
 
             /* show main menu */
-            action = main_menu(m);
+            action = main_menu(&m);
 
             /* do the action selected by the user */
             switch (action)
@@ -131,7 +135,7 @@ int main(int argc, char *argv[])
                 case ANOTHER:
                     /* if there are unsaved pending changes, 
                      * ask for confirmation */
-                    if (!color_error || !rotation_error)
+                    if (!color_error || !edit_error)
                         action = confirm(action);
                     break; /* action value determine if remain inside of loop */
 
@@ -148,30 +152,79 @@ int main(int argc, char *argv[])
                     break;
 
                 case INFO:
-                    show_info(m);
+                    show_info(&m);
                     break;
 
                 case EXIT:
                     /* if there are unsaved pending changes, 
                      * ask for confirmation */
-                    if (!color_error || !rotation_error)
+                    if (!color_error || !edit_error)
                         if (confirm(action) == NULL_ACTION)
                             break;
                     fclose(m.file_model);
-                    clear_model(m);
+                    clear_model(&m);
                     exit(EXIT_SUCCESS);
 
                 case ROTATE:
                     /* apply rotation (asking detail to the user */
-                    rotation_error = rotate_model(m);
+                    edit_error = rotate_model(&m);
+                    break;
+
+                case ALIGN:
+                    edit_error = align_model(&m);
+                    break;
+
+                case NORMALS:
+                    edit_error = normals_model(&m);
+                    break;
+
+                case SMOOTH:
+                    edit_error = smooth_model(&m);
+                    break;
+
+                case SUBDIVIDE:
+                    edit_error = subdivide_model(&m);
+                    break;
+
+                case DECIMATE:
+                    edit_error = decimate_model(&m);
+                    break;
+
+                case LOD:
+                    lod_model(&m);
+                    break;
+
+                case WELD:
+                    edit_error = weld_model(&m);
+                    break;
+
+                case CLEANUP:
+                    edit_error = cleanup_model(&m);
+                    break;
+
+                case ORIENT:
+                    edit_error = orient_model(&m);
+                    break;
+
+                case REORDER:
+                    edit_error = reorder_model(&m);
+                    break;
+
+                case VCACHE:
+                    edit_error = vcache_model(&m);
                     break;
 
                 case COL_FLAT:
                 case COL_GRAD:
                 case COL_DIST:
                 case COL_RAND:
+                case COL_MULTI:
+                case COL_GEO:
+                case COL_FIELD:
+                case COL_COMP:
+                case COL_DEV:
                     /* apply the desired coloration (asking user for details) */
-                    color_error = color_model(m, action);
+                    color_error = color_model(&m, action);
                     break;
             }
         } while (action != SAVE && action != ANOTHER);
@@ -179,7 +232,7 @@ int main(int argc, char *argv[])
         if (action == ANOTHER) /* pick another model */
         {
             fclose(m.file_model);
-            clear_model(m); /* cleanup */
+            clear_model(&m); /* cleanup */
             continue; /* ask another file to import */
         }
     
@@ -215,14 +268,14 @@ int main(int argc, char *argv[])
         } while (out_file == NULL);
     
         /* save model in the output file */
-        save_model(out_file, m);
+        save_model(out_file, &m);
     
         /* close files */
         fclose(out_file);
         fclose(m.file_model);
     
         /* resource cleanup */
-        clear_model(m);
+        clear_model(&m);
 
         /* ask for exit */
         flag = ask_exit();
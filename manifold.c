@@ -0,0 +1,364 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) Martino Pilia, 2015
+ */
+
+
+/*!
+ * \file manifold.c
+ */
+
+#include <stdlib.h>
+
+#include "manifold.h"
+#include "profile.h"
+#include "reorder.h"
+
+/*!
+ * Check if a half-edge goes from its smaller end point to the larger one.
+ */
+static int forward(const Model3D *m, Index h)
+{
+    return face_vertex(m, h / 3, h % 3)
+        < face_vertex(m, h / 3, (h % 3 + 1) % 3);
+}
+
+/*!
+ * Check if a half-edge joins a vertex with itself.
+ */
+static int degenerate(const Model3D *m, Index h)
+{
+    return face_vertex(m, h / 3, h % 3)
+        == face_vertex(m, h / 3, (h % 3 + 1) % 3);
+}
+
+/*!
+ * Compute the signed volume of the tetrahedron joining a face to the
+ * origin.
+ */
+static double signed_volume(const Model3D *m, Index f)
+{
+    Point3D a = m->vertices_array[face_vertex(m, f, 0)]->vertexCoordinates;
+    Point3D b = m->vertices_array[face_vertex(m, f, 1)]->vertexCoordinates;
+    Point3D c = m->vertices_array[face_vertex(m, f, 2)]->vertexCoordinates;
+
+    return (  (double) a.x * ((double) b.y * c.z - (double) b.z * c.y)
+            + (double) a.y * ((double) b.z * c.x - (double) b.x * c.z)
+            + (double) a.z * ((double) b.x * c.y - (double) b.y * c.x))
+        / 6.0;
+}
+
+/*!
+ * Get the end points of a half-edge, the smaller one first.
+ */
+static void edge_ends(const Model3D *m, Index h, Index *lo, Index *hi)
+{
+    Index a = face_vertex(m, h / 3, h % 3);
+    Index b = face_vertex(m, h / 3, (h % 3 + 1) % 3);
+
+    *lo = a < b ? a : b;
+    *hi = a < b ? b : a;
+}
+
+/*!
+ * Sort the half-edges by edge when the two end points do not fit in a
+ * single key, with a stable pass on the larger end point followed by a
+ * stable pass on the smaller one. The keys are then replaced by the rank
+ * of the edge, so that the half-edges of each edge still form a run of
+ * equal keys.
+ */
+static int sort_edge_pairs(Model3D *m, uint64_t *k, Index *e, int bits)
+{
+    Index H = 3 * m->n_faces, h, lo, hi, prev_lo = 0, prev_hi = 0;
+    uint64_t rank = 0;
+
+    #pragma omp parallel for schedule(static) private(lo, hi)
+    for (h = 0; h < H; ++h)
+    {
+        edge_ends(m, h, &lo, &hi);
+        k[h] = (uint64_t) hi;
+        e[h] = h;
+    }
+
+    if (radix_sort(k, e, H, bits) != 0)
+        return ERR_NO_MEMORY;
+
+    #pragma omp parallel for schedule(static) private(lo, hi)
+    for (h = 0; h < H; ++h)
+    {
+        edge_ends(m, e[h], &lo, &hi);
+        k[h] = (uint64_t) lo;
+    }
+
+    if (radix_sort(k, e, H, bits) != 0)
+        return ERR_NO_MEMORY;
+
+    for (h = 0; h < H; ++h)
+    {
+        edge_ends(m, e[h], &lo, &hi);
+        if (h > 0 && (lo != prev_lo || hi != prev_hi))
+            ++rank;
+        k[h] = rank;
+        prev_lo = lo;
+        prev_hi = hi;
+    }
+
+    return 0;
+}
+
+/*!
+ * Sort the half-edges of the model by edge. The key of a half-edge has the
+ * smaller end point in the high bits and the larger one in the low bits,
+ * so the half-edges of each edge end up in a run of equal keys. With 2^32
+ * vertices or more the two end points do not fit in 64 bits, and the
+ * half-edges are sorted by pairs of end points instead. On success the
+ * caller owns and frees the sorted keys and half-edges.
+ */
+static int sort_edges(Model3D *m, uint64_t **keys, Index **half)
+{
+    Index H = 3 * m->n_faces, h, a, b;
+    uint64_t *k;
+    Index *e;
+    int bits, status;
+
+    if (model_build_indices(m) != 0)
+        return ERR_NO_MEMORY;
+
+    for (bits = 0; ((Index) 1 << bits) < m->n_vertices; ++bits)
+        ;
+
+    k = (uint64_t*) malloc((H + 1) * sizeof (uint64_t));
+    e = (Index*) malloc((H + 1) * sizeof (Index));
+    if (k == NULL || e == NULL)
+    {
+        free(k);
+        free(e);
+        return ERR_NO_MEMORY;
+    }
+
+    if (2 * bits > 64)
+        status = sort_edge_pairs(m, k, e, bits);
+    else
+    {
+        #pragma omp parallel for schedule(static) private(a, b)
+        for (h = 0; h < H; ++h)
+        {
+            edge_ends(m, h, &a, &b);
+            k[h] = (uint64_t) a << bits | (uint64_t) b;
+            e[h] = h;
+        }
+
+        status = radix_sort(k, e, H, 2 * bits);
+    }
+
+    if (status != 0)
+    {
+        free(k);
+        free(e);
+        return ERR_NO_MEMORY;
+    }
+
+    *keys = k;
+    *half = e;
+
+    return 0;
+}
+
+/*!
+ * Sort the half-edges, then classify each run of equal keys by its length
+ * and, for the runs of two, by the directions of the half-edges.
+ */
+int check_surface(Model3D *m, SurfaceCheck *c)
+{
+    uint64_t *keys;
+    Index *half;
+    Index H = 3 * m->n_faces, i, j;
+    Index edges = 0, boundary = 0, non_manifold = 0, misoriented = 0;
+    double start = profile_clock();
+
+    if (sort_edges(m, &keys, &half) != 0)
+        return ERR_NO_MEMORY;
+
+    #pragma omp parallel for schedule(static) private(j) \
+        reduction(+: edges, boundary, non_manifold, misoriented)
+    for (i = 0; i < H; ++i)
+    {
+        if ((i > 0 && keys[i] == keys[i - 1]) || degenerate(m, half[i]))
+            continue;
+
+        for (j = i + 1; j < H && keys[j] == keys[i]; ++j)
+            ;
+
+        ++edges;
+        if (j - i == 1)
+            ++boundary;
+        else if (j - i > 2)
+            ++non_manifold;
+        else if (forward(m, half[i]) == forward(m, half[i + 1]))
+            ++misoriented;
+    }
+
+    free(keys);
+    free(half);
+
+    c->edges = edges;
+    c->boundary = boundary;
+    c->non_manifold = non_manifold;
+    c->misoriented = misoriented;
+
+    profile_record(PROF_CHECK, start, m->n_vertices, m->n_faces);
+
+    return 0;
+}
+
+/*!
+ * Pair the half-edges of the manifold edges, propagate the orientation of
+ * the first face of each patch with a breadth-first visit, turn the closed
+ * patches outwards, and finally swap two vertices of the flipped faces.
+ */
+int orient_faces(Model3D *m, Index *flipped)
+{
+    uint64_t *keys;
+    Index *half, *pair, *queue;
+    signed char *flip, want;
+    Face *face;
+    Vertex *p;
+    Index H = 3 * m->n_faces, F = m->n_faces;
+    Index i, f, g, h, s, head, tail = 0, begin, t, n = 0;
+    double volume;
+    double start = profile_clock();
+    int k, closed, status = 0;
+
+    if (sort_edges(m, &keys, &half) != 0)
+        return ERR_NO_MEMORY;
+
+    pair = (Index*) malloc((H + 1) * sizeof (Index));
+    queue = (Index*) malloc((F + 1) * sizeof (Index));
+    flip = (signed char*) malloc(F + 1);
+    if (pair == NULL || queue == NULL || flip == NULL)
+    {
+        free(keys);
+        free(half);
+        free(pair);
+        free(queue);
+        free(flip);
+        return ERR_NO_MEMORY;
+    }
+
+    #pragma omp parallel for schedule(static)
+    for (h = 0; h < H; ++h)
+        pair[h] = -1;
+
+    #pragma omp parallel for schedule(static)
+    for (f = 0; f < F; ++f)
+        flip[f] = -1;
+
+    /* pair the half-edges of the edges used by exactly two faces */
+    #pragma omp parallel for schedule(static)
+    for (i = 0; i < H; ++i)
+    {
+        if ((i > 0 && keys[i] == keys[i - 1])
+                || i + 1 >= H || keys[i + 1] != keys[i]
+                || (i + 2 < H && keys[i + 2] == keys[i])
+                || degenerate(m, half[i]))
+            continue;
+        pair[half[i]] = half[i + 1];
+        pair[half[i + 1]] = half[i];
+    }
+
+    free(keys);
+    free(half);
+
+    for (s = 0; s < F; ++s)
+    {
+        if (flip[s] != -1)
+            continue;
+
+        /* visit the patch of face s, which keeps its orientation */
+        begin = head = tail;
+        flip[s] = 0;
+        queue[tail++] = s;
+        closed = 1;
+
+        while (head < tail)
+        {
+            f = queue[head++];
+            for (k = 0; k < 3; ++k)
+            {
+                h = 3 * f + k;
+                if (pair[h] == -1)
+                {
+                    if (!degenerate(m, h))
+                        closed = 0;
+                    continue;
+                }
+
+                /* a shared edge traversed in the same direction by the two
+                 * faces needs exactly one of them flipped */
+                g = pair[h] / 3;
+                want = flip[f] ^ (forward(m, h) == forward(m, pair[h]));
+                if (flip[g] == -1)
+                {
+                    flip[g] = want;
+                    queue[tail++] = g;
+                }
+                else if (flip[g] != want)
+                    status = -1;
+            }
+        }
+
+        if (!closed)
+            continue;
+
+        volume = 0.0;
+        for (t = begin; t < tail; ++t)
+            volume += flip[queue[t]]
+                ? -signed_volume(m, queue[t])
+                : signed_volume(m, queue[t]);
+
+        if (volume < 0)
+            for (t = begin; t < tail; ++t)
+                flip[queue[t]] = !flip[queue[t]];
+    }
+
+    /* faces are indexed in list order */
+    for (face = m->faces_list, f = 0; face != NULL; face = face->next, ++f)
+    {
+        if (!flip[f])
+            continue;
+
+        t = face->v2;
+        face->v2 = face->v3;
+        face->v3 = t;
+        p = face->v2p;
+        face->v2p = face->v3p;
+        face->v3p = p;
+        ++n;
+    }
+
+    if (n > 0)
+        model_topology_changed(m);
+
+    if (flipped != NULL)
+        *flipped = n;
+
+    free(pair);
+    free(queue);
+    free(flip);
+
+    profile_record(PROF_ORIENT, start, m->n_vertices, m->n_faces);
+
+    return status;
+}
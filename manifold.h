@@ -0,0 +1,77 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) Martino Pilia, 2015
+ */
+
+
+/*!
+ * \file manifold.h
+ */
+
+#ifndef MANIFOLD_H
+#define MANIFOLD_H
+
+#include "backend.h"
+
+/*! Define a type for the result of a surface check. */
+typedef struct SurfaceCheck SurfaceCheck;
+
+/*!
+ * Type holding the edge counts of a surface check. The surface is closed
+ * and consistently oriented, so that its volume is meaningful, if and only
+ * if there are no boundary, non-manifold or misoriented edges.
+ */
+struct SurfaceCheck
+{
+    Index edges;        /*!< Number of distinct edges. */
+    Index boundary;     /*!< Edges used by a single face. */
+    Index non_manifold; /*!< Edges used by more than two faces. */
+    Index misoriented;  /*!< Edges shared by two faces which traverse them
+                             in the same direction. */
+};
+
+/*!
+ * \brief Count the boundary, non-manifold and misoriented edges of a model.
+ *
+ * Each half-edge gets the key (min, max) of its end points, the keys are
+ * sorted with a parallel radix sort, and the runs of equal keys give the
+ * uses of each edge. Edges between a vertex and itself, belonging to
+ * degenerate faces, are ignored.
+ * @param m Model.
+ * @param c Structure to be filled.
+ * @return Zero on success, ERR_NO_MEMORY if an allocation failed.
+ * @note With 2^32 vertices or more the end points do not fit in a single
+ * key, and the half-edges are sorted in two passes instead.
+ */
+int check_surface(Model3D *m, SurfaceCheck *c);
+
+/*!
+ * \brief Flip faces of the model to make the winding consistent.
+ *
+ * Faces are visited breadth-first across the manifold edges, starting from
+ * the first face of each connected patch, and each face is flipped if it
+ * traverses a shared edge in the same direction as its neighbour. Then each
+ * closed patch with negative volume is flipped as a whole, so that its
+ * faces point outwards.
+ * @param m Model to be oriented.
+ * @param flipped If not NULL, filled with the number of faces flipped.
+ * @return Zero on success, -1 if some patch cannot be oriented (e.g. a
+ * Moebius strip), in which case its faces are oriented as far as possible,
+ * ERR_NO_MEMORY if an allocation failed.
+ * @note The vertex normals are not changed.
+ */
+int orient_faces(Model3D *m, Index *flipped);
+
+#endif // MANIFOLD_H
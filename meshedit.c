@@ -0,0 +1,886 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) Martino Pilia, 2015
+ */
+
+/*!
+ * \file meshedit.c
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "align.h"
+#include "backend.h"
+#include "bvh.h"
+#include "cleanup.h"
+#include "components.h"
+#include "decimate.h"
+#include "deviation.h"
+#include "fields.h"
+#include "geodesic.h"
+#include "hull.h"
+#include "manifold.h"
+#include "normals.h"
+#include "quality.h"
+#include "reorder.h"
+#include "smooth.h"
+#include "subdivide.h"
+#include "vcache.h"
+#include "weld.h"
+#include "meshedit.h"
+
+/*!
+ * Check if a color has valid components, and convert it into a ColorRGB.
+ */
+static int make_color(ColorRGB *c, const int rgb[3])
+{
+    int i;
+
+    if (rgb == NULL)
+        return 1;
+
+    for (i = 0; i < 3; ++i)
+        if (rgb[i] < 0 || rgb[i] > 255)
+            return 1;
+
+    c->r = rgb[0];
+    c->g = rgb[1];
+    c->b = rgb[2];
+    return 0;
+}
+
+/*!
+ * Allocate a model, parse the file and compute the model info. The input
+ * file is closed before returning, so the handle does not hold any system
+ * resource other than memory.
+ */
+int meshedit_load(const char *path, MeshEditModel **model)
+{
+    Model3D *m;
+    int status;
+
+    if (path == NULL || model == NULL)
+        return MESHEDIT_ERR_INVALID_ARGUMENT;
+
+    *model = NULL;
+
+    m = (Model3D*) malloc(sizeof (Model3D));
+    if (m == NULL)
+        return MESHEDIT_ERR_NO_MEMORY;
+
+    init_model(m);
+    strncpy(m->filename, path, STR_LEN);
+    m->filename[STR_LEN] = '\0';
+
+    m->file_model = fopen(path, "r");
+    if (m->file_model == NULL)
+    {
+        free(m);
+        return MESHEDIT_ERR_IO;
+    }
+
+    /* parser error values match the MeshEditError ones */
+    status = parse_model_data(m);
+    fclose(m->file_model);
+    m->file_model = NULL;
+
+    if (status != 0)
+    {
+        clear_model(m);
+        free(m);
+        return status;
+    }
+
+    model_info(m);
+
+    *model = m;
+    return MESHEDIT_OK;
+}
+
+/*!
+ * Release the model lists and the handle itself.
+ */
+void meshedit_free(MeshEditModel *model)
+{
+    if (model == NULL)
+        return;
+
+    clear_model(model);
+    free(model);
+}
+
+/*!
+ * Open the output file and write the model on it.
+ */
+int meshedit_save(MeshEditModel *model, const char *path)
+{
+    FILE *f;
+    int status;
+
+    if (model == NULL || path == NULL)
+        return MESHEDIT_ERR_INVALID_ARGUMENT;
+
+    f = fopen(path, "w");
+    if (f == NULL)
+        return MESHEDIT_ERR_IO;
+
+    status = save_model(f, model);
+
+    if (fclose(f) != 0)
+        return MESHEDIT_ERR_IO;
+    if (status == ERR_INVALID_ARGUMENT)
+        return MESHEDIT_ERR_INVALID_ARGUMENT;
+    if (status != 0)
+        return MESHEDIT_ERR_IO;
+
+    return MESHEDIT_OK;
+}
+
+/*!
+ * Copy the relevant fields of the model Info structure.
+ */
+int meshedit_info(MeshEditModel *model, MeshEditInfo *info)
+{
+    if (model == NULL || info == NULL || model->info.min_x == NULL)
+        return MESHEDIT_ERR_INVALID_ARGUMENT;
+
+    info->n_vertices = model->n_vertices;
+    info->n_faces = model->n_faces;
+    info->surface = model->info.tot_surface;
+    info->volume = model->info.volume;
+    info->min[0] = model->info.min_x->vertexCoordinates.x;
+    info->min[1] = model->info.min_y->vertexCoordinates.y;
+    info->min[2] = model->info.min_z->vertexCoordinates.z;
+    info->max[0] = model->info.max_x->vertexCoordinates.x;
+    info->max[1] = model->info.max_y->vertexCoordinates.y;
+    info->max[2] = model->info.max_z->vertexCoordinates.z;
+
+    return MESHEDIT_OK;
+}
+
+/*!
+ * Validate the color and apply the flat coloration.
+ */
+int meshedit_color_flat(MeshEditModel *model, const int rgb[3])
+{
+    ColorRGB c;
+
+    if (model == NULL || make_color(&c, rgb))
+        return MESHEDIT_ERR_INVALID_ARGUMENT;
+
+    return color_flat(model, c) ? MESHEDIT_ERR_UNDEFINED : MESHEDIT_OK;
+}
+
+/*!
+ * Seed the model generator and apply the random coloration.
+ */
+int meshedit_color_random(MeshEditModel *model, unsigned int seed)
+{
+    if (model == NULL)
+        return MESHEDIT_ERR_INVALID_ARGUMENT;
+
+    model->seed = seed;
+
+    return color_random(model) ? MESHEDIT_ERR_UNDEFINED : MESHEDIT_OK;
+}
+
+/*!
+ * Validate the parameters and apply the distance-based coloration.
+ */
+int meshedit_color_distance(MeshEditModel *model, const int rgb[3],
+        const float point[3])
+{
+    ColorRGB c;
+    Point3D p;
+    int status;
+
+    if (model == NULL || point == NULL || make_color(&c, rgb))
+        return MESHEDIT_ERR_INVALID_ARGUMENT;
+
+    p.x = point[0];
+    p.y = point[1];
+    p.z = point[2];
+
+    status = color_distance(model, c, p);
+    if (status > 0)
+        return status; /* backend error values match the MeshEditError ones */
+
+    return status ? MESHEDIT_ERR_UNDEFINED : MESHEDIT_OK;
+}
+
+/*!
+ * Validate the parameters, convert the points and apply the multi-point
+ * distance coloration.
+ */
+int meshedit_color_distance_multi(MeshEditModel *model, const int rgb[3],
+        const float *points, long long n)
+{
+    ColorRGB c;
+    Point3D *p;
+    Index i;
+    int status;
+
+    if (model == NULL || points == NULL || n <= 0 || make_color(&c, rgb))
+        return MESHEDIT_ERR_INVALID_ARGUMENT;
+
+    p = (Point3D*) malloc(n * sizeof (Point3D));
+    if (p == NULL)
+        return MESHEDIT_ERR_NO_MEMORY;
+
+    for (i = 0; i < n; ++i)
+    {
+        p[i].x = points[3 * i];
+        p[i].y = points[3 * i + 1];
+        p[i].z = points[3 * i + 2];
+    }
+
+    status = color_distance_multi(model, c, p, n);
+    free(p);
+
+    if (status > 0)
+        return status;
+
+    return status ? MESHEDIT_ERR_UNDEFINED : MESHEDIT_OK;
+}
+
+/*!
+ * Validate the parameters and apply the geodesic distance coloration.
+ */
+int meshedit_color_geodesic(MeshEditModel *model, const int rgb[3],
+        long long source)
+{
+    ColorRGB c;
+    int status;
+
+    if (model == NULL || make_color(&c, rgb))
+        return MESHEDIT_ERR_INVALID_ARGUMENT;
+
+    status = color_geodesic(model, c, source);
+    if (status > 0)
+        return status;
+
+    return status ? MESHEDIT_ERR_UNDEFINED : MESHEDIT_OK;
+}
+
+/*!
+ * Validate the parameters and apply the field coloration.
+ */
+int meshedit_color_field(MeshEditModel *model, const int rgb[3],
+        MeshEditField field)
+{
+    ColorRGB c;
+    int status;
+
+    if (model == NULL || make_color(&c, rgb)
+            || field < MESHEDIT_MEAN_CURVATURE || field > MESHEDIT_OCCLUSION)
+        return MESHEDIT_ERR_INVALID_ARGUMENT;
+
+    status = color_field(model, c, (Field) field);
+    if (status > 0)
+        return status;
+
+    return status ? MESHEDIT_ERR_UNDEFINED : MESHEDIT_OK;
+}
+
+/*!
+ * Seed the model generator and apply the components coloration.
+ */
+int meshedit_color_components(MeshEditModel *model, unsigned int seed)
+{
+    if (model == NULL)
+        return MESHEDIT_ERR_INVALID_ARGUMENT;
+
+    model->seed = seed;
+
+    return color_components(model);
+}
+
+/*!
+ * Validate the parameters and apply the deviation coloration.
+ */
+int meshedit_color_deviation(MeshEditModel *model, const int rgb[3],
+        MeshEditModel *reference)
+{
+    ColorRGB c;
+    int status;
+
+    if (model == NULL || reference == NULL || make_color(&c, rgb))
+        return MESHEDIT_ERR_INVALID_ARGUMENT;
+
+    status = color_deviation(model, c, reference, NULL);
+    if (status > 0)
+        return status;
+
+    return status ? MESHEDIT_ERR_UNDEFINED : MESHEDIT_OK;
+}
+
+/*!
+ * Validate the parameters and compute the distances.
+ */
+int meshedit_surface_distances(MeshEditModel *model,
+        MeshEditModel *reference, double *distances)
+{
+    if (model == NULL || reference == NULL || distances == NULL)
+        return MESHEDIT_ERR_INVALID_ARGUMENT;
+
+    return surface_distances(model, reference, distances);
+}
+
+/*!
+ * Validate the parameters and apply the gradient coloration.
+ */
+int meshedit_color_gradient(MeshEditModel *model, const int rgb[3],
+        MeshEditDirection direction)
+{
+    ColorRGB c;
+    int status;
+
+    if (model == NULL || make_color(&c, rgb)
+            || direction < MESHEDIT_RL || direction > MESHEDIT_FB)
+        return MESHEDIT_ERR_INVALID_ARGUMENT;
+
+    status = color_gradient(model, c, (Direction) direction);
+    if (status > 0)
+        return status;
+
+    return status ? MESHEDIT_ERR_UNDEFINED : MESHEDIT_OK;
+}
+
+/*!
+ * Validate the axis, rotate the model and update the extreme vertices.
+ */
+int meshedit_rotate(MeshEditModel *model, const float origin[3],
+        const float axis[3], float angle)
+{
+    Point3D o;
+    Vector3D u;
+
+    if (model == NULL || origin == NULL || axis == NULL
+            || (fabs(axis[0]) < NUM_TOL
+                && fabs(axis[1]) < NUM_TOL
+                && fabs(axis[2]) < NUM_TOL))
+        return MESHEDIT_ERR_INVALID_ARGUMENT;
+
+    o.x = origin[0];
+    o.y = origin[1];
+    o.z = origin[2];
+    u.x = axis[0];
+    u.y = axis[1];
+    u.z = axis[2];
+
+    if (rotation(model, o, u, angle))
+        return MESHEDIT_ERR_UNDEFINED;
+
+    rescan_vertices_info(model);
+
+    return MESHEDIT_OK;
+}
+
+/*!
+ * Align the model and copy the frame.
+ */
+int meshedit_align(MeshEditModel *model, float center[3], float axes[3][3])
+{
+    Point3D c;
+    Vector3D a[3];
+    int i, status;
+
+    if (model == NULL)
+        return MESHEDIT_ERR_INVALID_ARGUMENT;
+
+    status = align_principal_axes(model, &c, a);
+    if (status > 0)
+        return status;
+    if (status)
+        return MESHEDIT_ERR_UNDEFINED;
+
+    if (center != NULL)
+    {
+        center[0] = c.x;
+        center[1] = c.y;
+        center[2] = c.z;
+    }
+    if (axes != NULL)
+        for (i = 0; i < 3; ++i)
+        {
+            axes[i][0] = a[i].x;
+            axes[i][1] = a[i].y;
+            axes[i][2] = a[i].z;
+        }
+
+    return MESHEDIT_OK;
+}
+
+/*!
+ * Recompute the vertex normals.
+ */
+int meshedit_compute_normals(MeshEditModel *model)
+{
+    if (model == NULL)
+        return MESHEDIT_ERR_INVALID_ARGUMENT;
+
+    return compute_normals(model);
+}
+
+/*!
+ * Smooth the model surface.
+ */
+int meshedit_smooth(MeshEditModel *model, int iterations, double lambda,
+        double mu)
+{
+    if (model == NULL)
+        return MESHEDIT_ERR_INVALID_ARGUMENT;
+
+    return smooth_mesh(model, iterations, lambda, mu);
+}
+
+/*!
+ * Validate the scheme and refine the model.
+ */
+int meshedit_subdivide(MeshEditModel *model, int levels,
+        MeshEditSubdivision scheme)
+{
+    if (model == NULL || scheme < MESHEDIT_MIDPOINT || scheme > MESHEDIT_LOOP)
+        return MESHEDIT_ERR_INVALID_ARGUMENT;
+
+    return subdivide_mesh(model, levels, (Subdivision) scheme);
+}
+
+/*!
+ * Validate the target and run the edge-collapse simplification.
+ */
+int meshedit_decimate(MeshEditModel *model, long long target_faces,
+        double max_error)
+{
+    if (model == NULL || target_faces <= 0)
+        return MESHEDIT_ERR_INVALID_ARGUMENT;
+
+    return decimate(model, target_faces, max_error);
+}
+
+/*!
+ * Open all the files, then compute and write the levels.
+ */
+int meshedit_save_lod(MeshEditModel *model, const long long *targets,
+        const char *const *paths, int n_levels)
+{
+    FILE **files;
+    int i, opened, status = MESHEDIT_OK;
+
+    if (model == NULL || targets == NULL || paths == NULL || n_levels <= 0)
+        return MESHEDIT_ERR_INVALID_ARGUMENT;
+
+    files = (FILE**) malloc(n_levels * sizeof (FILE*));
+    if (files == NULL)
+        return MESHEDIT_ERR_NO_MEMORY;
+
+    for (opened = 0; opened < n_levels; ++opened)
+    {
+        files[opened] = fopen(paths[opened], "w");
+        if (files[opened] == NULL)
+        {
+            status = MESHEDIT_ERR_IO;
+            break;
+        }
+    }
+
+    if (status == MESHEDIT_OK)
+        status = decimate_lod(model, targets, files, n_levels);
+
+    for (i = 0; i < opened; ++i)
+        if (fclose(files[i]) != 0 && status == MESHEDIT_OK)
+            status = MESHEDIT_ERR_IO;
+    free(files);
+
+    return status;
+}
+
+/*!
+ * Validate the arguments and merge the vertices.
+ */
+int meshedit_weld(MeshEditModel *model, double tolerance, long long *merged)
+{
+    Index n;
+    int status;
+
+    if (model == NULL || tolerance < 0)
+        return MESHEDIT_ERR_INVALID_ARGUMENT;
+
+    status = weld_vertices(model, tolerance, &n);
+    if (status == 0 && merged != NULL)
+        *merged = n;
+
+    return status;
+}
+
+/*!
+ * Validate the thresholds and clean the model.
+ */
+int meshedit_cleanup(MeshEditModel *model, double min_area,
+        long long min_faces, long long *removed_faces,
+        long long *removed_vertices)
+{
+    Index faces, vertices;
+    int status;
+
+    if (model == NULL || min_area < 0 || min_faces < 0)
+        return MESHEDIT_ERR_INVALID_ARGUMENT;
+
+    status = cleanup_mesh(model, min_area, min_faces, &faces, &vertices);
+    if (status < 0)
+        return MESHEDIT_ERR_UNDEFINED;
+
+    if (status == 0 && removed_faces != NULL)
+        *removed_faces = faces;
+    if (status == 0 && removed_vertices != NULL)
+        *removed_vertices = vertices;
+
+    return status;
+}
+
+/*!
+ * Check the surface and copy the counts.
+ */
+int meshedit_check_surface(MeshEditModel *model,
+        MeshEditSurfaceCheck *check)
+{
+    SurfaceCheck c;
+    int status;
+
+    if (model == NULL || check == NULL)
+        return MESHEDIT_ERR_INVALID_ARGUMENT;
+
+    status = check_surface(model, &c);
+    if (status)
+        return status;
+
+    check->edges = c.edges;
+    check->boundary = c.boundary;
+    check->non_manifold = c.non_manifold;
+    check->misoriented = c.misoriented;
+
+    return MESHEDIT_OK;
+}
+
+/*!
+ * Copy the summary of a sketch.
+ */
+static void copy_distribution(MeshEditDistribution *d, const Sketch *s)
+{
+    d->min = s->count > 0 ? s->min : 0;
+    d->p1 = sketch_quantile(s, 0.01);
+    d->p50 = sketch_quantile(s, 0.5);
+    d->p99 = sketch_quantile(s, 0.99);
+    d->max = s->max;
+    d->mean = s->count > 0 ? s->sum / s->count : 0;
+}
+
+/*!
+ * Compute the distributions and copy their summary.
+ */
+int meshedit_quality(MeshEditModel *model, MeshEditDistribution *area,
+        MeshEditDistribution *edge)
+{
+    Quality *q;
+    int status;
+
+    if (model == NULL)
+        return MESHEDIT_ERR_INVALID_ARGUMENT;
+
+    /* the sketches are too large for the stack of a worker thread */
+    q = (Quality*) malloc(sizeof (Quality));
+    if (q == NULL)
+        return MESHEDIT_ERR_NO_MEMORY;
+
+    status = model_quality(model, q);
+    if (status == 0)
+    {
+        if (area != NULL)
+            copy_distribution(area, &q->area);
+        if (edge != NULL)
+            copy_distribution(edge, &q->edge);
+    }
+
+    free(q);
+
+    return status;
+}
+
+/*!
+ * Compute the hull and the box, and copy their summary.
+ */
+int meshedit_convex_hull(MeshEditModel *model, MeshEditHull *hull)
+{
+    ConvexHull h;
+    OrientedBox b;
+    int i, status;
+
+    if (model == NULL || hull == NULL)
+        return MESHEDIT_ERR_INVALID_ARGUMENT;
+
+    status = convex_hull(model, &h);
+    if (status > 0)
+        return status;
+    if (status)
+        return MESHEDIT_ERR_UNDEFINED;
+
+    status = oriented_box(model, &h, &b);
+    if (status == 0)
+    {
+        hull->n_vertices = h.n_vertices;
+        hull->n_faces = h.n_faces;
+        hull->surface = h.surface;
+        hull->volume = h.volume;
+        hull->center[0] = b.center.x;
+        hull->center[1] = b.center.y;
+        hull->center[2] = b.center.z;
+        for (i = 0; i < 3; ++i)
+        {
+            hull->axes[i][0] = b.axes[i].x;
+            hull->axes[i][1] = b.axes[i].y;
+            hull->axes[i][2] = b.axes[i].z;
+            hull->extents[i] = b.extents[i];
+        }
+        hull->box_volume = b.volume;
+    }
+
+    hull_free(&h);
+
+    return status;
+}
+
+/*!
+ * Orient the faces of the model.
+ */
+int meshedit_orient(MeshEditModel *model, long long *flipped)
+{
+    Index n = 0;
+    int status;
+
+    if (model == NULL)
+        return MESHEDIT_ERR_INVALID_ARGUMENT;
+
+    status = orient_faces(model, &n);
+    if (status > 0)
+        return status;
+
+    if (flipped != NULL)
+        *flipped = n;
+
+    return status ? MESHEDIT_ERR_UNDEFINED : MESHEDIT_OK;
+}
+
+/*!
+ * Reorder the model along a space filling curve.
+ */
+int meshedit_reorder(MeshEditModel *model)
+{
+    if (model == NULL)
+        return MESHEDIT_ERR_INVALID_ARGUMENT;
+
+    return spatial_reorder(model);
+}
+
+/*!
+ * Validate the cache size and reorder the model for it.
+ */
+int meshedit_optimize_vertex_cache(MeshEditModel *model, int cache_size)
+{
+    if (model == NULL || cache_size <= 0)
+        return MESHEDIT_ERR_INVALID_ARGUMENT;
+
+    return optimize_vertex_cache(model, cache_size);
+}
+
+/*!
+ * Label the components and copy the requested part of the result.
+ */
+int meshedit_components(MeshEditModel *model, long long *labels,
+        MeshEditComponent *parts, long long max_parts, long long *n_parts)
+{
+    Components c;
+    Index i;
+    int status;
+
+    if (model == NULL || (parts != NULL && max_parts < 0))
+        return MESHEDIT_ERR_INVALID_ARGUMENT;
+
+    status = model_components(model, &c);
+    if (status)
+        return status;
+
+    if (labels != NULL)
+        memcpy(labels, c.label, model->n_vertices * sizeof (Index));
+
+    for (i = 0; parts != NULL && i < c.n && i < max_parts; ++i)
+    {
+        parts[i].n_vertices = c.parts[i].n_vertices;
+        parts[i].n_faces = c.parts[i].n_faces;
+        parts[i].surface = c.parts[i].surface;
+        parts[i].volume = c.parts[i].volume;
+        parts[i].min[0] = c.parts[i].min.x;
+        parts[i].min[1] = c.parts[i].min.y;
+        parts[i].min[2] = c.parts[i].min.z;
+        parts[i].max[0] = c.parts[i].max.x;
+        parts[i].max[1] = c.parts[i].max.y;
+        parts[i].max[2] = c.parts[i].max.z;
+    }
+
+    if (n_parts != NULL)
+        *n_parts = c.n;
+
+    components_free(&c);
+
+    return MESHEDIT_OK;
+}
+
+/*!
+ * Allocate the handle and build the hierarchy in it.
+ */
+int meshedit_bvh_build(MeshEditModel *model, MeshEditBvh **bvh)
+{
+    Bvh *t;
+    int status;
+
+    if (model == NULL || bvh == NULL)
+        return MESHEDIT_ERR_INVALID_ARGUMENT;
+
+    *bvh = NULL;
+
+    t = (Bvh*) malloc(sizeof (Bvh));
+    if (t == NULL)
+        return MESHEDIT_ERR_NO_MEMORY;
+
+    status = bvh_build(t, model);
+    if (status != 0)
+    {
+        free(t);
+        return status;
+    }
+
+    *bvh = t;
+
+    return MESHEDIT_OK;
+}
+
+/*!
+ * Validate the ray and trace it.
+ */
+int meshedit_bvh_raycast(const MeshEditBvh *bvh, const float origin[3],
+        const float direction[3], float max_t, long long *face, float *t)
+{
+    Point3D o;
+    Vector3D d;
+    Index f;
+    float hit;
+
+    if (bvh == NULL || origin == NULL || direction == NULL || face == NULL
+            || !(max_t >= 0))
+        return MESHEDIT_ERR_INVALID_ARGUMENT;
+
+    if (direction[0] == 0 && direction[1] == 0 && direction[2] == 0)
+        return MESHEDIT_ERR_INVALID_ARGUMENT;
+
+    o.x = origin[0];
+    o.y = origin[1];
+    o.z = origin[2];
+    d.x = direction[0];
+    d.y = direction[1];
+    d.z = direction[2];
+
+    f = bvh_intersect(bvh, o, d, max_t, &hit);
+
+    *face = f;
+    if (f >= 0 && t != NULL)
+        *t = hit;
+
+    return MESHEDIT_OK;
+}
+
+/*!
+ * Validate the query and search the closest point.
+ */
+int meshedit_bvh_closest(const MeshEditBvh *bvh, const float point[3],
+        float max_dist, long long *face, float closest[3], float *dist)
+{
+    Point3D p, c;
+    Index f;
+    float d;
+
+    if (bvh == NULL || point == NULL || face == NULL || !(max_dist >= 0))
+        return MESHEDIT_ERR_INVALID_ARGUMENT;
+
+    p.x = point[0];
+    p.y = point[1];
+    p.z = point[2];
+
+    f = bvh_closest(bvh, p, max_dist, &c, &d);
+
+    *face = f;
+    if (f >= 0)
+    {
+        if (closest != NULL)
+        {
+            closest[0] = c.x;
+            closest[1] = c.y;
+            closest[2] = c.z;
+        }
+        if (dist != NULL)
+            *dist = d;
+    }
+
+    return MESHEDIT_OK;
+}
+
+/*!
+ * Free the hierarchy and its handle.
+ */
+void meshedit_bvh_free(MeshEditBvh *bvh)
+{
+    if (bvh == NULL)
+        return;
+
+    bvh_free(bvh);
+    free(bvh);
+}
+
+/*!
+ * Return a constant string for each error code.
+ */
+const char* meshedit_strerror(int error)
+{
+    switch (error)
+    {
+        case MESHEDIT_OK:
+            return "success";
+        case MESHEDIT_ERR_NO_DATA:
+            return "the file does not contain any vertex or face";
+        case MESHEDIT_ERR_INCOHERENT_DATA:
+            return "the file content does not match its header";
+        case MESHEDIT_ERR_NO_MEMORY:
+            return "out of memory";
+        case MESHEDIT_ERR_INVALID_ARGUMENT:
+            return "invalid argument";
+        case MESHEDIT_ERR_IO:
+            return "input/output error";
+        case MESHEDIT_ERR_UNDEFINED:
+            return "operation not defined for the model";
+        default:
+            return "unknown error";
+    }
+}
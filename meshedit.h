@@ -0,0 +1,556 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) Martino Pilia, 2015
+ */
+
+/*!
+ * \file meshedit.h
+ *
+ * Public interface of the libmeshedit library. Models are accessed through
+ * opaque handles, and every function returns an error code instead of
+ * terminating the program. Functions are re-entrant: different models may
+ * be processed concurrently from different threads, while a single model
+ * must not be used by more than one thread at a time.
+ */
+
+#ifndef MESHEDIT_H
+#define MESHEDIT_H
+
+/*! Opaque handle to a model loaded by the library. */
+typedef struct Model3D MeshEditModel;
+
+/*! Opaque handle to a spatial index over the faces of a model. */
+typedef struct Bvh MeshEditBvh;
+
+/*!
+ * Error codes returned by the library functions.
+ */
+typedef enum MeshEditError
+{
+    MESHEDIT_OK = 0,                   /*!< Success. */
+    MESHEDIT_ERR_NO_DATA = 1,          /*!< The file contains no model. */
+    MESHEDIT_ERR_INCOHERENT_DATA = 2,  /*!< The file content does not match
+                                            its header. */
+    MESHEDIT_ERR_NO_MEMORY = 3,        /*!< A memory allocation failed. */
+    MESHEDIT_ERR_INVALID_ARGUMENT = 4, /*!< A parameter is not valid. */
+    MESHEDIT_ERR_IO = 5,               /*!< A file cannot be opened, read or
+                                            written. */
+    MESHEDIT_ERR_UNDEFINED = 6         /*!< The operation is not defined for
+                                            the model (e.g. a gradient on a
+                                            model flat in that direction). */
+} MeshEditError;
+
+/*!
+ * Directions for meshedit_color_gradient().
+ */
+typedef enum MeshEditDirection
+{
+    MESHEDIT_RL = 1, /*!< From right to left. */
+    MESHEDIT_LR = 2, /*!< From left to right. */
+    MESHEDIT_TB = 3, /*!< From top to bottom. */
+    MESHEDIT_BT = 4, /*!< From bottom to top. */
+    MESHEDIT_BF = 5, /*!< From back to front. */
+    MESHEDIT_FB = 6  /*!< From front to back. */
+} MeshEditDirection;
+
+/*!
+ * Scalar fields for meshedit_color_field().
+ */
+typedef enum MeshEditField
+{
+    MESHEDIT_MEAN_CURVATURE = 1,     /*!< Discrete mean curvature. */
+    MESHEDIT_GAUSSIAN_CURVATURE = 2, /*!< Discrete Gaussian curvature. */
+    MESHEDIT_OCCLUSION = 3           /*!< Ambient occlusion. */
+} MeshEditField;
+
+/*!
+ * Subdivision schemes for meshedit_subdivide().
+ */
+typedef enum MeshEditSubdivision
+{
+    MESHEDIT_MIDPOINT = 1, /*!< Split the edges at their midpoint. */
+    MESHEDIT_LOOP = 2      /*!< Loop's approximating scheme. */
+} MeshEditSubdivision;
+
+/*!
+ * Summary information about a model.
+ */
+typedef struct MeshEditInfo
+{
+    long long n_vertices; /*!< Number of vertices. */
+    long long n_faces;    /*!< Number of faces. */
+    double surface;       /*!< Total surface. */
+    double volume;        /*!< Volume delimited by the model. */
+    float min[3];         /*!< Minimum corner of the bounding box. */
+    float max[3];         /*!< Maximum corner of the bounding box. */
+} MeshEditInfo;
+
+/*!
+ * Summary information about a connected component of a model.
+ */
+typedef struct MeshEditComponent
+{
+    long long n_vertices; /*!< Number of vertices. */
+    long long n_faces;    /*!< Number of faces. */
+    double surface;       /*!< Total surface. */
+    double volume;        /*!< Volume delimited by the component. */
+    float min[3];         /*!< Minimum corner of the bounding box. */
+    float max[3];         /*!< Maximum corner of the bounding box. */
+} MeshEditComponent;
+
+/*!
+ * Edge counts of a model, see meshedit_check_surface().
+ */
+typedef struct MeshEditSurfaceCheck
+{
+    long long edges;        /*!< Number of distinct edges. */
+    long long boundary;     /*!< Edges used by a single face. */
+    long long non_manifold; /*!< Edges used by more than two faces. */
+    long long misoriented;  /*!< Edges traversed in the same direction by
+                                 their two faces. */
+} MeshEditSurfaceCheck;
+
+/*!
+ * Summary of the distribution of a measure on a model, see
+ * meshedit_quality().
+ */
+typedef struct MeshEditDistribution
+{
+    double min;  /*!< Smallest value. */
+    double p1;   /*!< First percentile. */
+    double p50;  /*!< Median. */
+    double p99;  /*!< Ninety-ninth percentile. */
+    double max;  /*!< Largest value. */
+    double mean; /*!< Mean value. */
+} MeshEditDistribution;
+
+/*!
+ * Convex hull and oriented bounding box of a model, see
+ * meshedit_convex_hull().
+ */
+typedef struct MeshEditHull
+{
+    long long n_vertices; /*!< Number of vertices on the hull. */
+    long long n_faces;    /*!< Number of faces of the hull. */
+    double surface;       /*!< Area of the hull. */
+    double volume;        /*!< Volume of the hull. */
+    float center[3];      /*!< Centre of the box. */
+    float axes[3][3];     /*!< Unit axes of the box, in order of decreasing
+                               extent. */
+    double extents[3];    /*!< Length of the sides of the box. */
+    double box_volume;    /*!< Volume of the box. */
+} MeshEditHull;
+
+/*!
+ * \brief Load a model from a .ply file.
+ * @param path Name of the file.
+ * @param model Pointer filled with the handle of the new model.
+ * @return MESHEDIT_OK on success, an error code otherwise.
+ */
+int meshedit_load(const char *path, MeshEditModel **model);
+
+/*!
+ * \brief Release a model and all its resources.
+ * @param model Handle of the model, may be NULL.
+ */
+void meshedit_free(MeshEditModel *model);
+
+/*!
+ * \brief Save a model on a .ply file.
+ * @param model Handle of the model.
+ * @param path Name of the file.
+ * @return MESHEDIT_OK on success, MESHEDIT_ERR_INVALID_ARGUMENT if the
+ * model has too many vertices for the 32 bit indices of the PLY format,
+ * another error code otherwise.
+ */
+int meshedit_save(MeshEditModel *model, const char *path);
+
+/*!
+ * \brief Get summary information about a model.
+ * @param model Handle of the model.
+ * @param info Structure to be filled.
+ * @return MESHEDIT_OK on success, an error code otherwise.
+ */
+int meshedit_info(MeshEditModel *model, MeshEditInfo *info);
+
+/*!
+ * \brief Apply a flat coloration.
+ * @param model Handle of the model.
+ * @param rgb Color components in [0,255].
+ * @return MESHEDIT_OK on success, an error code otherwise.
+ */
+int meshedit_color_flat(MeshEditModel *model, const int rgb[3]);
+
+/*!
+ * \brief Apply a random coloration.
+ * @param model Handle of the model.
+ * @param seed Seed for the random sequence.
+ * @return MESHEDIT_OK on success, an error code otherwise.
+ */
+int meshedit_color_random(MeshEditModel *model, unsigned int seed);
+
+/*!
+ * \brief Apply a distance-based coloration.
+ * @param model Handle of the model.
+ * @param rgb Color of the nearest vertex, components in [0,255].
+ * @param point Reference point.
+ * @return MESHEDIT_OK on success, an error code otherwise.
+ */
+int meshedit_color_distance(MeshEditModel *model, const int rgb[3],
+        const float point[3]);
+
+/*!
+ * \brief Apply a coloration based on the distance from the nearest of a set
+ * of points.
+ * @param model Handle of the model.
+ * @param rgb Color of the nearest vertices, components in [0,255].
+ * @param points Reference points, as n consecutive (x, y, z) triples.
+ * @param n Number of reference points.
+ * @return MESHEDIT_OK on success, an error code otherwise.
+ */
+int meshedit_color_distance_multi(MeshEditModel *model, const int rgb[3],
+        const float *points, long long n);
+
+/*!
+ * \brief Apply a coloration based on the geodesic distance from a vertex,
+ * measured along the edges of the model.
+ * @param model Handle of the model.
+ * @param rgb Color of the source vertex, components in [0,255].
+ * @param source Index of the source vertex.
+ * @return MESHEDIT_OK on success, an error code otherwise.
+ */
+int meshedit_color_geodesic(MeshEditModel *model, const int rgb[3],
+        long long source);
+
+/*!
+ * \brief Apply a coloration based on a scalar field.
+ * @param model Handle of the model.
+ * @param rgb Color of the vertices with the lowest value, components in
+ * [0,255].
+ * @param field Field.
+ * @return MESHEDIT_OK on success, an error code otherwise.
+ */
+int meshedit_color_field(MeshEditModel *model, const int rgb[3],
+        MeshEditField field);
+
+/*!
+ * \brief Color each connected component with a random color.
+ * @param model Handle of the model.
+ * @param seed Seed for the random generator.
+ * @return MESHEDIT_OK on success, an error code otherwise.
+ */
+int meshedit_color_components(MeshEditModel *model, unsigned int seed);
+
+/*!
+ * \brief Apply a coloration based on the signed distance of each vertex
+ * from the surface of a reference model.
+ * @param model Handle of the model.
+ * @param rgb Color of the vertices deepest inside the reference, components
+ * in [0,255].
+ * @param reference Handle of the reference model, which is not modified.
+ * @return MESHEDIT_OK on success, an error code otherwise.
+ */
+int meshedit_color_deviation(MeshEditModel *model, const int rgb[3],
+        MeshEditModel *reference);
+
+/*!
+ * \brief Compute the signed distance of each vertex from the surface of a
+ * reference model.
+ * @param model Handle of the model.
+ * @param reference Handle of the reference model, which is not modified.
+ * @param distances Array of one element for each vertex, filled with its
+ * distance, positive outside the reference and negative inside (assuming
+ * the reference faces are oriented counterclockwise from outside).
+ * @return MESHEDIT_OK on success, an error code otherwise.
+ */
+int meshedit_surface_distances(MeshEditModel *model,
+        MeshEditModel *reference, double *distances);
+
+/*!
+ * \brief Apply a gradient coloration.
+ * @param model Handle of the model.
+ * @param rgb Starting color, components in [0,255].
+ * @param direction Direction of the gradient.
+ * @return MESHEDIT_OK on success, an error code otherwise.
+ */
+int meshedit_color_gradient(MeshEditModel *model, const int rgb[3],
+        MeshEditDirection direction);
+
+/*!
+ * \brief Rotate a model around an arbitrary axis.
+ * @param model Handle of the model.
+ * @param origin Point of the rotation axis.
+ * @param axis Direction of the rotation axis, not null.
+ * @param angle Rotation angle in radians.
+ * @return MESHEDIT_OK on success, an error code otherwise.
+ */
+int meshedit_rotate(MeshEditModel *model, const float origin[3],
+        const float axis[3], float angle);
+
+/*!
+ * \brief Rotate a model around its centroid, so that its principal axes,
+ * computed from the area weighted covariance of the surface, are aligned
+ * with the coordinate axes.
+ * @param model Handle of the model.
+ * @param center If not NULL, filled with the centroid of the surface.
+ * @param axes If not NULL, filled with the principal axes in order of
+ * decreasing variance (brought on x, y and z), as unit vectors in the
+ * coordinates before the rotation.
+ * @return MESHEDIT_OK on success, MESHEDIT_ERR_UNDEFINED if the model has
+ * no surface, an error code otherwise.
+ * @note Useful to normalize the orientation before an axis aligned
+ * coloration such as meshedit_color_gradient().
+ */
+int meshedit_align(MeshEditModel *model, float center[3], float axes[3][3]);
+
+/*!
+ * \brief Recompute the vertex normals from the faces, weighting each face
+ * by its area.
+ * @param model Handle of the model.
+ * @return MESHEDIT_OK on success, an error code otherwise.
+ */
+int meshedit_compute_normals(MeshEditModel *model);
+
+/*!
+ * \brief Smooth the surface, moving each vertex towards the centroid of its
+ * neighbours, then recompute the vertex normals.
+ * @param model Handle of the model.
+ * @param iterations Number of iterations, not negative.
+ * @param lambda Factor of the first step of each iteration, in (0,1].
+ * @param mu Factor of the second step, in [-1,0]. Zero gives Laplacian
+ * smoothing, which shrinks the model, while a value slightly larger than
+ * lambda in magnitude (such as -0.53 with lambda 0.5) gives Taubin
+ * smoothing, which preserves its volume.
+ * @return MESHEDIT_OK on success, an error code otherwise.
+ * @note Boundary vertices are not moved.
+ */
+int meshedit_smooth(MeshEditModel *model, int iterations, double lambda,
+        double mu);
+
+/*!
+ * \brief Refine the model, splitting each face in four at each level, then
+ * recompute the vertex normals.
+ * @param model Handle of the model.
+ * @param levels Number of levels, not negative.
+ * @param scheme Subdivision scheme. The midpoint scheme keeps the shape of
+ * the model, while the Loop scheme converges to a smooth surface.
+ * @return MESHEDIT_OK on success, an error code otherwise.
+ * @note The colors are interpolated on the new vertices.
+ */
+int meshedit_subdivide(MeshEditModel *model, int levels,
+        MeshEditSubdivision scheme);
+
+/*!
+ * \brief Simplify the model by collapsing edges in order of increasing
+ * quadric error, interpolating colors and normals.
+ * @param model Handle of the model.
+ * @param target_faces Number of faces at which to stop, must be positive.
+ * @param max_error Maximum error of a collapse (squared distance from the
+ * original surface), or zero for no bound.
+ * @return MESHEDIT_OK on success, an error code otherwise.
+ * @note Vertex indices change, and vertices left without faces are
+ * removed.
+ */
+int meshedit_decimate(MeshEditModel *model, long long target_faces,
+        double max_error);
+
+/*!
+ * \brief Save a chain of progressively simplified copies of the model in
+ * PLY format, computed in a single simplification run.
+ * @param model Handle of the model, which is not modified.
+ * @param targets Number of faces of each level, positive and decreasing.
+ * @param paths Path of the file of each level.
+ * @param n_levels Number of levels.
+ * @return MESHEDIT_OK on success, an error code otherwise.
+ */
+int meshedit_save_lod(MeshEditModel *model, const long long *targets,
+        const char *const *paths, int n_levels);
+
+/*!
+ * \brief Merge the vertices closer than a tolerance, rewriting the faces on
+ * them and removing the vertices left unused.
+ * @param model Handle of the model.
+ * @param tolerance Step of the grid on which positions are compared, or
+ * zero to merge only identical positions.
+ * @param merged If not NULL, filled with the number of vertices removed.
+ * @return MESHEDIT_OK on success, an error code otherwise.
+ * @note Vertex indices change, and faces left with a repeated vertex are
+ * removed.
+ */
+int meshedit_weld(MeshEditModel *model, double tolerance, long long *merged);
+
+/*!
+ * \brief Remove the degenerate faces and the small connected components,
+ * then the vertices left unused.
+ * @param model Handle of the model.
+ * @param min_area Faces with an area not greater than this are removed.
+ * @param min_faces Components with fewer faces than this are removed.
+ * @param removed_faces If not NULL, filled with the number of faces
+ * removed.
+ * @param removed_vertices If not NULL, filled with the number of vertices
+ * removed.
+ * @return MESHEDIT_OK on success, an error code otherwise.
+ * @note Vertex indices change. If no face would be left, the model is not
+ * changed and MESHEDIT_ERR_UNDEFINED is returned.
+ */
+int meshedit_cleanup(MeshEditModel *model, double min_area,
+        long long min_faces, long long *removed_faces,
+        long long *removed_vertices);
+
+/*!
+ * \brief Count the boundary, non-manifold and misoriented edges of a
+ * model.
+ * @param model Handle of the model.
+ * @param check Structure to be filled. The surface is closed and
+ * consistently oriented, so that its volume is meaningful, if the last
+ * three counts are zero.
+ * @return MESHEDIT_OK on success, an error code otherwise.
+ */
+int meshedit_check_surface(MeshEditModel *model,
+        MeshEditSurfaceCheck *check);
+
+/*!
+ * \brief Compute the distribution of the face areas and of the edge lengths
+ * of a model, which is more robust than the single largest and smallest
+ * face as a measure of the mesh quality.
+ * @param model Handle of the model.
+ * @param area If not NULL, filled with the distribution of the face areas.
+ * @param edge If not NULL, filled with the distribution of the lengths of
+ * the face sides, where an edge shared by two faces is counted twice.
+ * @return MESHEDIT_OK on success, an error code otherwise.
+ * @note The percentiles are estimated within 0.8% relative error.
+ */
+int meshedit_quality(MeshEditModel *model, MeshEditDistribution *area,
+        MeshEditDistribution *edge);
+
+/*!
+ * \brief Compute the convex hull of the vertices of a model, and an oriented
+ * bounding box of small volume around it.
+ * @param model Handle of the model.
+ * @param hull Structure to be filled. The ratio between the volume of the
+ * hull and the volume of the box measures how compact the model is.
+ * @return MESHEDIT_OK on success, MESHEDIT_ERR_UNDEFINED if the vertices
+ * are coplanar, an error code otherwise.
+ * @note The box is not guaranteed to be the one of minimum volume, but it
+ * is never larger than the axis aligned bounding box.
+ */
+int meshedit_convex_hull(MeshEditModel *model, MeshEditHull *hull);
+
+/*!
+ * \brief Flip faces to make their winding consistent, with the closed parts
+ * facing outwards.
+ * @param model Handle of the model.
+ * @param flipped If not NULL, filled with the number of faces flipped.
+ * @return MESHEDIT_OK on success, MESHEDIT_ERR_UNDEFINED if some part is
+ * not orientable (it is oriented as far as possible), an error code
+ * otherwise.
+ */
+int meshedit_orient(MeshEditModel *model, long long *flipped);
+
+/*!
+ * \brief Sort the vertices along a Morton curve and the faces by vertex, so
+ * that elements near in space are near in memory.
+ * @param model Handle of the model.
+ * @return MESHEDIT_OK on success, an error code otherwise.
+ * @note Vertex indices change. Saving the model afterwards writes the new
+ * order.
+ */
+int meshedit_reorder(MeshEditModel *model);
+
+/*!
+ * \brief Reorder the faces to reduce the post-transform vertex cache
+ * misses of a GPU, then the vertices in order of first use.
+ * @param model Handle of the model.
+ * @param cache_size Number of vertices held by the cache (e.g. 16).
+ * @return MESHEDIT_OK on success, an error code otherwise.
+ * @note Vertex indices change. Saving the model afterwards writes the new
+ * order.
+ */
+int meshedit_optimize_vertex_cache(MeshEditModel *model, int cache_size);
+
+/*!
+ * \brief Find the connected components of a model, ordered by decreasing
+ * number of faces.
+ * @param model Handle of the model.
+ * @param labels If not NULL, array of one element for each vertex, filled
+ * with the position of the component of each vertex.
+ * @param parts If not NULL, array of max_parts elements, filled with the
+ * summary of the first components.
+ * @param max_parts Number of elements of parts.
+ * @param n_parts If not NULL, filled with the number of components.
+ * @return MESHEDIT_OK on success, an error code otherwise.
+ */
+int meshedit_components(MeshEditModel *model, long long *labels,
+        MeshEditComponent *parts, long long max_parts, long long *n_parts);
+
+/*!
+ * \brief Build a spatial index over the faces of a model, for ray and
+ * closest point queries.
+ * @param model Handle of the model.
+ * @param bvh Filled with the handle of the index, to be released with
+ * meshedit_bvh_free().
+ * @return MESHEDIT_OK on success, an error code otherwise.
+ * @note The index holds a copy of the geometry, so it must be rebuilt to
+ * see later changes of the model, and it stays valid after the model is
+ * freed.
+ */
+int meshedit_bvh_build(MeshEditModel *model, MeshEditBvh **bvh);
+
+/*!
+ * \brief Find the first face hit by a ray.
+ * @param bvh Handle of the index.
+ * @param origin Origin of the ray.
+ * @param direction Direction of the ray, not null.
+ * @param max_t Maximum distance along the ray, in units of the length of
+ * direction.
+ * @param face Filled with the index of the face hit, or -1 if the ray hits
+ * nothing within max_t.
+ * @param t If not NULL, filled with the distance of the hit along the ray,
+ * in units of the length of direction.
+ * @return MESHEDIT_OK on success, an error code otherwise.
+ * @note Queries do not modify the index, so they can run concurrently.
+ */
+int meshedit_bvh_raycast(const MeshEditBvh *bvh, const float origin[3],
+        const float direction[3], float max_t, long long *face, float *t);
+
+/*!
+ * \brief Find the point of the model surface closest to a query point.
+ * @param bvh Handle of the index.
+ * @param point Query point.
+ * @param max_dist Maximum distance searched.
+ * @param face Filled with the index of the face of the closest point, or -1
+ * if no face is within max_dist.
+ * @param closest If not NULL, filled with the closest point.
+ * @param dist If not NULL, filled with the distance of the closest point.
+ * @return MESHEDIT_OK on success, an error code otherwise.
+ * @note Queries do not modify the index, so they can run concurrently.
+ */
+int meshedit_bvh_closest(const MeshEditBvh *bvh, const float point[3],
+        float max_dist, long long *face, float closest[3], float *dist);
+
+/*!
+ * \brief Release a spatial index.
+ * @param bvh Handle of the index, may be NULL.
+ */
+void meshedit_bvh_free(MeshEditBvh *bvh);
+
+/*!
+ * \brief Get a description of an error code.
+ * @param error Error code returned by a library function.
+ * @return A static string describing the error.
+ */
+const char* meshedit_strerror(int error);
+
+#endif // MESHEDIT_H
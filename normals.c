@@ -0,0 +1,102 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) Martino Pilia, 2015
+ */
+
+/*!
+ * \file normals.c
+ */
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "adjacency.h"
+#include "normals.h"
+#include "profile.h"
+
+/*!
+ * Compute the face normals first, then gather them on each vertex through
+ * the vertex-to-face lists of the model connectivity. Each vertex is
+ * written by a single thread, so neither pass needs atomic operations or
+ * per-thread accumulators.
+ *
+ * The cross product of two edges has a length equal to twice the face
+ * area, so summing the unnormalized products gives the area weighting for
+ * free.
+ */
+int compute_normals(Model3D *m)
+{
+    const Adjacency *a;
+    float *fn;
+    Index f, v, e;
+    Point3D p1, p2, p3;
+    double ax, ay, az, bx, by, bz, nx, ny, nz, norm;
+    double start = profile_clock();
+
+    a = model_adjacency(m);
+    if (a == NULL)
+        return ERR_NO_MEMORY;
+
+    fn = (float*) malloc((3 * m->n_faces + 1) * sizeof (float));
+    if (fn == NULL)
+        return ERR_NO_MEMORY;
+
+    #pragma omp parallel for schedule(static) \
+            private(p1, p2, p3, ax, ay, az, bx, by, bz)
+    for (f = 0; f < m->n_faces; ++f)
+    {
+        p1 = m->vertices_array[face_vertex(m, f, 0)]->vertexCoordinates;
+        p2 = m->vertices_array[face_vertex(m, f, 1)]->vertexCoordinates;
+        p3 = m->vertices_array[face_vertex(m, f, 2)]->vertexCoordinates;
+
+        ax = p2.x - p1.x;
+        ay = p2.y - p1.y;
+        az = p2.z - p1.z;
+        bx = p3.x - p1.x;
+        by = p3.y - p1.y;
+        bz = p3.z - p1.z;
+
+        fn[3 * f] = ay * bz - az * by;
+        fn[3 * f + 1] = az * bx - ax * bz;
+        fn[3 * f + 2] = ax * by - ay * bx;
+    }
+
+    #pragma omp parallel for schedule(dynamic, 4096) \
+            private(e, nx, ny, nz, norm)
+    for (v = 0; v < m->n_vertices; ++v)
+    {
+        nx = ny = nz = 0;
+        for (e = a->vf_offsets[v]; e < a->vf_offsets[v + 1]; ++e)
+        {
+            nx += fn[3 * a->vf[e]];
+            ny += fn[3 * a->vf[e] + 1];
+            nz += fn[3 * a->vf[e] + 2];
+        }
+
+        norm = sqrt(nx * nx + ny * ny + nz * nz);
+        if (norm == 0)
+            continue;
+
+        m->vertices_array[v]->vertexNormals.x = nx / norm;
+        m->vertices_array[v]->vertexNormals.y = ny / norm;
+        m->vertices_array[v]->vertexNormals.z = nz / norm;
+    }
+
+    free(fn);
+
+    profile_record(PROF_NORMALS, start, m->n_vertices, m->n_faces);
+
+    return 0;
+}
@@ -0,0 +1,40 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) Martino Pilia, 2015
+ */
+
+/*!
+ * \file normals.h
+ */
+
+#ifndef NORMALS_H
+#define NORMALS_H
+
+#include "backend.h"
+
+/*!
+ * \brief Recompute the vertex normals from the faces.
+ *
+ * The normal of each vertex is the normalized sum of the normals of its
+ * faces, each one weighted by the face area. Faces are assumed to be
+ * oriented counterclockwise, as seen from outside the model.
+ * @param m Model whose vertex normals are replaced.
+ * @return Zero on success, ERR_NO_MEMORY if an allocation failed.
+ * @note Vertices not belonging to any face, or whose faces have null
+ * area, keep their previous normal.
+ */
+int compute_normals(Model3D *m);
+
+#endif // NORMALS_H
@@ -0,0 +1,320 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) Martino Pilia, 2015
+ */
+
+/*!
+ * \file profile.c
+ */
+
+#if defined(__APPLE__) || defined(__linux__)
+    #define _POSIX_C_SOURCE 200809L
+    #include <sys/resource.h>
+    #include <time.h>
+#else // _WIN32
+    #include <windows.h>
+#endif // defined(__APPLE__) || defined(__linux__)
+
+#include <stdatomic.h>
+#include <stdio.h>
+
+#include "profile.h"
+#include "trace.h"
+
+/*!
+ * Counters collected for each phase. Times are kept in nanoseconds as
+ * integers, so they can be accumulated with atomic operations.
+ */
+typedef struct PhaseCounters
+{
+    atomic_llong calls;    /*!< Number of executions. */
+    atomic_llong total_ns; /*!< Total time spent in the phase. */
+    atomic_llong max_ns;   /*!< Longest single execution. */
+    atomic_llong vertices; /*!< Total number of vertices processed. */
+    atomic_llong faces;    /*!< Total number of faces processed. */
+} PhaseCounters;
+
+/*! Names used for the phases in the reports. */
+static const char *phase_names[PROF_PHASES] =
+{
+    "parse",
+    "model_info",
+    "color_flat",
+    "color_random",
+    "color_distance",
+    "color_gradient",
+    "color_multi_dist",
+    "color_geodesic",
+    "color_components",
+    "color_deviation",
+    "adjacency",
+    "normals",
+    "curvature",
+    "occlusion",
+    "decimate",
+    "weld",
+    "reorder",
+    "vertex_cache",
+    "components",
+    "cleanup",
+    "surface_check",
+    "orient",
+    "smooth",
+    "subdivide",
+    "align",
+    "convex_hull",
+    "oriented_box",
+    "quality",
+    "rotation",
+    "save",
+};
+
+static atomic_int enabled = 0;
+static PhaseCounters phases[PROF_PHASES];
+static atomic_llong bytes_read = 0;
+static atomic_llong bytes_written = 0;
+
+/*!
+ * Set the flag checked by the other profile_ subroutines.
+ */
+void profile_enable(int e)
+{
+    atomic_store(&enabled, e != 0);
+}
+
+/*!
+ * Return the value of the enable flag.
+ */
+int profile_enabled(void)
+{
+    return atomic_load_explicit(&enabled, memory_order_relaxed);
+}
+
+/*!
+ * Read a monotonic clock, which is not affected by changes of the system
+ * time, and convert its value in seconds.
+ */
+double profile_clock(void)
+{
+    #if defined(__APPLE__) || defined(__linux__)
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+    #else // _WIN32
+    LARGE_INTEGER count, freq;
+    QueryPerformanceCounter(&count);
+    QueryPerformanceFrequency(&freq);
+    return (double) count.QuadPart / freq.QuadPart;
+    #endif // defined(__APPLE__) || defined(__linux__)
+}
+
+/*!
+ * Accumulate the elapsed time and the element counts of a phase execution,
+ * and forward the phase to the tracer as a trace event. The procedure does
+ * nothing when both profiling and tracing are disabled, and it is safe to
+ * call it concurrently from several threads.
+ */
+void profile_record(ProfilePhase p, double start, long long vertices,
+        long long faces)
+{
+    PhaseCounters *c;
+    long long ns, max;
+    double end;
+
+    if ((!profile_enabled() && !trace_enabled()) || p < 0 || p >= PROF_PHASES)
+        return;
+
+    end = profile_clock();
+    trace_record(phase_names[p], start, end);
+
+    if (!profile_enabled())
+        return;
+
+    c = &phases[p];
+    ns = (long long) ((end - start) * 1e9);
+
+    atomic_fetch_add_explicit(&c->calls, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&c->total_ns, ns, memory_order_relaxed);
+    atomic_fetch_add_explicit(&c->vertices, vertices, memory_order_relaxed);
+    atomic_fetch_add_explicit(&c->faces, faces, memory_order_relaxed);
+
+    /* update the maximum, retrying if another thread changed it */
+    max = atomic_load_explicit(&c->max_ns, memory_order_relaxed);
+    while (ns > max && !atomic_compare_exchange_weak(&c->max_ns, &max, ns))
+        ;
+}
+
+/*!
+ * Update the input byte counter, if profiling is enabled.
+ */
+void profile_add_bytes_read(long long bytes)
+{
+    if (profile_enabled() && bytes > 0)
+        atomic_fetch_add_explicit(&bytes_read, bytes, memory_order_relaxed);
+}
+
+/*!
+ * Update the output byte counter, if profiling is enabled.
+ */
+void profile_add_bytes_written(long long bytes)
+{
+    if (profile_enabled() && bytes > 0)
+        atomic_fetch_add_explicit(&bytes_written, bytes, memory_order_relaxed);
+}
+
+/*!
+ * Query the operating system for the maximum resident set size reached by
+ * the process. Note that getrusage() reports kilobytes on Linux and bytes
+ * on OS X.
+ */
+long long profile_peak_rss(void)
+{
+    #if defined(__APPLE__) || defined(__linux__)
+    struct rusage r;
+
+    if (getrusage(RUSAGE_SELF, &r) != 0)
+        return 0;
+
+    #ifdef __APPLE__
+    return (long long) r.ru_maxrss;
+    #else
+    return (long long) r.ru_maxrss * 1024;
+    #endif // __APPLE__
+    #else // _WIN32
+    return 0;
+    #endif // defined(__APPLE__) || defined(__linux__)
+}
+
+/*!
+ * Set all counters to zero.
+ */
+void profile_reset(void)
+{
+    int i;
+
+    for (i = 0; i < PROF_PHASES; ++i)
+    {
+        atomic_store(&phases[i].calls, 0);
+        atomic_store(&phases[i].total_ns, 0);
+        atomic_store(&phases[i].max_ns, 0);
+        atomic_store(&phases[i].vertices, 0);
+        atomic_store(&phases[i].faces, 0);
+    }
+    atomic_store(&bytes_read, 0);
+    atomic_store(&bytes_written, 0);
+}
+
+/*!
+ * Compute a throughput in elements per second, avoiding the division by
+ * zero for phases too fast to be measured.
+ */
+static double rate(long long count, long long ns)
+{
+    return ns > 0 ? count / (ns * 1e-9) : 0;
+}
+
+/*!
+ * Write a table with one row for each phase executed at least once,
+ * followed by the I/O counters and the peak memory usage.
+ */
+void profile_report(FILE *out)
+{
+    int i;
+    long long calls, ns;
+
+    fprintf(out,
+            "\nProfile:\n"
+            "  %-16s %8s %12s %12s %14s %14s\n",
+            "phase", "calls", "total [ms]", "max [ms]",
+            "vertices/s", "faces/s");
+
+    for (i = 0; i < PROF_PHASES; ++i)
+    {
+        calls = atomic_load(&phases[i].calls);
+        if (calls == 0)
+            continue;
+
+        ns = atomic_load(&phases[i].total_ns);
+        fprintf(out,
+                "  %-16s %8lld %12.3f %12.3f %14.4g %14.4g\n",
+                phase_names[i],
+                calls,
+                ns * 1e-6,
+                atomic_load(&phases[i].max_ns) * 1e-6,
+                rate(atomic_load(&phases[i].vertices), ns),
+                rate(atomic_load(&phases[i].faces), ns));
+    }
+
+    fprintf(out,
+            "  bytes read:      %lld\n"
+            "  bytes written:   %lld\n"
+            "  peak RSS:        %lld\n",
+            (long long) atomic_load(&bytes_read),
+            (long long) atomic_load(&bytes_written),
+            profile_peak_rss());
+}
+
+/*!
+ * Write the collected data in a JSON object, with a member for each phase
+ * executed at least once.
+ */
+int profile_write_json(const char *path)
+{
+    int i, first = 1;
+    long long calls, ns, v, f;
+    FILE *out = fopen(path, "w");
+
+    if (out == NULL)
+        return 1;
+
+    fprintf(out, "{\n  \"phases\": {");
+
+    for (i = 0; i < PROF_PHASES; ++i)
+    {
+        calls = atomic_load(&phases[i].calls);
+        if (calls == 0)
+            continue;
+
+        ns = atomic_load(&phases[i].total_ns);
+        v = atomic_load(&phases[i].vertices);
+        f = atomic_load(&phases[i].faces);
+        fprintf(out,
+                "%s\n    \"%s\": {\"calls\": %lld, \"total_s\": %.9f, "
+                "\"max_s\": %.9f, \"vertices\": %lld, \"faces\": %lld, "
+                "\"vertices_per_s\": %.6g, \"faces_per_s\": %.6g}",
+                first ? "" : ",",
+                phase_names[i],
+                calls,
+                ns * 1e-9,
+                atomic_load(&phases[i].max_ns) * 1e-9,
+                v,
+                f,
+                rate(v, ns),
+                rate(f, ns));
+        first = 0;
+    }
+
+    fprintf(out,
+            "\n  },\n"
+            "  \"bytes_read\": %lld,\n"
+            "  \"bytes_written\": %lld,\n"
+            "  \"peak_rss_bytes\": %lld\n"
+            "}\n",
+            (long long) atomic_load(&bytes_read),
+            (long long) atomic_load(&bytes_written),
+            profile_peak_rss());
+
+    return fclose(out) != 0;
+}
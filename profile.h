@@ -0,0 +1,130 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) Martino Pilia, 2015
+ */
+
+/*!
+ * \file profile.h
+ */
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdio.h>
+
+/*!
+ * Type identifying a backend phase measured by the profiler.
+ */
+typedef enum ProfilePhase
+{
+    PROF_PARSE = 0,      /*!< parse_model_data() */
+    PROF_INFO,           /*!< model_info() */
+    PROF_COLOR_FLAT,     /*!< color_flat() */
+    PROF_COLOR_RANDOM,   /*!< color_random() */
+    PROF_COLOR_DISTANCE, /*!< color_distance() */
+    PROF_COLOR_GRADIENT, /*!< color_gradient() */
+    PROF_COLOR_MULTI,    /*!< color_distance_multi() */
+    PROF_COLOR_GEODESIC, /*!< color_geodesic() */
+    PROF_COLOR_COMP,     /*!< color_components() */
+    PROF_COLOR_DEV,      /*!< color_deviation() */
+    PROF_ADJACENCY,      /*!< model_adjacency() */
+    PROF_NORMALS,        /*!< compute_normals() */
+    PROF_CURVATURE,      /*!< curvature() */
+    PROF_OCCLUSION,      /*!< ambient_occlusion() */
+    PROF_DECIMATE,       /*!< decimate() */
+    PROF_WELD,           /*!< weld_vertices() */
+    PROF_REORDER,        /*!< spatial_reorder() */
+    PROF_VCACHE,         /*!< optimize_vertex_cache() */
+    PROF_COMPONENTS,     /*!< model_components() */
+    PROF_CLEANUP,        /*!< cleanup_mesh() */
+    PROF_CHECK,          /*!< check_surface() */
+    PROF_ORIENT,         /*!< orient_faces() */
+    PROF_SMOOTH,         /*!< smooth_mesh() */
+    PROF_SUBDIVIDE,      /*!< subdivide_mesh() */
+    PROF_ALIGN,          /*!< align_principal_axes() */
+    PROF_HULL,           /*!< convex_hull() */
+    PROF_OBB,            /*!< oriented_box() */
+    PROF_QUALITY,        /*!< model_quality() */
+    PROF_ROTATION,       /*!< rotation() */
+    PROF_SAVE,           /*!< save_model() */
+    PROF_PHASES          /*!< Number of phases, not a real phase. */
+} ProfilePhase;
+
+/*!
+ * \brief Enable or disable the collection of profiling data.
+ * @param enabled Nonzero to enable, zero to disable.
+ * @note Profiling is disabled by default.
+ */
+void profile_enable(int enabled);
+
+/*!
+ * \brief Check if profiling is enabled.
+ * @return Nonzero if profiling data are being collected.
+ */
+int profile_enabled(void);
+
+/*!
+ * \brief Read the monotonic clock.
+ * @return Time in seconds from an arbitrary, fixed point in the past.
+ */
+double profile_clock(void);
+
+/*!
+ * \brief Record one execution of a phase.
+ * @param p Phase executed.
+ * @param start Value of profile_clock() when the phase was started.
+ * @param vertices Number of vertices processed by the phase.
+ * @param faces Number of faces processed by the phase.
+ */
+void profile_record(ProfilePhase p, double start, long long vertices,
+        long long faces);
+
+/*!
+ * \brief Add to the count of bytes read from model files.
+ * @param bytes Number of bytes read.
+ */
+void profile_add_bytes_read(long long bytes);
+
+/*!
+ * \brief Add to the count of bytes written to model files.
+ * @param bytes Number of bytes written.
+ */
+void profile_add_bytes_written(long long bytes);
+
+/*!
+ * \brief Get the peak resident set size of the process.
+ * @return Peak RSS in bytes, or zero if not available on the platform.
+ */
+long long profile_peak_rss(void);
+
+/*!
+ * \brief Discard all the collected data.
+ */
+void profile_reset(void);
+
+/*!
+ * \brief Write a human readable report of the collected data.
+ * @param out Stream on which write the report (usually stderr).
+ */
+void profile_report(FILE *out);
+
+/*!
+ * \brief Write the collected data in JSON format.
+ * @param path Name of the output file.
+ * @return Zero on success, nonzero if the file cannot be written.
+ */
+int profile_write_json(const char *path);
+
+#endif // PROFILE_H
@@ -0,0 +1,261 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) Martino Pilia, 2015
+ */
+
+
+/*!
+ * \file quality.c
+ */
+
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "profile.h"
+#include "quality.h"
+
+/*!
+ * Return the bucket of a positive value, from its binary exponent and the
+ * leading bits of its mantissa, read from the IEEE 754 representation.
+ */
+static Index bucket(double x)
+{
+    uint64_t bits;
+    Index e, i;
+
+    memcpy(&bits, &x, sizeof bits);
+    e = (Index) ((bits >> 52) & 0x7ff) - 1023;
+    i = ((e - SKETCH_MIN_EXP) << SKETCH_SUB_BITS)
+            + (Index) ((bits >> (52 - SKETCH_SUB_BITS))
+                    & ((1 << SKETCH_SUB_BITS) - 1));
+
+    if (i < 0)
+        return 0;
+    if (i >= SKETCH_BUCKETS)
+        return SKETCH_BUCKETS - 1;
+    return i;
+}
+
+/*!
+ * Return the value in the middle of a bucket.
+ */
+static double bucket_value(Index i)
+{
+    return ldexp(1.0 + ((i & ((1 << SKETCH_SUB_BITS) - 1)) + 0.5)
+                    / (1 << SKETCH_SUB_BITS),
+            (int) (i >> SKETCH_SUB_BITS) + SKETCH_MIN_EXP);
+}
+
+/*!
+ * Reset the counts and the range.
+ */
+void sketch_init(Sketch *s)
+{
+    memset(s->buckets, 0, sizeof s->buckets);
+    s->count = 0;
+    s->zeros = 0;
+    s->min = DBL_MAX;
+    s->max = 0;
+    s->sum = 0;
+}
+
+/*!
+ * Count the value in its bucket, or among the zeros.
+ */
+void sketch_add(Sketch *s, double x)
+{
+    if (!(x > 0)) /* also true for NaN */
+    {
+        x = 0;
+        ++s->zeros;
+    }
+    else
+        ++s->buckets[bucket(x)];
+
+    ++s->count;
+    s->sum += x;
+    if (x < s->min)
+        s->min = x;
+    if (x > s->max)
+        s->max = x;
+}
+
+/*!
+ * Sum the counts and join the ranges.
+ */
+void sketch_merge(Sketch *s, const Sketch *t)
+{
+    Index i;
+
+    for (i = 0; i < SKETCH_BUCKETS; ++i)
+        s->buckets[i] += t->buckets[i];
+
+    s->count += t->count;
+    s->zeros += t->zeros;
+    s->sum += t->sum;
+    if (t->min < s->min)
+        s->min = t->min;
+    if (t->max > s->max)
+        s->max = t->max;
+}
+
+/*!
+ * Walk the buckets in increasing order until the rank is reached, and
+ * return the middle of the bucket, clamped to the range of the values. The
+ * extremes are known exactly.
+ */
+double sketch_quantile(const Sketch *s, double q)
+{
+    Index i, rank, seen;
+    double x;
+
+    if (s->count == 0)
+        return 0;
+
+    q = q < 0 ? 0 : (q > 1 ? 1 : q);
+    rank = (Index) (q * (s->count - 1) + 0.5);
+
+    if (rank < s->zeros)
+        return 0;
+    if (rank == 0)
+        return s->min;
+    if (rank == s->count - 1)
+        return s->max;
+
+    seen = s->zeros;
+    for (i = 0; i < SKETCH_BUCKETS - 1; ++i)
+    {
+        seen += s->buckets[i];
+        if (seen > rank)
+            break;
+    }
+
+    x = bucket_value(i);
+    return x < s->min ? s->min : (x > s->max ? s->max : x);
+}
+
+/*!
+ * Distribute the count of each bucket on the bin containing its middle
+ * value.
+ */
+void sketch_histogram(const Sketch *s, int bins, Index *counts)
+{
+    Index i, first, last;
+    double lo, scale;
+    int k;
+
+    for (k = 0; k < bins; ++k)
+        counts[k] = 0;
+
+    if (bins <= 0)
+        return;
+
+    counts[0] = s->zeros;
+
+    for (first = 0; first < SKETCH_BUCKETS && s->buckets[first] == 0;
+            ++first)
+        ;
+    if (first == SKETCH_BUCKETS)
+        return;
+    for (last = SKETCH_BUCKETS - 1; s->buckets[last] == 0; --last)
+        ;
+
+    lo = log(bucket_value(first));
+    scale = last > first ? bins / (log(bucket_value(last)) - lo) : 0;
+
+    for (i = first; i <= last; ++i)
+    {
+        if (s->buckets[i] == 0)
+            continue;
+        k = (int) ((log(bucket_value(i)) - lo) * scale);
+        counts[k < bins ? k : bins - 1] += s->buckets[i];
+    }
+}
+
+/*!
+ * Each thread fills a partial pair of sketches on its share of the faces,
+ * then adds it to the result under a critical section, so the counts do
+ * not depend on the number of threads.
+ */
+int model_quality(Model3D *m, Quality *q)
+{
+    Quality *t;
+    Index f;
+    Point3D p[3];
+    double e[3][3], cx, cy, cz;
+    int k, failed = 0;
+    double start = profile_clock();
+
+    if (model_build_indices(m) != 0)
+        return ERR_NO_MEMORY;
+
+    sketch_init(&q->area);
+    sketch_init(&q->edge);
+
+    #pragma omp parallel private(t, f, p, e, cx, cy, cz, k)
+    {
+        t = (Quality*) malloc(sizeof (Quality));
+        if (t == NULL)
+        {
+            #pragma omp atomic write
+            failed = 1;
+        }
+        else
+        {
+            sketch_init(&t->area);
+            sketch_init(&t->edge);
+        }
+
+        #pragma omp for schedule(static)
+        for (f = 0; f < m->n_faces; ++f)
+        {
+            if (t == NULL)
+                continue;
+
+            for (k = 0; k < 3; ++k)
+                p[k] = m->vertices_array[face_vertex(m, f, k)]
+                        ->vertexCoordinates;
+
+            for (k = 0; k < 3; ++k)
+            {
+                e[k][0] = (double) p[(k + 1) % 3].x - p[k].x;
+                e[k][1] = (double) p[(k + 1) % 3].y - p[k].y;
+                e[k][2] = (double) p[(k + 1) % 3].z - p[k].z;
+                sketch_add(&t->edge, sqrt(e[k][0] * e[k][0]
+                            + e[k][1] * e[k][1] + e[k][2] * e[k][2]));
+            }
+
+            cx = e[0][1] * e[1][2] - e[0][2] * e[1][1];
+            cy = e[0][2] * e[1][0] - e[0][0] * e[1][2];
+            cz = e[0][0] * e[1][1] - e[0][1] * e[1][0];
+            sketch_add(&t->area, 0.5 * sqrt(cx * cx + cy * cy + cz * cz));
+        }
+
+        #pragma omp critical
+        if (t != NULL)
+        {
+            sketch_merge(&q->area, &t->area);
+            sketch_merge(&q->edge, &t->edge);
+        }
+
+        free(t);
+    }
+
+    profile_record(PROF_QUALITY, start, m->n_vertices, m->n_faces);
+
+    return failed ? ERR_NO_MEMORY : 0;
+}
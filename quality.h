@@ -0,0 +1,135 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) Martino Pilia, 2015
+ */
+
+
+/*!
+ * \file quality.h
+ */
+
+#ifndef QUALITY_H
+#define QUALITY_H
+
+#include "backend.h"
+
+/*!
+ * Number of sub-buckets in which each power of two is split by a sketch,
+ * as a power of two. With 64 sub-buckets a quantile is within 0.8% of
+ * the exact value.
+ */
+#define SKETCH_SUB_BITS 6
+
+/*!
+ * Smallest binary exponent resolved by a sketch. Values below
+ * 2^SKETCH_MIN_EXP fall in the first bucket, values above
+ * 2^-SKETCH_MIN_EXP in the last one.
+ */
+#define SKETCH_MIN_EXP (-64)
+
+/*! Number of buckets of a sketch. */
+#define SKETCH_BUCKETS ((-2 * SKETCH_MIN_EXP) << SKETCH_SUB_BITS)
+
+/*!
+ * Number of bins of the histograms shown by show_info(Model3D*).
+ */
+#define QUALITY_BINS 32
+
+/*!
+ * Type for a streaming sketch of the distribution of non-negative values.
+ *
+ * Each value is counted in a fixed bucket, given by its binary exponent and
+ * by the leading bits of its mantissa, so the buckets have the same
+ * relative width at every scale, adding a value takes a few integer
+ * operations, and two sketches are merged by summing their counts. This
+ * makes the sketch suitable to be filled by many threads in parallel, each
+ * with its own partial sketch.
+ */
+typedef struct Sketch
+{
+    Index count;                   /*!< Number of values. */
+    Index zeros;                   /*!< Number of values equal to zero. */
+    double min;                    /*!< Smallest value. */
+    double max;                    /*!< Largest value. */
+    double sum;                    /*!< Sum of the values. */
+    Index buckets[SKETCH_BUCKETS]; /*!< Count of the positive values in
+                                        each bucket. */
+} Sketch;
+
+/*!
+ * Type for the distributions of the face areas and of the edge lengths of
+ * a model.
+ */
+typedef struct Quality
+{
+    Sketch area; /*!< Area of each face. */
+    Sketch edge; /*!< Length of the sides of each face, so that an edge
+                      shared by two faces is counted twice. */
+} Quality;
+
+/*!
+ * \brief Empty a sketch.
+ * @param s Sketch.
+ */
+void sketch_init(Sketch *s);
+
+/*!
+ * \brief Add a value to a sketch.
+ * @param s Sketch.
+ * @param x Value, negative values are counted as zero.
+ */
+void sketch_add(Sketch *s, double x);
+
+/*!
+ * \brief Add the values of a sketch to another.
+ * @param s Sketch, which receives the values.
+ * @param t Sketch, which is not modified.
+ */
+void sketch_merge(Sketch *s, const Sketch *t);
+
+/*!
+ * \brief Estimate a quantile of the values of a sketch.
+ * @param s Sketch.
+ * @param q Order of the quantile, in [0,1] (0.5 for the median).
+ * @return The value with rank q * (count - 1), within 0.8% relative
+ * error, or zero if the sketch is empty.
+ */
+double sketch_quantile(const Sketch *s, double q);
+
+/*!
+ * \brief Count the values of a sketch in bins of equal width on a
+ * logarithmic scale, from the smallest to the largest positive value.
+ * @param s Sketch.
+ * @param bins Number of bins.
+ * @param counts Array of bins elements, filled with the count of each bin.
+ * Values equal to zero are counted in the first bin.
+ * @note The bins are derived from the buckets of the sketch, so a value
+ * near the border between two bins may be counted in the wrong one.
+ */
+void sketch_histogram(const Sketch *s, int bins, Index *counts);
+
+/*!
+ * \brief Compute the distribution of the face areas and of the edge
+ * lengths of a model.
+ *
+ * The faces are processed in parallel, each thread filling its partial
+ * sketches, which are merged at the end.
+ * @param m Model.
+ * @param q Structure to be filled.
+ * @return Zero on success, ERR_NO_MEMORY if an allocation failed.
+ */
+int model_quality(Model3D *m, Quality *q);
+
+#endif // QUALITY_H
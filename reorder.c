@@ -0,0 +1,264 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) Martino Pilia, 2015
+ */
+
+/*!
+ * \file reorder.c
+ */
+
+#include <float.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "profile.h"
+#include "reorder.h"
+
+/*! Number of bits of each coordinate in a Morton code. */
+#define MORTON_BITS 21
+
+/*! Number of bits sorted by each pass of the radix sort. */
+#define RADIX_BITS 8
+
+/*!
+ * Number of blocks in which the radix sort splits its input. Each block is
+ * counted and scattered by a single thread, so this bounds the parallelism
+ * without depending on the number of threads, which keeps the result the
+ * same on any machine.
+ */
+#define RADIX_BLOCKS 64
+
+/*!
+ * Spread the lowest 21 bits of x, so that there are two zero bits between
+ * each pair of consecutive bits.
+ */
+static uint64_t spread_bits(uint64_t x)
+{
+    x &= 0x1fffff;
+    x = (x | x << 32) & 0x1f00000000ffffull;
+    x = (x | x << 16) & 0x1f0000ff0000ffull;
+    x = (x | x << 8) & 0x100f00f00f00f00full;
+    x = (x | x << 4) & 0x10c30c30c30c30c3ull;
+    x = (x | x << 2) & 0x1249249249249249ull;
+
+    return x;
+}
+
+/*!
+ * Sort with a least significant digit radix sort. Each pass counts and
+ * scatters the blocks of the input in parallel.
+ */
+int radix_sort(uint64_t *keys, Index *values, Index n, int bits)
+{
+    uint64_t *k2;
+    Index *v2, *count, *swap_v, block, b, i, end, pos;
+    uint64_t *swap_k;
+    int shift, d;
+
+    block = (n + RADIX_BLOCKS - 1) / RADIX_BLOCKS;
+
+    k2 = (uint64_t*) malloc((n + 1) * sizeof (uint64_t));
+    v2 = (Index*) malloc((n + 1) * sizeof (Index));
+    count = (Index*) malloc(RADIX_BLOCKS * (1 << RADIX_BITS) * sizeof (Index));
+    if (k2 == NULL || v2 == NULL || count == NULL)
+    {
+        free(k2);
+        free(v2);
+        free(count);
+        return ERR_NO_MEMORY;
+    }
+
+    for (shift = 0; shift < bits; shift += RADIX_BITS)
+    {
+        memset(count, 0,
+                RADIX_BLOCKS * (1 << RADIX_BITS) * sizeof (Index));
+
+        #pragma omp parallel for schedule(static) private(i, end)
+        for (b = 0; b < RADIX_BLOCKS; ++b)
+        {
+            end = (b + 1) * block < n ? (b + 1) * block : n;
+            for (i = b * block; i < end; ++i)
+                ++count[b * (1 << RADIX_BITS)
+                    + ((keys[i] >> shift) & ((1 << RADIX_BITS) - 1))];
+        }
+
+        /* exclusive prefix sum, by digit first and then by block */
+        pos = 0;
+        for (d = 0; d < (1 << RADIX_BITS); ++d)
+        {
+            for (b = 0; b < RADIX_BLOCKS; ++b)
+            {
+                i = count[b * (1 << RADIX_BITS) + d];
+                count[b * (1 << RADIX_BITS) + d] = pos;
+                pos += i;
+            }
+        }
+
+        #pragma omp parallel for schedule(static) private(i, end, d)
+        for (b = 0; b < RADIX_BLOCKS; ++b)
+        {
+            end = (b + 1) * block < n ? (b + 1) * block : n;
+            for (i = b * block; i < end; ++i)
+            {
+                d = (keys[i] >> shift) & ((1 << RADIX_BITS) - 1);
+                k2[count[b * (1 << RADIX_BITS) + d]] = keys[i];
+                v2[count[b * (1 << RADIX_BITS) + d]++] = values[i];
+            }
+        }
+
+        swap_k = keys;
+        keys = k2;
+        k2 = swap_k;
+        swap_v = values;
+        values = v2;
+        v2 = swap_v;
+    }
+
+    /* after an odd number of passes the sorted data is in the temporary
+     * buffers, so it is copied back to the caller's arrays */
+    if (((bits + RADIX_BITS - 1) / RADIX_BITS) % 2 == 1)
+    {
+        memcpy(k2, keys, n * sizeof (uint64_t));
+        memcpy(v2, values, n * sizeof (Index));
+        free(keys);
+        free(values);
+    }
+    else
+    {
+        free(k2);
+        free(v2);
+    }
+    free(count);
+
+    return 0;
+}
+
+/*!
+ * Compute the Morton code of each vertex over the bounding box, sort the
+ * vertices by code, then sort the faces by their lowest new vertex index.
+ * Both sorts are stable, so ties keep the file order.
+ */
+int spatial_reorder(Model3D *m)
+{
+    Index V = m->n_vertices, F = m->n_faces;
+    uint64_t *keys;
+    Index *order, *map, *faces, *sorted, *face_order, v, f, lo;
+    Vertex *vertices;
+    Point3D p;
+    float min_x = FLT_MAX, min_y = FLT_MAX, min_z = FLT_MAX;
+    float max_x = -FLT_MAX, max_y = -FLT_MAX, max_z = -FLT_MAX;
+    double sx, sy, sz;
+    double start = profile_clock();
+    int k, bits, status;
+
+    if (model_build_indices(m) != 0)
+        return ERR_NO_MEMORY;
+
+    keys = (uint64_t*) malloc(((V > F ? V : F) + 1) * sizeof (uint64_t));
+    order = (Index*) malloc((V + 1) * sizeof (Index));
+    map = (Index*) malloc((V + 1) * sizeof (Index));
+    faces = (Index*) malloc((3 * F + 1) * sizeof (Index));
+    sorted = (Index*) malloc((3 * F + 1) * sizeof (Index));
+    face_order = (Index*) malloc((F + 1) * sizeof (Index));
+    vertices = (Vertex*) malloc((V + 1) * sizeof (Vertex));
+
+    if (keys == NULL || order == NULL || map == NULL || faces == NULL
+            || sorted == NULL || face_order == NULL || vertices == NULL)
+    {
+        status = ERR_NO_MEMORY;
+    }
+    else
+    {
+        #pragma omp parallel for schedule(static) private(p) \
+                reduction(min: min_x, min_y, min_z) \
+                reduction(max: max_x, max_y, max_z)
+        for (v = 0; v < V; ++v)
+        {
+            p = m->vertices_array[v]->vertexCoordinates;
+            min_x = p.x < min_x ? p.x : min_x;
+            min_y = p.y < min_y ? p.y : min_y;
+            min_z = p.z < min_z ? p.z : min_z;
+            max_x = p.x > max_x ? p.x : max_x;
+            max_y = p.y > max_y ? p.y : max_y;
+            max_z = p.z > max_z ? p.z : max_z;
+        }
+
+        /* scale each axis of the box to the range of the codes */
+        sx = max_x > min_x ? ((1 << MORTON_BITS) - 1) / (max_x - min_x) : 0;
+        sy = max_y > min_y ? ((1 << MORTON_BITS) - 1) / (max_y - min_y) : 0;
+        sz = max_z > min_z ? ((1 << MORTON_BITS) - 1) / (max_z - min_z) : 0;
+
+        #pragma omp parallel for schedule(static) private(p)
+        for (v = 0; v < V; ++v)
+        {
+            p = m->vertices_array[v]->vertexCoordinates;
+            keys[v] = spread_bits((uint64_t) ((p.x - min_x) * sx))
+                | spread_bits((uint64_t) ((p.y - min_y) * sy)) << 1
+                | spread_bits((uint64_t) ((p.z - min_z) * sz)) << 2;
+            order[v] = v;
+        }
+
+        status = radix_sort(keys, order, V, 3 * MORTON_BITS);
+    }
+
+    if (status == 0)
+    {
+        #pragma omp parallel for schedule(static)
+        for (v = 0; v < V; ++v)
+        {
+            map[order[v]] = v;
+            vertices[v] = *m->vertices_array[order[v]];
+        }
+
+        #pragma omp parallel for schedule(static) private(k, lo)
+        for (f = 0; f < F; ++f)
+        {
+            lo = V;
+            for (k = 0; k < 3; ++k)
+            {
+                faces[3 * f + k] = map[face_vertex(m, f, k)];
+                lo = faces[3 * f + k] < lo ? faces[3 * f + k] : lo;
+            }
+            keys[f] = lo;
+            face_order[f] = f;
+        }
+
+        for (bits = 0; ((Index) 1 << bits) <= V; ++bits)
+            ;
+        status = radix_sort(keys, face_order, F, bits);
+    }
+
+    if (status == 0)
+    {
+        #pragma omp parallel for schedule(static) private(k)
+        for (f = 0; f < F; ++f)
+            for (k = 0; k < 3; ++k)
+                sorted[3 * f + k] = faces[3 * face_order[f] + k];
+
+        status = model_replace(m, vertices, V, sorted, F);
+    }
+
+    free(keys);
+    free(order);
+    free(map);
+    free(faces);
+    free(sorted);
+    free(face_order);
+    free(vertices);
+
+    profile_record(PROF_REORDER, start, V, F);
+
+    return status;
+}
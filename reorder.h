@@ -0,0 +1,54 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) Martino Pilia, 2015
+ */
+
+/*!
+ * \file reorder.h
+ */
+
+#ifndef REORDER_H
+#define REORDER_H
+
+#include "backend.h"
+
+/*!
+ * \brief Reorder vertices and faces of a model for memory locality.
+ *
+ * Vertices are sorted along a Morton (Z-order) curve over the bounding box
+ * of the model, so that vertices near in space are near in memory, and
+ * faces are then sorted by their lowest vertex index. Loops over the faces
+ * then visit the vertices almost sequentially.
+ * @param m Model to be reordered.
+ * @return Zero on success, ERR_NO_MEMORY if an allocation failed.
+ * @note The model lists are rebuilt, so pointers to the old vertices and
+ * faces are no longer valid. Saving the model afterwards writes the new
+ * order, so later loads of the file benefit as well.
+ */
+int spatial_reorder(Model3D *m);
+
+/*!
+ * \brief Sort a set of values by their keys.
+ * @param keys Keys, sorted in place.
+ * @param values Values, moved together with their keys.
+ * @param n Number of keys.
+ * @param bits Number of low bits of the keys to be sorted on, the higher
+ * bits are ignored.
+ * @return Zero on success, ERR_NO_MEMORY if an allocation failed.
+ * @note The sort is stable, so values with equal keys keep their order.
+ */
+int radix_sort(uint64_t *keys, Index *values, Index n, int bits);
+
+#endif // REORDER_H
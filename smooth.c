@@ -0,0 +1,145 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) Martino Pilia, 2015
+ */
+
+
+/*!
+ * \file smooth.c
+ */
+
+#include <stdlib.h>
+
+#include "adjacency.h"
+#include "normals.h"
+#include "profile.h"
+#include "smooth.h"
+
+/*!
+ * Apply one step from the positions in src to the ones in dst, where w holds
+ * the inverse of the number of neighbours of each vertex, or zero for the
+ * vertices which are kept fixed.
+ */
+static void smooth_step(const Adjacency *adj, const float *w, Index n,
+        const float *src, float *dst, float factor)
+{
+    Index v, e;
+    float c[3];
+    int k;
+
+    #pragma omp parallel for schedule(static) private(e, c, k)
+    for (v = 0; v < n; ++v)
+    {
+        if (w[v] == 0)
+        {
+            for (k = 0; k < 3; ++k)
+                dst[3 * v + k] = src[3 * v + k];
+            continue;
+        }
+
+        c[0] = c[1] = c[2] = 0;
+        for (e = adj->vv_offsets[v]; e < adj->vv_offsets[v + 1]; ++e)
+            for (k = 0; k < 3; ++k)
+                c[k] += src[3 * adj->vv[e] + k];
+
+        for (k = 0; k < 3; ++k)
+            dst[3 * v + k] = src[3 * v + k]
+                + factor * (c[k] * w[v] - src[3 * v + k]);
+    }
+}
+
+/*!
+ * Copy the positions in a flat array, apply the steps swapping the roles
+ * of the two arrays, then copy the result back to the vertices. A vertex
+ * with more neighbours than faces is on the boundary, and it is kept fixed
+ * as well as a vertex without neighbours.
+ */
+int smooth_mesh(Model3D *m, int iterations, double lambda, double mu)
+{
+    const Adjacency *adj;
+    float *a, *b, *w, *tmp;
+    Point3D *p;
+    Index v, deg, n = m->n_vertices;
+    int i;
+    double start = profile_clock();
+
+    if (iterations < 0 || lambda <= 0 || lambda > 1 || mu < -1 || mu > 0)
+        return ERR_INVALID_ARGUMENT;
+
+    adj = model_adjacency(m);
+    if (adj == NULL)
+        return ERR_NO_MEMORY;
+
+    a = (float*) malloc(3 * n * sizeof (float));
+    b = (float*) malloc(3 * n * sizeof (float));
+    w = (float*) malloc(n * sizeof (float));
+    if (a == NULL || b == NULL || w == NULL)
+    {
+        free(a);
+        free(b);
+        free(w);
+        return ERR_NO_MEMORY;
+    }
+
+    #pragma omp parallel for schedule(static) private(p, deg)
+    for (v = 0; v < n; ++v)
+    {
+        p = &m->vertices_array[v]->vertexCoordinates;
+        a[3 * v] = p->x;
+        a[3 * v + 1] = p->y;
+        a[3 * v + 2] = p->z;
+
+        deg = adj->vv_offsets[v + 1] - adj->vv_offsets[v];
+        if (deg == 0 || deg > adj->vf_offsets[v + 1] - adj->vf_offsets[v])
+            w[v] = 0;
+        else
+            w[v] = 1.0f / deg;
+    }
+
+    for (i = 0; i < iterations; ++i)
+    {
+        smooth_step(adj, w, n, a, b, lambda);
+        tmp = a;
+        a = b;
+        b = tmp;
+
+        if (mu != 0)
+        {
+            smooth_step(adj, w, n, a, b, mu);
+            tmp = a;
+            a = b;
+            b = tmp;
+        }
+    }
+
+    #pragma omp parallel for schedule(static) private(p)
+    for (v = 0; v < n; ++v)
+    {
+        p = &m->vertices_array[v]->vertexCoordinates;
+        p->x = a[3 * v];
+        p->y = a[3 * v + 1];
+        p->z = a[3 * v + 2];
+    }
+
+    free(a);
+    free(b);
+    free(w);
+
+    profile_record(PROF_SMOOTH, start, n, m->n_faces);
+
+    model_info(m);
+
+    return compute_normals(m);
+}
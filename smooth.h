@@ -0,0 +1,64 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) Martino Pilia, 2015
+ */
+
+
+/*!
+ * \file smooth.h
+ */
+
+#ifndef SMOOTH_H
+#define SMOOTH_H
+
+#include "backend.h"
+
+/*! Maximum number of iterations asked by the front-end. */
+#define SMOOTH_MAX_ITERATIONS 1000
+
+/*! Shrinking factor of each smoothing step. */
+#define SMOOTH_LAMBDA 0.5
+
+/*!
+ * Inflating factor of the second step of each Taubin iteration, slightly
+ * larger than SMOOTH_LAMBDA in magnitude, so that the two steps together
+ * remove the noise without shrinking the model.
+ */
+#define SMOOTH_MU -0.53
+
+/*!
+ * \brief Smooth the surface of a model, moving each vertex towards the
+ * centroid of its neighbours.
+ *
+ * Each step moves every vertex by a factor times the umbrella Laplacian,
+ * the difference between the mean of its neighbours and its position.
+ * Laplacian smoothing applies one step with factor lambda per iteration,
+ * and Taubin smoothing follows it with a step with factor mu < 0, which
+ * compensates the shrinking. Positions are kept in two arrays, one read
+ * and one written by each step, so that the vertices are updated in
+ * parallel from the neighbour lists of the model connectivity.
+ * @param m Model to be smoothed.
+ * @param iterations Number of iterations.
+ * @param lambda Factor of the first step, in (0,1].
+ * @param mu Factor of the second step, in [-1,0]; zero for Laplacian
+ * smoothing.
+ * @return Zero on success, ERR_INVALID_ARGUMENT if a parameter is out of
+ * range, ERR_NO_MEMORY if an allocation failed.
+ * @note Boundary vertices are not moved, so that open models keep their
+ * outline. The model info and the vertex normals are recomputed.
+ */
+int smooth_mesh(Model3D *m, int iterations, double lambda, double mu);
+
+#endif // SMOOTH_H
@@ -0,0 +1,343 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) Martino Pilia, 2015
+ */
+
+
+/*!
+ * \file subdivide.c
+ */
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "adjacency.h"
+#include "normals.h"
+#include "profile.h"
+#include "subdivide.h"
+
+/*!
+ * Type for the edge numbering of a level. The edges of vertex v towards
+ * greater vertices are the neighbours vv[first[v]] ... vv[vv_offsets[v + 1]
+ * - 1], and they are numbered consecutively from offset[v].
+ */
+typedef struct EdgeTable
+{
+    Index *first;  /*!< First greater neighbour of each vertex. */
+    Index *offset; /*!< Number of the first edge of each vertex. */
+    Index n;       /*!< Number of edges. */
+} EdgeTable;
+
+/*!
+ * Return the position of u in the neighbours of v, or -1 if it is not a
+ * neighbour, with a binary search on the sorted list. With u = v, return
+ * the position of the first neighbour greater than v.
+ */
+static Index find_neighbour(const Adjacency *adj, Index v, Index u)
+{
+    Index lo = adj->vv_offsets[v], hi = adj->vv_offsets[v + 1], mid;
+
+    while (lo < hi)
+    {
+        mid = lo + (hi - lo) / 2;
+        if (adj->vv[mid] < u)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    if (u == v)
+        return lo;
+
+    return lo < adj->vv_offsets[v + 1] && adj->vv[lo] == u ? lo : -1;
+}
+
+/*!
+ * Return the number of the edge between a and b, or -1 if there is none.
+ */
+static Index edge_number(const Adjacency *adj, const EdgeTable *t, Index a,
+        Index b)
+{
+    Index e;
+
+    if (a > b)
+    {
+        e = a;
+        a = b;
+        b = e;
+    }
+
+    e = find_neighbour(adj, a, b);
+
+    return e < 0 ? -1 : t->offset[a] + e - t->first[a];
+}
+
+/*!
+ * Number the edges: each vertex counts its greater neighbours, and the
+ * counts are turned into offsets with a prefix sum.
+ */
+static int build_edges(const Adjacency *adj, Index n, EdgeTable *t)
+{
+    Index v;
+
+    t->first = (Index*) malloc(n * sizeof (Index));
+    t->offset = (Index*) malloc((n + 1) * sizeof (Index));
+    if (t->first == NULL || t->offset == NULL)
+        return ERR_NO_MEMORY;
+
+    t->offset[0] = 0;
+
+    #pragma omp parallel for schedule(static)
+    for (v = 0; v < n; ++v)
+    {
+        t->first[v] = find_neighbour(adj, v, v);
+        t->offset[v + 1] = adj->vv_offsets[v + 1] - t->first[v];
+    }
+
+    for (v = 0; v < n; ++v)
+        t->offset[v + 1] += t->offset[v];
+    t->n = t->offset[n];
+
+    return 0;
+}
+
+/*!
+ * Count the faces shared by the vertices a and b, merging their sorted
+ * face lists. The vertex of the first two faces opposite to the edge is
+ * stored in opposite.
+ */
+static int shared_faces(const Model3D *m, const Adjacency *adj, Index a,
+        Index b, Index opposite[2])
+{
+    Index i = adj->vf_offsets[a], j = adj->vf_offsets[b];
+    Index f;
+    int n = 0;
+
+    while (i < adj->vf_offsets[a + 1] && j < adj->vf_offsets[b + 1])
+    {
+        if (adj->vf[i] < adj->vf[j])
+            ++i;
+        else if (adj->vf[i] > adj->vf[j])
+            ++j;
+        else
+        {
+            f = adj->vf[i];
+            if (n < 2)
+                opposite[n] = face_vertex(m, f, 0) + face_vertex(m, f, 1)
+                    + face_vertex(m, f, 2) - a - b;
+            ++n;
+            ++i;
+            ++j;
+        }
+    }
+
+    return n;
+}
+
+/*!
+ * Compute the new position of an old vertex with the Loop scheme. An
+ * interior vertex with n neighbours is averaged with them with weight
+ * beta = 3 / (8 n) (3 / 16 for n = 3, Warren's weights). A boundary
+ * vertex is averaged with the two neighbours along the boundary with
+ * weight 1 / 8. Other vertices are not moved.
+ */
+static Point3D loop_vertex(const Model3D *m, const Adjacency *adj, Index v)
+{
+    Point3D p = m->vertices_array[v]->vertexCoordinates, q;
+    Index e, u, boundary[2], opposite[2];
+    Index n = adj->vv_offsets[v + 1] - adj->vv_offsets[v];
+    double s[3] = {0, 0, 0}, b[3] = {0, 0, 0}, beta;
+    int shared, n_boundary = 0, manifold = 1;
+
+    if (n == 0)
+        return p;
+
+    for (e = adj->vv_offsets[v]; e < adj->vv_offsets[v + 1]; ++e)
+    {
+        u = adj->vv[e];
+        q = m->vertices_array[u]->vertexCoordinates;
+        s[0] += q.x;
+        s[1] += q.y;
+        s[2] += q.z;
+
+        shared = shared_faces(m, adj, v, u, opposite);
+        if (shared == 1 && n_boundary < 2)
+            boundary[n_boundary] = u;
+        n_boundary += shared == 1;
+        manifold &= shared <= 2;
+    }
+
+    if (!manifold || (n_boundary != 0 && n_boundary != 2))
+        return p;
+
+    if (n_boundary == 2)
+    {
+        for (e = 0; e < 2; ++e)
+        {
+            q = m->vertices_array[boundary[e]]->vertexCoordinates;
+            b[0] += q.x;
+            b[1] += q.y;
+            b[2] += q.z;
+        }
+        q.x = 0.75 * p.x + 0.125 * b[0];
+        q.y = 0.75 * p.y + 0.125 * b[1];
+        q.z = 0.75 * p.z + 0.125 * b[2];
+        return q;
+    }
+
+    beta = n == 3 ? 3.0 / 16 : 3.0 / (8 * n);
+    q.x = (1 - n * beta) * p.x + beta * s[0];
+    q.y = (1 - n * beta) * p.y + beta * s[1];
+    q.z = (1 - n * beta) * p.z + beta * s[2];
+
+    return q;
+}
+
+/*!
+ * Compute the vertex added on the edge between a and b. With the Loop
+ * scheme, an edge shared by two faces gives weight 3 / 8 to its endpoints
+ * and 1 / 8 to the opposite vertices, any other edge is split at its
+ * midpoint, as with the midpoint scheme. The color is always the mean of
+ * the endpoint colors.
+ */
+static Vertex edge_vertex(const Model3D *m, const Adjacency *adj, Index a,
+        Index b, Subdivision scheme)
+{
+    const Vertex *va = m->vertices_array[a], *vb = m->vertices_array[b];
+    const Point3D *c, *d;
+    Index opposite[2];
+    Vertex r = *va;
+
+    r.vertexCoordinates.x = 0.5f * (va->vertexCoordinates.x
+            + vb->vertexCoordinates.x);
+    r.vertexCoordinates.y = 0.5f * (va->vertexCoordinates.y
+            + vb->vertexCoordinates.y);
+    r.vertexCoordinates.z = 0.5f * (va->vertexCoordinates.z
+            + vb->vertexCoordinates.z);
+    r.vertexColor.r = (va->vertexColor.r + vb->vertexColor.r + 1) / 2;
+    r.vertexColor.g = (va->vertexColor.g + vb->vertexColor.g + 1) / 2;
+    r.vertexColor.b = (va->vertexColor.b + vb->vertexColor.b + 1) / 2;
+
+    if (scheme == SUBDIVISION_LOOP
+            && shared_faces(m, adj, a, b, opposite) == 2)
+    {
+        c = &m->vertices_array[opposite[0]]->vertexCoordinates;
+        d = &m->vertices_array[opposite[1]]->vertexCoordinates;
+        r.vertexCoordinates.x = 0.75f * r.vertexCoordinates.x
+            + 0.125f * (c->x + d->x);
+        r.vertexCoordinates.y = 0.75f * r.vertexCoordinates.y
+            + 0.125f * (c->y + d->y);
+        r.vertexCoordinates.z = 0.75f * r.vertexCoordinates.z
+            + 0.125f * (c->z + d->z);
+    }
+
+    return r;
+}
+
+/*!
+ * Refine the model by one level. The old vertices keep their index, and
+ * the vertex of edge e has index V + e, so the output sizes are known from
+ * the edge numbering, and each vertex and face is written by one thread.
+ */
+static int subdivide_level(Model3D *m, Subdivision scheme)
+{
+    const Adjacency *adj;
+    EdgeTable t = {NULL, NULL, 0};
+    Vertex *vertices = NULL;
+    Index *faces = NULL;
+    Index V = m->n_vertices, F = m->n_faces;
+    Index v, f, e, c[3], mid[3];
+    int k, status = 0;
+
+    adj = model_adjacency(m);
+    if (adj == NULL || build_edges(adj, V, &t) != 0)
+        status = ERR_NO_MEMORY;
+
+    if (status == 0)
+    {
+        vertices = (Vertex*) malloc((V + t.n) * sizeof (Vertex));
+        faces = (Index*) malloc(12 * F * sizeof (Index));
+        if (vertices == NULL || faces == NULL)
+            status = ERR_NO_MEMORY;
+    }
+
+    if (status == 0)
+    {
+        #pragma omp parallel for schedule(dynamic, 1024) private(e)
+        for (v = 0; v < V; ++v)
+        {
+            vertices[v] = *m->vertices_array[v];
+            if (scheme == SUBDIVISION_LOOP)
+                vertices[v].vertexCoordinates = loop_vertex(m, adj, v);
+
+            for (e = t.first[v]; e < adj->vv_offsets[v + 1]; ++e)
+                vertices[V + t.offset[v] + e - t.first[v]] =
+                    edge_vertex(m, adj, v, adj->vv[e], scheme);
+        }
+
+        /* a degenerate edge, with a repeated vertex, is not split */
+        #pragma omp parallel for schedule(static) private(c, mid, k)
+        for (f = 0; f < F; ++f)
+        {
+            for (k = 0; k < 3; ++k)
+                c[k] = face_vertex(m, f, k);
+            for (k = 0; k < 3; ++k)
+                mid[k] = c[k] == c[(k + 1) % 3] ? c[k]
+                    : V + edge_number(adj, &t, c[k], c[(k + 1) % 3]);
+
+            for (k = 0; k < 3; ++k)
+            {
+                faces[12 * f + 3 * k] = c[k];
+                faces[12 * f + 3 * k + 1] = mid[k];
+                faces[12 * f + 3 * k + 2] = mid[(k + 2) % 3];
+            }
+            for (k = 0; k < 3; ++k)
+                faces[12 * f + 9 + k] = mid[k];
+        }
+
+        status = model_replace(m, vertices, V + t.n, faces, 4 * F);
+    }
+
+    free(t.first);
+    free(t.offset);
+    free(vertices);
+    free(faces);
+
+    return status;
+}
+
+/*!
+ * Apply the levels one after the other, then recompute the normals.
+ */
+int subdivide_mesh(Model3D *m, int levels, Subdivision scheme)
+{
+    Index V = m->n_vertices, F = m->n_faces;
+    double start = profile_clock();
+    int i, status = 0;
+
+    if (levels < 0 || (scheme != SUBDIVISION_MIDPOINT
+                && scheme != SUBDIVISION_LOOP))
+        return ERR_INVALID_ARGUMENT;
+
+    for (i = 0; i < levels && status == 0; ++i)
+        status = subdivide_level(m, scheme);
+
+    if (status == 0 && levels > 0)
+        status = compute_normals(m);
+
+    profile_record(PROF_SUBDIVIDE, start, V, F);
+
+    return status;
+}
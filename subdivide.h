@@ -0,0 +1,65 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) Martino Pilia, 2015
+ */
+
+
+/*!
+ * \file subdivide.h
+ */
+
+#ifndef SUBDIVIDE_H
+#define SUBDIVIDE_H
+
+#include "backend.h"
+
+/*! Maximum number of levels asked by the front-end. */
+#define SUBDIVIDE_MAX_LEVELS 6
+
+/*!
+ * Type for the subdivision scheme.
+ */
+typedef enum Subdivision
+{
+    SUBDIVISION_MIDPOINT = 1, /*!< Split the edges at their midpoint. */
+    SUBDIVISION_LOOP = 2      /*!< Loop's approximating scheme. */
+} Subdivision;
+
+/*!
+ * \brief Refine a model, splitting each face in four.
+ *
+ * At each level a new vertex is added on each edge, and each face is
+ * replaced by the three faces at its corners and the one between the new
+ * vertices. The midpoint scheme keeps the shape of the model, while the
+ * Loop scheme moves both the old and the new vertices, converging to a
+ * smooth surface. Edges are numbered from the connectivity of the model,
+ * so that the size of the output is known before it is filled, and all
+ * the vertices and faces are computed in parallel.
+ * @param m Model to be refined.
+ * @param levels Number of levels, the number of faces is multiplied by four
+ * at each of them.
+ * @param scheme Subdivision scheme.
+ * @return Zero on success, ERR_INVALID_ARGUMENT if a parameter is out of
+ * range, ERR_NO_MEMORY if an allocation failed, in which case the model is
+ * left at the last level completed.
+ * @note The color of each new vertex is the mean of the colors of the edge
+ * endpoints. With the Loop scheme, the vertices on the boundary follow the
+ * boundary curve, while the vertices on a non-manifold edge are not moved.
+ * The vertex normals are recomputed, and the model lists are rebuilt, so
+ * pointers to the old vertices and faces are no longer valid.
+ */
+int subdivide_mesh(Model3D *m, int levels, Subdivision scheme);
+
+#endif // SUBDIVIDE_H
@@ -0,0 +1,191 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) Martino Pilia, 2015
+ */
+
+/*!
+ * \file trace.c
+ */
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "profile.h"
+#include "trace.h"
+
+/*!
+ * A recorded call, stored as a Chrome "complete" event (begin and end in
+ * the same record).
+ */
+typedef struct TraceEvent
+{
+    const char *name; /*!< Name of the call. */
+    double start;     /*!< Begin time, from profile_clock(). */
+    double end;       /*!< End time, from profile_clock(). */
+} TraceEvent;
+
+/*! Define a type for the event buffer owned by a thread. */
+typedef struct TraceBuffer TraceBuffer;
+
+/*!
+ * Event buffer owned by a thread. Only the owner writes the events, and it
+ * publishes each of them by incrementing count with release semantics, so
+ * the writer of the trace never sees an incomplete event. Buffers are
+ * chained in a global list, where they are pushed with a compare-and-swap.
+ */
+struct TraceBuffer
+{
+    int tid;                                 /*!< Thread number. */
+    unsigned calls;                          /*!< Calls seen, for sampling. */
+    atomic_int count;                        /*!< Events published. */
+    TraceBuffer *next;                       /*!< Next buffer in the list. */
+    TraceEvent events[TRACE_BUFFER_EVENTS];  /*!< Recorded events. */
+};
+
+static atomic_int sampling_rate = 0;
+static double trace_origin;
+static _Atomic(TraceBuffer*) buffers = NULL;
+static atomic_int next_tid = 1;
+static atomic_llong dropped = 0;
+
+/*! Buffer of the calling thread, allocated at its first event. */
+static _Thread_local TraceBuffer *local_buffer = NULL;
+
+/*!
+ * Set the sampling rate and take the time origin of the trace.
+ */
+void trace_enable(int sampling)
+{
+    trace_origin = profile_clock();
+    atomic_store(&sampling_rate, sampling > 0 ? sampling : 0);
+}
+
+/*!
+ * Tracing is enabled when the sampling rate is positive.
+ */
+int trace_enabled(void)
+{
+    return atomic_load_explicit(&sampling_rate, memory_order_relaxed) > 0;
+}
+
+/*!
+ * Allocate the buffer for the calling thread and push it on the global
+ * list. Return NULL if the allocation fails.
+ */
+static TraceBuffer* buffer_create(void)
+{
+    TraceBuffer *b = (TraceBuffer*) malloc(sizeof (TraceBuffer));
+
+    if (b == NULL)
+        return NULL;
+
+    b->tid = atomic_fetch_add(&next_tid, 1);
+    b->calls = 0;
+    atomic_init(&b->count, 0);
+
+    b->next = atomic_load(&buffers);
+    while (!atomic_compare_exchange_weak(&buffers, &b->next, b))
+        ;
+
+    return b;
+}
+
+/*!
+ * Store an event in the buffer of the calling thread, if the call is
+ * sampled. No locks are taken: each thread writes only on its own buffer.
+ */
+void trace_record(const char *name, double start, double end)
+{
+    int rate = atomic_load_explicit(&sampling_rate, memory_order_relaxed);
+    TraceBuffer *b = local_buffer;
+    int n;
+
+    if (rate <= 0)
+        return;
+
+    if (b == NULL && (b = local_buffer = buffer_create()) == NULL)
+    {
+        atomic_fetch_add_explicit(&dropped, 1, memory_order_relaxed);
+        return;
+    }
+
+    if (b->calls++ % rate != 0)
+        return; /* not sampled */
+
+    n = atomic_load_explicit(&b->count, memory_order_relaxed);
+    if (n >= TRACE_BUFFER_EVENTS)
+    {
+        atomic_fetch_add_explicit(&dropped, 1, memory_order_relaxed);
+        return;
+    }
+
+    b->events[n].name = name;
+    b->events[n].start = start;
+    b->events[n].end = end;
+    atomic_store_explicit(&b->count, n + 1, memory_order_release);
+}
+
+/*!
+ * Return the number of events lost because a thread buffer was full.
+ */
+long long trace_dropped(void)
+{
+    return atomic_load(&dropped);
+}
+
+/*!
+ * Write a JSON object with a traceEvents array, containing a thread name
+ * metadata event and the complete events for each thread. Times are
+ * converted to microseconds from the moment tracing was enabled.
+ */
+int trace_write_json(const char *path)
+{
+    TraceBuffer *b;
+    int i, n, first = 1;
+    FILE *out = fopen(path, "w");
+
+    if (out == NULL)
+        return 1;
+
+    fprintf(out, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [");
+
+    for (b = atomic_load(&buffers); b != NULL; b = b->next)
+    {
+        fprintf(out,
+                "%s\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, "
+                "\"tid\": %d, \"args\": {\"name\": \"thread %d\"}}",
+                first ? "" : ",",
+                b->tid,
+                b->tid);
+        first = 0;
+
+        n = atomic_load_explicit(&b->count, memory_order_acquire);
+        for (i = 0; i < n; ++i)
+            fprintf(out,
+                    ",\n{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, "
+                    "\"tid\": %d, \"ts\": %.3f, \"dur\": %.3f}",
+                    b->events[i].name,
+                    b->tid,
+                    (b->events[i].start - trace_origin) * 1e6,
+                    (b->events[i].end - b->events[i].start) * 1e6);
+    }
+
+    fprintf(out,
+            "\n], \"otherData\": {\"dropped_events\": %lld}}\n",
+            trace_dropped());
+
+    return fclose(out) != 0;
+}
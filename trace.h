@@ -0,0 +1,72 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) Martino Pilia, 2015
+ */
+
+/*!
+ * \file trace.h
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+/*!
+ * Maximum number of events stored for each thread. Events recorded by a
+ * thread after its buffer is full are dropped (and counted).
+ */
+#define TRACE_BUFFER_EVENTS 65536
+
+/*!
+ * \brief Enable or disable the recording of trace events.
+ * @param sampling Record one call out of sampling for each thread; a
+ * value of one records every call, zero or a negative value disables
+ * tracing.
+ * @note Tracing is disabled by default.
+ */
+void trace_enable(int sampling);
+
+/*!
+ * \brief Check if tracing is enabled.
+ * @return Nonzero if trace events are being recorded.
+ */
+int trace_enabled(void);
+
+/*!
+ * \brief Record the execution of a backend call in the buffer of the
+ * calling thread.
+ * @param name Name of the call. It must be a string literal, or anyway
+ * a string living until the trace is written.
+ * @param start Value of profile_clock() when the call started.
+ * @param end Value of profile_clock() when the call ended.
+ * @note The procedure is lock-free, and it may be called concurrently
+ * from any number of threads.
+ */
+void trace_record(const char *name, double start, double end);
+
+/*!
+ * \brief Get the number of events dropped because of full buffers.
+ * @return Number of dropped events.
+ */
+long long trace_dropped(void);
+
+/*!
+ * \brief Write the recorded events in the Chrome trace-event JSON format,
+ * viewable with chrome://tracing or Perfetto.
+ * @param path Name of the output file.
+ * @return Zero on success, nonzero if the file cannot be written.
+ */
+int trace_write_json(const char *path);
+
+#endif // TRACE_H
@@ -0,0 +1,253 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) Martino Pilia, 2015
+ */
+
+/*!
+ * \file vcache.c
+ */
+
+#include <stdlib.h>
+
+#include "adjacency.h"
+#include "profile.h"
+#include "vcache.h"
+
+/*!
+ * Take the next fanning vertex from the dead-end stack, whose vertices
+ * were recently used, or else from the cursor scanning all the vertices in
+ * order. Return -1 when no vertex has faces left.
+ */
+static Index skip_dead_end(const Index *live, const Index *dead, Index *n_dead,
+        Index *cursor, Index n_vertices)
+{
+    Index v;
+
+    while (*n_dead > 0)
+    {
+        v = dead[--*n_dead];
+        if (live[v] > 0)
+            return v;
+    }
+
+    while (*cursor < n_vertices)
+    {
+        v = (*cursor)++;
+        if (live[v] > 0)
+            return v;
+    }
+
+    return -1;
+}
+
+/*!
+ * Tipsify. The cache is simulated with a time stamp for each vertex, which
+ * is in the cache if less than cache_size misses happened after it was
+ * loaded. After emitting the faces around the fanning vertex, the next one
+ * is the candidate which will stay in the cache long enough to emit all
+ * its remaining faces and was loaded the earliest; if there is none, a
+ * recently used vertex is taken from the dead-end stack.
+ */
+static int tipsify(Model3D *m, const Adjacency *adj, int cache_size,
+        Index *face_order)
+{
+    Index V = m->n_vertices, F = m->n_faces;
+    Index *live, *stamp, *dead, *cand;
+    unsigned char *emitted;
+    Index v, f, e, u, best, n_dead = 0, n_cand, cursor = 0, n_out = 0;
+    Index time, priority, best_priority, max_degree = 0;
+    int k;
+
+    for (v = 0; v < V; ++v)
+        if (adj->vf_offsets[v + 1] - adj->vf_offsets[v] > max_degree)
+            max_degree = adj->vf_offsets[v + 1] - adj->vf_offsets[v];
+
+    live = (Index*) malloc((V + 1) * sizeof (Index));
+    stamp = (Index*) calloc(V + 1, sizeof (Index));
+    dead = (Index*) malloc((3 * F + 1) * sizeof (Index));
+    cand = (Index*) malloc((3 * max_degree + 1) * sizeof (Index));
+    emitted = (unsigned char*) calloc(F + 1, 1);
+
+    if (live == NULL || stamp == NULL || dead == NULL || cand == NULL
+            || emitted == NULL)
+    {
+        free(live);
+        free(stamp);
+        free(dead);
+        free(cand);
+        free(emitted);
+        return ERR_NO_MEMORY;
+    }
+
+    for (v = 0; v < V; ++v)
+        live[v] = adj->vf_offsets[v + 1] - adj->vf_offsets[v];
+
+    time = cache_size + 1;
+    v = skip_dead_end(live, dead, &n_dead, &cursor, V);
+    while (v != -1)
+    {
+        /* emit the faces around v, collecting their vertices */
+        n_cand = 0;
+        for (e = adj->vf_offsets[v]; e < adj->vf_offsets[v + 1]; ++e)
+        {
+            f = adj->vf[e];
+            if (emitted[f])
+                continue;
+            emitted[f] = 1;
+            face_order[n_out++] = f;
+
+            for (k = 0; k < 3; ++k)
+            {
+                u = face_vertex(m, f, k);
+                dead[n_dead++] = u;
+                cand[n_cand++] = u;
+                --live[u];
+                if (time - stamp[u] > cache_size)
+                    stamp[u] = time++;
+            }
+        }
+
+        /* choose the next fanning vertex among the candidates */
+        best = -1;
+        best_priority = -1;
+        for (e = 0; e < n_cand; ++e)
+        {
+            u = cand[e];
+            if (live[u] <= 0)
+                continue;
+            priority = 0;
+            if (time - stamp[u] + 2 * live[u] <= cache_size)
+                priority = time - stamp[u];
+            if (priority > best_priority)
+            {
+                best_priority = priority;
+                best = u;
+            }
+        }
+
+        v = best != -1 ? best : skip_dead_end(live, dead, &n_dead, &cursor, V);
+    }
+
+    free(live);
+    free(stamp);
+    free(dead);
+    free(cand);
+    free(emitted);
+
+    return 0;
+}
+
+/*!
+ * Order the faces with Tipsify, then number the vertices by first use and
+ * rebuild the model in the new order.
+ */
+int optimize_vertex_cache(Model3D *m, int cache_size)
+{
+    const Adjacency *adj;
+    Index V = m->n_vertices, F = m->n_faces;
+    Index *face_order, *map, *faces, v, f, n = 0;
+    Vertex *vertices;
+    double start = profile_clock();
+    int k, status;
+
+    if (cache_size <= 0)
+        return ERR_INVALID_ARGUMENT;
+
+    if (model_build_indices(m) != 0 || (adj = model_adjacency(m)) == NULL)
+        return ERR_NO_MEMORY;
+
+    face_order = (Index*) malloc((F + 1) * sizeof (Index));
+    map = (Index*) malloc((V + 1) * sizeof (Index));
+    faces = (Index*) malloc((3 * F + 1) * sizeof (Index));
+    vertices = (Vertex*) malloc((V + 1) * sizeof (Vertex));
+
+    if (face_order == NULL || map == NULL || faces == NULL
+            || vertices == NULL)
+        status = ERR_NO_MEMORY;
+    else
+        status = tipsify(m, adj, cache_size, face_order);
+
+    if (status == 0)
+    {
+        for (v = 0; v < V; ++v)
+            map[v] = -1;
+
+        for (f = 0; f < F; ++f)
+        {
+            for (k = 0; k < 3; ++k)
+            {
+                v = face_vertex(m, face_order[f], k);
+                if (map[v] == -1)
+                    map[v] = n++;
+                faces[3 * f + k] = map[v];
+            }
+        }
+
+        for (v = 0; v < V; ++v)
+            if (map[v] == -1)
+                map[v] = n++;
+
+        #pragma omp parallel for schedule(static)
+        for (v = 0; v < V; ++v)
+            vertices[map[v]] = *m->vertices_array[v];
+
+        status = model_replace(m, vertices, V, faces, F);
+    }
+
+    free(face_order);
+    free(map);
+    free(faces);
+    free(vertices);
+
+    profile_record(PROF_VCACHE, start, V, F);
+
+    return status;
+}
+
+/*!
+ * Simulate a FIFO cache with the same time stamps used by Tipsify.
+ */
+double vertex_cache_acmr(Model3D *m, int cache_size)
+{
+    Index *stamp, f, v, time, misses = 0;
+    int k;
+
+    if (m->n_faces == 0)
+        return 0;
+    if (model_build_indices(m) != 0)
+        return -1;
+
+    stamp = (Index*) calloc(m->n_vertices + 1, sizeof (Index));
+    if (stamp == NULL)
+        return -1;
+
+    time = cache_size + 1;
+    for (f = 0; f < m->n_faces; ++f)
+    {
+        for (k = 0; k < 3; ++k)
+        {
+            v = face_vertex(m, f, k);
+            if (time - stamp[v] > cache_size)
+            {
+                stamp[v] = time++;
+                ++misses;
+            }
+        }
+    }
+
+    free(stamp);
+
+    return (double) misses / m->n_faces;
+}
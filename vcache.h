@@ -0,0 +1,63 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) Martino Pilia, 2015
+ */
+
+/*!
+ * \file vcache.h
+ */
+
+#ifndef VCACHE_H
+#define VCACHE_H
+
+#include "backend.h"
+
+/*!
+ * Size of the post-transform vertex cache assumed when the caller has no
+ * better estimate for the target hardware.
+ */
+#define VCACHE_SIZE 16
+
+/*!
+ * \brief Reorder the faces of a model to reduce the post-transform vertex
+ * cache misses of a GPU, then the vertices in order of first use.
+ *
+ * Faces are ordered with the Tipsify algorithm (Sander, Nehab, Barczak,
+ * 2007), which fans around each vertex and moves to a neighbour still in
+ * the cache, in time linear in the number of faces. Vertices are then
+ * renumbered in the order in which the faces reference them, so the
+ * vertex fetches are almost sequential as well; vertices used by no face
+ * are kept at the end.
+ * @param m Model to be reordered.
+ * @param cache_size Number of vertices held by the cache.
+ * @return Zero on success, ERR_INVALID_ARGUMENT if the cache size is not
+ * positive, ERR_NO_MEMORY if an allocation failed.
+ * @note The model lists are rebuilt, so pointers to the old vertices and
+ * faces are no longer valid. Saving the model afterwards writes the new
+ * order.
+ */
+int optimize_vertex_cache(Model3D *m, int cache_size);
+
+/*!
+ * \brief Compute the average cache miss ratio of the faces of a model.
+ * @param m Model.
+ * @param cache_size Number of vertices held by a simulated FIFO cache.
+ * @return Number of cache misses divided by the number of faces, between
+ * 0.5 for an ideal order on large meshes and 3, or a negative value if an
+ * allocation failed.
+ */
+double vertex_cache_acmr(Model3D *m, int cache_size);
+
+#endif // VCACHE_H
@@ -0,0 +1,237 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) Martino Pilia, 2015
+ */
+
+/*!
+ * \file weld.c
+ */
+
+#include <math.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "profile.h"
+#include "weld.h"
+
+/*!
+ * Type for the key of a vertex, made of the coordinates of its grid cell.
+ */
+typedef struct CellKey
+{
+    long long k[3]; /*!< Cell coordinates, or raw bits of the position. */
+} CellKey;
+
+/*!
+ * Compute the cell of a point. With no tolerance the key is the bit
+ * pattern of the coordinates, with -0 taken as 0.
+ */
+static CellKey cell_key(Point3D p, double tolerance)
+{
+    CellKey c;
+    float x[3] = {p.x, p.y, p.z};
+    int32_t bits;
+    int i;
+
+    for (i = 0; i < 3; ++i)
+    {
+        if (tolerance > 0)
+            c.k[i] = llround(x[i] / tolerance);
+        else
+        {
+            if (x[i] == 0)
+                x[i] = 0;
+            memcpy(&bits, &x[i], sizeof (bits));
+            c.k[i] = bits;
+        }
+    }
+
+    return c;
+}
+
+/*!
+ * Hash a cell key, mixing the three coordinates so that neighbouring cells
+ * are spread over the table.
+ */
+static uint64_t cell_hash(const CellKey *c)
+{
+    uint64_t h = (uint64_t) c->k[0] * 0x9E3779B97F4A7C15ull
+        ^ (uint64_t) c->k[1] * 0xC2B2AE3D27D4EB4Full
+        ^ (uint64_t) c->k[2] * 0x165667B19E3779F9ull;
+
+    h ^= h >> 29;
+    h *= 0xBF58476D1CE4E5B9ull;
+    h ^= h >> 32;
+
+    return h;
+}
+
+/*!
+ * Tell if two cell keys are equal.
+ */
+static int same_cell(const CellKey *a, const CellKey *b)
+{
+    return a->k[0] == b->k[0] && a->k[1] == b->k[1] && a->k[2] == b->k[2];
+}
+
+/*!
+ * The vertices are inserted concurrently in an open addressing hash table,
+ * where each slot holds a vertex index and is claimed with a compare and
+ * swap. When a vertex finds its cell already in the table, the slot is
+ * lowered to the minimum of the two indices, so the representative of each
+ * cell does not depend on the order of the threads. A second parallel pass
+ * looks up the representative of each vertex, then the faces are rewritten
+ * and the model is rebuilt with the referenced representatives only.
+ */
+int weld_vertices(Model3D *m, double tolerance, Index *merged)
+{
+    CellKey *keys;
+    atomic_llong *table;
+    Index *rep, *map, *faces;
+    unsigned char *used;
+    Vertex *vertices;
+    Index V = m->n_vertices, F = m->n_faces;
+    Index size, mask, v, f, h, cur, n_vertices = 0, n_faces = 0;
+    double start = profile_clock();
+    int k, status;
+
+    if (tolerance < 0)
+        return ERR_INVALID_ARGUMENT;
+
+    if (model_build_indices(m) != 0)
+        return ERR_NO_MEMORY;
+
+    for (size = 16; size < 2 * V; size *= 2)
+        ;
+    mask = size - 1;
+
+    keys = (CellKey*) malloc((V + 1) * sizeof (CellKey));
+    table = (atomic_llong*) malloc(size * sizeof (atomic_llong));
+    rep = (Index*) malloc((V + 1) * sizeof (Index));
+    map = (Index*) malloc((V + 1) * sizeof (Index));
+    used = (unsigned char*) calloc(V + 1, 1);
+    faces = (Index*) malloc((3 * F + 1) * sizeof (Index));
+
+    if (keys == NULL || table == NULL || rep == NULL || map == NULL
+            || used == NULL || faces == NULL)
+    {
+        free(keys);
+        free(table);
+        free(rep);
+        free(map);
+        free(used);
+        free(faces);
+        return ERR_NO_MEMORY;
+    }
+
+    #pragma omp parallel for schedule(static)
+    for (h = 0; h < size; ++h)
+        atomic_init(&table[h], -1);
+
+    #pragma omp parallel for schedule(static) private(h, cur)
+    for (v = 0; v < V; ++v)
+    {
+        keys[v] = cell_key(m->vertices_array[v]->vertexCoordinates, tolerance);
+
+        h = cell_hash(&keys[v]) & mask;
+        cur = -1;
+        while (!atomic_compare_exchange_strong(&table[h], &cur, v))
+        {
+            /* the slot is taken by vertex cur, whose key is already
+             * written, since it was written before claiming the slot */
+            if (same_cell(&keys[cur], &keys[v]))
+            {
+                while (v < cur
+                        && !atomic_compare_exchange_weak(&table[h], &cur, v))
+                    ;
+                break;
+            }
+            h = (h + 1) & mask;
+            cur = -1;
+        }
+    }
+
+    #pragma omp parallel for schedule(static) private(h)
+    for (v = 0; v < V; ++v)
+    {
+        h = cell_hash(&keys[v]) & mask;
+        while (!same_cell(&keys[atomic_load(&table[h])], &keys[v]))
+            h = (h + 1) & mask;
+        rep[v] = atomic_load(&table[h]);
+    }
+
+    /* rewrite the faces on the representatives, marking the degenerate
+     * ones with -1 and the used vertices */
+    #pragma omp parallel for schedule(static) private(k)
+    for (f = 0; f < F; ++f)
+    {
+        for (k = 0; k < 3; ++k)
+            faces[3 * f + k] = rep[face_vertex(m, f, k)];
+
+        if (faces[3 * f] == faces[3 * f + 1]
+                || faces[3 * f + 1] == faces[3 * f + 2]
+                || faces[3 * f + 2] == faces[3 * f])
+            faces[3 * f] = -1;
+        else
+        {
+            for (k = 0; k < 3; ++k)
+            {
+                #pragma omp atomic write
+                used[faces[3 * f + k]] = 1;
+            }
+        }
+    }
+
+    for (v = 0; v < V; ++v)
+        map[v] = used[v] ? n_vertices++ : -1;
+
+    for (f = 0; f < F; ++f)
+    {
+        if (faces[3 * f] == -1)
+            continue;
+        for (k = 0; k < 3; ++k)
+            faces[3 * n_faces + k] = map[faces[3 * f + k]];
+        ++n_faces;
+    }
+
+    vertices = (Vertex*) malloc((n_vertices + 1) * sizeof (Vertex));
+    if (vertices == NULL)
+        status = ERR_NO_MEMORY;
+    else
+    {
+        #pragma omp parallel for schedule(static)
+        for (v = 0; v < V; ++v)
+            if (map[v] != -1)
+                vertices[map[v]] = *m->vertices_array[v];
+
+        if (merged != NULL)
+            *merged = V - n_vertices;
+
+        status = model_replace(m, vertices, n_vertices, faces, n_faces);
+    }
+
+    free(keys);
+    free(table);
+    free(rep);
+    free(map);
+    free(used);
+    free(faces);
+    free(vertices);
+
+    profile_record(PROF_WELD, start, V, F);
+
+    return status;
+}
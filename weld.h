@@ -0,0 +1,48 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) Martino Pilia, 2015
+ */
+
+/*!
+ * \file weld.h
+ */
+
+#ifndef WELD_H
+#define WELD_H
+
+#include "backend.h"
+
+/*!
+ * \brief Merge the vertices of a model which share the same position, up to
+ * a tolerance.
+ *
+ * Positions are rounded to a grid with the tolerance as step, and vertices
+ * falling in the same cell are merged into the one with the lowest index,
+ * whose normal and color are kept. Faces are rewritten on the merged
+ * vertices, faces left with a repeated vertex are dropped, and vertices not
+ * referenced by any face are removed.
+ * @param m Model to be welded.
+ * @param tolerance Step of the grid; zero merges only vertices with exactly
+ * the same coordinates.
+ * @param merged If not NULL, filled with the number of vertices removed.
+ * @return Zero on success, ERR_INVALID_ARGUMENT if the tolerance is
+ * negative, ERR_NO_MEMORY if an allocation failed.
+ * @note Two points closer than the tolerance but on opposite sides of a
+ * cell boundary are not merged. The model lists are rebuilt, so pointers
+ * to the old vertices and faces are no longer valid.
+ */
+int weld_vertices(Model3D *m, double tolerance, Index *merged);
+
+#endif // WELD_H